@@ -0,0 +1,728 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Throughput benchmark source
+ *
+ * Benchmark generates synthetic syslog file and measures throughput
+ * of each conversion stage separately:
+ *   - reading lines from the input;
+ *   - parsing entries by syslog_entry_parse();
+ *   - output of the parsed entries by each output format
+ *     (into the memory buffer).
+ *
+ * Each stage is repeated several times and the best time is reported.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <syslog_fc.h>
+#include <syslog_input.h>
+#include <syslog_gen.h>
+
+#include <fmt_avail.h>
+#include <fmt_plain.h>
+
+/** @brief Memory output size to discard collected data at */
+#define BENCH_OUTPUT_DISCARD_SIZE  (4 * 1024 * 1024)
+
+/**
+ * @brief Global configuration structure
+ */
+config_t config =
+{
+	.output_fmt        = &fmt_plain,
+	.entry_spec        = "%T %F.%P %G: %_M",
+	.ts_parse_spec     = "%a %b %d %H:%M:%S %Y",
+	.ts_output_spec    = "",
+	.csv_delimeter     = ",",
+	.html_class_prefix = "syslog-",
+	.threads           = 1,
+};
+
+/**
+ * @brief Generator configuration
+ */
+static syslog_gen_config_t gen_config =
+{
+	.seed             = 1,
+	.size             = 64 * 1024 * 1024,
+	.msg_min          = 16,
+	.msg_max          = 256,
+	.msg_dist         = SYSLOG_GEN_DIST_EXPONENTIAL,
+	.mix              = SYSLOG_GEN_MIX_REALISTIC,
+	.escape_density   = 0.01,
+	.numeric_priority = 0.0,
+	.invalid          = 0.0,
+};
+
+/**
+ * @brief Benchmark options
+ */
+static struct
+{
+	const char *input_filename;  /**< Existing input file (no generation) */
+	const char *keep_filename;   /**< File to keep the generated data in */
+	const char *json_filename;   /**< File to write JSON results to */
+	unsigned int repeat;         /**< Number of repetitions */
+} bench =
+{
+	.repeat = 3,
+};
+
+/**
+ * @brief Stage measurement results
+ */
+typedef struct bench_stage
+{
+	const char *name;    /**< Stage name */
+	double seconds;      /**< Best time */
+	size_t out_bytes;    /**< Output size (format stages only) */
+} bench_stage_t;
+
+/** @brief Number of the non-format stages */
+#define BENCH_BASE_STAGES  2
+
+/** @brief Stage results (read, parse and all formats) */
+static bench_stage_t stages[BENCH_BASE_STAGES + ARRAY_SIZE(fmt_avail) - 1];
+
+/**
+ * @brief Short command line options list
+ */
+static const char *opts_str = "hn:S:m:D:M:E:N:V:e:p:i:k:r:j:";
+
+/**
+ * @brief Long command line options list
+ */
+static const struct option opts[] =
+{
+	{ .name = "help",             .val = 'h' },
+	{ .name = "size",             .val = 'n', .has_arg = 1 },
+	{ .name = "seed",             .val = 'S', .has_arg = 1 },
+	{ .name = "msg-len",          .val = 'm', .has_arg = 1 },
+	{ .name = "msg-dist",         .val = 'D', .has_arg = 1 },
+	{ .name = "mix",              .val = 'M', .has_arg = 1 },
+	{ .name = "escape-density",   .val = 'E', .has_arg = 1 },
+	{ .name = "numeric-priority", .val = 'N', .has_arg = 1 },
+	{ .name = "invalid",          .val = 'V', .has_arg = 1 },
+	{ .name = "entry-spec",       .val = 'e', .has_arg = 1 },
+	{ .name = "ts-parse-spec",    .val = 'p', .has_arg = 1 },
+	{ .name = "input",            .val = 'i', .has_arg = 1 },
+	{ .name = "keep",             .val = 'k', .has_arg = 1 },
+	{ .name = "repeat",           .val = 'r', .has_arg = 1 },
+	{ .name = "json",             .val = 'j', .has_arg = 1 },
+	{ 0 }
+};
+
+/**
+ * Display benchmark usage help
+ */
+static void display_usage(void)
+{
+	fprintf(stdout,
+		"\n"
+		"Syslog File Converter benchmark version " SYSLOG_FC_VERSION "\n"
+		"\n"
+		"Usage: syslog_fc_bench [options]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help                   Show this help text.\n"
+		"  -n, --size <MiB>             Generated data size (default: %zu).\n"
+		"  -S, --seed <N>               Generator seed (default: %lu).\n"
+		"  -m, --msg-len <min>:<max>    Message length (default: %u:%u).\n"
+		"  -D, --msg-dist <uniform|exp> Message length distribution.\n"
+		"  -M, --mix <uniform|real>     Facility and priority mix.\n"
+		"  -E, --escape-density <f>     Fraction of the message characters\n"
+		"                               that need escaping (default: %g).\n"
+		"  -N, --numeric-priority <f>   Fraction of numeric priorities.\n"
+		"  -V, --invalid <f>            Fraction of invalid entries.\n"
+		"  -e, --entry-spec <spec>      Entry specification (default: \"%s\").\n"
+		"  -p, --ts-parse-spec <format> Timestamp format (default: \"%s\").\n"
+		"  -i, --input <file>           Benchmark existing file instead\n"
+		"                               of the generated data.\n"
+		"  -k, --keep <file>            Keep generated data in the file.\n"
+		"  -r, --repeat <N>             Number of repetitions (default: %u).\n"
+		"  -j, --json <file>            Write results in JSON to the file.\n"
+		"\n",
+		gen_config.size / (1024 * 1024),
+		gen_config.seed,
+		gen_config.msg_min, gen_config.msg_max,
+		gen_config.escape_density,
+		config.entry_spec,
+		config.ts_parse_spec,
+		bench.repeat
+	);
+}
+
+/**
+ * Parse fraction argument
+ *
+ * @param[in]  arg    Argument string.
+ * @param[out] value  Parsed value.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int cli_fraction(const char *arg, double *value)
+{
+	char *end;
+
+	*value = strtod(arg, &end);
+
+	if (*end || (*value < 0.0) || (*value > 1.0))
+	{
+		fprintf(stderr, "invalid fraction '%s'\n", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse command line arguments
+ *
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Array of the pointers to the arguments
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int cli_args(int argc, char *argv[])
+{
+	int opt;
+
+	while((opt = getopt_long(argc, argv, opts_str, opts, NULL)) != EOF)
+	{
+		switch(opt)
+		{
+			case 'h': /* --help */
+				display_usage();
+				exit(0);
+
+			case 'n': /* --size */
+				gen_config.size = strtoul(optarg, NULL, 10) * 1024 * 1024;
+				break;
+
+			case 'S': /* --seed */
+				gen_config.seed = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'm': /* --msg-len */
+			{
+				if ((sscanf(optarg, "%u:%u", &gen_config.msg_min,
+					&gen_config.msg_max) != 2) ||
+				    (gen_config.msg_min > gen_config.msg_max))
+				{
+					fprintf(stderr, "%s: invalid message length '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				break;
+			}
+
+			case 'D': /* --msg-dist */
+			{
+				if (!strcmp(optarg, "uniform"))
+					gen_config.msg_dist = SYSLOG_GEN_DIST_UNIFORM;
+				else if (!strcmp(optarg, "exp"))
+					gen_config.msg_dist = SYSLOG_GEN_DIST_EXPONENTIAL;
+				else
+				{
+					fprintf(stderr, "%s: invalid distribution '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				break;
+			}
+
+			case 'M': /* --mix */
+			{
+				if (!strcmp(optarg, "uniform"))
+					gen_config.mix = SYSLOG_GEN_MIX_UNIFORM;
+				else if (!strcmp(optarg, "real"))
+					gen_config.mix = SYSLOG_GEN_MIX_REALISTIC;
+				else
+				{
+					fprintf(stderr, "%s: invalid mix '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				break;
+			}
+
+			case 'E': /* --escape-density */
+				if (cli_fraction(optarg, &gen_config.escape_density))
+					return -EINVAL;
+
+				break;
+
+			case 'N': /* --numeric-priority */
+				if (cli_fraction(optarg, &gen_config.numeric_priority))
+					return -EINVAL;
+
+				break;
+
+			case 'V': /* --invalid */
+				if (cli_fraction(optarg, &gen_config.invalid))
+					return -EINVAL;
+
+				break;
+
+			case 'e': /* --entry-spec */
+				config.entry_spec = optarg;
+				break;
+
+			case 'p': /* --ts-parse-spec */
+				config.ts_parse_spec = optarg;
+				break;
+
+			case 'i': /* --input */
+				bench.input_filename = optarg;
+				break;
+
+			case 'k': /* --keep */
+				bench.keep_filename = optarg;
+				break;
+
+			case 'r': /* --repeat */
+				bench.repeat = strtoul(optarg, NULL, 10);
+				if (!bench.repeat)
+					bench.repeat = 1;
+
+				break;
+
+			case 'j': /* --json */
+				bench.json_filename = optarg;
+				break;
+
+			default:
+				return -EINVAL;
+		}
+	}
+
+	gen_config.entry_spec = config.entry_spec;
+	gen_config.ts_spec    = config.ts_parse_spec;
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get monotonic time in seconds
+ */
+static double bench_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Update best stage time
+ */
+static void bench_stage_time(bench_stage_t *stage, double start)
+{
+	double seconds = bench_time() - start;
+
+	if (!stage->seconds || (seconds < stage->seconds))
+		stage->seconds = seconds;
+}
+
+/**
+ * Run all benchmark stages once
+ *
+ * @param[in]  filename  Input file name.
+ * @param[out] lines_n   Number of the input lines.
+ * @param[out] parsed_n  Number of the parsed entries.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int bench_run(
+	const char *filename,
+	unsigned int *lines_n,
+	unsigned int *parsed_n
+)
+{
+	int ret;
+	unsigned int i, k;
+	double start;
+
+	syslog_input_t input;
+	syslog_entry_t entry;
+	syslog_output_t out;
+
+	char *data = NULL;
+	size_t data_size = 0;
+	size_t data_max = 0;
+	size_t *offsets = NULL;
+	size_t *lens = NULL;
+	size_t lines_max = 0;
+	syslog_field_state_t *states = NULL;
+
+	ret = syslog_input_open(&input, filename);
+	if (ret)
+	{
+		fprintf(stderr, "Could not open file '%s' (%d)\n", filename, ret);
+		return ret;
+	}
+
+	ret = syslog_entry_init(&entry, config.entry_spec);
+	if (ret)
+	{
+		fprintf(stderr, "Syslog entry initialization failed (%d)\n", ret);
+		syslog_input_close(&input);
+		return ret;
+	}
+
+	ret = syslog_output_open(&out, -1);
+	if (ret)
+		goto out;
+
+	/* Stage: read (lines are copied, as the line buffer is reused) */
+	*lines_n = 0;
+	start = bench_time();
+
+	while (1)
+	{
+		char *line;
+		size_t len;
+
+		ret = syslog_input_read_line(&input, &line, &len);
+		if (ret <= 0)
+			break;
+
+		if (*lines_n == lines_max)
+		{
+			lines_max = lines_max ? lines_max * 2 : 65536;
+			offsets = realloc(offsets, lines_max * sizeof(*offsets));
+			lens    = realloc(lens, lines_max * sizeof(*lens));
+
+			if (!offsets || !lens)
+			{
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+
+		if (data_size + len + 1 > data_max)
+		{
+			data_max = data_max ? data_max * 2 : 16 * 1024 * 1024;
+			if (data_max < data_size + len + 1)
+				data_max = data_size + len + 1;
+
+			data = realloc(data, data_max);
+			if (!data)
+			{
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+
+		memcpy(data + data_size, line, len + 1);
+
+		offsets[*lines_n] = data_size;
+		lens[*lines_n] = len;
+		(*lines_n)++;
+
+		data_size += len + 1;
+	}
+
+	bench_stage_time(&stages[0], start);
+
+	if (ret < 0)
+		goto out;
+
+	/* Stage: parse (including saving parsed states) */
+	states = malloc(((size_t)*lines_n + 1) * entry.fields_num *
+		sizeof(syslog_field_state_t));
+
+	if (!states)
+	{
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	*parsed_n = 0;
+	start = bench_time();
+
+	for (i = 0; i < *lines_n; i++)
+	{
+		if (syslog_entry_parse(&entry, i + 1, data + offsets[i], lens[i]))
+			continue;
+
+		syslog_entry_save(&entry,
+			states + (size_t)(*parsed_n)++ * entry.fields_num);
+	}
+
+	bench_stage_time(&stages[1], start);
+
+	/* Stages: output formats */
+	for (k = 0; fmt_avail[k]; k++)
+	{
+		const output_fmt_t *fmt = fmt_avail[k];
+		bench_stage_t *stage = &stages[BENCH_BASE_STAGES + k];
+
+		config.output_fmt = fmt;
+		stage->out_bytes = 0;
+		out.size = 0;
+
+		start = bench_time();
+
+		if (fmt->fn_output_init)
+			fmt->fn_output_init(&entry);
+
+		if (fmt->fn_output_start)
+			fmt->fn_output_start(&out, &entry);
+
+		for (i = 0; i < *parsed_n; i++)
+		{
+			syslog_entry_restore(&entry,
+				states + (size_t)i * entry.fields_num);
+
+			entry.num = i + 1;
+			fmt->fn_output_entry(&out, &entry);
+
+			if (out.size >= BENCH_OUTPUT_DISCARD_SIZE)
+			{
+				stage->out_bytes += out.size;
+				out.size = 0;
+			}
+		}
+
+		if (fmt->fn_output_end)
+			fmt->fn_output_end(&out, &entry);
+
+		bench_stage_time(stage, start);
+
+		stage->out_bytes += out.size;
+
+		if (out.error)
+		{
+			ret = out.error;
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	free(states);
+	free(data);
+	free(offsets);
+	free(lens);
+	syslog_output_close(&out);
+	syslog_entry_destroy(&entry);
+	syslog_input_close(&input);
+	return ret;
+}
+
+/**
+ * Write results in JSON
+ *
+ * @param[in] f         Output stream.
+ * @param[in] in_bytes  Input size in bytes.
+ * @param[in] lines_n   Number of the input lines.
+ * @param[in] parsed_n  Number of the parsed entries.
+ */
+static void bench_json(
+	FILE *f,
+	size_t in_bytes,
+	unsigned int lines_n,
+	unsigned int parsed_n
+)
+{
+	unsigned int i;
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"version\": \"%s\",\n", SYSLOG_FC_VERSION);
+	fprintf(f, "  \"input\": {\n");
+
+	if (bench.input_filename)
+		fprintf(f, "    \"file\": \"%s\",\n", bench.input_filename);
+	else
+	{
+		fprintf(f, "    \"seed\": %lu,\n", gen_config.seed);
+		fprintf(f, "    \"msg_min\": %u,\n", gen_config.msg_min);
+		fprintf(f, "    \"msg_max\": %u,\n", gen_config.msg_max);
+		fprintf(f, "    \"msg_dist\": \"%s\",\n",
+			gen_config.msg_dist == SYSLOG_GEN_DIST_UNIFORM ? "uniform" : "exp");
+		fprintf(f, "    \"mix\": \"%s\",\n",
+			gen_config.mix == SYSLOG_GEN_MIX_UNIFORM ? "uniform" : "real");
+		fprintf(f, "    \"escape_density\": %g,\n", gen_config.escape_density);
+		fprintf(f, "    \"numeric_priority\": %g,\n", gen_config.numeric_priority);
+		fprintf(f, "    \"invalid\": %g,\n", gen_config.invalid);
+	}
+
+	fprintf(f, "    \"bytes\": %zu,\n", in_bytes);
+	fprintf(f, "    \"lines\": %u,\n", lines_n);
+	fprintf(f, "    \"parsed\": %u\n", parsed_n);
+	fprintf(f, "  },\n");
+	fprintf(f, "  \"repeat\": %u,\n", bench.repeat);
+	fprintf(f, "  \"stages\": [\n");
+
+	for (i = 0; i < ARRAY_SIZE(stages); i++)
+	{
+		const bench_stage_t *stage = &stages[i];
+
+		fprintf(f,
+			"    { \"stage\": \"%s\", \"seconds\": %.6f, "
+			"\"lines_per_sec\": %.0f, \"mb_per_sec\": %.2f",
+			stage->name,
+			stage->seconds,
+			lines_n / stage->seconds,
+			in_bytes / stage->seconds / 1e6
+		);
+
+		if (i >= BENCH_BASE_STAGES)
+			fprintf(f, ", \"output_bytes\": %zu", stage->out_bytes);
+
+		fprintf(f, " }%s\n", (i + 1 < ARRAY_SIZE(stages)) ? "," : "");
+	}
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+/**
+ * Benchmark start point
+ *
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Array of the pointers to the arguments
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int main(int argc, char *argv[])
+{
+	int ret = 0;
+	unsigned int i;
+	unsigned int lines_n = 0;
+	unsigned int parsed_n = 0;
+	char tmp_filename[] = "/tmp/syslog_bench.XXXXXX";
+	const char *filename;
+	struct stat st;
+
+	if (cli_args(argc, argv))
+	{
+		display_usage();
+		return -EINVAL;
+	}
+
+	stages[0].name = "read";
+	stages[1].name = "parse";
+
+	for (i = 0; fmt_avail[i]; i++)
+		stages[BENCH_BASE_STAGES + i].name = fmt_avail[i]->name;
+
+	if (bench.input_filename)
+	{
+		filename = bench.input_filename;
+	}
+	else
+	{
+		FILE *f;
+		long gen_lines;
+
+		if (bench.keep_filename)
+		{
+			filename = bench.keep_filename;
+			f = fopen(filename, "w");
+		}
+		else
+		{
+			int fd = mkstemp(tmp_filename);
+			filename = tmp_filename;
+			f = (fd < 0) ? NULL : fdopen(fd, "w");
+		}
+
+		if (!f)
+		{
+			fprintf(stderr, "Could not create file '%s'\n", filename);
+			return -EIO;
+		}
+
+		gen_lines = syslog_gen(&gen_config, f);
+
+		if (fclose(f) || (gen_lines < 0))
+		{
+			fprintf(stderr, "Data generation failed (%ld)\n", gen_lines);
+			ret = -EIO;
+			goto out;
+		}
+	}
+
+	if (stat(filename, &st))
+	{
+		fprintf(stderr, "Could not stat file '%s'\n", filename);
+		ret = -errno;
+		goto out;
+	}
+
+	for (i = 0; i < bench.repeat; i++)
+	{
+		ret = bench_run(filename, &lines_n, &parsed_n);
+		if (ret)
+			goto out;
+	}
+
+	fprintf(stdout, "Input: %zu bytes, %u lines, %u parsed entries\n\n",
+		(size_t)st.st_size, lines_n, parsed_n);
+
+	fprintf(stdout, "%-10s %10s %14s %10s\n",
+		"Stage", "Seconds", "Lines/s", "MB/s");
+
+	for (i = 0; i < ARRAY_SIZE(stages); i++)
+	{
+		fprintf(stdout, "%-10s %10.4f %14.0f %10.2f\n",
+			stages[i].name,
+			stages[i].seconds,
+			lines_n / stages[i].seconds,
+			st.st_size / stages[i].seconds / 1e6
+		);
+	}
+
+	if (bench.json_filename)
+	{
+		FILE *f = fopen(bench.json_filename, "w");
+
+		if (!f)
+		{
+			fprintf(stderr, "Could not create file '%s'\n",
+				bench.json_filename);
+
+			ret = -EIO;
+			goto out;
+		}
+
+		bench_json(f, st.st_size, lines_n, parsed_n);
+		fclose(f);
+	}
+
+out:
+	if (!bench.input_filename && !bench.keep_filename)
+		unlink(tmp_filename);
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
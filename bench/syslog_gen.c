@@ -0,0 +1,450 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Synthetic syslog generator source
+ *
+ * Generated lines follow the entry format specification, so any
+ * specification accepted by syslog_entry_init() can be benchmarked.
+ * Data depends only on the generator configuration (the random
+ * generator is not shared with the C library).
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <syslog_gen.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Start time of the generated log (Mon Jun 24 18:12:50 2019 UTC) */
+#define GEN_START_TIME  1561399970
+
+/** @brief Maximum length of the single generated line */
+#define GEN_MAX_LINE  8192
+
+/**
+ * @brief Weighted name
+ */
+typedef struct gen_name
+{
+	const char *name; /**< Name */
+	int code;         /**< Numeric value */
+	unsigned int w;   /**< Weight for the realistic mix */
+} gen_name_t;
+
+/** @brief Facility names (glibc spelling) */
+static const gen_name_t gen_facilities[] =
+{
+	{ "kern",     0, 20 }, { "user",     1, 15 }, { "mail",     2,  4 },
+	{ "daemon",   3, 30 }, { "auth",     4,  8 }, { "syslog",   5,  3 },
+	{ "lpr",      6,  1 }, { "news",     7,  1 }, { "uucp",     8,  1 },
+	{ "cron",     9,  8 }, { "authpriv",10,  4 }, { "ftp",     11,  1 },
+	{ "local0",  16,  1 }, { "local1",  17,  1 }, { "local2",  18,  1 },
+	{ "local3",  19,  1 }, { "local4",  20,  1 }, { "local5",  21,  1 },
+	{ "local6",  22,  1 }, { "local7",  23,  1 },
+};
+
+/** @brief Priority names (glibc spelling) */
+static const gen_name_t gen_priorities[] =
+{
+	{ "emerg",    0,  1 }, { "alert",    1,  1 }, { "crit",     2,  2 },
+	{ "err",      3,  7 }, { "warning",  4, 10 }, { "notice",   5, 15 },
+	{ "info",     6, 49 }, { "debug",    7, 15 },
+};
+
+/** @brief Message tags (process names) */
+static const char *gen_tags[] =
+{
+	"kernel", "sshd", "dnsmasq", "netifd", "cron", "dropbear",
+	"procd", "systemd", "NetworkManager", "ntpd", "hostapd", "logread",
+};
+
+/** @brief Message words */
+static const char *gen_words[] =
+{
+	"interface", "link", "is", "up", "down", "started", "stopped",
+	"connection", "from", "port", "closed", "by", "user", "session",
+	"opened", "for", "root", "failed", "password", "timeout", "reached",
+	"device", "eth0", "wlan0", "br-lan", "address", "renewed", "lease",
+	"of", "to", "the", "a", "received", "packet", "dropped", "error",
+	"retrying", "in", "seconds", "configuration", "reloaded", "ok",
+};
+
+/** @brief Characters that need escaping in some output formats */
+static const char gen_escapes[] = "\"\\&<>\t";
+
+/**
+ * @brief Generator state
+ */
+typedef struct gen_state
+{
+	const syslog_gen_config_t *config; /**< Generator configuration */
+	unsigned long long rng;            /**< Random generator state */
+	time_t time;                       /**< Current timestamp */
+	unsigned long id;                  /**< Current entry ID */
+	double ktime;                      /**< Current kernel time */
+	char *p;                           /**< Current output position */
+	char *end;                         /**< End of the line buffer */
+} gen_state_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get next random number (xorshift64*)
+ *
+ * @param[in,out] gen  Pointer to the generator state.
+ *
+ * @return Random number
+ */
+static unsigned long long gen_rand(gen_state_t *gen)
+{
+	gen->rng ^= gen->rng >> 12;
+	gen->rng ^= gen->rng << 25;
+	gen->rng ^= gen->rng >> 27;
+	return gen->rng * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * Get random number in range [0, n)
+ */
+static unsigned int gen_rand_n(gen_state_t *gen, unsigned int n)
+{
+	return (unsigned int)((gen_rand(gen) >> 32) % n);
+}
+
+/**
+ * Get random number in range [0, 1)
+ */
+static double gen_rand_f(gen_state_t *gen)
+{
+	return (double)(gen_rand(gen) >> 11) / (double)(1ULL << 53);
+}
+
+/**
+ * Pick random name from the array
+ *
+ * @param[in,out] gen    Pointer to the generator state.
+ * @param[in]     names  Names array.
+ * @param[in]     num    Number of names in the array.
+ *
+ * @return Pointer to the picked name
+ */
+static const gen_name_t *gen_pick(
+	gen_state_t *gen,
+	const gen_name_t *names,
+	unsigned int num
+)
+{
+	unsigned int i;
+	unsigned int total = 0;
+	unsigned int r;
+
+	if (gen->config->mix == SYSLOG_GEN_MIX_UNIFORM)
+		return &names[gen_rand_n(gen, num)];
+
+	for (i = 0; i < num; i++)
+		total += names[i].w;
+
+	r = gen_rand_n(gen, total);
+
+	for (i = 0; r >= names[i].w; i++)
+		r -= names[i].w;
+
+	return &names[i];
+}
+
+/**
+ * Append string to the generated line
+ */
+static void gen_puts(gen_state_t *gen, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (len > (size_t)(gen->end - gen->p))
+		len = gen->end - gen->p;
+
+	memcpy(gen->p, s, len);
+	gen->p += len;
+}
+
+/**
+ * Append formatted string to the generated line
+ */
+__attribute__((format(printf, 2, 3)))
+static void gen_printf(gen_state_t *gen, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(gen->p, gen->end - gen->p, fmt, ap);
+	va_end(ap);
+
+	if (len > 0)
+		gen->p += (len < gen->end - gen->p) ? len : gen->end - gen->p - 1;
+}
+
+/**
+ * Get random message length according to the configured distribution
+ */
+static unsigned int gen_msg_len(gen_state_t *gen)
+{
+	const syslog_gen_config_t *config = gen->config;
+	unsigned int range = config->msg_max - config->msg_min;
+	double r;
+
+	if (!range)
+		return config->msg_min;
+
+	if (config->msg_dist == SYSLOG_GEN_DIST_UNIFORM)
+		return config->msg_min + gen_rand_n(gen, range + 1);
+
+	/* Exponential with the mean at 1/4 of the range */
+	r = -log(1.0 - gen_rand_f(gen)) * range / 4;
+	if (r > range)
+		r = range;
+
+	return config->msg_min + (unsigned int)r;
+}
+
+/**
+ * Generate message field
+ */
+static void gen_message(gen_state_t *gen)
+{
+	unsigned int len = gen_msg_len(gen);
+	char *end;
+
+	if (len > (size_t)(gen->end - gen->p))
+		len = gen->end - gen->p;
+
+	end = gen->p + len;
+
+	while (gen->p < end)
+	{
+		const char *word = gen_words[gen_rand_n(gen, sizeof(gen_words) /
+			sizeof(gen_words[0]))];
+
+		while (*word && (gen->p < end))
+		{
+			if (gen_rand_f(gen) < gen->config->escape_density)
+				*gen->p++ = gen_escapes[gen_rand_n(gen, sizeof(gen_escapes) - 1)];
+			else
+				*gen->p++ = *word++;
+		}
+
+		if (gen->p < end)
+			*gen->p++ = ' ';
+	}
+
+	/* Messages never end with a space (it would be trimmed) */
+	if (len && (gen->p[-1] == ' '))
+		gen->p[-1] = '.';
+}
+
+/**
+ * Generate field value for the entry specificator
+ *
+ * @param[in,out] gen   Pointer to the generator state.
+ * @param[in]     spec  Entry specificator character.
+ *
+ * @return 0 on success
+ * @return <0 on unknown specificator
+ */
+static int gen_field(gen_state_t *gen, char spec)
+{
+	const syslog_gen_config_t *config = gen->config;
+
+	switch (spec)
+	{
+		case 'T':
+		{
+			struct tm tm;
+			size_t len;
+
+			localtime_r(&gen->time, &tm);
+			len = strftime(gen->p, gen->end - gen->p, config->ts_spec, &tm);
+			gen->p += len;
+			break;
+		}
+
+		case 'K':
+			gen_printf(gen, "%lu.%06lu", (unsigned long)gen->ktime,
+				(unsigned long)((gen->ktime - (unsigned long)gen->ktime) * 1e6));
+			break;
+
+		case 'I':
+			gen_printf(gen, "%lu", gen->id);
+			break;
+
+		case 'H':
+			gen_printf(gen, "host%02u", gen_rand_n(gen, 16) + 1);
+			break;
+
+		case 'F':
+			if (gen_rand_f(gen) < config->invalid)
+				gen_puts(gen, "unknown");
+			else
+				gen_puts(gen, gen_pick(gen, gen_facilities,
+					sizeof(gen_facilities) / sizeof(gen_facilities[0]))->name);
+			break;
+
+		case 'P':
+		{
+			const gen_name_t *prio = gen_pick(gen, gen_priorities,
+				sizeof(gen_priorities) / sizeof(gen_priorities[0]));
+
+			if (gen_rand_f(gen) < config->numeric_priority)
+				gen_printf(gen, "%d", prio->code);
+			else
+				gen_puts(gen, prio->name);
+
+			break;
+		}
+
+		case 'G':
+		{
+			unsigned int tag = gen_rand_n(gen,
+				sizeof(gen_tags) / sizeof(gen_tags[0]));
+
+			if (tag)
+				gen_printf(gen, "%s[%u]", gen_tags[tag], gen_rand_n(gen, 30000) + 1);
+			else
+				gen_puts(gen, gen_tags[tag]);
+
+			break;
+		}
+
+		case 'M':
+			gen_message(gen);
+			break;
+
+		default:
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Generate single line by the entry format specification
+ *
+ * @param[in,out] gen   Pointer to the generator state.
+ *
+ * @return 0 on success
+ * @return <0 on invalid entry format specification
+ */
+static int gen_line(gen_state_t *gen)
+{
+	const char *s;
+
+	for (s = gen->config->entry_spec; *s; s++)
+	{
+		if (*s != '%')
+		{
+			if (gen->p < gen->end)
+				*gen->p++ = *s;
+
+			continue;
+		}
+
+		/* Skip field modifiers */
+		while ((s[1] == '!') || (s[1] == '_') || (s[1] == '@'))
+			s++;
+
+		if (!*(++s))
+			return -EINVAL;
+
+		if (*s == '%')
+		{
+			if (gen->p < gen->end)
+				*gen->p++ = '%';
+
+			continue;
+		}
+
+		if (gen_field(gen, *s))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+long syslog_gen(const syslog_gen_config_t *config, FILE *out)
+{
+	gen_state_t gen;
+	size_t size = 0;
+	long lines_n = 0;
+	char *line;
+
+	if (config->msg_min > config->msg_max)
+		return -EINVAL;
+
+	line = malloc(GEN_MAX_LINE);
+	if (!line)
+		return -ENOMEM;
+
+	memset(&gen, 0, sizeof(gen));
+	gen.config = config;
+	gen.rng    = config->seed * 0x9e3779b97f4a7c15ULL + 1;
+	gen.time   = GEN_START_TIME;
+	gen.ktime  = 1.0;
+
+	while (size < config->size)
+	{
+		size_t len;
+
+		gen.p   = line;
+		gen.end = line + GEN_MAX_LINE - 1;
+		gen.id++;
+
+		if (gen_line(&gen))
+		{
+			free(line);
+			return -EINVAL;
+		}
+
+		*gen.p++ = '\n';
+		len = gen.p - line;
+
+		if (fwrite(line, 1, len, out) != len)
+		{
+			free(line);
+			return -EIO;
+		}
+
+		size += len;
+		lines_n++;
+
+		/* Several entries per second with occasional pauses */
+		if (!gen_rand_n(&gen, 4))
+		{
+			unsigned int step = gen_rand_n(&gen, 16) ? 1 : gen_rand_n(&gen, 600);
+			gen.time  += step;
+			gen.ktime += step;
+		}
+
+		gen.ktime += gen_rand_f(&gen) / 100;
+	}
+
+	free(line);
+	return lines_n;
+}
+
+/* ----------------------------------------------------------------------- */
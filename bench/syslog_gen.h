@@ -0,0 +1,107 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Synthetic syslog generator header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_GEN_H__
+#define __SYSLOG_GEN_H__
+
+#include <stdio.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @name Message length distributions
+ * @{
+ */
+
+/** @brief Uniform distribution between minimum and maximum */
+#define SYSLOG_GEN_DIST_UNIFORM      0
+
+/** @brief Exponential distribution (many short, few long messages) */
+#define SYSLOG_GEN_DIST_EXPONENTIAL  1
+
+/** @} */
+
+/**
+ * @name Facility and priority mixes
+ * @{
+ */
+
+/** @brief All names are equally likely */
+#define SYSLOG_GEN_MIX_UNIFORM    0
+
+/** @brief Names are weighted like on a typical system */
+#define SYSLOG_GEN_MIX_REALISTIC  1
+
+/** @} */
+
+/**
+ * @brief Synthetic syslog generator configuration
+ */
+typedef struct syslog_gen_config
+{
+	/** Random generator seed */
+	unsigned long seed;
+
+	/** Approximate size of the generated data in bytes */
+	size_t size;
+
+	/** Entry format specification (syslog_entry_init() syntax) */
+	const char *entry_spec;
+
+	/** Timestamp format specification (strftime() syntax) */
+	const char *ts_spec;
+
+	/** Minimum message length */
+	unsigned int msg_min;
+
+	/** Maximum message length */
+	unsigned int msg_max;
+
+	/** Message length distribution (SYSLOG_GEN_DIST_xxx) */
+	int msg_dist;
+
+	/** Facility and priority mix (SYSLOG_GEN_MIX_xxx) */
+	int mix;
+
+	/** Fraction of the message characters that need escaping */
+	double escape_density;
+
+	/** Fraction of the numeric priorities */
+	double numeric_priority;
+
+	/** Fraction of the entries with invalid facility */
+	double invalid;
+
+} syslog_gen_config_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Generate synthetic syslog data
+ *
+ * The same configuration always produces the same data.
+ *
+ * @param[in] gen  Pointer to the generator configuration.
+ * @param[in] out  Output stream.
+ *
+ * @return Number of generated lines
+ * @return <0 on error
+ */
+long syslog_gen(const syslog_gen_config_t *gen, FILE *out);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_GEN_H__ */
@@ -0,0 +1,1339 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * Apache Arrow IPC file output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Apache Arrow IPC file output format support
+ *
+ * Entries are output as the Arrow IPC file (columnar format version 5),
+ * which can be memory-mapped by pyarrow, DuckDB and other Arrow readers
+ * without parsing. Each output field is a column:
+ *
+ *   - timestamp fields are timestamp[s, tz=UTC] (int64 Unix time);
+ *   - integer fields are int64 and uint64;
+ *   - facility and priority are dictionary-encoded utf8 strings
+ *     (int32 indices), new dictionary values are written as delta
+ *     dictionary batches before the record batch which uses them;
+ *   - other string fields are utf8 (int32 offsets and data buffers),
+ *     invalid UTF-8 sequences are replaced by U+FFFD.
+ *
+ * Entries are collected into record batches of up to
+ * #FMT_ARROW_BATCH_ROWS rows. Message metadata is encoded by the
+ * minimal flatbuffers builder below, so no Arrow library is required.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <syslog_intern.h>
+#include <fmt_arrow.h>
+
+/** @brief Maximum number of rows in the record batch */
+#define FMT_ARROW_BATCH_ROWS  (64 * 1024)
+
+/** @brief Size of the column string data that causes the record batch output */
+#define FMT_ARROW_BATCH_DATA_SIZE  (64 * 1024 * 1024)
+
+/** @brief Alignment of the messages and body buffers */
+#define FMT_ARROW_ALIGNMENT  8
+
+/** @brief Initial size of the flatbuffers builder buffer */
+#define FMT_ARROW_FB_SIZE  1024
+
+/** @brief Maximum number of fields in the flatbuffers table */
+#define FMT_ARROW_FB_MAX_FIELDS  8
+
+/** @brief Align size to #FMT_ARROW_ALIGNMENT bytes */
+#define FMT_ARROW_ALIGN(size) \
+	(((size) + FMT_ARROW_ALIGNMENT - 1) & ~(size_t)(FMT_ARROW_ALIGNMENT - 1))
+
+/**
+ * @name Arrow format constants (Schema.fbs, Message.fbs)
+ * @{
+ */
+#define ARROW_METADATA_V5              4
+#define ARROW_ENDIANNESS_LITTLE        0
+#define ARROW_ENDIANNESS_BIG           1
+#define ARROW_TYPE_INT                 2
+#define ARROW_TYPE_UTF8                5
+#define ARROW_TYPE_TIMESTAMP           10
+#define ARROW_TIME_UNIT_SECOND         0
+#define ARROW_HEADER_SCHEMA            1
+#define ARROW_HEADER_DICTIONARY_BATCH  2
+#define ARROW_HEADER_RECORD_BATCH      3
+/** @} */
+
+/** @brief Endianness of the body buffers (host byte order) */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define FMT_ARROW_ENDIANNESS  ARROW_ENDIANNESS_BIG
+#else
+#define FMT_ARROW_ENDIANNESS  ARROW_ENDIANNESS_LITTLE
+#endif
+
+/**
+ * @brief Flatbuffers builder
+ *
+ * Flatbuffer is built from the end to the beginning, so offsets of the
+ * built objects are counted from the end of the buffer. Child objects
+ * must be built before their parents, and only one table can be built
+ * at a time.
+ */
+typedef struct fmt_arrow_fb
+{
+	/** Buffer (built data is at the end of the buffer) */
+	uint8_t *buffer;
+
+	/** Buffer capacity */
+	size_t capacity;
+
+	/** Size of the built data */
+	size_t size;
+
+	/** Maximum alignment of the built data */
+	size_t minalign;
+
+	/** Size of the built data at the start of the current table */
+	size_t table;
+
+	/** Offsets of the current table fields (0 if field is not set) */
+	size_t fields[FMT_ARROW_FB_MAX_FIELDS];
+
+	/** Number of the current table fields */
+	unsigned int fields_n;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+} fmt_arrow_fb_t;
+
+/**
+ * @brief Growing data buffer
+ */
+typedef struct fmt_arrow_buffer
+{
+	uint8_t *data;   /**< Data */
+	size_t size;     /**< Data size */
+	size_t capacity; /**< Buffer capacity */
+
+} fmt_arrow_buffer_t;
+
+/**
+ * @brief Body buffer of the message
+ */
+typedef struct fmt_arrow_span
+{
+	const void *data; /**< Data */
+	size_t size;      /**< Data size */
+
+} fmt_arrow_span_t;
+
+/**
+ * @brief Column types
+ */
+typedef enum
+{
+	FMT_ARROW_COLUMN_TIMESTAMP,  /**< timestamp[s, tz=UTC] */
+	FMT_ARROW_COLUMN_INT64,      /**< int64 */
+	FMT_ARROW_COLUMN_UINT64,     /**< uint64 */
+	FMT_ARROW_COLUMN_UTF8,       /**< utf8 */
+	FMT_ARROW_COLUMN_DICTIONARY, /**< dictionary<values=utf8, indices=int32> */
+
+} fmt_arrow_column_type_t;
+
+/**
+ * @brief Dictionary of the dictionary-encoded column
+ */
+typedef struct fmt_arrow_dict
+{
+	/** Offsets of all values (int32) */
+	fmt_arrow_buffer_t offsets;
+
+	/** Data of all values */
+	fmt_arrow_buffer_t data;
+
+	/** Values intern table (identifiers are the value indices) */
+	syslog_intern_t intern;
+
+	/** Number of values */
+	uint32_t values_n;
+
+	/** Number of values written into the output */
+	uint32_t written_n;
+
+} fmt_arrow_dict_t;
+
+/**
+ * @brief Column data structure
+ */
+typedef struct fmt_arrow_column
+{
+	/** Field information */
+	const syslog_field_info_t *info;
+
+	/** Column type */
+	fmt_arrow_column_type_t type;
+
+	/** Values (int64), string offsets (int32) or dictionary indices (int32) */
+	fmt_arrow_buffer_t values;
+
+	/** String data */
+	fmt_arrow_buffer_t data;
+
+	/** Dictionary (dictionary-encoded columns only) */
+	fmt_arrow_dict_t dict;
+
+} fmt_arrow_column_t;
+
+/**
+ * @brief Message position in the file
+ */
+typedef struct fmt_arrow_block
+{
+	uint64_t offset;        /**< Message offset */
+	uint32_t metadata_size; /**< Metadata size including prefix and padding */
+	uint64_t body_size;     /**< Body size */
+
+} fmt_arrow_block_t;
+
+/**
+ * @brief Array of the message positions
+ */
+typedef struct fmt_arrow_blocks
+{
+	fmt_arrow_block_t *blocks; /**< Blocks */
+	size_t n;                  /**< Number of blocks */
+	size_t max;                /**< Number of blocks that fit into array */
+
+} fmt_arrow_blocks_t;
+
+/**
+ * @brief Output file data structure
+ */
+typedef struct fmt_arrow_file
+{
+	/** Columns */
+	fmt_arrow_column_t *columns;
+
+	/** Number of columns */
+	unsigned int columns_n;
+
+	/** Number of rows in the current record batch */
+	uint32_t rows_n;
+
+	/** Current output offset */
+	uint64_t offset;
+
+	/** Positions of the dictionary batches */
+	fmt_arrow_blocks_t dictionaries;
+
+	/** Positions of the record batches */
+	fmt_arrow_blocks_t batches;
+
+	/** Body buffers of the message */
+	fmt_arrow_span_t *spans;
+
+	/** Offsets of the built schema fields */
+	uint32_t *fields;
+
+	/** Rebased offsets of the delta dictionary values */
+	fmt_arrow_buffer_t scratch;
+
+	/** Flatbuffers builder */
+	fmt_arrow_fb_t fb;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+} fmt_arrow_file_t;
+
+/** @brief Output file */
+static fmt_arrow_file_t fmt_arrow_file;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Make room for the data in the flatbuffers builder
+ *
+ * @param[in,out] fb  Pointer to the builder.
+ * @param[in]     len Data length.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int fmt_arrow_fb_reserve(fmt_arrow_fb_t *fb, size_t len)
+{
+	size_t capacity;
+	uint8_t *buffer;
+
+	if (fb->error)
+		return fb->error;
+
+	if (fb->capacity - fb->size >= len)
+		return 0;
+
+	capacity = fb->capacity ? fb->capacity * 2 : FMT_ARROW_FB_SIZE;
+	while (capacity - fb->size < len)
+		capacity *= 2;
+
+	buffer = malloc(capacity);
+	if (!buffer)
+	{
+		fb->error = -ENOMEM;
+		return fb->error;
+	}
+
+	if (fb->size)
+	{
+		memcpy(buffer + capacity - fb->size,
+			fb->buffer + fb->capacity - fb->size, fb->size);
+	}
+
+	free(fb->buffer);
+	fb->buffer = buffer;
+	fb->capacity = capacity;
+	return 0;
+}
+
+/**
+ * Prepend data to the flatbuffers builder
+ */
+static void fmt_arrow_fb_push(fmt_arrow_fb_t *fb, const void *data, size_t len)
+{
+	if (!len || fmt_arrow_fb_reserve(fb, len))
+		return;
+
+	fb->size += len;
+	memcpy(fb->buffer + fb->capacity - fb->size, data, len);
+}
+
+/**
+ * Prepend padding, so that after prepending @p len bytes
+ * the data is aligned to @p align bytes
+ */
+static void fmt_arrow_fb_prep(fmt_arrow_fb_t *fb, size_t align, size_t len)
+{
+	static const uint8_t zeros[FMT_ARROW_ALIGNMENT] = { 0 };
+
+	if (align > fb->minalign)
+		fb->minalign = align;
+
+	fmt_arrow_fb_push(fb, zeros, (-(fb->size + len)) & (align - 1));
+}
+
+/**
+ * Prepend aligned little-endian scalar value of @p width bytes
+ *
+ * @return Offset of the value
+ */
+static size_t fmt_arrow_fb_scalar(
+	fmt_arrow_fb_t *fb,
+	uint64_t value,
+	unsigned int width
+)
+{
+	uint8_t data[sizeof(value)];
+	unsigned int i;
+
+	for (i = 0; i < width; i++)
+		data[i] = (uint8_t)(value >> (i * 8));
+
+	fmt_arrow_fb_prep(fb, width, 0);
+	fmt_arrow_fb_push(fb, data, width);
+	return fb->size;
+}
+
+/**
+ * Prepend offset of the previously built object
+ *
+ * @return Offset of the offset value
+ */
+static size_t fmt_arrow_fb_offset(fmt_arrow_fb_t *fb, size_t offset)
+{
+	fmt_arrow_fb_prep(fb, 4, 0);
+	return fmt_arrow_fb_scalar(fb, fb->size + 4 - offset, 4);
+}
+
+/**
+ * Build string
+ *
+ * @return Offset of the string
+ */
+static size_t fmt_arrow_fb_string(fmt_arrow_fb_t *fb, const char *string)
+{
+	size_t len = strlen(string);
+
+	fmt_arrow_fb_prep(fb, 4, len + 1);
+	fmt_arrow_fb_push(fb, "", 1);
+	fmt_arrow_fb_push(fb, string, len);
+	return fmt_arrow_fb_scalar(fb, len, 4);
+}
+
+/**
+ * Start vector building
+ *
+ * Vector elements must be prepended in the reverse order.
+ */
+static void fmt_arrow_fb_vector_start(
+	fmt_arrow_fb_t *fb,
+	size_t elem_size,
+	size_t n,
+	size_t align
+)
+{
+	fmt_arrow_fb_prep(fb, 4, elem_size * n);
+	fmt_arrow_fb_prep(fb, align, elem_size * n);
+}
+
+/**
+ * Finish vector building
+ *
+ * @return Offset of the vector
+ */
+static size_t fmt_arrow_fb_vector_end(fmt_arrow_fb_t *fb, size_t n)
+{
+	return fmt_arrow_fb_scalar(fb, n, 4);
+}
+
+/**
+ * Start table building
+ */
+static void fmt_arrow_fb_table_start(fmt_arrow_fb_t *fb, unsigned int fields_n)
+{
+	assert(fields_n <= FMT_ARROW_FB_MAX_FIELDS);
+
+	memset(fb->fields, 0, sizeof(fb->fields));
+	fb->fields_n = fields_n;
+	fb->table = fb->size;
+}
+
+/**
+ * Add scalar field to the table
+ */
+static void fmt_arrow_fb_table_scalar(
+	fmt_arrow_fb_t *fb,
+	unsigned int slot,
+	uint64_t value,
+	unsigned int width
+)
+{
+	fb->fields[slot] = fmt_arrow_fb_scalar(fb, value, width);
+}
+
+/**
+ * Add offset field to the table
+ */
+static void fmt_arrow_fb_table_offset(
+	fmt_arrow_fb_t *fb,
+	unsigned int slot,
+	size_t offset
+)
+{
+	fb->fields[slot] = fmt_arrow_fb_offset(fb, offset);
+}
+
+/**
+ * Finish table building
+ *
+ * Table vtable is prepended to the table (vtables are not shared).
+ *
+ * @return Offset of the table
+ */
+static size_t fmt_arrow_fb_table_end(fmt_arrow_fb_t *fb)
+{
+	size_t table;
+	unsigned int n = fb->fields_n;
+	unsigned int i;
+	int32_t vtable;
+
+	/* Placeholder for the vtable offset */
+	table = fmt_arrow_fb_scalar(fb, 0, 4);
+
+	/* Trailing fields which are not set are omitted */
+	while (n && !fb->fields[n - 1])
+		n--;
+
+	for (i = n; i-- > 0; )
+		fmt_arrow_fb_scalar(fb, fb->fields[i] ? table - fb->fields[i] : 0, 2);
+
+	fmt_arrow_fb_scalar(fb, table - fb->table, 2);
+	fmt_arrow_fb_scalar(fb, (n + 2) * 2, 2);
+
+	if (!fb->error)
+	{
+		uint8_t *p = fb->buffer + fb->capacity - table;
+
+		vtable = (int32_t)(fb->size - table);
+		for (i = 0; i < 4; i++)
+			p[i] = (uint8_t)((uint32_t)vtable >> (i * 8));
+	}
+
+	return table;
+}
+
+/**
+ * Finish flatbuffer with the root table
+ */
+static void fmt_arrow_fb_finish(fmt_arrow_fb_t *fb, size_t root)
+{
+	fmt_arrow_fb_prep(fb, fb->minalign, 4);
+	fmt_arrow_fb_offset(fb, root);
+}
+
+/**
+ * Get built flatbuffer data
+ */
+static const uint8_t *fmt_arrow_fb_data(const fmt_arrow_fb_t *fb)
+{
+	return fb->buffer + fb->capacity - fb->size;
+}
+
+/**
+ * Clear flatbuffers builder
+ */
+static void fmt_arrow_fb_clear(fmt_arrow_fb_t *fb)
+{
+	fb->size = 0;
+	fb->minalign = 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Make room for the data in the buffer
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int fmt_arrow_buffer_reserve(fmt_arrow_buffer_t *buffer, size_t len)
+{
+	size_t capacity;
+	uint8_t *data;
+
+	if (buffer->capacity - buffer->size >= len)
+		return 0;
+
+	capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+	while (capacity - buffer->size < len)
+		capacity *= 2;
+
+	data = realloc(buffer->data, capacity);
+	if (!data)
+		return -ENOMEM;
+
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return 0;
+}
+
+/**
+ * Append data to the buffer
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int fmt_arrow_buffer_append(
+	fmt_arrow_buffer_t *buffer,
+	const void *data,
+	size_t len
+)
+{
+	if (fmt_arrow_buffer_reserve(buffer, len))
+		return -ENOMEM;
+
+	memcpy(buffer->data + buffer->size, data, len);
+	buffer->size += len;
+	return 0;
+}
+
+/**
+ * Append int32 value to the buffer
+ */
+static int fmt_arrow_buffer_int32(fmt_arrow_buffer_t *buffer, int32_t value)
+{
+	return fmt_arrow_buffer_append(buffer, &value, sizeof(value));
+}
+
+/**
+ * Free buffer
+ */
+static void fmt_arrow_buffer_free(fmt_arrow_buffer_t *buffer)
+{
+	free(buffer->data);
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+/**
+ * Append string to the buffer replacing invalid
+ * UTF-8 sequences by U+FFFD
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int fmt_arrow_buffer_utf8(fmt_arrow_buffer_t *buffer, const char *string)
+{
+	size_t len = strlen(string);
+	size_t valid;
+
+	for (;;)
+	{
+		valid = syslog_output_utf8_valid(string, len);
+
+		if (fmt_arrow_buffer_append(buffer, string, valid))
+			return -ENOMEM;
+
+		if (valid == len)
+			return 0;
+
+		if (fmt_arrow_buffer_append(buffer, "\xef\xbf\xbd", 3))
+			return -ENOMEM;
+
+		string += valid + 1;
+		len -= valid + 1;
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get index of the dictionary value (value is added if it is new)
+ *
+ * @param[in,out] dict   Pointer to the dictionary.
+ * @param[in]     string Value.
+ * @param[out]    index  Value index.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int fmt_arrow_dict_index(
+	fmt_arrow_dict_t *dict,
+	const char *string,
+	int32_t *index
+)
+{
+	size_t start = dict->data.size;
+	int ret;
+	int id;
+
+	/* Value is appended to the dictionary data for the lookup
+	 * and is removed if it is found */
+	ret = fmt_arrow_buffer_utf8(&dict->data, string);
+	if (ret)
+		return ret;
+
+	id = syslog_intern_add(&dict->intern,
+		(const char *)dict->data.data + start, dict->data.size - start);
+
+	if (id < 0)
+		return id;
+
+	if ((uint32_t)id < dict->values_n)
+	{
+		dict->data.size = start;
+		*index = id;
+		return 0;
+	}
+
+	if (dict->data.size > INT32_MAX)
+		return -EOVERFLOW;
+
+	ret = fmt_arrow_buffer_int32(&dict->offsets, dict->data.size);
+	if (ret)
+		return ret;
+
+	*index = dict->values_n++;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Write data into the output
+ */
+static void fmt_arrow_write(syslog_output_t *out, const void *data, size_t len)
+{
+	syslog_output_write(out, data, len);
+	fmt_arrow_file.offset += len;
+}
+
+/**
+ * Write zero padding up to the aligned output offset
+ */
+static void fmt_arrow_write_padding(syslog_output_t *out)
+{
+	static const uint8_t zeros[FMT_ARROW_ALIGNMENT] = { 0 };
+
+	fmt_arrow_write(out, zeros,
+		FMT_ARROW_ALIGN(fmt_arrow_file.offset) - fmt_arrow_file.offset);
+}
+
+/**
+ * Write little-endian 32-bit value into the output
+ */
+static void fmt_arrow_write_u32(syslog_output_t *out, uint32_t value)
+{
+	uint8_t data[4] = {
+		(uint8_t)value, (uint8_t)(value >> 8),
+		(uint8_t)(value >> 16), (uint8_t)(value >> 24)
+	};
+
+	fmt_arrow_write(out, data, sizeof(data));
+}
+
+/**
+ * Add message position
+ */
+static int fmt_arrow_blocks_add(
+	fmt_arrow_blocks_t *blocks,
+	const fmt_arrow_block_t *block
+)
+{
+	if (blocks->n == blocks->max)
+	{
+		size_t max = blocks->max ? blocks->max * 2 : 64;
+		fmt_arrow_block_t *p = realloc(blocks->blocks, max * sizeof(*p));
+
+		if (!p)
+			return -ENOMEM;
+
+		blocks->blocks = p;
+		blocks->max = max;
+	}
+
+	blocks->blocks[blocks->n++] = *block;
+	return 0;
+}
+
+/**
+ * Build vector of the message positions (Block structs)
+ *
+ * @return Offset of the vector
+ */
+static size_t fmt_arrow_fb_blocks(
+	fmt_arrow_fb_t *fb,
+	const fmt_arrow_blocks_t *blocks
+)
+{
+	size_t i;
+
+	fmt_arrow_fb_vector_start(fb, 24, blocks->n, 8);
+
+	for (i = blocks->n; i-- > 0; )
+	{
+		fmt_arrow_fb_scalar(fb, blocks->blocks[i].body_size, 8);
+		fmt_arrow_fb_scalar(fb, 0, 4);
+		fmt_arrow_fb_scalar(fb, blocks->blocks[i].metadata_size, 4);
+		fmt_arrow_fb_scalar(fb, blocks->blocks[i].offset, 8);
+	}
+
+	return fmt_arrow_fb_vector_end(fb, blocks->n);
+}
+
+/**
+ * Build schema table
+ *
+ * @return Offset of the table
+ */
+static size_t fmt_arrow_fb_schema(fmt_arrow_fb_t *fb)
+{
+	unsigned int i;
+	size_t fields;
+
+	for (i = 0; i < fmt_arrow_file.columns_n; i++)
+	{
+		const fmt_arrow_column_t *column = &fmt_arrow_file.columns[i];
+		size_t name, type, tz, index_type, children;
+		size_t dictionary = 0;
+		unsigned int type_type;
+
+		name = fmt_arrow_fb_string(fb, column->info->param_name);
+
+		switch(column->type)
+		{
+			case FMT_ARROW_COLUMN_TIMESTAMP:
+				tz = fmt_arrow_fb_string(fb, "UTC");
+				fmt_arrow_fb_table_start(fb, 2);
+				fmt_arrow_fb_table_scalar(fb, 0, ARROW_TIME_UNIT_SECOND, 2);
+				fmt_arrow_fb_table_offset(fb, 1, tz);
+				type = fmt_arrow_fb_table_end(fb);
+				type_type = ARROW_TYPE_TIMESTAMP;
+				break;
+
+			case FMT_ARROW_COLUMN_INT64:
+			case FMT_ARROW_COLUMN_UINT64:
+				fmt_arrow_fb_table_start(fb, 2);
+				fmt_arrow_fb_table_scalar(fb, 0, 64, 4);
+				fmt_arrow_fb_table_scalar(fb, 1,
+					column->type == FMT_ARROW_COLUMN_INT64, 1);
+				type = fmt_arrow_fb_table_end(fb);
+				type_type = ARROW_TYPE_INT;
+				break;
+
+			default:
+				fmt_arrow_fb_table_start(fb, 0);
+				type = fmt_arrow_fb_table_end(fb);
+				type_type = ARROW_TYPE_UTF8;
+				break;
+		}
+
+		if (column->type == FMT_ARROW_COLUMN_DICTIONARY)
+		{
+			fmt_arrow_fb_table_start(fb, 2);
+			fmt_arrow_fb_table_scalar(fb, 0, 32, 4);
+			fmt_arrow_fb_table_scalar(fb, 1, 1, 1);
+			index_type = fmt_arrow_fb_table_end(fb);
+
+			/* Dictionary identifier is the column index */
+			fmt_arrow_fb_table_start(fb, 2);
+			fmt_arrow_fb_table_scalar(fb, 0, i, 8);
+			fmt_arrow_fb_table_offset(fb, 1, index_type);
+			dictionary = fmt_arrow_fb_table_end(fb);
+		}
+
+		fmt_arrow_fb_vector_start(fb, 4, 0, 4);
+		children = fmt_arrow_fb_vector_end(fb, 0);
+
+		fmt_arrow_fb_table_start(fb, 6);
+		fmt_arrow_fb_table_offset(fb, 0, name);
+		fmt_arrow_fb_table_scalar(fb, 2, type_type, 1);
+		fmt_arrow_fb_table_offset(fb, 3, type);
+		if (dictionary)
+			fmt_arrow_fb_table_offset(fb, 4, dictionary);
+		fmt_arrow_fb_table_offset(fb, 5, children);
+		fmt_arrow_file.fields[i] = fmt_arrow_fb_table_end(fb);
+	}
+
+	fmt_arrow_fb_vector_start(fb, 4, fmt_arrow_file.columns_n, 4);
+
+	for (i = fmt_arrow_file.columns_n; i-- > 0; )
+		fmt_arrow_fb_offset(fb, fmt_arrow_file.fields[i]);
+
+	fields = fmt_arrow_fb_vector_end(fb, fmt_arrow_file.columns_n);
+
+	fmt_arrow_fb_table_start(fb, 2);
+	fmt_arrow_fb_table_scalar(fb, 0, FMT_ARROW_ENDIANNESS, 2);
+	fmt_arrow_fb_table_offset(fb, 1, fields);
+	return fmt_arrow_fb_table_end(fb);
+}
+
+/**
+ * Build record batch table
+ *
+ * All nodes have the same length and no nulls.
+ *
+ * @param[in,out] fb        Pointer to the builder.
+ * @param[in]     length    Number of rows.
+ * @param[in]     nodes_n   Number of field nodes.
+ * @param[in]     spans     Body buffers.
+ * @param[in]     spans_n   Number of the body buffers.
+ * @param[out]    body_size Body size.
+ *
+ * @return Offset of the table
+ */
+static size_t fmt_arrow_fb_record_batch(
+	fmt_arrow_fb_t *fb,
+	uint32_t length,
+	unsigned int nodes_n,
+	const fmt_arrow_span_t *spans,
+	unsigned int spans_n,
+	uint64_t *body_size
+)
+{
+	uint64_t offset = 0;
+	size_t nodes, buffers;
+	unsigned int i;
+
+	for (i = 0; i < spans_n; i++)
+		offset += FMT_ARROW_ALIGN(spans[i].size);
+
+	*body_size = offset;
+
+	fmt_arrow_fb_vector_start(fb, 16, spans_n, 8);
+
+	for (i = spans_n; i-- > 0; )
+	{
+		offset -= FMT_ARROW_ALIGN(spans[i].size);
+		fmt_arrow_fb_scalar(fb, spans[i].size, 8);
+		fmt_arrow_fb_scalar(fb, offset, 8);
+	}
+
+	buffers = fmt_arrow_fb_vector_end(fb, spans_n);
+
+	fmt_arrow_fb_vector_start(fb, 16, nodes_n, 8);
+
+	for (i = 0; i < nodes_n; i++)
+	{
+		fmt_arrow_fb_scalar(fb, 0, 8);
+		fmt_arrow_fb_scalar(fb, length, 8);
+	}
+
+	nodes = fmt_arrow_fb_vector_end(fb, nodes_n);
+
+	fmt_arrow_fb_table_start(fb, 3);
+	fmt_arrow_fb_table_scalar(fb, 0, length, 8);
+	fmt_arrow_fb_table_offset(fb, 1, nodes);
+	fmt_arrow_fb_table_offset(fb, 2, buffers);
+	return fmt_arrow_fb_table_end(fb);
+}
+
+/**
+ * Write message
+ *
+ * Message metadata is built with the header table and written with the
+ * body buffers. Flatbuffers builder is cleared.
+ *
+ * @param[in,out] out         Pointer to the output structure.
+ * @param[in]     header_type Message header type.
+ * @param[in]     header      Offset of the header table.
+ * @param[in]     spans       Body buffers.
+ * @param[in]     spans_n     Number of the body buffers.
+ * @param[in]     body_size   Body size.
+ * @param[in,out] blocks      Array to add the message position or NULL.
+ */
+static void fmt_arrow_write_message(
+	syslog_output_t *out,
+	unsigned int header_type,
+	size_t header,
+	const fmt_arrow_span_t *spans,
+	unsigned int spans_n,
+	uint64_t body_size,
+	fmt_arrow_blocks_t *blocks
+)
+{
+	fmt_arrow_fb_t *fb = &fmt_arrow_file.fb;
+	fmt_arrow_block_t block;
+	unsigned int i;
+	int ret;
+
+	fmt_arrow_fb_table_start(fb, 4);
+	fmt_arrow_fb_table_scalar(fb, 0, ARROW_METADATA_V5, 2);
+	fmt_arrow_fb_table_scalar(fb, 1, header_type, 1);
+	fmt_arrow_fb_table_offset(fb, 2, header);
+	fmt_arrow_fb_table_scalar(fb, 3, body_size, 8);
+	fmt_arrow_fb_finish(fb, fmt_arrow_fb_table_end(fb));
+
+	if (fb->error)
+	{
+		fmt_arrow_file.error = fb->error;
+		return;
+	}
+
+	block.offset = fmt_arrow_file.offset;
+	block.metadata_size = 8 + FMT_ARROW_ALIGN(fb->size);
+	block.body_size = body_size;
+
+	/* Continuation marker and metadata size */
+	fmt_arrow_write_u32(out, 0xffffffff);
+	fmt_arrow_write_u32(out, block.metadata_size - 8);
+	fmt_arrow_write(out, fmt_arrow_fb_data(fb), fb->size);
+	fmt_arrow_write_padding(out);
+	fmt_arrow_fb_clear(fb);
+
+	for (i = 0; i < spans_n; i++)
+	{
+		if (!spans[i].size)
+			continue;
+
+		fmt_arrow_write(out, spans[i].data, spans[i].size);
+		fmt_arrow_write_padding(out);
+	}
+
+	if (blocks)
+	{
+		ret = fmt_arrow_blocks_add(blocks, &block);
+		if (ret)
+			fmt_arrow_file.error = ret;
+	}
+}
+
+/**
+ * Write new values of the dictionary as dictionary batch
+ */
+static void fmt_arrow_write_dictionary(
+	syslog_output_t *out,
+	unsigned int column_index
+)
+{
+	fmt_arrow_dict_t *dict = &fmt_arrow_file.columns[column_index].dict;
+	fmt_arrow_fb_t *fb = &fmt_arrow_file.fb;
+	const int32_t *offsets = (const int32_t *)dict->offsets.data;
+	int32_t start = offsets[dict->written_n];
+	uint32_t new_n = dict->values_n - dict->written_n;
+	fmt_arrow_span_t spans[3];
+	uint64_t body_size;
+	size_t batch, header;
+	uint32_t i;
+
+	/* Offsets of the delta values start from zero */
+	fmt_arrow_file.scratch.size = 0;
+
+	for (i = dict->written_n; i <= dict->values_n; i++)
+	{
+		if (fmt_arrow_buffer_int32(&fmt_arrow_file.scratch, offsets[i] - start))
+		{
+			fmt_arrow_file.error = -ENOMEM;
+			return;
+		}
+	}
+
+	spans[0].data = NULL;
+	spans[0].size = 0;
+	spans[1].data = fmt_arrow_file.scratch.data;
+	spans[1].size = fmt_arrow_file.scratch.size;
+	spans[2].data = dict->data.data + start;
+	spans[2].size = offsets[dict->values_n] - start;
+
+	batch = fmt_arrow_fb_record_batch(fb, new_n, 1, spans, 3, &body_size);
+
+	fmt_arrow_fb_table_start(fb, 3);
+	fmt_arrow_fb_table_scalar(fb, 0, column_index, 8);
+	fmt_arrow_fb_table_offset(fb, 1, batch);
+	if (dict->written_n)
+		fmt_arrow_fb_table_scalar(fb, 2, 1, 1);
+	header = fmt_arrow_fb_table_end(fb);
+
+	fmt_arrow_write_message(out, ARROW_HEADER_DICTIONARY_BATCH, header,
+		spans, 3, body_size, &fmt_arrow_file.dictionaries);
+
+	dict->written_n = dict->values_n;
+}
+
+/**
+ * Write collected rows as record batch (preceded by the
+ * dictionary batches with the new dictionary values)
+ */
+static void fmt_arrow_write_batch(syslog_output_t *out)
+{
+	fmt_arrow_fb_t *fb = &fmt_arrow_file.fb;
+	fmt_arrow_span_t *spans = fmt_arrow_file.spans;
+	unsigned int spans_n = 0;
+	uint64_t body_size;
+	unsigned int i;
+	size_t header;
+
+	for (i = 0; i < fmt_arrow_file.columns_n; i++)
+	{
+		fmt_arrow_column_t *column = &fmt_arrow_file.columns[i];
+
+		if ((column->type == FMT_ARROW_COLUMN_DICTIONARY) &&
+		    (column->dict.written_n < column->dict.values_n))
+			fmt_arrow_write_dictionary(out, i);
+
+		/* Validity bitmap is omitted (no nulls) */
+		spans[spans_n].data = NULL;
+		spans[spans_n].size = 0;
+		spans_n++;
+
+		spans[spans_n].data = column->values.data;
+		spans[spans_n].size = column->values.size;
+		spans_n++;
+
+		if (column->type == FMT_ARROW_COLUMN_UTF8)
+		{
+			spans[spans_n].data = column->data.data;
+			spans[spans_n].size = column->data.size;
+			spans_n++;
+		}
+	}
+
+	header = fmt_arrow_fb_record_batch(fb, fmt_arrow_file.rows_n,
+		fmt_arrow_file.columns_n, spans, spans_n, &body_size);
+
+	fmt_arrow_write_message(out, ARROW_HEADER_RECORD_BATCH, header,
+		spans, spans_n, body_size, &fmt_arrow_file.batches);
+
+	for (i = 0; i < fmt_arrow_file.columns_n; i++)
+	{
+		fmt_arrow_column_t *column = &fmt_arrow_file.columns[i];
+
+		column->values.size = 0;
+		column->data.size = 0;
+
+		/* Offsets buffer starts with zero offset */
+		if (column->type == FMT_ARROW_COLUMN_UTF8)
+			fmt_arrow_buffer_int32(&column->values, 0);
+	}
+
+	fmt_arrow_file.rows_n = 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Free all allocated resources
+ */
+static void fmt_arrow_free(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < fmt_arrow_file.columns_n; i++)
+	{
+		fmt_arrow_column_t *column = &fmt_arrow_file.columns[i];
+
+		fmt_arrow_buffer_free(&column->values);
+		fmt_arrow_buffer_free(&column->data);
+		fmt_arrow_buffer_free(&column->dict.offsets);
+		fmt_arrow_buffer_free(&column->dict.data);
+		syslog_intern_free(&column->dict.intern);
+	}
+
+	free(fmt_arrow_file.columns);
+	free(fmt_arrow_file.dictionaries.blocks);
+	free(fmt_arrow_file.batches.blocks);
+	free(fmt_arrow_file.spans);
+	free(fmt_arrow_file.fields);
+	fmt_arrow_buffer_free(&fmt_arrow_file.scratch);
+	free(fmt_arrow_file.fb.buffer);
+
+	memset(&fmt_arrow_file, 0, sizeof(fmt_arrow_file));
+}
+
+static void fmt_arrow_output_init(const syslog_entry_t *entry)
+{
+	syslog_field_t *field;
+	unsigned int n = 0;
+
+	fmt_arrow_free();
+	fmt_arrow_fb_clear(&fmt_arrow_file.fb);
+
+	fmt_arrow_file.columns = calloc(entry->fields_output_num + 1,
+		sizeof(fmt_arrow_column_t));
+	fmt_arrow_file.spans = calloc(entry->fields_output_num * 3 + 1,
+		sizeof(fmt_arrow_span_t));
+	fmt_arrow_file.fields = calloc(entry->fields_output_num + 1,
+		sizeof(uint32_t));
+
+	if (!fmt_arrow_file.columns || !fmt_arrow_file.spans ||
+	    !fmt_arrow_file.fields)
+	{
+		fmt_arrow_file.error = -ENOMEM;
+		return;
+	}
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		fmt_arrow_column_t *column;
+
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		column = &fmt_arrow_file.columns[n++];
+		column->info = field->info;
+
+		switch(field->info->type)
+		{
+			case SYSLOG_FIELD_TYPE_TIME:
+				column->type = FMT_ARROW_COLUMN_TIMESTAMP;
+				break;
+
+			case SYSLOG_FIELD_TYPE_INTEGER:
+				column->type = FMT_ARROW_COLUMN_INT64;
+				break;
+
+			case SYSLOG_FIELD_TYPE_UINTEGER:
+				column->type = FMT_ARROW_COLUMN_UINT64;
+				break;
+
+			case SYSLOG_FIELD_TYPE_STRING:
+				if ((field->info->id == SYSLOG_FIELD_ID_FACILITY) ||
+				    (field->info->id == SYSLOG_FIELD_ID_PRIORITY))
+				{
+					column->type = FMT_ARROW_COLUMN_DICTIONARY;
+
+					if (fmt_arrow_buffer_int32(&column->dict.offsets, 0))
+						fmt_arrow_file.error = -ENOMEM;
+				}
+				else
+				{
+					column->type = FMT_ARROW_COLUMN_UTF8;
+
+					if (fmt_arrow_buffer_int32(&column->values, 0))
+						fmt_arrow_file.error = -ENOMEM;
+				}
+				break;
+		}
+	}
+
+	fmt_arrow_file.columns_n = n;
+}
+
+static void fmt_arrow_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	fmt_arrow_fb_t *fb = &fmt_arrow_file.fb;
+
+	(void)entry;
+
+	if (fmt_arrow_file.error)
+	{
+		out->error = fmt_arrow_file.error;
+		return;
+	}
+
+	/* Magic with padding */
+	fmt_arrow_write(out, "ARROW1\0\0", 8);
+
+	fmt_arrow_write_message(out, ARROW_HEADER_SCHEMA,
+		fmt_arrow_fb_schema(fb), NULL, 0, 0, NULL);
+
+	if (fmt_arrow_file.error && !out->error)
+		out->error = fmt_arrow_file.error;
+}
+
+static void fmt_arrow_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	syslog_field_t *field;
+	unsigned int n = 0;
+	int full = 0;
+	int64_t value;
+	int32_t index;
+	int ret = 0;
+
+	if (fmt_arrow_file.error)
+		return;
+
+	for (field = entry->fields; field && !ret; field = field->next)
+	{
+		fmt_arrow_column_t *column;
+		const char *string;
+
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		column = &fmt_arrow_file.columns[n++];
+
+		switch(column->type)
+		{
+			case FMT_ARROW_COLUMN_TIMESTAMP:
+				value = (int64_t)field->value.time.unixtime;
+				ret = fmt_arrow_buffer_append(
+					&column->values, &value, sizeof(value));
+				break;
+
+			case FMT_ARROW_COLUMN_INT64:
+				value = field->value.integer;
+				ret = fmt_arrow_buffer_append(
+					&column->values, &value, sizeof(value));
+				break;
+
+			case FMT_ARROW_COLUMN_UINT64:
+				value = (int64_t)field->value.uinteger;
+				ret = fmt_arrow_buffer_append(
+					&column->values, &value, sizeof(value));
+				break;
+
+			case FMT_ARROW_COLUMN_UTF8:
+				string = field->value.string ? field->value.string : "";
+				ret = fmt_arrow_buffer_utf8(&column->data, string);
+				if (!ret)
+				{
+					ret = fmt_arrow_buffer_int32(
+						&column->values, column->data.size);
+				}
+
+				if (column->data.size >= FMT_ARROW_BATCH_DATA_SIZE)
+					full = 1;
+				break;
+
+			case FMT_ARROW_COLUMN_DICTIONARY:
+				string = field->value.string ? field->value.string : "";
+				ret = fmt_arrow_dict_index(&column->dict, string, &index);
+				if (!ret)
+					ret = fmt_arrow_buffer_int32(&column->values, index);
+				break;
+		}
+	}
+
+	if (ret)
+	{
+		fmt_arrow_file.error = ret;
+		out->error = ret;
+		return;
+	}
+
+	if ((++fmt_arrow_file.rows_n == FMT_ARROW_BATCH_ROWS) || full)
+		fmt_arrow_write_batch(out);
+
+	if (fmt_arrow_file.error && !out->error)
+		out->error = fmt_arrow_file.error;
+}
+
+static void fmt_arrow_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	fmt_arrow_fb_t *fb = &fmt_arrow_file.fb;
+	uint64_t footer_offset;
+	size_t schema, dictionaries, batches;
+
+	(void)entry;
+
+	if (fmt_arrow_file.rows_n && !fmt_arrow_file.error)
+		fmt_arrow_write_batch(out);
+
+	if (fmt_arrow_file.error)
+	{
+		if (!out->error)
+			out->error = fmt_arrow_file.error;
+
+		fmt_arrow_free();
+		return;
+	}
+
+	/* End-of-stream marker */
+	fmt_arrow_write_u32(out, 0xffffffff);
+	fmt_arrow_write_u32(out, 0);
+
+	schema = fmt_arrow_fb_schema(fb);
+	dictionaries = fmt_arrow_fb_blocks(fb, &fmt_arrow_file.dictionaries);
+	batches = fmt_arrow_fb_blocks(fb, &fmt_arrow_file.batches);
+
+	fmt_arrow_fb_table_start(fb, 4);
+	fmt_arrow_fb_table_scalar(fb, 0, ARROW_METADATA_V5, 2);
+	fmt_arrow_fb_table_offset(fb, 1, schema);
+	fmt_arrow_fb_table_offset(fb, 2, dictionaries);
+	fmt_arrow_fb_table_offset(fb, 3, batches);
+	fmt_arrow_fb_finish(fb, fmt_arrow_fb_table_end(fb));
+
+	if (fb->error)
+	{
+		if (!out->error)
+			out->error = fb->error;
+
+		fmt_arrow_free();
+		return;
+	}
+
+	footer_offset = fmt_arrow_file.offset;
+	fmt_arrow_write(out, fmt_arrow_fb_data(fb), fb->size);
+	fmt_arrow_write_u32(out, fmt_arrow_file.offset - footer_offset);
+	fmt_arrow_write(out, "ARROW1", 6);
+
+	fmt_arrow_free();
+}
+
+output_fmt_t fmt_arrow =
+{
+	.name              = "arrow",
+	.description       = "Apache Arrow IPC file (columnar binary)",
+	.flags             = OUTPUT_FMT_FLAG_SEQUENTIAL | OUTPUT_FMT_FLAG_NOAPPEND,
+	.fn_output_init    = fmt_arrow_output_init,
+	.fn_output_start   = fmt_arrow_output_start,
+	.fn_output_entry   = fmt_arrow_output_entry,
+	.fn_output_end     = fmt_arrow_output_end
+};
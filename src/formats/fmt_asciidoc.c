@@ -18,12 +18,15 @@
 
 #include <syslog_fc.h>
 
-static void fmt_asciidoc_output_start(const syslog_entry_t *entry)
+static void fmt_asciidoc_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	int count = 0;
 	syslog_field_t *field;
 
-	fputs("[cols=\"", stdout);
+	syslog_output_puts(out, "[cols=\"");
 
 	for (field = entry->fields; field; field = field->next)
 	{
@@ -31,70 +34,84 @@ static void fmt_asciidoc_output_start(const syslog_entry_t *entry)
 			continue;
 
 		if (count)
-			fputs(",", stdout);
+			syslog_output_putc(out, ',');
 
 		if (field->info->id == SYSLOG_FIELD_ID_TIMESTAMP)
-			fputs("30", stdout);
+			syslog_output_puts(out, "30");
 		else if (field->info->id == SYSLOG_FIELD_ID_MESSAGE)
-			fputs("70", stdout);
+			syslog_output_puts(out, "70");
 		else
-			fputs("1", stdout);
+			syslog_output_putc(out, '1');
 
 		count++;
 	}
 	
-	fputs("\", options=\"header\"]\n", stdout);
-	fputs("|===\n", stdout);
+	syslog_output_puts(out, "\", options=\"header\"]\n");
+	syslog_output_puts(out, "|===\n");
 
 	for (field = entry->fields; field; field = field->next)
 	{
 		if (!(field->flags & SYSLOG_FIELD_FLAG_DROP))
-			printf("|%s\n", field->info->human_name);
+		{
+			syslog_output_putc(out, '|');
+			syslog_output_puts(out, field->info->human_name);
+			syslog_output_putc(out, '\n');
+		}
 	}
 }
 
-static void fmt_asciidoc_output_stop(const syslog_entry_t *entry)
+static void fmt_asciidoc_output_stop(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
-	printf("|===\n");
+	syslog_output_puts(out, "|===\n");
 }
 
-static void fmt_asciidoc_output_entry(const syslog_entry_t *entry)
+static void fmt_asciidoc_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	syslog_field_t *field;
 
-	printf("\n");
+	syslog_output_putc(out, '\n');
 
 	for (field = entry->fields; field; field = field->next)
 	{
 		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
 			continue;
 
-		printf("|");
+		syslog_output_putc(out, '|');
 
 		switch(field->info->type)
 		{
 			case SYSLOG_FIELD_TYPE_TIME:
-				printf("%s", syslog_field_time_fmt(field));
+				syslog_output_puts(out, syslog_field_time_fmt(field));
 				break;
 
 			case SYSLOG_FIELD_TYPE_INTEGER:
-				printf("%ld", field->value.integer);
+				syslog_output_int(out, field->value.integer);
 				break;
 
 			case SYSLOG_FIELD_TYPE_UINTEGER:
-				printf("%lu", field->value.uinteger);
+				syslog_output_uint(out, field->value.uinteger);
 				break;
 
 			case SYSLOG_FIELD_TYPE_STRING:
 				if (field->info->id == SYSLOG_FIELD_ID_MESSAGE)
-					printf("`%s`", field->value.string);
+				{
+					syslog_output_putc(out, '`');
+					syslog_output_puts(out, field->value.string);
+					syslog_output_putc(out, '`');
+				}
 				else
-					printf("%s", field->value.string);
+					syslog_output_puts(out, field->value.string);
 
 				break;
 		}
 
-		printf("\n");
+		syslog_output_putc(out, '\n');
 	}
 }
 
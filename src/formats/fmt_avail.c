@@ -0,0 +1,49 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * Available output formats
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Available output formats
+ *
+ * Table is shared by the converter and the benchmark, so the benchmark
+ * measures all output formats selectable by the "-f" option.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <syslog_fc.h>
+
+#include <fmt_avail.h>
+#include <fmt_plain.h>
+#include <fmt_json.h>
+#include <fmt_ndjson.h>
+#include <fmt_msgpack.h>
+#include <fmt_cbor.h>
+#include <fmt_arrow.h>
+#include <fmt_csv.h>
+#include <fmt_md.h>
+#include <fmt_html.h>
+#include <fmt_asciidoc.h>
+
+const output_fmt_t *const fmt_avail[FMT_AVAIL_NUM + 1] =
+{
+	&fmt_plain,
+	&fmt_md,
+	&fmt_csv,
+	&fmt_json,
+	&fmt_ndjson,
+	&fmt_msgpack,
+	&fmt_cbor,
+	&fmt_arrow,
+	&fmt_html,
+	&fmt_asciidoc,
+	NULL
+};
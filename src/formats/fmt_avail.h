@@ -0,0 +1,30 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * Available output formats
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Available output formats
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __FMT_AVAIL_H__
+#define __FMT_AVAIL_H__
+
+#include "syslog_fc.h"
+
+/** @brief Number of the available output formats */
+#define FMT_AVAIL_NUM  10
+
+/** @brief Available output formats (NULL-terminated) */
+extern const output_fmt_t *const fmt_avail[FMT_AVAIL_NUM + 1];
+
+#endif /* __FMT_AVAIL_H__ */
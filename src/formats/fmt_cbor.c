@@ -0,0 +1,218 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * CBOR output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief CBOR output format support
+ *
+ * Each entry is output as CBOR map with field parameter names as keys,
+ * maps of the entries form CBOR sequence (RFC 8742). Timestamps (signed
+ * Unix time) and integers are output as integers, strings are output as
+ * length-prefixed text strings (or byte strings if string is not
+ * a valid UTF-8), so no escaping is required.
+ *
+ * Keys are encoded once by the output preparation callback.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <fmt_cbor.h>
+
+/** @brief Maximum number of fields with the pre-encoded keys */
+#define FMT_CBOR_MAX_KEYS  32
+
+/** @brief Size of the pre-encoded keys buffer */
+#define FMT_CBOR_KEYS_SIZE  1024
+
+/** @brief Offsets of the pre-encoded keys of the output fields in the
+ *         entry order (and the end offset of the last key) */
+static size_t fmt_cbor_keys[FMT_CBOR_MAX_KEYS + 1];
+
+/** @brief Number of the output fields (0 if keys are not pre-encoded) */
+static unsigned int fmt_cbor_keys_n;
+
+/** @brief Pre-encoded keys data */
+static char fmt_cbor_keys_data[FMT_CBOR_KEYS_SIZE];
+
+/**
+ * @name CBOR major types
+ * @{
+ */
+#define CBOR_MAJOR_UINT    0
+#define CBOR_MAJOR_NEGINT  1
+#define CBOR_MAJOR_BYTES   2
+#define CBOR_MAJOR_TEXT    3
+#define CBOR_MAJOR_MAP     5
+/** @} */
+
+/**
+ * Output data item head (major type and argument)
+ *
+ * @param[in,out] out   Pointer to the output structure.
+ * @param[in]     major Major type.
+ * @param[in]     value Argument value.
+ */
+static void fmt_cbor_output_head(
+	syslog_output_t *out,
+	unsigned int major,
+	uint64_t value
+)
+{
+	uint8_t head[9];
+	unsigned int size;
+	unsigned int i;
+
+	if (value < 24)
+	{
+		syslog_output_putc(out, (char)((major << 5) | value));
+		return;
+	}
+
+	if (value <= UINT8_MAX)
+	{
+		head[0] = (major << 5) | 24;
+		size = 1;
+	}
+	else if (value <= UINT16_MAX)
+	{
+		head[0] = (major << 5) | 25;
+		size = 2;
+	}
+	else if (value <= UINT32_MAX)
+	{
+		head[0] = (major << 5) | 26;
+		size = 4;
+	}
+	else
+	{
+		head[0] = (major << 5) | 27;
+		size = 8;
+	}
+
+	for (i = 0; i < size; i++)
+		head[1 + i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+
+	syslog_output_write(out, head, size + 1);
+}
+
+static void fmt_cbor_output_int(syslog_output_t *out, int64_t value)
+{
+	if (value >= 0)
+		fmt_cbor_output_head(out, CBOR_MAJOR_UINT, value);
+	else
+		fmt_cbor_output_head(out, CBOR_MAJOR_NEGINT, -(value + 1));
+}
+
+static void fmt_cbor_output_string(syslog_output_t *out, const char *string)
+{
+	size_t len = strlen(string);
+
+	fmt_cbor_output_head(out,
+		(syslog_output_utf8_valid(string, len) == len) ?
+			CBOR_MAJOR_TEXT : CBOR_MAJOR_BYTES, len);
+
+	syslog_output_write(out, string, len);
+}
+
+static void fmt_cbor_output_init(const syslog_entry_t *entry)
+{
+	syslog_output_t keys;
+	syslog_field_t *field;
+	unsigned int count = 0;
+
+	fmt_cbor_keys_n = 0;
+
+	if (syslog_output_open(&keys, -1))
+		return;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		/* Too many fields, keys are encoded for each entry */
+		if (count == FMT_CBOR_MAX_KEYS)
+			break;
+
+		fmt_cbor_keys[count++] = keys.size;
+		fmt_cbor_output_string(&keys, field->info->param_name);
+	}
+
+	if (!field && !keys.error && (keys.size <= FMT_CBOR_KEYS_SIZE))
+	{
+		memcpy(fmt_cbor_keys_data, keys.buffer, keys.size);
+		fmt_cbor_keys[count] = keys.size;
+		fmt_cbor_keys_n = count;
+	}
+
+	syslog_output_close(&keys);
+}
+
+static void fmt_cbor_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	unsigned int count = 0;
+	syslog_field_t *field;
+
+	fmt_cbor_output_head(out, CBOR_MAJOR_MAP, entry->fields_output_num);
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		if (count < fmt_cbor_keys_n)
+		{
+			syslog_output_write(out,
+				fmt_cbor_keys_data + fmt_cbor_keys[count],
+				fmt_cbor_keys[count + 1] - fmt_cbor_keys[count]);
+		}
+		else
+			fmt_cbor_output_string(out, field->info->param_name);
+
+		++count;
+
+		switch(field->info->type)
+		{
+			case SYSLOG_FIELD_TYPE_TIME:
+				fmt_cbor_output_int(out,
+					(time_t)field->value.time.unixtime);
+				break;
+
+			case SYSLOG_FIELD_TYPE_INTEGER:
+				fmt_cbor_output_int(out, field->value.integer);
+				break;
+
+			case SYSLOG_FIELD_TYPE_UINTEGER:
+				fmt_cbor_output_head(out, CBOR_MAJOR_UINT,
+					field->value.uinteger);
+				break;
+
+			case SYSLOG_FIELD_TYPE_STRING:
+				fmt_cbor_output_string(out,
+					field->value.string ? field->value.string : "");
+				break;
+		}
+	}
+}
+
+output_fmt_t fmt_cbor =
+{
+	.name              = "cbor",
+	.description       = "CBOR (sequence of maps)",
+	.fn_output_init    = fmt_cbor_output_init,
+	.fn_output_entry   = fmt_cbor_output_entry
+};
@@ -0,0 +1,27 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * CBOR output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief CBOR output format support
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __FMT_CBOR_H__
+#define __FMT_CBOR_H__
+
+#include "syslog_fc.h"
+
+/** @brief CBOR output format data structure */
+extern output_fmt_t fmt_cbor;
+
+#endif /* __FMT_CBOR_H__ */
@@ -18,36 +18,30 @@
 
 #include <syslog_fc.h>
 
-static void fmt_csv_output_encoded(const char *string)
+/*
+ * RFC 4180:
+ *
+ * If double-quotes are used to enclose fields,
+ * then a double-quote appearing inside a field
+ * must be escaped by preceding it with another
+ * double quote.
+ */
+static const syslog_output_escapes_t fmt_csv_escapes =
 {
-	const char *p = string;
-
-	fputc('"', stdout);
-
-	while (*p)
-	{
-		if (*p == '"')
-		{
-			/*
-			 * RFC 4180:
-			 *
-			 * If double-quotes are used to enclose fields,
-			 * then a double-quote appearing inside a field
-			 * must be escaped by preceding it with another
-			 * double quote.  For example:
-			 */
-			fputs("\"\"", stdout);
-		}
-		else
-			fputc(*p, stdout);
-
-		p++;
-	}
+	['"'] = "\"\"",
+};
 
-	fputc('"', stdout);
+static void fmt_csv_output_encoded(syslog_output_t *out, const char *string)
+{
+	syslog_output_putc(out, '"');
+	syslog_output_escaped(out, string, fmt_csv_escapes);
+	syslog_output_putc(out, '"');
 }
 
-static void fmt_csv_output_start(const syslog_entry_t *entry)
+static void fmt_csv_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	int count = 0;
 	syslog_field_t *field;
@@ -58,17 +52,20 @@ static void fmt_csv_output_start(const syslog_entry_t *entry)
 			continue;
 
 		if (count)
-			fputs(config.csv_delimeter, stdout);
+			syslog_output_puts(out, config.csv_delimeter);
 
-		printf("%s", field->info->human_name);
+		syslog_output_puts(out, field->info->human_name);
 			
 		++count;
 	}
 
-	fputc('\n', stdout);
+	syslog_output_putc(out, '\n');
 }
 
-static void fmt_csv_output_entry(const syslog_entry_t *entry)
+static void fmt_csv_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	int count = 0;
 	syslog_field_t *field;
@@ -79,31 +76,31 @@ static void fmt_csv_output_entry(const syslog_entry_t *entry)
 			continue;
 
 		if (count)
-			fputs(config.csv_delimeter, stdout);
+			syslog_output_puts(out, config.csv_delimeter);
 
 		switch(field->info->type)
 		{
 			case SYSLOG_FIELD_TYPE_TIME:
-				fmt_csv_output_encoded(syslog_field_time_fmt(field));
+				fmt_csv_output_encoded(out, syslog_field_time_fmt(field));
 				break;
 
 			case SYSLOG_FIELD_TYPE_INTEGER:
-				printf("%ld", field->value.integer);
+				syslog_output_int(out, field->value.integer);
 				break;
 
 			case SYSLOG_FIELD_TYPE_UINTEGER:
-				printf("%lu", field->value.uinteger);
+				syslog_output_uint(out, field->value.uinteger);
 				break;
 
 			case SYSLOG_FIELD_TYPE_STRING:
-				fmt_csv_output_encoded(field->value.string);
+				fmt_csv_output_encoded(out, field->value.string);
 				break;
 		}
 
 		++count;
 	}
 
-	fputc('\n', stdout);
+	syslog_output_putc(out, '\n');
 }
 
 output_fmt_t fmt_csv =
@@ -19,49 +19,51 @@
 #include <syslog_fc.h>
 
 static void fmt_html_open_tag(
+	syslog_output_t *out,
 	const char *tag,
 	const char *class_prefix,
 	const char *class
 )
 {
+	syslog_output_putc(out, '<');
+	syslog_output_puts(out, tag);
+
 	if (class)
 	{
-		fprintf(stdout, "<%s class=\"%s%s\">",
-			tag, class_prefix ? class_prefix : "", class);
-	}
-	else
-	{
-		fprintf(stdout, "<%s>", tag);
+		syslog_output_puts(out, " class=\"");
+
+		if (class_prefix)
+			syslog_output_puts(out, class_prefix);
+
+		syslog_output_puts(out, class);
+		syslog_output_putc(out, '"');
 	}
+
+	syslog_output_putc(out, '>');
 }
 
-static void fmt_html_close_tag(const char *tag)
+static void fmt_html_close_tag(syslog_output_t *out, const char *tag)
 {
-	fprintf(stdout, "</%s>", tag);
+	syslog_output_puts(out, "</");
+	syslog_output_puts(out, tag);
+	syslog_output_putc(out, '>');
 }
 
-static void fmt_html_output_encoded(const char *string)
+static const syslog_output_escapes_t fmt_html_escapes =
 {
-	const char *p = string;
-	while (*p)
-	{
-		switch(*p)
-		{
-			case '\n': fputs("<br />",  stdout); break;
-			case '&' : fputs("&amp;", stdout); break;
-			case '<' : fputs("&lt;", stdout); break;
-			case '>' : fputs("&gt;", stdout); break;
-
-			default:
-				fputc(*p, stdout);
-				break;
-		}
+	['\n'] = "<br />",
+	['&' ] = "&amp;",
+	['<' ] = "&lt;",
+	['>' ] = "&gt;",
+};
 
-		p++;
-	}
+static void fmt_html_output_encoded(syslog_output_t *out, const char *string)
+{
+	syslog_output_escaped(out, string, fmt_html_escapes);
 }
 
 static void fmt_html_output_row(
+	syslog_output_t *out,
 	const char *html_cell_tag,
 	const syslog_entry_t *entry
 )
@@ -84,7 +86,7 @@ static void fmt_html_output_row(
 	}
 
 	/* Start table row */
-	fmt_html_open_tag("tr", config.html_class_prefix, tr_class);
+	fmt_html_open_tag(out, "tr", config.html_class_prefix, tr_class);
 
 	for (field = entry->fields; field; field = field->next)
 	{
@@ -92,7 +94,7 @@ static void fmt_html_output_row(
 			continue;
 
 		/* Start table cell */
-		fmt_html_open_tag(html_cell_tag,
+		fmt_html_open_tag(out, html_cell_tag,
 			config.html_class_prefix,
 			config.html_cell_classes ? field->info->param_name : NULL);
 
@@ -102,26 +104,26 @@ static void fmt_html_output_row(
 			switch(field->info->type)
 			{
 				case SYSLOG_FIELD_TYPE_TIME:
-					fmt_html_output_encoded(syslog_field_time_fmt(field));
+					fmt_html_output_encoded(out, syslog_field_time_fmt(field));
 					break;
 
 				case SYSLOG_FIELD_TYPE_INTEGER:
-					printf("%ld", field->value.integer);
+					syslog_output_int(out, field->value.integer);
 					break;
 
 				case SYSLOG_FIELD_TYPE_UINTEGER:
-					printf("%lu", field->value.uinteger);
+					syslog_output_uint(out, field->value.uinteger);
 					break;
 
 				case SYSLOG_FIELD_TYPE_STRING:
 					if (field->info->id == SYSLOG_FIELD_ID_MESSAGE)
 					{
-						fmt_html_open_tag("pre", NULL, NULL);
-						fmt_html_output_encoded(field->value.string);
-						fmt_html_close_tag("pre");
+						fmt_html_open_tag(out, "pre", NULL, NULL);
+						fmt_html_output_encoded(out, field->value.string);
+						fmt_html_close_tag(out, "pre");
 					}
 					else
-						fmt_html_output_encoded(field->value.string);
+						fmt_html_output_encoded(out, field->value.string);
 
 					break;
 			}
@@ -129,46 +131,55 @@ static void fmt_html_output_row(
 		else
 		{
 			/* Header */
-			fmt_html_output_encoded(field->info->human_name);
+			fmt_html_output_encoded(out, field->info->human_name);
 		}
 
 		/* End table cell */
-		fmt_html_close_tag(html_cell_tag);
+		fmt_html_close_tag(out, html_cell_tag);
 	}
 
 	/* End table row */
-	fmt_html_close_tag("tr");
+	fmt_html_close_tag(out, "tr");
 }
 
-static void fmt_html_output_start(const syslog_entry_t *entry)
+static void fmt_html_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	/* Start table */
-	fmt_html_open_tag("table", config.html_class_prefix, "table");
+	fmt_html_open_tag(out, "table", config.html_class_prefix, "table");
 
 	/* Start heading */
-	fmt_html_open_tag("thead", NULL, NULL);
+	fmt_html_open_tag(out, "thead", NULL, NULL);
 
 	/* Heading row */
-	fmt_html_output_row("th", entry);
+	fmt_html_output_row(out, "th", entry);
 
 	/* End heading */
-	fmt_html_close_tag("thead");
+	fmt_html_close_tag(out, "thead");
 
 	/* Start body */
-	fmt_html_open_tag("tbody", NULL, NULL);
+	fmt_html_open_tag(out, "tbody", NULL, NULL);
 }
 
-static void fmt_html_output_entry(const syslog_entry_t *entry)
+static void fmt_html_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	/* Heading row */
-	fmt_html_output_row("td", entry);
+	fmt_html_output_row(out, "td", entry);
 }
 
-static void fmt_html_output_end(const syslog_entry_t *entry)
+static void fmt_html_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	/* End body and table */
-	fmt_html_close_tag("tbody");
-	fmt_html_close_tag("table");
+	fmt_html_close_tag(out, "tbody");
+	fmt_html_close_tag(out, "table");
 }
 
 output_fmt_t fmt_html =
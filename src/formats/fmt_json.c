@@ -18,97 +18,183 @@
 
 #include <ctype.h> /* tolower() */
 #include <syslog_fc.h>
+#include <fmt_json.h>
 
-static void fmt_json_output_encoded(const char *string)
+static const syslog_output_escapes_t fmt_json_escapes =
+{
+	['\b'] = "\\b",
+	['\f'] = "\\f",
+	['\n'] = "\\n",
+	['\r'] = "\\r",
+	['\t'] = "\\t",
+	['\\'] = "\\\\",
+	['"' ] = "\\\"",
+	[0x1b] = SYSLOG_OUTPUT_ESCAPE_STOP,
+};
+
+/* Other control characters are not allowed in the strict JSON strings */
+static const syslog_output_escapes_t fmt_json_strict_escapes =
+{
+	['\b'] = "\\b",
+	['\f'] = "\\f",
+	['\n'] = "\\n",
+	['\r'] = "\\r",
+	['\t'] = "\\t",
+	['\\'] = "\\\\",
+	['"' ] = "\\\"",
+	[0x01] = "\\u0001",
+	[0x02] = "\\u0002",
+	[0x03] = "\\u0003",
+	[0x04] = "\\u0004",
+	[0x05] = "\\u0005",
+	[0x06] = "\\u0006",
+	[0x07] = "\\u0007",
+	[0x0b] = "\\u000b",
+	[0x0e] = "\\u000e",
+	[0x0f] = "\\u000f",
+	[0x10] = "\\u0010",
+	[0x11] = "\\u0011",
+	[0x12] = "\\u0012",
+	[0x13] = "\\u0013",
+	[0x14] = "\\u0014",
+	[0x15] = "\\u0015",
+	[0x16] = "\\u0016",
+	[0x17] = "\\u0017",
+	[0x18] = "\\u0018",
+	[0x19] = "\\u0019",
+	[0x1a] = "\\u001a",
+	[0x1c] = "\\u001c",
+	[0x1d] = "\\u001d",
+	[0x1e] = "\\u001e",
+	[0x1f] = "\\u001f",
+	[0x1b] = SYSLOG_OUTPUT_ESCAPE_STOP,
+};
+
+/**
+ * Append escaped JSON string contents to the output
+ *
+ * @param[in,out] out     Pointer to the output data structure.
+ * @param[in]     string  NULL-terminated string.
+ * @param[in]     escapes Escapes table.
+ */
+static void fmt_json_output_escaped(
+	syslog_output_t *out,
+	const char *string,
+	const syslog_output_escapes_t escapes
+)
 {
 	const char *p = string;
-	while (*p)
+
+	while (*(p = syslog_output_escaped(out, p, escapes)))
 	{
-		switch (*p)
+		/* Do not output non-printable characters
+		 * Filter part of vt100 escape sequences such
+		 * as vt100 colors, etc */
+		while (*p)
 		{
-			case '\b': fputs("\\b",  stdout); break;
-			case '\f': fputs("\\f",  stdout); break;
-			case '\n': fputs("\\n",  stdout); break;
-			case '\r': fputs("\\r",  stdout); break;
-			case '\t': fputs("\\t",  stdout); break;
-			case '\\': fputs("\\\\", stdout); break;
-			case '"' : fputs("\\\"", stdout); break;
-			case 0x1b:
-				/* Do not output non-printable characters
-				 * Filter part of vt100 escape sequences such
-				 * as vt100 colors, etc */
-				while (*p)
-				{
-					if (strchr("abcdhsujkm", tolower(*p)))
-						break;
-
-					p++;
-				}
-
+			if (strchr("abcdhsujkm", tolower(*p)))
 				break;
 
-			default:
-				fputc(*p, stdout);
-				break;
+			p++;
 		}
 
-		p++;
+		if (*p)
+			p++;
 	}
 }
 
-static void fmt_json_output_start(const syslog_entry_t *entry)
+void fmt_json_output_encoded(syslog_output_t *out, const char *string)
+{
+	fmt_json_output_escaped(out, string, fmt_json_escapes);
+}
+
+void fmt_json_output_encoded_strict(syslog_output_t *out, const char *string)
 {
-	fputc('[', stdout);
+	fmt_json_output_escaped(out, string, fmt_json_strict_escapes);
 }
 
-static void fmt_json_output_entry(const syslog_entry_t *entry)
+/*
+ * In follow mode each entry is output on its own line, so the consumer
+ * can read entries by lines while the array is not terminated yet
+ */
+
+static void fmt_json_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	syslog_output_putc(out, '[');
+
+	if (config.follow)
+		syslog_output_putc(out, '\n');
+}
+
+static void fmt_json_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	int count = 0;
 	syslog_field_t *field;
 
-	printf("%s{", (entry->num > 1) ? "," : "");
+	if (entry->num > 1)
+		syslog_output_putc(out, ',');
+
+	syslog_output_putc(out, '{');
 
 	for (field = entry->fields; field; field = field->next)
 	{
 		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
 			continue;
 
-		printf("%s\"%s\":",
-			(count > 0) ? "," : "",
-			field->info->param_name);
+		if (count > 0)
+			syslog_output_putc(out, ',');
+
+		syslog_output_putc(out, '"');
+		syslog_output_puts(out, field->info->param_name);
+		syslog_output_puts(out, "\":");
 
 		switch(field->info->type)
 		{
 			case SYSLOG_FIELD_TYPE_TIME:
-				fputc('"', stdout);
-				fmt_json_output_encoded(syslog_field_time_fmt(field));
-				fputc('"', stdout);
+				syslog_output_putc(out, '"');
+				fmt_json_output_encoded(out, syslog_field_time_fmt(field));
+				syslog_output_putc(out, '"');
 				break;
 
 			case SYSLOG_FIELD_TYPE_INTEGER:
-				printf("%ld", field->value.integer);
+				syslog_output_int(out, field->value.integer);
 				break;
 
 			case SYSLOG_FIELD_TYPE_UINTEGER:
-				printf("%lu", field->value.uinteger);
+				syslog_output_uint(out, field->value.uinteger);
 				break;
 
 			case SYSLOG_FIELD_TYPE_STRING:
-				fputc('"', stdout);
-				fmt_json_output_encoded(field->value.string);
-				fputc('"', stdout);
+				syslog_output_putc(out, '"');
+				fmt_json_output_encoded(out, field->value.string);
+				syslog_output_putc(out, '"');
 				break;
 		}
 
 		++count;
 	}
 
-	fputc('}', stdout);
+	syslog_output_putc(out, '}');
+
+	if (config.follow)
+		syslog_output_putc(out, '\n');
 }
 
-static void fmt_json_output_end(const syslog_entry_t *entry)
+static void fmt_json_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
-	fputc(']', stdout);
+	syslog_output_putc(out, ']');
+
+	if (config.follow)
+		syslog_output_putc(out, '\n');
 }
 
 output_fmt_t fmt_json =
@@ -24,4 +24,25 @@
 /** @brief JSON output format data structure */
 extern output_fmt_t fmt_json;
 
+/**
+ * Append JSON string contents (without quotes) to the output
+ *
+ * Non-printable vt100 escape sequences are dropped.
+ *
+ * @param[in,out] out    Pointer to the output data structure.
+ * @param[in]     string NULL-terminated string.
+ */
+void fmt_json_output_encoded(syslog_output_t *out, const char *string);
+
+/**
+ * Append JSON string contents (without quotes) to the output with all
+ * control characters escaped (as \\u00XX if there is no short escape)
+ *
+ * Non-printable vt100 escape sequences are dropped.
+ *
+ * @param[in,out] out    Pointer to the output data structure.
+ * @param[in]     string NULL-terminated string.
+ */
+void fmt_json_output_encoded_strict(syslog_output_t *out, const char *string);
+
 #endif /* __FMT_JSON_H__ */
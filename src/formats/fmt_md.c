@@ -18,28 +18,37 @@
 
 #include <syslog_fc.h>
 
-static void fmt_md_output_start(const syslog_entry_t *entry)
+static void fmt_md_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	syslog_field_t *field;
 
 	for (field = entry->fields; field; field = field->next)
 	{
 		if (!(field->flags & SYSLOG_FIELD_FLAG_DROP))
-			printf("|%s", field->info->human_name);
+		{
+			syslog_output_putc(out, '|');
+			syslog_output_puts(out, field->info->human_name);
+		}
 	}
 
-	printf("|\n");
+	syslog_output_puts(out, "|\n");
 
 	for (field = entry->fields; field; field = field->next)
 	{
 		if (!(field->flags & SYSLOG_FIELD_FLAG_DROP))
-			printf("|---");
+			syslog_output_puts(out, "|---");
 	}
 
-	printf("|\n");
+	syslog_output_puts(out, "|\n");
 }
 
-static void fmt_md_output_entry(const syslog_entry_t *entry)
+static void fmt_md_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	syslog_field_t *field;
 
@@ -48,33 +57,37 @@ static void fmt_md_output_entry(const syslog_entry_t *entry)
 		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
 			continue;
 
-		printf("|");
+		syslog_output_putc(out, '|');
 
 		switch(field->info->type)
 		{
 			case SYSLOG_FIELD_TYPE_TIME:
-				printf("%s", syslog_field_time_fmt(field));
+				syslog_output_puts(out, syslog_field_time_fmt(field));
 				break;
 
 			case SYSLOG_FIELD_TYPE_INTEGER:
-				printf("%ld", field->value.integer);
+				syslog_output_int(out, field->value.integer);
 				break;
 
 			case SYSLOG_FIELD_TYPE_UINTEGER:
-				printf("%lu", field->value.uinteger);
+				syslog_output_uint(out, field->value.uinteger);
 				break;
 
 			case SYSLOG_FIELD_TYPE_STRING:
 				if (field->info->id == SYSLOG_FIELD_ID_MESSAGE)
-					printf("`%s`", field->value.string);
+				{
+					syslog_output_putc(out, '`');
+					syslog_output_puts(out, field->value.string);
+					syslog_output_putc(out, '`');
+				}
 				else
-					printf("%s", field->value.string);
+					syslog_output_puts(out, field->value.string);
 
 				break;
 		}
 	}
 
-	printf("|\n");
+	syslog_output_puts(out, "|\n");
 }
 
 output_fmt_t fmt_md =
@@ -0,0 +1,228 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * MessagePack output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief MessagePack output format support
+ *
+ * Each entry is output as MessagePack map with field parameter names
+ * as keys, maps of the entries are concatenated into the stream.
+ * Timestamps (signed Unix time) and integers are output as integers,
+ * strings are output as length-prefixed str values (or bin values if
+ * string is not a valid UTF-8), so no escaping is required.
+ *
+ * Keys are encoded once by the output preparation callback.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <fmt_msgpack.h>
+
+/** @brief Maximum number of fields with the pre-encoded keys */
+#define FMT_MSGPACK_MAX_KEYS  32
+
+/** @brief Size of the pre-encoded keys buffer */
+#define FMT_MSGPACK_KEYS_SIZE  1024
+
+/** @brief Offsets of the pre-encoded keys of the output fields in the
+ *         entry order (and the end offset of the last key) */
+static size_t fmt_msgpack_keys[FMT_MSGPACK_MAX_KEYS + 1];
+
+/** @brief Number of the output fields (0 if keys are not pre-encoded) */
+static unsigned int fmt_msgpack_keys_n;
+
+/** @brief Pre-encoded keys data */
+static char fmt_msgpack_keys_data[FMT_MSGPACK_KEYS_SIZE];
+
+/**
+ * Output type byte followed by the big-endian value
+ *
+ * @param[in,out] out   Pointer to the output structure.
+ * @param[in]     type  Type byte.
+ * @param[in]     value Value.
+ * @param[in]     size  Value size in bytes (0, 1, 2, 4 or 8).
+ */
+static void fmt_msgpack_output_head(
+	syslog_output_t *out,
+	uint8_t type,
+	uint64_t value,
+	unsigned int size
+)
+{
+	uint8_t head[9];
+	unsigned int i;
+
+	head[0] = type;
+
+	for (i = 0; i < size; i++)
+		head[1 + i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+
+	syslog_output_write(out, head, size + 1);
+}
+
+static void fmt_msgpack_output_uint(syslog_output_t *out, uint64_t value)
+{
+	if (value < 0x80)
+		fmt_msgpack_output_head(out, (uint8_t)value, 0, 0);
+	else if (value <= UINT8_MAX)
+		fmt_msgpack_output_head(out, 0xcc, value, 1);
+	else if (value <= UINT16_MAX)
+		fmt_msgpack_output_head(out, 0xcd, value, 2);
+	else if (value <= UINT32_MAX)
+		fmt_msgpack_output_head(out, 0xce, value, 4);
+	else
+		fmt_msgpack_output_head(out, 0xcf, value, 8);
+}
+
+static void fmt_msgpack_output_int(syslog_output_t *out, int64_t value)
+{
+	if (value >= 0)
+		fmt_msgpack_output_uint(out, value);
+	else if (value >= -32)
+		fmt_msgpack_output_head(out, (uint8_t)value, 0, 0);
+	else if (value >= INT8_MIN)
+		fmt_msgpack_output_head(out, 0xd0, (uint64_t)value, 1);
+	else if (value >= INT16_MIN)
+		fmt_msgpack_output_head(out, 0xd1, (uint64_t)value, 2);
+	else if (value >= INT32_MIN)
+		fmt_msgpack_output_head(out, 0xd2, (uint64_t)value, 4);
+	else
+		fmt_msgpack_output_head(out, 0xd3, (uint64_t)value, 8);
+}
+
+static void fmt_msgpack_output_string(
+	syslog_output_t *out,
+	const char *string
+)
+{
+	size_t len = strlen(string);
+
+	if (syslog_output_utf8_valid(string, len) == len)
+	{
+		if (len < 32)
+			fmt_msgpack_output_head(out, 0xa0 | len, 0, 0);
+		else if (len <= UINT8_MAX)
+			fmt_msgpack_output_head(out, 0xd9, len, 1);
+		else if (len <= UINT16_MAX)
+			fmt_msgpack_output_head(out, 0xda, len, 2);
+		else
+			fmt_msgpack_output_head(out, 0xdb, len, 4);
+	}
+	else
+	{
+		if (len <= UINT8_MAX)
+			fmt_msgpack_output_head(out, 0xc4, len, 1);
+		else if (len <= UINT16_MAX)
+			fmt_msgpack_output_head(out, 0xc5, len, 2);
+		else
+			fmt_msgpack_output_head(out, 0xc6, len, 4);
+	}
+
+	syslog_output_write(out, string, len);
+}
+
+static void fmt_msgpack_output_init(const syslog_entry_t *entry)
+{
+	syslog_output_t keys;
+	syslog_field_t *field;
+	unsigned int count = 0;
+
+	fmt_msgpack_keys_n = 0;
+
+	if (syslog_output_open(&keys, -1))
+		return;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		/* Too many fields, keys are encoded for each entry */
+		if (count == FMT_MSGPACK_MAX_KEYS)
+			break;
+
+		fmt_msgpack_keys[count++] = keys.size;
+		fmt_msgpack_output_string(&keys, field->info->param_name);
+	}
+
+	if (!field && !keys.error && (keys.size <= FMT_MSGPACK_KEYS_SIZE))
+	{
+		memcpy(fmt_msgpack_keys_data, keys.buffer, keys.size);
+		fmt_msgpack_keys[count] = keys.size;
+		fmt_msgpack_keys_n = count;
+	}
+
+	syslog_output_close(&keys);
+}
+
+static void fmt_msgpack_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	unsigned int fields_n = entry->fields_output_num;
+	unsigned int count = 0;
+	syslog_field_t *field;
+
+	if (fields_n < 16)
+		fmt_msgpack_output_head(out, 0x80 | fields_n, 0, 0);
+	else
+		fmt_msgpack_output_head(out, 0xde, fields_n, 2);
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		if (count < fmt_msgpack_keys_n)
+		{
+			syslog_output_write(out,
+				fmt_msgpack_keys_data + fmt_msgpack_keys[count],
+				fmt_msgpack_keys[count + 1] - fmt_msgpack_keys[count]);
+		}
+		else
+			fmt_msgpack_output_string(out, field->info->param_name);
+
+		++count;
+
+		switch(field->info->type)
+		{
+			case SYSLOG_FIELD_TYPE_TIME:
+				fmt_msgpack_output_int(out,
+					(time_t)field->value.time.unixtime);
+				break;
+
+			case SYSLOG_FIELD_TYPE_INTEGER:
+				fmt_msgpack_output_int(out, field->value.integer);
+				break;
+
+			case SYSLOG_FIELD_TYPE_UINTEGER:
+				fmt_msgpack_output_uint(out, field->value.uinteger);
+				break;
+
+			case SYSLOG_FIELD_TYPE_STRING:
+				fmt_msgpack_output_string(out,
+					field->value.string ? field->value.string : "");
+				break;
+		}
+	}
+}
+
+output_fmt_t fmt_msgpack =
+{
+	.name              = "msgpack",
+	.description       = "MessagePack (stream of maps)",
+	.fn_output_init    = fmt_msgpack_output_init,
+	.fn_output_entry   = fmt_msgpack_output_entry
+};
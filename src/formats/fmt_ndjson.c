@@ -0,0 +1,170 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * JSON Lines output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief JSON Lines output format support
+ *
+ * Each entry is output as JSON object on its own line (NDJSON), so the
+ * output can be split, appended and processed by lines. Objects are
+ * the same as objects of the JSON format, except that all control
+ * characters are escaped, so each line is valid for the strict JSON
+ * parsers.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <syslog_fc.h>
+#include <fmt_json.h>
+
+/** @brief Maximum number of fields with the pre-rendered key prefixes */
+#define FMT_NDJSON_MAX_FIELDS  32
+
+/** @brief Size of the pre-rendered key prefixes buffer */
+#define FMT_NDJSON_PREFIXES_SIZE  1024
+
+/**
+ * @brief Pre-rendered field key prefix
+ *
+ * Prefix is the object start or the separator of the previous field,
+ * the quoted key, colon and the opening quote of the string value,
+ * e.g. <tt>,"facility":"</tt>.
+ */
+typedef struct fmt_ndjson_prefix
+{
+	const char *data;  /**< Prefix data */
+	size_t len;        /**< Prefix length */
+} fmt_ndjson_prefix_t;
+
+/** @brief Key prefixes of the output fields in the entry order */
+static fmt_ndjson_prefix_t fmt_ndjson_prefixes[FMT_NDJSON_MAX_FIELDS];
+
+/** @brief Number of the output fields (0 if prefixes are not rendered) */
+static unsigned int fmt_ndjson_prefixes_n;
+
+/** @brief Pre-rendered key prefixes data */
+static char fmt_ndjson_prefixes_data[FMT_NDJSON_PREFIXES_SIZE];
+
+/**
+ * Check that the field value is output as JSON string
+ *
+ * @param[in] field Pointer to the field.
+ *
+ * @return 1 if value is quoted, 0 otherwise
+ */
+static int fmt_ndjson_quoted(const syslog_field_t *field)
+{
+	return (field->info->type == SYSLOG_FIELD_TYPE_TIME) ||
+	       (field->info->type == SYSLOG_FIELD_TYPE_STRING);
+}
+
+static void fmt_ndjson_output_init(const syslog_entry_t *entry)
+{
+	syslog_field_t *field;
+	unsigned int count = 0;
+	size_t size = 0;
+	int len;
+
+	fmt_ndjson_prefixes_n = 0;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		/* Too many fields, keys are rendered for each entry */
+		if (count == FMT_NDJSON_MAX_FIELDS)
+			return;
+
+		len = snprintf(fmt_ndjson_prefixes_data + size,
+			FMT_NDJSON_PREFIXES_SIZE - size, "%c\"%s\":%s",
+			count ? ',' : '{', field->info->param_name,
+			fmt_ndjson_quoted(field) ? "\"" : "");
+
+		if ((len < 0) || ((size_t)len >= FMT_NDJSON_PREFIXES_SIZE - size))
+			return;
+
+		fmt_ndjson_prefixes[count].data = fmt_ndjson_prefixes_data + size;
+		fmt_ndjson_prefixes[count].len  = len;
+
+		size += len;
+		count++;
+	}
+
+	fmt_ndjson_prefixes_n = count;
+}
+
+static void fmt_ndjson_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	unsigned int count = 0;
+	syslog_field_t *field;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		if (count < fmt_ndjson_prefixes_n)
+		{
+			syslog_output_write(out, fmt_ndjson_prefixes[count].data,
+				fmt_ndjson_prefixes[count].len);
+		}
+		else
+		{
+			syslog_output_putc(out, count ? ',' : '{');
+			syslog_output_putc(out, '"');
+			syslog_output_puts(out, field->info->param_name);
+			syslog_output_puts(out, "\":");
+
+			if (fmt_ndjson_quoted(field))
+				syslog_output_putc(out, '"');
+		}
+
+		switch(field->info->type)
+		{
+			case SYSLOG_FIELD_TYPE_TIME:
+				fmt_json_output_encoded_strict(out, syslog_field_time_fmt(field));
+				syslog_output_putc(out, '"');
+				break;
+
+			case SYSLOG_FIELD_TYPE_INTEGER:
+				syslog_output_int(out, field->value.integer);
+				break;
+
+			case SYSLOG_FIELD_TYPE_UINTEGER:
+				syslog_output_uint(out, field->value.uinteger);
+				break;
+
+			case SYSLOG_FIELD_TYPE_STRING:
+				fmt_json_output_encoded_strict(out, field->value.string);
+				syslog_output_putc(out, '"');
+				break;
+		}
+
+		++count;
+	}
+
+	if (!count)
+		syslog_output_putc(out, '{');
+
+	syslog_output_write(out, "}\n", 2);
+}
+
+output_fmt_t fmt_ndjson =
+{
+	.name              = "ndjson",
+	.description       = "JSON Lines (newline-delimited JSON objects)",
+	.fn_output_init    = fmt_ndjson_output_init,
+	.fn_output_entry   = fmt_ndjson_output_entry
+};
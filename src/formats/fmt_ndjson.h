@@ -0,0 +1,27 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * JSON Lines output format support
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief JSON Lines output format support
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __FMT_NDJSON_H__
+#define __FMT_NDJSON_H__
+
+#include "syslog_fc.h"
+
+/** @brief JSON Lines output format data structure */
+extern output_fmt_t fmt_ndjson;
+
+#endif /* __FMT_NDJSON_H__ */
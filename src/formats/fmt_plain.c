@@ -18,7 +18,24 @@
 
 #include <syslog_fc.h>
 
-static void fmt_plain_output_entry(const syslog_entry_t *entry)
+static void fmt_plain_output_name(syslog_output_t *out, const char *name)
+{
+	/* Field name left-justified in 10 characters */
+	static const char spaces[] = "          ";
+	size_t len = strlen(name);
+
+	syslog_output_write(out, name, len);
+
+	if (len < sizeof(spaces) - 1)
+		syslog_output_write(out, spaces, sizeof(spaces) - 1 - len);
+
+	syslog_output_puts(out, " : ");
+}
+
+static void fmt_plain_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
 {
 	syslog_field_t *field;
 
@@ -27,31 +44,31 @@ static void fmt_plain_output_entry(const syslog_entry_t *entry)
 		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
 			continue;
 
-		printf("%-10s : ", field->info->human_name);
+		fmt_plain_output_name(out, field->info->human_name);
 
 		switch(field->info->type)
 		{
 			case SYSLOG_FIELD_TYPE_TIME:
-				printf("%s", syslog_field_time_fmt(field));
+				syslog_output_puts(out, syslog_field_time_fmt(field));
 				break;
 
 			case SYSLOG_FIELD_TYPE_INTEGER:
-				printf("%ld", field->value.integer);
+				syslog_output_int(out, field->value.integer);
 				break;
 
 			case SYSLOG_FIELD_TYPE_UINTEGER:
-				printf("%lu", field->value.uinteger);
+				syslog_output_uint(out, field->value.uinteger);
 				break;
 
 			case SYSLOG_FIELD_TYPE_STRING:
-				printf("%s", field->value.string);
+				syslog_output_puts(out, field->value.string);
 				break;
 		}
 
-		fputc('\n', stdout);
+		syslog_output_putc(out, '\n');
 	}
 
-	fputc('\n', stdout);
+	syslog_output_putc(out, '\n');
 }
 
 output_fmt_t fmt_plain =
@@ -28,29 +28,25 @@
  */
 
 #include <getopt.h>
+#include <unistd.h> /* sysconf(), STDOUT_FILENO */
+#include <sys/stat.h> /* fstat() */
 
 #include <syslog_fc.h>
-
+#include <syslog_dedup.h>
+#include <syslog_follow.h>
+#include <syslog_index.h>
+#include <syslog_input.h>
+#include <syslog_merge.h>
+#include <syslog_seek.h>
+#include <syslog_state.h>
+#include <syslog_stats.h>
+#include <syslog_templates.h>
+#include <syslog_threads.h>
+#include <syslog_top.h>
+
+#include <fmt_avail.h>
 #include <fmt_plain.h>
-#include <fmt_json.h>
-#include <fmt_csv.h>
-#include <fmt_md.h>
-#include <fmt_html.h>
-#include <fmt_asciidoc.h>
-
-/**
- * @brief Output formats
- */
-static const output_fmt_t *fmt_avail[] =
-{
-	&fmt_plain,
-	&fmt_md,
-	&fmt_csv,
-	&fmt_json,
-	&fmt_html,
-	&fmt_asciidoc,
-	NULL
-};
+#include <fmt_ndjson.h>
 
 /**
  * @brief Default configuration structure
@@ -62,10 +58,20 @@ static const config_t default_config =
 	.entry_spec        = "%T %F.%P %G: %_M",
 	.ts_parse_spec     = "%a %b %d %H:%M:%S %Y", /* Mon Jun 24 18:12:50 2019 */
 	.ts_output_spec    = "",                     /* UNIX timestamp */
-	.input_filename    =  NULL,
+	.input_filenames   =  NULL,
+	.inputs_n          =  0,
+	.follow            =  0,
+	.state_filename    =  NULL,
+	.stats_spec        =  NULL,
+	.top_spec          =  NULL,
+	.templates         =  0,
+	.template_column   =  0,
+	.dedup             =  0,
+	.dedup_window      =  NULL,
 	.csv_delimeter     = ",",
 	.html_class_prefix = "syslog-",
 	.html_cell_classes =  0,
+	.threads           =  1,
 };
 
 /**
@@ -73,10 +79,15 @@ static const config_t default_config =
  */
 config_t config = { 0 };
 
+/**
+ * @brief Output format header has been written
+ */
+static int output_started = 0;
+
 /**
  * @brief Short command line options list
  */
-static const char *opts_str = "hf:e:sp:o:d:x:c:";
+static const char *opts_str = "hf:e:sp:o:d:x:c:t:l:a:g:S:U:IBmFC:A:K:TYDW:";
 
 /**
  * @brief Long command line options list
@@ -92,6 +103,23 @@ static const struct option opts[] =
 	{ .name = "csv-delimeter",     .val = 'd', .has_arg = 1 },
 	{ .name = "html-class-prefix", .val = 'x', .has_arg = 1 },
 	{ .name = "html-cell-classes", .val = 'c', .has_arg = 1 },
+	{ .name = "threads",           .val = 't', .has_arg = 1 },
+	{ .name = "min-priority",      .val = 'l', .has_arg = 1 },
+	{ .name = "facility",          .val = 'a', .has_arg = 1 },
+	{ .name = "tag",               .val = 'g', .has_arg = 1 },
+	{ .name = "since",             .val = 'S', .has_arg = 1 },
+	{ .name = "until",             .val = 'U', .has_arg = 1 },
+	{ .name = "index",             .val = 'I' },
+	{ .name = "seek",              .val = 'B' },
+	{ .name = "merge",             .val = 'm' },
+	{ .name = "follow",            .val = 'F' },
+	{ .name = "state-file",        .val = 'C', .has_arg = 1 },
+	{ .name = "stats",             .val = 'A', .has_arg = 1 },
+	{ .name = "top",               .val = 'K', .has_arg = 1 },
+	{ .name = "templates",         .val = 'T' },
+	{ .name = "template-column",   .val = 'Y' },
+	{ .name = "dedup",             .val = 'D' },
+	{ .name = "dedup-window",      .val = 'W', .has_arg = 1 },
 	{ 0 }
 };
 
@@ -107,7 +135,10 @@ static void display_usage(void)
 		"Syslog File Converter version " SYSLOG_FC_VERSION "\n"
 		"Copyright (c) 2019 Anton Kikin <a.kikin@tano-systems.com>\n"
 		"\n"
-		"Usage: syslog_fc [options] <input-file>\n"
+		"Usage: syslog_fc [options] <input-file> [<input-file>...]\n"
+		"\n"
+		"Input compressed with gzip, zstd or xz is decompressed\n"
+		"automatically (if support is built in).\n"
 		"\n"
 		"Options:\n"
 		"  -h, --help\n"
@@ -116,6 +147,66 @@ static void display_usage(void)
 		"  -s, --stdin\n"
 		"        Read data from stdin instead of file.\n"
 		"\n"
+		"  -m, --merge\n"
+		"        Merge entries of all input files ordered by timestamp\n"
+		"        (each input file must be time-ordered). Without this\n"
+		"        option input files are converted one after another.\n"
+		"\n"
+		"  -F, --follow\n"
+		"        Convert the whole input file and then wait for the new\n"
+		"        lines appended to it (like \"tail -F\"). Truncated file\n"
+		"        is converted from the beginning, rotated file is\n"
+		"        replaced by the new file with the same name. Output is\n"
+		"        flushed after each batch of the new lines. Conversion is\n"
+		"        stopped by SIGINT or SIGTERM signal.\n"
+		"\n"
+		"  -C, --state-file <file>\n"
+		"        Save position of the last converted line of the input\n"
+		"        file into the state file and resume conversion from it\n"
+		"        on the next run, so only the new lines are converted.\n"
+		"        If the output is the file appended by the previous run\n"
+		"        (redirected by \">>\"), it is continued.\n"
+		"\n"
+		"  -A, --stats <key>[,<key>...]\n"
+		"        Output the number of entries by groups instead of the\n"
+		"        entries. Keys are \"facility\", \"priority\", \"tag\" and\n"
+		"        \"hostname\" fields and the time bucket (\"minute\",\n"
+		"        \"hour\", \"day\" or \"<N>[s|m|h|d]\"), e.g. \"tag,hour\".\n"
+		"        Groups are output in the selected format.\n"
+		"\n"
+		"  -K, --top <field>[:<N>][,<field>[:<N>]...]\n"
+		"        Output the approximate top N values (default 10) and\n"
+		"        the number of distinct values of the fields instead of\n"
+		"        the entries. Fields are \"facility\", \"priority\",\n"
+		"        \"tag\", \"hostname\", \"message\" and \"template\" (message\n"
+		"        template, see --templates), e.g. \"tag,template:20\".\n"
+		"        Memory usage does not depend on the input size (except\n"
+		"        for the message templates).\n"
+		"\n"
+		"  -T, --templates\n"
+		"        Output message templates with the number of entries\n"
+		"        and the first and the last entry time instead of the\n"
+		"        entries. Numbers, hexadecimal values, IP addresses and\n"
+		"        paths are masked, other variable message parts are\n"
+		"        replaced by \"<*>\".\n"
+		"\n"
+		"  -Y, --template-column\n"
+		"        Add message template field to the output entries.\n"
+		"        Field is the template at the moment the entry is\n"
+		"        converted, so earlier entries of the same template may\n"
+		"        have fewer tokens replaced by \"<*>\" than later ones.\n"
+		"\n"
+		"  -D, --dedup\n"
+		"        Collapse consecutive repeated entries (all fields\n"
+		"        except timestamps are the same) into the single entry\n"
+		"        with the number of entries and the last entry time.\n"
+		"        Repeats reported by the syslogd \"last message repeated\n"
+		"        N times\" entries are counted too.\n"
+		"\n"
+		"  -W, --dedup-window <N>[s|m|h|d]\n"
+		"        Collapse repeated entries within the time window from\n"
+		"        the first entry, not only consecutive (implies -D).\n"
+		"\n"
 		"  -f, --format <format>\n"
 		"        Select output format.\n"
 		"\n"
@@ -134,7 +225,7 @@ static void display_usage(void)
 
 	fprintf(stdout,
 		"\n"
-		"        Default: \"%s\"\n"
+		"        Default: \"%s\" (\"%s\" in follow mode)\n"
 		"\n"
 		"  -e, --entry-spec <spec>\n"
 		"        Syslog entry fields specification.\n"
@@ -178,17 +269,111 @@ static void display_usage(void)
 		"        Add HTML classes for each table cell.\n"
 		"\n"
 		"        Default: \"%s\"\n"
+		"\n"
+		"  -t, --threads <N>\n"
+		"        Number of conversion threads.\n"
+		"        Use 0 for the number of available processors.\n"
+		"\n"
+		"        Default: %u\n"
+		"\n"
+		"  -l, --min-priority <priority>\n"
+		"        Output only entries with the specified or higher priority\n"
+		"        (name or number, e.g. \"err\" or \"3\").\n"
+		"\n"
+		"  -a, --facility <facility>[,<facility>...]\n"
+		"        Output only entries with the specified facilities.\n"
+		"\n"
+		"  -g, --tag <tag>\n"
+		"        Output only entries with the specified tag\n"
+		"        (\"[pid]\" suffix of the entry tag is ignored).\n"
+		"\n"
+		"  -S, --since <time>\n"
+		"        Output only entries not older than the specified time.\n"
+		"\n"
+		"  -U, --until <time>\n"
+		"        Output only entries older than the specified time.\n"
+		"\n"
+		"        Time is specified in local time as \"YYYY-MM-DD[ HH:MM[:SS]]\"\n"
+		"        or as UNIX timestamp \"@<seconds>\".\n"
+		"\n"
+		"  -I, --index\n"
+		"        Use sidecar time index <input-file>" SYSLOG_INDEX_SUFFIX " for --since\n"
+		"        and --until. Index is written by conversion without\n"
+		"        filters and is updated when the input file has grown.\n"
+		"\n"
+		"  -B, --seek\n"
+		"        Binary search the time-ordered input file for --since\n"
+		"        and --until instead of reading the whole file. Lines\n"
+		"        moved far from their time-ordered position may be missed.\n"
 		"\n",
 		default_config.output_fmt->name,
+		fmt_ndjson.name,
 		default_config.entry_spec,
 		default_config.ts_parse_spec,
 		default_config.ts_output_spec ? default_config.ts_output_spec : "",
 		default_config.csv_delimeter,
 		default_config.html_class_prefix,
-		default_config.html_cell_classes ? "on" : "off"
+		default_config.html_cell_classes ? "on" : "off",
+		default_config.threads
 	);
 }
 
+/**
+ * Parse filter time argument
+ *
+ * Time is specified in local time as "YYYY-MM-DD[ HH:MM[:SS]]"
+ * ("T" separator is also accepted) or as UNIX timestamp "@<seconds>".
+ *
+ * @param[in]  arg   Argument string.
+ * @param[out] time  Parsed time.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int cli_time(const char *arg, time_t *time)
+{
+	static const char *formats[] =
+	{
+		"%Y-%m-%d %H:%M:%S",
+		"%Y-%m-%dT%H:%M:%S",
+		"%Y-%m-%d %H:%M",
+		"%Y-%m-%dT%H:%M",
+		"%Y-%m-%d",
+	};
+
+	int i;
+
+	if (*arg == '@')
+	{
+		char *end;
+		long long value = strtoll(arg + 1, &end, 10);
+
+		if ((end == arg + 1) || *end)
+			return -EINVAL;
+
+		*time = (time_t)value;
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++)
+	{
+		struct tm tm;
+		const char *end;
+
+		memset(&tm, 0, sizeof(tm));
+
+		end = strptime(arg, formats[i], &tm);
+		if (!end || *end)
+			continue;
+
+		tm.tm_isdst = -1;
+		*time = mktime(&tm);
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
 /**
  * Parse command line arguments into @ref config global structure
  *
@@ -201,6 +386,7 @@ static void display_usage(void)
 static int cli_args(int argc, char *argv[])
 {
 	int opt;
+	int format_set = 0;
 
 	while((opt = getopt_long(argc, argv, opts_str, opts, NULL)) != EOF)
 	{
@@ -247,6 +433,7 @@ static int cli_args(int argc, char *argv[])
 				}
 
 				config.output_fmt = new_output_fmt;
+				format_set = 1;
 				break;
 			}
 
@@ -292,6 +479,176 @@ static int cli_args(int argc, char *argv[])
 				break;
 			}
 
+			case 't': /* --threads */
+			{
+				char *end;
+				unsigned long threads = strtoul(optarg, &end, 10);
+
+				if (*end || (threads > SYSLOG_MAX_THREADS))
+				{
+					fprintf(stderr, "%s: invalid number of threads '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				if (!threads)
+				{
+					long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+					threads = (cpus > 0) ? cpus : 1;
+
+					if (threads > SYSLOG_MAX_THREADS)
+						threads = SYSLOG_MAX_THREADS;
+				}
+
+				config.threads = threads;
+				break;
+			}
+
+			case 'l': /* --min-priority */
+			{
+				int priority = syslog_priority_code(optarg);
+
+				if (priority < 0)
+				{
+					fprintf(stderr, "%s: invalid priority '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				config.filter.min_priority = priority;
+				config.filter.flags |= SYSLOG_FILTER_MIN_PRIORITY;
+				break;
+			}
+
+			case 'a': /* --facility */
+			{
+				char *names = strdupa(optarg);
+				char *name;
+				char *saveptr;
+
+				for (name = strtok_r(names, ",", &saveptr); name;
+				     name = strtok_r(NULL, ",", &saveptr))
+				{
+					int facility = syslog_facility_code(name);
+
+					if (facility < 0)
+					{
+						fprintf(stderr, "%s: invalid facility '%s'\n",
+							argv[0], name);
+
+						return -EINVAL;
+					}
+
+					config.filter.facilities |= 1UL << facility;
+				}
+
+				config.filter.flags |= SYSLOG_FILTER_FACILITY;
+				break;
+			}
+
+			case 'g': /* --tag */
+			{
+				config.filter.tag = optarg;
+				config.filter.flags |= SYSLOG_FILTER_TAG;
+				break;
+			}
+
+			case 'S': /* --since */
+			case 'U': /* --until */
+			{
+				time_t time;
+
+				if (cli_time(optarg, &time))
+				{
+					fprintf(stderr, "%s: invalid time '%s'\n",
+						argv[0], optarg);
+
+					return -EINVAL;
+				}
+
+				if (opt == 'S')
+				{
+					config.filter.since = time;
+					config.filter.flags |= SYSLOG_FILTER_SINCE;
+				}
+				else
+				{
+					config.filter.until = time;
+					config.filter.flags |= SYSLOG_FILTER_UNTIL;
+				}
+
+				break;
+			}
+
+			case 'I': /* --index */
+			{
+				config.index = 1;
+				break;
+			}
+
+			case 'B': /* --seek */
+			{
+				config.seek = 1;
+				break;
+			}
+
+			case 'm': /* --merge */
+			{
+				config.merge = 1;
+				break;
+			}
+
+			case 'F': /* --follow */
+			{
+				config.follow = 1;
+				break;
+			}
+
+			case 'C': /* --state-file */
+			{
+				config.state_filename = optarg;
+				break;
+			}
+
+			case 'A': /* --stats */
+			{
+				config.stats_spec = optarg;
+				break;
+			}
+
+			case 'K': /* --top */
+			{
+				config.top_spec = optarg;
+				break;
+			}
+
+			case 'T': /* --templates */
+			{
+				config.templates = 1;
+				break;
+			}
+
+			case 'Y': /* --template-column */
+			{
+				config.template_column = 1;
+				break;
+			}
+
+			case 'D': /* --dedup */
+			{
+				config.dedup = 1;
+				break;
+			}
+
+			case 'W': /* --dedup-window */
+			{
+				config.dedup = 1;
+				config.dedup_window = optarg;
+				break;
+			}
+
 			default:
 				break;
 		}
@@ -306,7 +663,8 @@ static int cli_args(int argc, char *argv[])
 	{
 		if (!config.is_stdin)
 		{
-			config.input_filename = argv[optind];
+			config.input_filenames = argv + optind;
+			config.inputs_n = argc - optind;
 		}
 		else if (argc > optind)
 		{
@@ -319,126 +677,697 @@ static int cli_args(int argc, char *argv[])
 		}
 	}
 
+	/* Streamed output is consumed by lines */
+	if (config.follow && !format_set)
+		config.output_fmt = &fmt_ndjson;
+
+	if ((config.follow || config.state_filename) &&
+	    (config.is_stdin || config.merge || (config.inputs_n > 1)))
+	{
+		fprintf(stderr,
+			"%s: %s requires a single input file\n", argv[0],
+			config.follow ? "follow mode" : "state file");
+
+		return -EINVAL;
+	}
+
+	if (config.state_filename &&
+	    (config.output_fmt->flags & OUTPUT_FMT_FLAG_NOAPPEND))
+	{
+		fprintf(stderr,
+			"%s: state file is not supported by output format '%s'\n",
+			argv[0], config.output_fmt->name);
+
+		return -EINVAL;
+	}
+
+	if (config.state_filename && config.stats_spec)
+	{
+		fprintf(stderr,
+			"%s: state file can not be used with aggregation\n", argv[0]);
+
+		return -EINVAL;
+	}
+
+	if (config.state_filename && config.top_spec)
+	{
+		fprintf(stderr,
+			"%s: state file can not be used with top values\n", argv[0]);
+
+		return -EINVAL;
+	}
+
+	if (config.state_filename && config.templates)
+	{
+		fprintf(stderr,
+			"%s: state file can not be used with message templates\n",
+			argv[0]);
+
+		return -EINVAL;
+	}
+
+	if (config.state_filename && config.dedup)
+	{
+		fprintf(stderr,
+			"%s: state file can not be used with deduplication\n",
+			argv[0]);
+
+		return -EINVAL;
+	}
+
+	if (!!config.stats_spec + !!config.top_spec + config.templates +
+	    config.template_column + config.dedup > 1)
+	{
+		fprintf(stderr,
+			"%s: only one of aggregation, top values, message templates, "
+			"template field and deduplication can be used\n", argv[0]);
+
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
 /**
- * Convert syslog file into other text format
+ * Write the output format header once the first input is opened
+ *
+ * Header is not written if no input could be opened, so nothing
+ * is output on error.
+ *
+ * @param[in,out] out   Pointer to the output structure
+ * @param[in]     entry Pointer to the entry data structure
+ */
+static void output_start(syslog_output_t *out, const syslog_entry_t *entry)
+{
+	if (output_started)
+		return;
+
+	output_started = 1;
+
+	if (config.output_fmt->fn_output_start)
+		config.output_fmt->fn_output_start(out, entry);
+}
+
+/**
+ * Convert all syslog input entries in the single thread
  *
- * @param[in] input Pointer to the input syslog file structure
+ * @param[in]     input     Pointer to the syslog input structure
+ * @param[in,out] out       Pointer to the output structure
+ * @param[in,out] entry     Pointer to the entry data structure
+ * @param[in,out] index     Pointer to the index to build or NULL
+ * @param[in,out] entries_n Number of the previously converted entries
  *
  * @return 0 on success
  * @return <0 on error
  */
-static int convert_syslog(FILE *input)
+static int convert_entries(
+	syslog_input_t *input,
+	syslog_output_t *out,
+	syslog_entry_t *entry,
+	syslog_index_t *index,
+	unsigned int *entries_n
+)
 {
-	int ret = 0;
-	syslog_entry_t entry;
+	const syslog_field_t *time_field =
+		syslog_entry_field(entry, SYSLOG_FIELD_ID_TIMESTAMP);
+
+	while (1)
+	{
+		int status;
+		char *line;
+		size_t line_len;
+		size_t offset = input->map_offset;
+
+		status = syslog_input_read_line(input, &line, &line_len);
+		if (status < 0)
+			return status;
+
+		if (!status) /* EOF */
+			break;
+
+		if (out->error)
+			return out->error;
+
+		status = syslog_entry_parse(
+			entry, input->line_n, line, line_len);
 
-	char *buffer;
-	size_t buffer_size = SYSLOG_BUFFER_SIZE;
+		if (!status)
+		{
+			entry->num = ++(*entries_n);
+
+			if (index)
+			{
+				syslog_index_add(index, offset, input->line_n,
+					time_field->value.time.unixtime);
+			}
 
-	unsigned int parsed_n = 0;
-	unsigned int line_n = 0;
+			if (config.output_fmt->fn_output_entry)
+				config.output_fmt->fn_output_entry(out, entry);
+		}
+	}
 
-	buffer = malloc(buffer_size);
-	if (!buffer)
+	return 0;
+}
+
+/**
+ * Check that all fields used by the enabled filters are present
+ * in the entry format specification
+ *
+ * @param[in] entry Pointer to the entry data structure
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int check_filter(const syslog_entry_t *entry)
+{
+	static const struct
 	{
-		fprintf(stderr,
-			"Failed to allocate memory for line buffer\n");
+		unsigned int flags;
+		syslog_field_id_t field_id;
+		const char *spec;
+	}
+	filter_fields[] =
+	{
+		{ SYSLOG_FILTER_MIN_PRIORITY, SYSLOG_FIELD_ID_PRIORITY,  "%P" },
+		{ SYSLOG_FILTER_FACILITY,     SYSLOG_FIELD_ID_FACILITY,  "%F" },
+		{ SYSLOG_FILTER_TAG,          SYSLOG_FIELD_ID_TAG,       "%G" },
+		{ SYSLOG_FILTER_SINCE |
+		  SYSLOG_FILTER_UNTIL,        SYSLOG_FIELD_ID_TIMESTAMP, "%T" },
+	};
+
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(filter_fields); i++)
+	{
+		if ((config.filter.flags & filter_fields[i].flags) &&
+		    !syslog_entry_has_field(entry, filter_fields[i].field_id))
+		{
+			fprintf(stderr,
+				"Filter requires field %s in the entry specification\n",
+				filter_fields[i].spec);
+
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Open syslog input and restrict it to the lines that may match
+ * the time range filter
+ *
+ * @param[out]    input       Pointer to the syslog input structure
+ * @param[in]     filename    Input file name or NULL for the standard input
+ * @param[in,out] entry       Pointer to the entry data structure
+ * @param[out]    index       Pointer to the index structure
+ * @param[out]    index_build Pointer to the index to build (set to
+ *                            @p index or NULL), or NULL if index
+ *                            must not be built
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int open_input(
+	syslog_input_t *input,
+	const char *filename,
+	syslog_entry_t *entry,
+	syslog_index_t *index,
+	syslog_index_t **index_build
+)
+{
+	int ret;
+	int index_status = 0;
+
+	syslog_index_init(index);
+
+	if (index_build)
+		*index_build = NULL;
+
+	if (syslog_input_open(input, filename))
+	{
+		if (filename)
+			fprintf(stderr, "Could not open file '%s'\n", filename);
+		else
+			fprintf(stderr, "Could not open standard input\n");
+
+		return -ENODEV;
+	}
+
+	if (config.index && input->map &&
+	    syslog_entry_has_field(entry, SYSLOG_FIELD_ID_TIMESTAMP))
+	{
+		index_status = syslog_index_load(index, filename, input, entry);
+		if (index_status < 0)
+		{
+			fprintf(stderr, "Failed to load index (%d)\n", index_status);
+			index_status = 0;
+		}
+
+		/* Whole input is converted without filters, build index */
+		if (!index_status && !config.filter.flags && index_build)
+			*index_build = index;
+	}
+
+	if (index_status > 0)
+		ret = syslog_index_seek(index, input);
+	else if (config.seek)
+		ret = syslog_seek_time_range(input, entry);
+	else
+		ret = 0;
+
+	if (ret)
+	{
+		fprintf(stderr, "Time range seek failed (%d)\n", ret);
+		syslog_index_free(index);
+		syslog_input_close(input);
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Convert lines appended to the followed input until
+ * following is stopped by signal
+ *
+ * @param[in,out] input     Pointer to the followed input
+ * @param[in]     filename  Input file name
+ * @param[in,out] out       Pointer to the output structure
+ * @param[in,out] entry     Pointer to the entry data structure
+ * @param[in,out] entries_n Number of the previously converted entries
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int follow_input(
+	syslog_input_t *input,
+	const char *filename,
+	syslog_output_t *out,
+	syslog_entry_t *entry,
+	unsigned int *entries_n
+)
+{
+	int ret;
+	syslog_follow_t follow;
+
+	ret = syslog_follow_init(&follow, filename);
+	if (ret)
+		return ret;
 
+	/*
+	 * Lines appended after the input has been opened are
+	 * read before the first wait, so none of them is missed
+	 */
+	do
+	{
+		ret = convert_entries(input, out, entry, NULL, entries_n);
+		if (ret)
+			break;
+
+		ret = syslog_output_flush(out);
+		if (ret)
+			break;
+
+		ret = syslog_follow_wait(&follow, input);
+	}
+	while (ret > 0);
+
+	syslog_follow_free(&follow);
+	return ret;
+}
+
+/**
+ * Convert all entries of the syslog input
+ *
+ * @param[in]     filename  Input file name or NULL for the standard input
+ * @param[in,out] out       Pointer to the output structure
+ * @param[in,out] entry     Pointer to the entry data structure
+ * @param[in,out] entries_n Number of the previously converted entries
+ * @param[in,out] state     Pointer to the incremental conversion state
+ *                          or NULL
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int convert_input(
+	const char *filename,
+	syslog_output_t *out,
+	syslog_entry_t *entry,
+	unsigned int *entries_n,
+	syslog_state_t *state
+)
+{
+	int ret;
+	syslog_input_t input;
+	syslog_index_t index;
+	syslog_index_t *index_build;
+
+	/* Index is built only for the whole file */
+	ret = open_input(&input, filename, entry, &index,
+		(config.follow || state) ? NULL : &index_build);
+
+	if (ret)
+		return ret;
+
+	output_start(out, entry);
+
+	if (state)
+	{
+		ret = syslog_state_resume(state, &input);
+		if (ret < 0)
+		{
+			fprintf(stderr, "Failed to resume conversion (%d)\n", ret);
+			goto out;
+		}
+	}
+
+	/* Unterminated last line is left for the next run */
+	if (config.follow || state)
+	{
+		ret = syslog_input_follow(&input);
+		if (ret)
+		{
+			fprintf(stderr,
+				"%s requires regular uncompressed file (%d)\n",
+				config.follow ? "Follow mode" : "State file", ret);
+
+			goto out;
+		}
+	}
+
+	/* Followed streamed input can only be read by lines */
+	if ((config.threads > 1) && (input.map || !config.follow))
+	{
+		ret = syslog_threads_convert(&input, out,
+			config.threads, index_build, entries_n);
+	}
+	else
+		ret = convert_entries(&input, out, entry, index_build, entries_n);
+
+	if (!ret && index_build)
+	{
+		index.lines_n = input.line_n;
+
+		/* Conversion result does not depend on the index */
+		ret = syslog_index_save(&index, filename, &input);
+		if (ret)
+		{
+			fprintf(stderr, "Failed to save index (%d)\n", ret);
+			ret = 0;
+		}
+	}
+
+	if (!ret && config.follow)
+		ret = follow_input(&input, filename, out, entry, entries_n);
+
+	if (!ret && state)
+	{
+		ret = syslog_state_checkpoint(state, &input);
+		if (ret)
+			fprintf(stderr, "Failed to get input position (%d)\n", ret);
+	}
+
+out:
+	syslog_index_free(&index);
+	syslog_input_close(&input);
+
+	return ret;
+}
+
+/**
+ * Convert entries of all input files merged by the timestamp
+ *
+ * @param[in,out] out       Pointer to the output structure
+ * @param[in,out] entry     Pointer to the entry data structure
+ * @param[in,out] entries_n Number of the previously converted entries
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int convert_merge(
+	syslog_output_t *out,
+	syslog_entry_t *entry,
+	unsigned int *entries_n
+)
+{
+	int ret = 0;
+	unsigned int i;
+	unsigned int inputs_n;
+	syslog_input_t *inputs;
+	syslog_index_t index;
+
+	inputs = calloc(config.inputs_n, sizeof(syslog_input_t));
+	if (!inputs)
 		return -ENOMEM;
+
+	for (inputs_n = 0; inputs_n < config.inputs_n; inputs_n++)
+	{
+		/* Index is not needed after the seek */
+		ret = open_input(&inputs[inputs_n],
+			config.input_filenames[inputs_n], entry, &index, NULL);
+
+		syslog_index_free(&index);
+
+		if (ret)
+			break;
 	}
 
+	if (!ret)
+	{
+		output_start(out, entry);
+
+		ret = syslog_merge_convert(inputs, inputs_n, out,
+			config.threads, entries_n);
+	}
+
+	for (i = 0; i < inputs_n; i++)
+		syslog_input_close(&inputs[i]);
+
+	free(inputs);
+	return ret;
+}
+
+/**
+ * Get size of the output file
+ *
+ * @return Output file size or 0 if output is not a regular file
+ */
+static uint64_t output_file_size(void)
+{
+	struct stat st;
+
+	if (fstat(STDOUT_FILENO, &st) || !S_ISREG(st.st_mode))
+		return 0;
+
+	return st.st_size;
+}
+
+/**
+ * Continue the output of the previous incremental conversion
+ *
+ * Output is continued if it is the same file the previous conversion
+ * has written. Output format trailer is removed from the file, so the
+ * output continues with the new entries.
+ *
+ * @param[in] state Pointer to the incremental conversion state
+ *
+ * @return 1 if output is continued
+ * @return 0 if output is new
+ * @return <0 on error
+ */
+static int continue_output(const syslog_state_t *state)
+{
+	if (!state->output_size || (output_file_size() != state->output_size))
+		return 0;
+
+	if (ftruncate(STDOUT_FILENO, state->output_size - state->trailer_size) ||
+	    (lseek(STDOUT_FILENO, 0, SEEK_END) < 0))
+		return -errno;
+
+	return 1;
+}
+
+/**
+ * Convert syslog files into other text format
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int convert_syslog(void)
+{
+	int ret = 0;
+	unsigned int i;
+	unsigned int entries_n = 0;
+	syslog_entry_t entry;
+	syslog_output_t out;
+	syslog_state_t state;
+	syslog_state_t *state_p = NULL;
+	int continued = 0;
+	uint64_t output_size = 0;
+
 	ret = syslog_entry_init(&entry, config.entry_spec);
 	if (ret)
 	{
 		fprintf(stderr,
 			"Syslog entry initialization failed (%d)\n", ret);
 
-		free(buffer);
 		return ret;
 	}
 
-	if (config.output_fmt->fn_output_start)
-		config.output_fmt->fn_output_start(&entry);
+	ret = check_filter(&entry);
+	if (ret)
+	{
+		syslog_entry_destroy(&entry);
+		return ret;
+	}
 
-	while (1)
+	if (config.merge &&
+	    !syslog_entry_has_field(&entry, SYSLOG_FIELD_ID_TIMESTAMP))
 	{
-		int status;
-		size_t buffer_offset = 0;
-		size_t line_len = 0;
+		fprintf(stderr,
+			"Merge requires field %%T in the entry specification\n");
 
-		line_n++;
+		syslog_entry_destroy(&entry);
+		return -EINVAL;
+	}
 
-		while (1)
+	/* Aggregation, top values, message templates and deduplication are
+	 * the output formats, which output results in the selected format */
+	if (config.stats_spec)
+	{
+		ret = syslog_stats_init(config.stats_spec, &entry, config.output_fmt);
+		if (ret)
 		{
-			char *new_buffer;
-			char *line;
+			syslog_entry_destroy(&entry);
+			return ret;
+		}
 
-			line = fgets(buffer + buffer_offset,
-				buffer_size - buffer_offset, input);
+		config.output_fmt = &syslog_stats_fmt;
+	}
+	else if (config.top_spec)
+	{
+		ret = syslog_top_init(config.top_spec, &entry, config.output_fmt);
+		if (ret)
+		{
+			syslog_entry_destroy(&entry);
+			return ret;
+		}
 
-			if (!line)
-				break;
+		config.output_fmt = &syslog_top_fmt;
+	}
+	else if (config.templates || config.template_column)
+	{
+		ret = syslog_templates_init(&entry, config.output_fmt,
+			config.template_column);
 
-			line_len += strnlen(line, buffer_size);
+		if (ret)
+		{
+			syslog_entry_destroy(&entry);
+			return ret;
+		}
 
-			if ((buffer[line_len - 1] == '\r') ||
-			    (buffer[line_len - 1] == '\n'))
-				break;
+		config.output_fmt = config.template_column ?
+			&syslog_templates_column_fmt : &syslog_templates_fmt;
+	}
+	else if (config.dedup)
+	{
+		ret = syslog_dedup_init(config.dedup_window, &entry, config.output_fmt);
+		if (ret)
+		{
+			syslog_entry_destroy(&entry);
+			return ret;
+		}
 
-			/* Increase line buffer size */
-			buffer_size += SYSLOG_BUFFER_SIZE;
-			if (buffer_size > SYSLOG_MAX_BUFFER_SIZE)
-			{
-				fprintf(stderr,
-					"line %u: Line buffer size limit (%zu) reached\n",
-					line_n, (size_t)SYSLOG_MAX_BUFFER_SIZE);
+		config.output_fmt = &syslog_dedup_fmt;
+	}
 
-				free(buffer);
-				return -EINVAL;
-			}
+	if (config.output_fmt->fn_output_init)
+		config.output_fmt->fn_output_init(&entry);
 
-			new_buffer = realloc(buffer, buffer_size);
-			if (!new_buffer)
-			{
-				fprintf(stderr,
-					"line %u: Failed to reallocate memory for line buffer "
-					"(%zu -> %zu)\n",
-					line_n,
-					buffer_size - SYSLOG_BUFFER_SIZE,
-					buffer_size);
-
-				free(buffer);
-				return -ENOMEM;
-			}
+	if (config.state_filename)
+	{
+		ret = syslog_state_load(&state, config.state_filename);
+		if (ret > 0)
+			ret = continue_output(&state);
+
+		if (ret < 0)
+		{
+			fprintf(stderr, "Failed to resume from state file '%s' (%d)\n",
+				config.state_filename, ret);
 
-			buffer = new_buffer;
-			buffer_offset = line_len;
+			syslog_entry_destroy(&entry);
+			return ret;
 		}
 
-		if (!line_len) /* EOF */
-			break;
+		continued = ret;
+		state_p = &state;
+	}
 
-		status = syslog_entry_parse(
-			&entry, line_n, buffer);
+	ret = syslog_output_open(&out, STDOUT_FILENO);
+	if (ret)
+	{
+		fprintf(stderr, "Output initialization failed (%d)\n", ret);
+		syslog_entry_destroy(&entry);
+		return ret;
+	}
 
-		if (!status)
-		{
-			entry.num = ++parsed_n;
+	/* Continued output has the entries of the previous conversions */
+	if (continued)
+	{
+		entries_n = state.parsed_n;
+		output_started = 1;
+	}
 
-			if (config.output_fmt->fn_output_entry)
-				config.output_fmt->fn_output_entry(&entry);
+	if (config.is_stdin)
+		ret = convert_input(NULL, &out, &entry, &entries_n, NULL);
+	else if (config.merge)
+		ret = convert_merge(&out, &entry, &entries_n);
+	else
+	{
+		for (i = 0; !ret && (i < config.inputs_n); i++)
+		{
+			ret = convert_input(config.input_filenames[i],
+				&out, &entry, &entries_n, state_p);
 		}
 	}
 
-	if (config.output_fmt->fn_output_end)
-		config.output_fmt->fn_output_end(&entry);
+	/* Output size without the trailer */
+	if (!ret && state_p && !syslog_output_flush(&out))
+		output_size = output_file_size();
+
+	/* Output is terminated even if the conversion has failed */
+	if (output_started && config.output_fmt->fn_output_end)
+		config.output_fmt->fn_output_end(&out, &entry);
+
+	if (syslog_output_close(&out))
+	{
+		fprintf(stderr, "Failed to write output (%d)\n", out.error);
+
+		if (!ret)
+			ret = out.error;
+	}
+
+	if (!ret && state_p)
+	{
+		state.parsed_n     = entries_n;
+		state.output_size  = output_file_size();
+		state.trailer_size = output_size ?
+			state.output_size - output_size : 0;
+
+		if (!output_size)
+			state.output_size = 0;
+
+		ret = syslog_state_save(&state, config.state_filename);
+		if (ret)
+		{
+			fprintf(stderr, "Failed to save state file '%s' (%d)\n",
+				config.state_filename, ret);
+		}
+	}
 
 	syslog_entry_destroy(&entry);
 
-	free(buffer);
 	return ret;
 }
 
@@ -453,9 +1382,6 @@ static int convert_syslog(FILE *input)
  */
 int main(int argc, char *argv[])
 {
-	int ret = 0;
-	FILE *input;
-
 	memcpy(&config, &default_config, sizeof(config));
 
 	if (cli_args(argc, argv))
@@ -464,24 +1390,5 @@ int main(int argc, char *argv[])
 		return -EINVAL;
 	}
 
-	if (config.is_stdin)
-		input = stdin;
-	else
-	{
-		input = fopen(config.input_filename, "rb");
-		if (!input)
-		{
-			fprintf(stderr, "%s: could not open file '%s'\n",
-				argv[0], config.input_filename);
-
-			return -ENODEV;
-		}
-	}
-
-	ret = convert_syslog(input);
-
-	if (!config.is_stdin)
-		fclose(input);
-
-	return ret;
+	return convert_syslog();
 }
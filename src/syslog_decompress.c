@@ -0,0 +1,747 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Compressed input decompression source
+ *
+ * Decompression thread reads the compressed data from the file
+ * descriptor and fills the ring of the decompressed data buffers.
+ * Reader takes the filled buffers in order and returns them to the
+ * thread when they are completely read. Concatenated gzip members,
+ * Zstandard frames and xz streams are decompressed as a single stream.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef SYSLOG_FC_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef SYSLOG_FC_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef SYSLOG_FC_WITH_LZMA
+#include <lzma.h>
+#endif
+
+#include <syslog_fc.h>
+#include <syslog_decompress.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Decompressed data buffer
+ */
+typedef struct decompress_buffer
+{
+	char *data;   /**< Buffer data */
+	size_t size;  /**< Size of the decompressed data in the buffer */
+} decompress_buffer_t;
+
+/**
+ * @brief Decompression format description
+ */
+typedef struct decompress_codec
+{
+	/** Format name */
+	const char *name;
+
+	/** Magic bytes */
+	const char *magic;
+
+	/** Number of the magic bytes */
+	size_t magic_size;
+
+	/**
+	 * Initialize decompression
+	 *
+	 * @param[in,out] dec  Pointer to the decompressor.
+	 *
+	 * @return 0 on success
+	 * @return <0 on error
+	 */
+	int (*init)(syslog_decompress_t *dec);
+
+	/**
+	 * Decompress the available input data into the buffer
+	 *
+	 * @param[in,out] dec  Pointer to the decompressor.
+	 * @param[in,out] buf  Pointer to the buffer (not full).
+	 *
+	 * @return 0 on success
+	 * @return 1 on end of the compressed data
+	 * @return <0 on error
+	 */
+	int (*step)(syslog_decompress_t *dec, decompress_buffer_t *buf);
+
+	/**
+	 * Free resources allocated for decompression
+	 *
+	 * @param[in,out] dec  Pointer to the decompressor.
+	 */
+	void (*end)(syslog_decompress_t *dec);
+
+} decompress_codec_t;
+
+/**
+ * @brief Decompressor data structure
+ */
+struct syslog_decompress
+{
+	/** Compressed data file descriptor */
+	int fd;
+
+	/** Compression format description */
+	const decompress_codec_t *codec;
+
+	/** Decompression thread */
+	pthread_t thread;
+
+	/** Ring state mutex */
+	pthread_mutex_t mutex;
+
+	/** Ring state change condition */
+	pthread_cond_t cond;
+
+	/** Decompressed data buffers ring */
+	decompress_buffer_t ring[SYSLOG_DECOMPRESS_BUFFERS];
+
+	/** Index of the first filled buffer */
+	unsigned int head;
+
+	/** Index of the buffer to fill */
+	unsigned int tail;
+
+	/** Number of the filled buffers */
+	unsigned int used;
+
+	/** Number of the read bytes of the first filled buffer */
+	size_t head_offset;
+
+	/** Decompression is finished */
+	int done;
+
+	/** Decompression must be stopped */
+	int stop;
+
+	/** Decompression error */
+	int error;
+
+	/** Decompression error description */
+	const char *message;
+
+	/** Compressed data buffer */
+	unsigned char *in;
+
+	/** Offset of the unprocessed compressed data */
+	size_t in_start;
+
+	/** Offset of the end of the compressed data */
+	size_t in_end;
+
+	/** End of the compressed data reached */
+	int in_eof;
+
+	/** Compressed data may end at the current position */
+	int boundary;
+
+	/** Decompression library state */
+	union
+	{
+#ifdef SYSLOG_FC_WITH_ZLIB
+		z_stream z;
+#endif
+#ifdef SYSLOG_FC_WITH_ZSTD
+		ZSTD_DStream *zstd;
+#endif
+#ifdef SYSLOG_FC_WITH_LZMA
+		lzma_stream xz;
+#endif
+		int none;
+	} state;
+};
+
+/** @brief Truncated compressed data error description */
+#define DECOMPRESS_TRUNCATED  "unexpected end of compressed data"
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef SYSLOG_FC_WITH_ZLIB
+
+static int decompress_gzip_init(syslog_decompress_t *dec)
+{
+	/* Accept gzip header only */
+	if (inflateInit2(&dec->state.z, 16 + MAX_WBITS) != Z_OK)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int decompress_gzip_step(
+	syslog_decompress_t *dec,
+	decompress_buffer_t *buf
+)
+{
+	z_stream *z = &dec->state.z;
+	size_t in_avail = dec->in_end - dec->in_start;
+	int ret;
+
+	if (!in_avail && dec->in_eof && dec->boundary)
+		return 1;
+
+	z->next_in   = dec->in + dec->in_start;
+	z->avail_in  = in_avail;
+	z->next_out  = (Bytef *)buf->data + buf->size;
+	z->avail_out = SYSLOG_DECOMPRESS_BUFFER_SIZE - buf->size;
+
+	ret = inflate(z, Z_NO_FLUSH);
+
+	dec->in_start += in_avail - z->avail_in;
+	buf->size = SYSLOG_DECOMPRESS_BUFFER_SIZE - z->avail_out;
+
+	if (in_avail != z->avail_in)
+		dec->boundary = 0;
+
+	switch (ret)
+	{
+		case Z_OK:
+			return 0;
+
+		case Z_STREAM_END:
+			/* Next member may follow */
+			dec->boundary = 1;
+			inflateReset(z);
+			return 0;
+
+		case Z_BUF_ERROR:
+			dec->message = DECOMPRESS_TRUNCATED;
+			return -EBADMSG;
+
+		case Z_MEM_ERROR:
+			dec->message = "out of memory";
+			return -ENOMEM;
+
+		default:
+			dec->message = z->msg ? z->msg : "invalid compressed data";
+			return -EBADMSG;
+	}
+}
+
+static void decompress_gzip_end(syslog_decompress_t *dec)
+{
+	inflateEnd(&dec->state.z);
+}
+
+#endif /* SYSLOG_FC_WITH_ZLIB */
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef SYSLOG_FC_WITH_ZSTD
+
+static int decompress_zstd_init(syslog_decompress_t *dec)
+{
+	dec->state.zstd = ZSTD_createDStream();
+	if (!dec->state.zstd)
+		return -ENOMEM;
+
+	if (ZSTD_isError(ZSTD_initDStream(dec->state.zstd)))
+	{
+		ZSTD_freeDStream(dec->state.zstd);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int decompress_zstd_step(
+	syslog_decompress_t *dec,
+	decompress_buffer_t *buf
+)
+{
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	size_t ret;
+
+	in.src   = dec->in + dec->in_start;
+	in.size  = dec->in_end - dec->in_start;
+	in.pos   = 0;
+	out.dst  = buf->data + buf->size;
+	out.size = SYSLOG_DECOMPRESS_BUFFER_SIZE - buf->size;
+	out.pos  = 0;
+
+	if (!in.size && dec->in_eof && dec->boundary)
+		return 1;
+
+	ret = ZSTD_decompressStream(dec->state.zstd, &out, &in);
+	if (ZSTD_isError(ret))
+	{
+		dec->message = ZSTD_getErrorName(ret);
+		return -EBADMSG;
+	}
+
+	dec->in_start += in.pos;
+	buf->size += out.pos;
+
+	/* Frame is completely decompressed and flushed */
+	dec->boundary = !ret;
+
+	if (!in.pos && !out.pos && dec->in_eof && !dec->boundary)
+	{
+		dec->message = DECOMPRESS_TRUNCATED;
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static void decompress_zstd_end(syslog_decompress_t *dec)
+{
+	ZSTD_freeDStream(dec->state.zstd);
+}
+
+#endif /* SYSLOG_FC_WITH_ZSTD */
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef SYSLOG_FC_WITH_LZMA
+
+static int decompress_xz_init(syslog_decompress_t *dec)
+{
+	lzma_stream init = LZMA_STREAM_INIT;
+
+	dec->state.xz = init;
+
+	if (lzma_stream_decoder(&dec->state.xz,
+		UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int decompress_xz_step(
+	syslog_decompress_t *dec,
+	decompress_buffer_t *buf
+)
+{
+	lzma_stream *xz = &dec->state.xz;
+	size_t in_avail = dec->in_end - dec->in_start;
+	lzma_ret ret;
+
+	xz->next_in   = dec->in + dec->in_start;
+	xz->avail_in  = in_avail;
+	xz->next_out  = (uint8_t *)buf->data + buf->size;
+	xz->avail_out = SYSLOG_DECOMPRESS_BUFFER_SIZE - buf->size;
+
+	/* Concatenated streams decoder must be finished explicitly */
+	ret = lzma_code(xz, dec->in_eof ? LZMA_FINISH : LZMA_RUN);
+
+	dec->in_start += in_avail - xz->avail_in;
+	buf->size = SYSLOG_DECOMPRESS_BUFFER_SIZE - xz->avail_out;
+
+	switch (ret)
+	{
+		case LZMA_OK:
+			return 0;
+
+		case LZMA_STREAM_END:
+			return 1;
+
+		case LZMA_BUF_ERROR:
+			dec->message = DECOMPRESS_TRUNCATED;
+			return -EBADMSG;
+
+		case LZMA_MEM_ERROR:
+		case LZMA_MEMLIMIT_ERROR:
+			dec->message = "out of memory";
+			return -ENOMEM;
+
+		case LZMA_OPTIONS_ERROR:
+			dec->message = "unsupported compression options";
+			return -EBADMSG;
+
+		default:
+			dec->message = "invalid compressed data";
+			return -EBADMSG;
+	}
+}
+
+static void decompress_xz_end(syslog_decompress_t *dec)
+{
+	lzma_end(&dec->state.xz);
+}
+
+#endif /* SYSLOG_FC_WITH_LZMA */
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Compression formats descriptions */
+static const decompress_codec_t decompress_codecs[] = {
+	[SYSLOG_COMPRESSION_GZIP] = {
+		.name       = "gzip",
+		.magic      = "\x1f\x8b",
+		.magic_size = 2,
+#ifdef SYSLOG_FC_WITH_ZLIB
+		.init       = decompress_gzip_init,
+		.step       = decompress_gzip_step,
+		.end        = decompress_gzip_end,
+#endif
+	},
+	[SYSLOG_COMPRESSION_ZSTD] = {
+		.name       = "zstd",
+		.magic      = "\x28\xb5\x2f\xfd",
+		.magic_size = 4,
+#ifdef SYSLOG_FC_WITH_ZSTD
+		.init       = decompress_zstd_init,
+		.step       = decompress_zstd_step,
+		.end        = decompress_zstd_end,
+#endif
+	},
+	[SYSLOG_COMPRESSION_XZ] = {
+		.name       = "xz",
+		.magic      = "\xfd\x37\x7a\x58\x5a\x00",
+		.magic_size = 6,
+#ifdef SYSLOG_FC_WITH_LZMA
+		.init       = decompress_xz_init,
+		.step       = decompress_xz_step,
+		.end        = decompress_xz_end,
+#endif
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Read next block of the compressed data
+ *
+ * Must be called when all previously read data is processed.
+ *
+ * @param[in,out] dec  Pointer to the decompressor.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int decompress_read_input(syslog_decompress_t *dec)
+{
+	ssize_t n;
+
+	do
+		n = read(dec->fd, dec->in, SYSLOG_INPUT_BLOCK_SIZE);
+	while ((n < 0) && (errno == EINTR));
+
+	if (n < 0)
+	{
+		dec->message = "failed to read compressed data";
+		return -errno;
+	}
+
+	dec->in_start = 0;
+	dec->in_end   = n;
+
+	if (!n)
+		dec->in_eof = 1;
+
+	return 0;
+}
+
+/**
+ * Fill the buffer with the decompressed data
+ *
+ * @param[in,out] dec  Pointer to the decompressor.
+ * @param[in,out] buf  Pointer to the buffer.
+ *
+ * @return 0 on success
+ * @return 1 on end of the compressed data
+ * @return <0 on error
+ */
+static int decompress_fill(
+	syslog_decompress_t *dec,
+	decompress_buffer_t *buf
+)
+{
+	int ret;
+
+	while (buf->size < SYSLOG_DECOMPRESS_BUFFER_SIZE)
+	{
+		if ((dec->in_start == dec->in_end) && !dec->in_eof)
+		{
+			ret = decompress_read_input(dec);
+			if (ret)
+				return ret;
+		}
+
+		ret = dec->codec->step(dec, buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Decompression thread
+ *
+ * @param[in] arg  Pointer to the decompressor.
+ *
+ * @return NULL
+ */
+static void *decompress_thread(void *arg)
+{
+	syslog_decompress_t *dec = arg;
+	decompress_buffer_t *buf;
+	int ret = 0;
+
+	while (!ret)
+	{
+		pthread_mutex_lock(&dec->mutex);
+
+		while ((dec->used == SYSLOG_DECOMPRESS_BUFFERS) && !dec->stop)
+			pthread_cond_wait(&dec->cond, &dec->mutex);
+
+		if (dec->stop)
+		{
+			pthread_mutex_unlock(&dec->mutex);
+			break;
+		}
+
+		/* Buffer at the tail is not used by the reader */
+		buf = &dec->ring[dec->tail];
+		pthread_mutex_unlock(&dec->mutex);
+
+		buf->size = 0;
+		ret = decompress_fill(dec, buf);
+
+		pthread_mutex_lock(&dec->mutex);
+
+		if (buf->size)
+		{
+			dec->tail = (dec->tail + 1) % SYSLOG_DECOMPRESS_BUFFERS;
+			dec->used++;
+		}
+
+		if (ret)
+		{
+			dec->done = 1;
+
+			if (ret < 0)
+				dec->error = ret;
+		}
+
+		pthread_cond_broadcast(&dec->cond);
+		pthread_mutex_unlock(&dec->mutex);
+	}
+
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+syslog_compression_t syslog_compression_detect(
+	const void *data,
+	size_t size
+)
+{
+	unsigned int i;
+
+	assert(data || !size);
+
+	for (i = 0; i < ARRAY_SIZE(decompress_codecs); i++)
+	{
+		const decompress_codec_t *codec = &decompress_codecs[i];
+
+		if (codec->magic && (size >= codec->magic_size) &&
+		    !memcmp(data, codec->magic, codec->magic_size))
+			return (syslog_compression_t)i;
+	}
+
+	return SYSLOG_COMPRESSION_NONE;
+}
+
+const char *syslog_compression_name(syslog_compression_t type)
+{
+	if ((type >= ARRAY_SIZE(decompress_codecs)) ||
+	    !decompress_codecs[type].name)
+		return "none";
+
+	return decompress_codecs[type].name;
+}
+
+int syslog_compression_supported(syslog_compression_t type)
+{
+	return (type < ARRAY_SIZE(decompress_codecs)) &&
+		decompress_codecs[type].init;
+}
+
+int syslog_decompress_open(
+	syslog_decompress_t **dec,
+	int fd,
+	syslog_compression_t type,
+	const void *prefix,
+	size_t prefix_size
+)
+{
+	syslog_decompress_t *d;
+	unsigned int i;
+	int ret;
+
+	assert(dec);
+	assert(prefix_size <= SYSLOG_INPUT_BLOCK_SIZE);
+
+	*dec = NULL;
+
+	if (!syslog_compression_supported(type))
+		return -ENOTSUP;
+
+	d = calloc(1, sizeof(syslog_decompress_t));
+	if (!d)
+		return -ENOMEM;
+
+	d->fd    = fd;
+	d->codec = &decompress_codecs[type];
+	d->in    = malloc(SYSLOG_INPUT_BLOCK_SIZE);
+
+	for (i = 0; i < SYSLOG_DECOMPRESS_BUFFERS; i++)
+		d->ring[i].data = malloc(SYSLOG_DECOMPRESS_BUFFER_SIZE);
+
+	for (i = 0; i < SYSLOG_DECOMPRESS_BUFFERS; i++)
+	{
+		if (!d->ring[i].data)
+			break;
+	}
+
+	if (!d->in || (i < SYSLOG_DECOMPRESS_BUFFERS))
+	{
+		ret = -ENOMEM;
+		goto fail_alloc;
+	}
+
+	if (prefix_size)
+	{
+		memcpy(d->in, prefix, prefix_size);
+		d->in_end = prefix_size;
+	}
+
+	ret = d->codec->init(d);
+	if (ret)
+		goto fail_alloc;
+
+	pthread_mutex_init(&d->mutex, NULL);
+	pthread_cond_init(&d->cond, NULL);
+
+	ret = -pthread_create(&d->thread, NULL, decompress_thread, d);
+	if (ret)
+	{
+		pthread_cond_destroy(&d->cond);
+		pthread_mutex_destroy(&d->mutex);
+		d->codec->end(d);
+		goto fail_alloc;
+	}
+
+	*dec = d;
+	return 0;
+
+fail_alloc:
+	for (i = 0; i < SYSLOG_DECOMPRESS_BUFFERS; i++)
+		free(d->ring[i].data);
+
+	free(d->in);
+	free(d);
+	return ret;
+}
+
+ssize_t syslog_decompress_read(
+	syslog_decompress_t *dec,
+	void *data,
+	size_t size
+)
+{
+	decompress_buffer_t *buf;
+	size_t n;
+	int ret;
+
+	assert(dec);
+	assert(data);
+
+	pthread_mutex_lock(&dec->mutex);
+
+	while (!dec->used && !dec->done)
+		pthread_cond_wait(&dec->cond, &dec->mutex);
+
+	if (!dec->used)
+	{
+		ret = dec->error;
+		pthread_mutex_unlock(&dec->mutex);
+
+		if (ret)
+		{
+			fprintf(stderr, "Failed to decompress %s input data: %s\n",
+				dec->codec->name, dec->message);
+		}
+
+		return ret;
+	}
+
+	/* Buffer at the head is not used by the decompression thread */
+	buf = &dec->ring[dec->head];
+	pthread_mutex_unlock(&dec->mutex);
+
+	n = buf->size - dec->head_offset;
+	if (n > size)
+		n = size;
+
+	memcpy(data, buf->data + dec->head_offset, n);
+	dec->head_offset += n;
+
+	if (dec->head_offset == buf->size)
+	{
+		/* Return buffer to the decompression thread */
+		pthread_mutex_lock(&dec->mutex);
+
+		dec->head = (dec->head + 1) % SYSLOG_DECOMPRESS_BUFFERS;
+		dec->used--;
+		dec->head_offset = 0;
+
+		pthread_cond_broadcast(&dec->cond);
+		pthread_mutex_unlock(&dec->mutex);
+	}
+
+	return n;
+}
+
+void syslog_decompress_close(syslog_decompress_t *dec)
+{
+	unsigned int i;
+
+	if (!dec)
+		return;
+
+	pthread_mutex_lock(&dec->mutex);
+	dec->stop = 1;
+	pthread_cond_broadcast(&dec->cond);
+	pthread_mutex_unlock(&dec->mutex);
+
+	pthread_join(dec->thread, NULL);
+
+	dec->codec->end(dec);
+
+	pthread_cond_destroy(&dec->cond);
+	pthread_mutex_destroy(&dec->mutex);
+
+	for (i = 0; i < SYSLOG_DECOMPRESS_BUFFERS; i++)
+		free(dec->ring[i].data);
+
+	free(dec->in);
+	free(dec);
+}
+
+/* ----------------------------------------------------------------------- */
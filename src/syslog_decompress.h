@@ -0,0 +1,134 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Compressed input decompression header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_DECOMPRESS_H__
+#define __SYSLOG_DECOMPRESS_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Number of bytes required to detect the compression format */
+#define SYSLOG_COMPRESSION_MAGIC_SIZE  6
+
+/**
+ * @brief Compression formats
+ */
+typedef enum syslog_compression
+{
+	SYSLOG_COMPRESSION_NONE = 0,  /**< Data is not compressed */
+	SYSLOG_COMPRESSION_GZIP,      /**< gzip (zlib) */
+	SYSLOG_COMPRESSION_ZSTD,      /**< Zstandard */
+	SYSLOG_COMPRESSION_XZ,        /**< xz (liblzma) */
+} syslog_compression_t;
+
+/**
+ * @brief Decompressor data structure
+ *
+ * Decompression runs in a separate thread, which fills a ring of
+ * #SYSLOG_DECOMPRESS_BUFFERS buffers of #SYSLOG_DECOMPRESS_BUFFER_SIZE
+ * bytes, so decompression and parsing of the data overlap.
+ */
+typedef struct syslog_decompress syslog_decompress_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Detect compression format by the magic bytes
+ *
+ * @param[in] data  Pointer to the first bytes of the data.
+ * @param[in] size  Number of available bytes (at least
+ *                  #SYSLOG_COMPRESSION_MAGIC_SIZE bytes are required
+ *                  to detect all formats).
+ *
+ * @return Detected compression format
+ */
+syslog_compression_t syslog_compression_detect(
+	const void *data,
+	size_t size
+);
+
+/**
+ * Get compression format name
+ *
+ * @param[in] type  Compression format.
+ *
+ * @return Compression format name
+ */
+const char *syslog_compression_name(syslog_compression_t type);
+
+/**
+ * Check that decompression of the format is supported by the build
+ *
+ * @param[in] type  Compression format.
+ *
+ * @return 1 if format is supported, 0 otherwise
+ */
+int syslog_compression_supported(syslog_compression_t type);
+
+/**
+ * Start decompression of the compressed data stream
+ *
+ * @param[out] dec          Pointer to the decompressor pointer.
+ * @param[in]  fd           Compressed data file descriptor.
+ * @param[in]  type         Compression format.
+ * @param[in]  prefix       Compressed data already read from the file
+ *                          descriptor (or NULL).
+ * @param[in]  prefix_size  Size of the @p prefix data (at most
+ *                          #SYSLOG_INPUT_BLOCK_SIZE bytes).
+ *
+ * @return 0 on success
+ * @return -ENOTSUP if format is not supported
+ * @return <0 on other errors
+ */
+int syslog_decompress_open(
+	syslog_decompress_t **dec,
+	int fd,
+	syslog_compression_t type,
+	const void *prefix,
+	size_t prefix_size
+);
+
+/**
+ * Read decompressed data
+ *
+ * Function blocks until decompressed data is available.
+ *
+ * @param[in,out] dec   Pointer to the decompressor.
+ * @param[out]    data  Pointer to the buffer for the data.
+ * @param[in]     size  Buffer size.
+ *
+ * @return Number of bytes read
+ * @return 0 on end of the decompressed data
+ * @return <0 on error
+ */
+ssize_t syslog_decompress_read(
+	syslog_decompress_t *dec,
+	void *data,
+	size_t size
+);
+
+/**
+ * Stop decompression and free all allocated resources
+ *
+ * @param[in] dec  Pointer to the decompressor.
+ */
+void syslog_decompress_close(syslog_decompress_t *dec);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_DECOMPRESS_H__ */
@@ -0,0 +1,711 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Repeated entries deduplication source
+ *
+ * Entries waiting for output (groups of the repeated entries) are kept
+ * in the ring in the order of their first occurrence and are found by
+ * the hash of the entry key fields (all output fields except the
+ * timestamps). Entry repeating one of the waiting entries increments
+ * its number of repeats, otherwise the new group is added to the ring.
+ * Ring has the single group if only consecutive entries are collapsed,
+ * so each different entry outputs the previous one. With the time
+ * window groups are output when the window from their first entry is
+ * passed (or if the ring is full).
+ *
+ * Field values of the waiting entries are copied into the group data
+ * buffers, which are reused by the following groups in the same ring
+ * slot, so nothing is allocated for each entry.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <syslog_sketch.h>
+#include <syslog_dedup.h>
+
+/**
+ * @brief Group of the repeated entries
+ */
+typedef struct syslog_dedup_group
+{
+	/** Hash of the entry key fields */
+	uint64_t hash;
+
+	/** Next group in the hash table chain (-1 if group is the last) */
+	int32_t next;
+
+	/** Number of entries */
+	unsigned long count;
+
+	/** Timestamp of the first entry */
+	time_t first;
+
+	/** Timestamp of the last entry */
+	union syslog_field_value_union last;
+
+	/** Output field values of the first entry */
+	syslog_field_state_t *fields;
+
+	/** String values data */
+	char *data;
+
+	/** Allocated size of the string values data */
+	size_t data_size;
+
+} syslog_dedup_group_t;
+
+/**
+ * @brief Deduplication data
+ */
+typedef struct syslog_dedup
+{
+	/** Output format of the entries */
+	const output_fmt_t *output_fmt;
+
+	/** Time window in seconds (<0 if only consecutive entries are collapsed) */
+	time_t window;
+
+	/** Ring of the groups waiting for output */
+	syslog_dedup_group_t *groups;
+
+	/** Ring size */
+	uint32_t groups_max;
+
+	/** Index of the first (oldest) group in the ring */
+	uint32_t head;
+
+	/** Number of groups in the ring */
+	uint32_t groups_n;
+
+	/** Hash table of the group chains (-1 if chain is empty) */
+	int32_t *hash;
+
+	/** Hash table size (power of 2) */
+	uint32_t hash_size;
+
+	/** Field values of all groups */
+	syslog_field_state_t *fields;
+
+	/** Number of the output fields of the parsed entries */
+	unsigned int fields_n;
+
+	/** Group of the last entry (-1 if group is already output) */
+	int32_t last_group;
+
+	/** Latest entry timestamp */
+	time_t now;
+
+	/** Number of the output entries */
+	unsigned int num;
+
+	/** Result entry */
+	syslog_entry_t result;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+} syslog_dedup_t;
+
+/** @brief Deduplication data */
+static syslog_dedup_t dd;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Parse time window
+ *
+ * @param[in]  arg     "<N>[s|m|h|d]" string.
+ * @param[out] window  Time window in seconds.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int dedup_parse_window(const char *arg, time_t *window)
+{
+	unsigned long value;
+	char *end;
+
+	if (!isdigit((unsigned char)*arg))
+		return -EINVAL;
+
+	value = strtoul(arg, &end, 10);
+	if (end[0] && end[1])
+		return -EINVAL;
+
+	switch(*end)
+	{
+		case '\0':
+		case 's': *window = value; break;
+		case 'm': *window = value * 60; break;
+		case 'h': *window = value * 60 * 60; break;
+		case 'd': *window = value * 24 * 60 * 60; break;
+		default:
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Check if field is compared to find the repeated entries
+ *
+ * @param[in] field  Pointer to the field data structure.
+ *
+ * @return Non-zero if field is the key field
+ */
+static inline int dedup_is_key(const syslog_field_t *field)
+{
+	return (field->info->type != SYSLOG_FIELD_TYPE_TIME) &&
+	       (field->info->id != SYSLOG_FIELD_ID_KTIME);
+}
+
+/**
+ * Compute hash of the entry key fields
+ *
+ * @param[in] entry  Pointer to the parsed entry data structure.
+ *
+ * @return Hash
+ */
+static uint64_t dedup_hash(const syslog_entry_t *entry)
+{
+	const syslog_field_t *field;
+	uint64_t hash = 14695981039346656037ull;
+	uint64_t value;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if ((field->flags & SYSLOG_FIELD_FLAG_DROP) || !dedup_is_key(field))
+			continue;
+
+		if (field->info->type != SYSLOG_FIELD_TYPE_STRING)
+		{
+			value = syslog_sketch_hash((const char *)&field->value.uinteger,
+				sizeof(field->value.uinteger));
+		}
+		else if (field->value.string)
+		{
+			value = syslog_sketch_hash(field->value.string,
+				strlen(field->value.string));
+		}
+		else
+			value = 0;
+
+		hash = (hash ^ value) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+/**
+ * Check if entry repeats the first entry of the group
+ *
+ * @param[in] group  Pointer to the group.
+ * @param[in] entry  Pointer to the parsed entry data structure.
+ *
+ * @return Non-zero if entry is repeated
+ */
+static int dedup_equal(
+	const syslog_dedup_group_t *group,
+	const syslog_entry_t *entry
+)
+{
+	const syslog_field_state_t *state = group->fields;
+	const syslog_field_t *field;
+	const char *a;
+	const char *b;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		if (dedup_is_key(field))
+		{
+			if (field->info->type != SYSLOG_FIELD_TYPE_STRING)
+			{
+				if (field->value.uinteger != state->value.uinteger)
+					return 0;
+			}
+			else
+			{
+				a = field->value.string ? field->value.string : "";
+				b = state->value.string ? state->value.string : "";
+
+				if (strcmp(a, b))
+					return 0;
+			}
+		}
+
+		state++;
+	}
+
+	return 1;
+}
+
+/**
+ * Get number of repeats from the syslogd "last message repeated N times"
+ * entry message
+ *
+ * FreeBSD "--- last message repeated N times ---" and rsyslog
+ * "message repeated N times: [...]" messages are also recognized.
+ *
+ * @param[in] entry  Pointer to the parsed entry data structure.
+ *
+ * @return Number of repeats
+ * @return 0 if entry is not the repeated message entry
+ */
+static unsigned long dedup_repeated(const syslog_entry_t *entry)
+{
+	const syslog_field_t *field;
+	const char *message;
+	unsigned long n;
+	char *end;
+
+	field = syslog_entry_field(entry, SYSLOG_FIELD_ID_MESSAGE);
+	if (!field || !field->value.string)
+		return 0;
+
+	message = field->value.string;
+
+	while (isspace((unsigned char)*message))
+		message++;
+
+	if (!strncmp(message, "--- ", 4))
+		message += 4;
+
+	if (!strncmp(message, "last ", 5))
+		message += 5;
+
+	if (strncmp(message, "message repeated ", 17))
+		return 0;
+
+	message += 17;
+
+	if (!isdigit((unsigned char)*message))
+		return 0;
+
+	n = strtoul(message, &end, 10);
+	if (strncmp(end, " time", 5))
+		return 0;
+
+	return n;
+}
+
+/**
+ * Set the last entry timestamp of the group
+ *
+ * @param[in,out] group  Pointer to the group.
+ * @param[in]     field  Pointer to the timestamp field of the entry
+ *                       or NULL.
+ */
+static void dedup_set_last(
+	syslog_dedup_group_t *group,
+	const syslog_field_t *field
+)
+{
+	if (field && (field->value.time.unixtime >= group->last.time.unixtime))
+		group->last = field->value;
+}
+
+/**
+ * Copy output field values of the entry into the group
+ *
+ * @param[in,out] group  Pointer to the group.
+ * @param[in]     entry  Pointer to the parsed entry data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int dedup_store(
+	syslog_dedup_group_t *group,
+	const syslog_entry_t *entry
+)
+{
+	syslog_field_state_t *state = group->fields;
+	const syslog_field_t *field;
+	size_t size = 0;
+	size_t len;
+	char *data;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (!(field->flags & SYSLOG_FIELD_FLAG_DROP) &&
+		    (field->info->type == SYSLOG_FIELD_TYPE_STRING) &&
+		    field->value.string)
+			size += strlen(field->value.string) + 1;
+	}
+
+	if (size > group->data_size)
+	{
+		data = realloc(group->data, size);
+		if (!data)
+			return -ENOMEM;
+
+		group->data = data;
+		group->data_size = size;
+	}
+
+	data = group->data;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		state->value = field->value;
+		state->flags = 0;
+		state->code  = field->code;
+
+		if ((field->info->type == SYSLOG_FIELD_TYPE_STRING) &&
+		    field->value.string)
+		{
+			len = strlen(field->value.string) + 1;
+			memcpy(data, field->value.string, len);
+			state->value.string = data;
+			data += len;
+		}
+
+		state++;
+	}
+
+	return 0;
+}
+
+/**
+ * Output the first group of the ring and remove it from the ring
+ *
+ * @param[in,out] out  Pointer to the output.
+ */
+static void dedup_emit(syslog_output_t *out)
+{
+	const output_fmt_t *fmt = dd.output_fmt;
+	syslog_dedup_group_t *group = &dd.groups[dd.head];
+	syslog_field_t *field;
+	int32_t *chain;
+	unsigned int i = 0;
+
+	for (field = dd.result.fields; field; field = field->next)
+	{
+		switch(field->info->id)
+		{
+			case SYSLOG_FIELD_ID_COUNT:
+				field->value.uinteger = group->count;
+				break;
+
+			case SYSLOG_FIELD_ID_LAST:
+				field->value = group->last;
+				break;
+
+			default:
+				field->value = group->fields[i].value;
+				field->code  = group->fields[i].code;
+				i++;
+				break;
+		}
+	}
+
+	dd.result.num = ++dd.num;
+
+	if (fmt->fn_output_entry)
+		fmt->fn_output_entry(out, &dd.result);
+
+	/* Remove group from the hash table chain */
+	chain = &dd.hash[group->hash & (dd.hash_size - 1)];
+	while (*chain != (int32_t)dd.head)
+		chain = &dd.groups[*chain].next;
+
+	*chain = group->next;
+
+	if (dd.last_group == (int32_t)dd.head)
+		dd.last_group = -1;
+
+	dd.head = (dd.head + 1) % dd.groups_max;
+	dd.groups_n--;
+}
+
+/**
+ * Add entry to the waiting groups
+ *
+ * @param[in,out] out    Pointer to the output.
+ * @param[in]     entry  Pointer to the parsed entry data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int dedup_add(syslog_output_t *out, const syslog_entry_t *entry)
+{
+	syslog_dedup_group_t *group;
+	const syslog_field_t *timestamp;
+	unsigned long repeated;
+	time_t time = 0;
+	uint64_t hash;
+	int32_t *chain;
+	int32_t index;
+	int ret;
+
+	timestamp = syslog_entry_field(entry, SYSLOG_FIELD_ID_TIMESTAMP);
+	if (timestamp)
+	{
+		time = (time_t)timestamp->value.time.unixtime;
+		if (time > dd.now)
+			dd.now = time;
+	}
+
+	/* Repeats reported by syslogd are counted in the group of the
+	 * previous entry */
+	repeated = dedup_repeated(entry);
+	if (repeated && (dd.last_group >= 0))
+	{
+		group = &dd.groups[dd.last_group];
+		group->count += repeated;
+		dedup_set_last(group, timestamp);
+		return 0;
+	}
+
+	/* Output groups with the passed time window */
+	if (dd.window >= 0)
+	{
+		while (dd.groups_n && (dd.now - dd.groups[dd.head].first > dd.window))
+			dedup_emit(out);
+	}
+
+	hash = dedup_hash(entry);
+	chain = &dd.hash[hash & (dd.hash_size - 1)];
+
+	/* Chain starts with the latest group */
+	for (index = *chain; index >= 0; index = group->next)
+	{
+		group = &dd.groups[index];
+		if ((group->hash == hash) && dedup_equal(group, entry))
+			break;
+	}
+
+	if ((index >= 0) &&
+	    ((dd.window < 0) || (time - group->first <= dd.window)))
+	{
+		group->count++;
+		dedup_set_last(group, timestamp);
+		dd.last_group = index;
+		return 0;
+	}
+
+	if (dd.groups_n == dd.groups_max)
+		dedup_emit(out);
+
+	index = (dd.head + dd.groups_n) % dd.groups_max;
+	group = &dd.groups[index];
+
+	ret = dedup_store(group, entry);
+	if (ret)
+		return ret;
+
+	group->hash  = hash;
+	group->count = 1;
+	group->first = time;
+
+	if (timestamp)
+		group->last = timestamp->value;
+
+	/* Chain head may be changed by the output of the ring head */
+	chain = &dd.hash[hash & (dd.hash_size - 1)];
+	group->next = *chain;
+	*chain = index;
+
+	dd.groups_n++;
+	dd.last_group = index;
+	return 0;
+}
+
+/**
+ * Free all allocated resources
+ */
+static void dedup_free(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < dd.groups_max; i++)
+		free(dd.groups[i].data);
+
+	syslog_entry_destroy(&dd.result);
+
+	free(dd.groups);
+	free(dd.hash);
+	free(dd.fields);
+
+	memset(&dd, 0, sizeof(dd));
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_dedup_init(
+	const char *window,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+)
+{
+	syslog_field_id_t ids[SYSLOG_FIELD_ID_LAST + 1];
+	unsigned int ids_n = 0;
+	syslog_field_t *field;
+	int has_timestamp = 0;
+	uint32_t i;
+	int ret;
+
+	assert(entry);
+	assert(output_fmt);
+
+	memset(&dd, 0, sizeof(dd));
+	dd.output_fmt = output_fmt;
+	dd.window = -1;
+	dd.last_group = -1;
+
+	if (window)
+	{
+		if (dedup_parse_window(window, &dd.window))
+		{
+			fprintf(stderr, "Invalid deduplication time window '%s'\n",
+				window);
+
+			return -EINVAL;
+		}
+
+		if (!syslog_entry_has_field(entry, SYSLOG_FIELD_ID_TIMESTAMP))
+		{
+			fprintf(stderr, "Deduplication time window requires "
+				"field %%T in the entry specification\n");
+
+			return -EINVAL;
+		}
+	}
+
+	/* Output fields of the entry, the number of repeats and
+	 * the last entry timestamp (the first is the entry timestamp) */
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		if (field->info->id == SYSLOG_FIELD_ID_TIMESTAMP)
+			has_timestamp = 1;
+
+		ids[ids_n++] = field->info->id;
+	}
+
+	dd.fields_n = ids_n;
+	ids[ids_n++] = SYSLOG_FIELD_ID_COUNT;
+
+	if (has_timestamp)
+		ids[ids_n++] = SYSLOG_FIELD_ID_LAST;
+
+	ret = syslog_entry_init_fields(&dd.result, ids, ids_n);
+	if (ret)
+		return ret;
+
+	dd.groups_max = window ? SYSLOG_DEDUP_MAX_PENDING : 1;
+	dd.hash_size = 2;
+
+	while (dd.hash_size < dd.groups_max * 2)
+		dd.hash_size <<= 1;
+
+	dd.groups = calloc(dd.groups_max, sizeof(syslog_dedup_group_t));
+	dd.hash   = malloc(dd.hash_size * sizeof(int32_t));
+	dd.fields = calloc((size_t)dd.groups_max * (dd.fields_n + 1),
+		sizeof(syslog_field_state_t));
+
+	if (!dd.groups || !dd.hash || !dd.fields)
+	{
+		dedup_free();
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < dd.hash_size; i++)
+		dd.hash[i] = -1;
+
+	for (i = 0; i < dd.groups_max; i++)
+		dd.groups[i].fields = &dd.fields[i * dd.fields_n];
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_dedup_output_init(const syslog_entry_t *entry)
+{
+	(void)entry;
+
+	if (dd.output_fmt->fn_output_init)
+		dd.output_fmt->fn_output_init(&dd.result);
+}
+
+static void syslog_dedup_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	dd.num = entry->num;
+	dd.result.num = entry->num;
+
+	if (dd.output_fmt->fn_output_start)
+		dd.output_fmt->fn_output_start(out, &dd.result);
+}
+
+static void syslog_dedup_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	int ret;
+
+	if (dd.error)
+		return;
+
+	ret = dedup_add(out, entry);
+	if (ret)
+	{
+		dd.error = ret;
+		out->error = ret;
+	}
+}
+
+static void syslog_dedup_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	(void)entry;
+
+	while (!dd.error && dd.groups_n)
+		dedup_emit(out);
+
+	if (dd.error && !out->error)
+		out->error = dd.error;
+
+	dd.result.num = dd.num;
+
+	if (dd.output_fmt->fn_output_end)
+		dd.output_fmt->fn_output_end(out, &dd.result);
+
+	dedup_free();
+}
+
+output_fmt_t syslog_dedup_fmt =
+{
+	.name              = "dedup",
+	.description       = "Entries with the repeated entries collapsed",
+	.flags             = OUTPUT_FMT_FLAG_SEQUENTIAL | OUTPUT_FMT_FLAG_NOAPPEND,
+	.fn_output_init    = syslog_dedup_output_init,
+	.fn_output_start   = syslog_dedup_output_start,
+	.fn_output_entry   = syslog_dedup_output_entry,
+	.fn_output_end     = syslog_dedup_output_end
+};
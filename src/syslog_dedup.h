@@ -0,0 +1,63 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Repeated entries deduplication header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_DEDUP_H__
+#define __SYSLOG_DEDUP_H__
+
+#include <syslog_fc.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Deduplication output format
+ *
+ * Repeated entries passed to the entry output callback are collapsed
+ * into the single entry, which is output in the output format passed
+ * to syslog_dedup_init() with the number of repeats and the timestamp
+ * of the last repeated entry added after all fields.
+ */
+extern output_fmt_t syslog_dedup_fmt;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize repeated entries deduplication
+ *
+ * Entries are repeated if all output fields except timestamps are the
+ * same. Without the time window only consecutive repeated entries are
+ * collapsed. With the time window entries repeated within the window
+ * from the first entry are collapsed even if there are other entries
+ * between them, and entries are output in the order of their first
+ * occurrence.
+ *
+ * @param[in] window      Time window ("<N>[s|m|h|d]") or NULL.
+ * @param[in] entry       Pointer to the entry data structure used for
+ *                        parsing (must have timestamp field if the
+ *                        time window is specified).
+ * @param[in] output_fmt  Output format of the entries.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_dedup_init(
+	const char *window,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_DEDUP_H__ */
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #define SYSLOG_NAMES
 #include <syslog.h> /* prioritynames, facilitynames */
@@ -42,11 +43,21 @@
 
 /* ----------------------------------------------------------------------- */
 
-static int validate_facility(const struct syslog_field *field);
-static int validate_priority(const struct syslog_field *field);
+static int validate_facility(struct syslog_field *field);
+static int validate_priority(struct syslog_field *field);
 
 static int mod_priority(struct syslog_field *field);
 
+/** @brief Field filter function type */
+typedef int (*field_filter_fn_t)(const struct syslog_field *field);
+
+static int filter_time(const struct syslog_field *field);
+static int filter_facility(const struct syslog_field *field);
+static int filter_priority(const struct syslog_field *field);
+static int filter_tag(const struct syslog_field *field);
+
+static int entry_compile(syslog_entry_t *entry);
+
 /**
  * @brief Available syslog fields information array
  */
@@ -111,131 +122,269 @@ static syslog_field_info_t syslog_field_info[] =
 		.param_name = "message",
 		.human_name = "Message",
 	},
+	{
+		.id         = SYSLOG_FIELD_ID_COUNT,
+		.type       = SYSLOG_FIELD_TYPE_UINTEGER,
+		.spec       = 0, /* Not parsed */
+		.param_name = "count",
+		.human_name = "Count",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_KEY,
+		.type       = SYSLOG_FIELD_TYPE_STRING,
+		.spec       = 0, /* Not parsed */
+		.param_name = "key",
+		.human_name = "Key",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_DISTINCT,
+		.type       = SYSLOG_FIELD_TYPE_UINTEGER,
+		.spec       = 0, /* Not parsed */
+		.param_name = "distinct",
+		.human_name = "Distinct",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_VALUE,
+		.type       = SYSLOG_FIELD_TYPE_STRING,
+		.spec       = 0, /* Not parsed */
+		.param_name = "value",
+		.human_name = "Value",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_ERROR,
+		.type       = SYSLOG_FIELD_TYPE_UINTEGER,
+		.spec       = 0, /* Not parsed */
+		.param_name = "error",
+		.human_name = "Error",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_TEMPLATE,
+		.type       = SYSLOG_FIELD_TYPE_STRING,
+		.spec       = 0, /* Not parsed */
+		.param_name = "template",
+		.human_name = "Template",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_FIRST,
+		.type       = SYSLOG_FIELD_TYPE_TIME,
+		.spec       = 0, /* Not parsed */
+		.param_name = "first",
+		.human_name = "First",
+	},
+	{
+		.id         = SYSLOG_FIELD_ID_LAST,
+		.type       = SYSLOG_FIELD_TYPE_TIME,
+		.spec       = 0, /* Not parsed */
+		.param_name = "last",
+		.human_name = "Last",
+	},
 };
 
 /* ----------------------------------------------------------------------- */
 
+/** @brief Size of the syslog names hash table (power of 2) */
+#define SYSLOG_NAMES_HASH_SIZE  64
+
+/** @brief Size of the priority names by value lookup table */
+#define SYSLOG_PRIORITY_VALUES  32
+
+/**
+ * @brief Syslog names hash table
+ *
+ * Hash function is collision-free for the glibc facility and priority
+ * names, so lookup takes single probe and single string comparison.
+ * Linear probing keeps lookups correct for any other names tables.
+ */
+typedef struct syslog_names
+{
+	/** Hash table slots */
+	const CODE *slots[SYSLOG_NAMES_HASH_SIZE];
+
+} syslog_names_t;
+
+/** @brief Facility names hash table */
+static syslog_names_t syslog_facility_names;
+
+/** @brief Priority names hash table */
+static syslog_names_t syslog_priority_names;
+
+/** @brief Priority names by priority value */
+static const char *syslog_priority_by_val[SYSLOG_PRIORITY_VALUES];
+
+/** @brief Syslog names tables initialization control */
+static pthread_once_t syslog_names_once = PTHREAD_ONCE_INIT;
+
 /**
- * Checks for the presence of the specified name in the array
- * of the CODE items.
+ * Calculate syslog name hash
+ *
+ * @param[in] name Name (at least one character).
+ * @param[in] len  Name length.
+ *
+ * @return Hash table slot index
+ */
+static inline unsigned int syslog_names_hash(const char *name, size_t len)
+{
+	return (len + (unsigned char)name[1] * 4 +
+		(unsigned char)name[len - 1] * 3) & (SYSLOG_NAMES_HASH_SIZE - 1);
+}
+
+/**
+ * Fill syslog names hash table
  *
  * Type of the structure CODE declared in default header file
  * @p <sys/syslog.h>.
  *
- * @param[in] code Pointer to the array of the CODE items
- * @param[in] name Name to check
- *
- * @return Pointer to the founded name from @p code list
- * @return NULL if name is not founded in the @p code list
+ * @param[out] names Pointer to the hash table.
+ * @param[in]  code  Pointer to the array of the CODE items.
  */
-static const CODE *find_syslog_name(
-	const CODE *code,
-	const char *name)
+static void syslog_names_fill(syslog_names_t *names, const CODE *code)
 {
 	const CODE *c;
 
-	assert(code);
-	assert(name);
-
 	for (c = code; c->c_name; c++)
 	{
-		if (strcmp(name, c->c_name) == 0)
-			return c;
+		unsigned int i = syslog_names_hash(c->c_name, strlen(c->c_name));
+
+		while (names->slots[i])
+			i = (i + 1) & (SYSLOG_NAMES_HASH_SIZE - 1);
+
+		names->slots[i] = c;
 	}
+}
 
-	return NULL;
+/**
+ * Initialize syslog names lookup tables
+ */
+static void syslog_names_init(void)
+{
+	const CODE *c;
+
+	syslog_names_fill(&syslog_facility_names, facilitynames);
+	syslog_names_fill(&syslog_priority_names, prioritynames);
+
+	/* First name wins for the values with several names */
+	for (c = prioritynames; c->c_name; c++)
+	{
+		if ((c->c_val >= 0) && (c->c_val < SYSLOG_PRIORITY_VALUES) &&
+		    !syslog_priority_by_val[c->c_val])
+			syslog_priority_by_val[c->c_val] = c->c_name;
+	}
 }
 
 /**
- * Checks for the presence of the specified value in the array
- * of the CODE items.
+ * Find name in the syslog names hash table
  *
- * Type of the structure CODE declared in default header file
- * @p <sys/syslog.h>.
- *
- * @param[in] code Pointer to the array of the CODE items
- * @param[in] val Value to check
+ * @param[in] names Pointer to the hash table.
+ * @param[in] name  Name to find.
  *
- * @return Pointer to the founded name from @p code list
- * @return NULL if name is not founded in the @p code list
+ * @return Pointer to the founded CODE item
+ * @return NULL if name is not founded
  */
-static const CODE *find_syslog_name_by_val(
-	const CODE *code,
-	const int val)
+static const CODE *syslog_names_find(
+	const syslog_names_t *names,
+	const char *name)
 {
-	const CODE *c;
+	size_t len = strlen(name);
+	unsigned int i;
 
-	assert(code);
+	if (!len)
+		return NULL;
 
-	for (c = code; c->c_name; c++)
+	for (i = syslog_names_hash(name, len); names->slots[i];
+	     i = (i + 1) & (SYSLOG_NAMES_HASH_SIZE - 1))
 	{
-		if (val == c->c_val)
-			return c;
+		if (!strcmp(name, names->slots[i]->c_name))
+			return names->slots[i];
 	}
 
 	return NULL;
 }
 
 /**
- * Validate syslog facility name in the syslog entry field value.
+ * Check that string consists of decimal digits only.
  *
- * @param[in] field  Pointer to the syslog entry field.
+ * @param[in] p Pointer to the string.
  *
- * @return 1 if fields priority name is valid, 0 otherwise.
+ * @return 1 if string @p p is a number, 0 otherwise.
  */
-static int validate_facility(const struct syslog_field *field)
+static int strisnumber(const char *p)
 {
-	assert(field);
-	assert(field->info->id == SYSLOG_FIELD_ID_FACILITY);
-
-	if (find_syslog_name(facilitynames, field->value.string))
+	if (!p || !*p)
 		return 0;
 
-	return -EINVAL;
+	while(*p)
+	{
+		if (!isdigit(*p++))
+			return 0;
+	}
+
+	return 1;
 }
 
 /**
- * Validate syslog priority name in the syslog entry field value.
+ * Validate syslog facility name in the syslog entry field value.
  *
- * @param[in] field  Pointer to the syslog entry field.
+ * Facility code (see @ref syslog_field_t::code) is set.
  *
- * @return 1 if fields priority name is valid, 0 otherwise.
+ * @param[in,out] field  Pointer to the syslog entry field.
+ *
+ * @return 0 if fields facility name is valid, <0 otherwise.
  */
-static int validate_priority(const struct syslog_field *field)
+static int validate_facility(struct syslog_field *field)
 {
+	const CODE *c;
+
 	assert(field);
-	assert(field->info->id == SYSLOG_FIELD_ID_PRIORITY);
+	assert(field->info->id == SYSLOG_FIELD_ID_FACILITY);
 
-	if (find_syslog_name(prioritynames, field->value.string))
+	c = syslog_names_find(&syslog_facility_names, field->value.string);
+	if (c)
+	{
+		field->code = LOG_FAC(c->c_val);
 		return 0;
+	}
 
+	field->code = -1;
 	return -EINVAL;
 }
 
 /**
- * Skip spaces at beginning of string.
+ * Validate syslog priority name in the syslog entry field value.
  *
- * @param[in] p Pointer to the string.
+ * Priority code (see @ref syslog_field_t::code) is set.
  *
- * @return Pointer to the first non-space character in the string @p p.
+ * @param[in,out] field  Pointer to the syslog entry field.
+ *
+ * @return 0 if fields priority name is valid, <0 otherwise.
  */
-static int strisnumber(const char *p)
+static int validate_priority(struct syslog_field *field)
 {
-	if (!p || !*p)
+	const CODE *c;
+
+	assert(field);
+	assert(field->info->id == SYSLOG_FIELD_ID_PRIORITY);
+
+	/* Unknown numeric priorities are kept as is */
+	if (strisnumber(field->value.string))
+	{
+		field->code = (int)strtoul(field->value.string, NULL, 0);
 		return 0;
+	}
 
-	while(*p)
+	c = syslog_names_find(&syslog_priority_names, field->value.string);
+	if (c)
 	{
-		if (!isdigit(*p++))
-			return 0;
+		field->code = c->c_val;
+		return 0;
 	}
 
-	return 1;
+	field->code = -1;
+	return -EINVAL;
 }
 
 static int mod_priority(struct syslog_field *field)
 {
-	const CODE *prcode;
+	unsigned long val;
 
 	assert(field);
 	assert(field->info->id == SYSLOG_FIELD_ID_PRIORITY);
@@ -243,23 +392,131 @@ static int mod_priority(struct syslog_field *field)
 	if (!strisnumber(field->value.string))
 		return 0;
 
-	/* String is number, disabled validation and try to find
-	   priority name by number */
-	field->flags |= SYSLOG_FIELD_FLAG_NOVALIDATION;
+	/* String is number, try to find priority name by number */
+	val = (unsigned int)strtoul(field->value.string, NULL, 0);
+
+	if ((val < SYSLOG_PRIORITY_VALUES) && syslog_priority_by_val[val])
+		field->value.string = (char *)syslog_priority_by_val[val];
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Filter entry by the timestamp (--since and --until options)
+ *
+ * @param[in] field  Pointer to the parsed timestamp field.
+ *
+ * @return Non-zero if entry must be skipped
+ */
+static int filter_time(const struct syslog_field *field)
+{
+	time_t t = (time_t)field->value.time.unixtime;
+
+	if ((config.filter.flags & SYSLOG_FILTER_SINCE) &&
+	    (t < config.filter.since))
+		return 1;
+
+	if ((config.filter.flags & SYSLOG_FILTER_UNTIL) &&
+	    (t >= config.filter.until))
+		return 1;
+
+	return 0;
+}
 
-	prcode = find_syslog_name_by_val(
-		prioritynames, (int)strtoul(field->value.string, NULL, 0));
+/**
+ * Filter entry by the facility (--facility option)
+ *
+ * @param[in] field  Pointer to the parsed facility field.
+ *
+ * @return Non-zero if entry must be skipped
+ */
+static int filter_facility(const struct syslog_field *field)
+{
+	return (field->code < 0) ||
+		!(config.filter.facilities & (1UL << field->code));
+}
 
-	if (prcode)
+/**
+ * Filter entry by the priority (--min-priority option)
+ *
+ * @param[in] field  Pointer to the parsed priority field.
+ *
+ * @return Non-zero if entry must be skipped
+ */
+static int filter_priority(const struct syslog_field *field)
+{
+	return (field->code < 0) ||
+		(field->code > config.filter.min_priority);
+}
+
+/**
+ * Filter entry by the tag (--tag option)
+ *
+ * Tag matches if it is equal to the filter tag or if it is
+ * the filter tag followed by the "[pid]" suffix.
+ *
+ * @param[in] field  Pointer to the parsed tag field.
+ *
+ * @return Non-zero if entry must be skipped
+ */
+static int filter_tag(const struct syslog_field *field)
+{
+	const char *tag = config.filter.tag;
+	const char *p = field->value.string;
+
+	while (*tag && (*tag == *p))
 	{
-		field->value.string = strdup(prcode->c_name);
-		if (!field->value.string)
-			return -ENOMEM;
+		tag++;
+		p++;
+	}
+
+	return *tag || (*p && (*p != '['));
+}
+
+/**
+ * Get filter function for the field
+ *
+ * @param[in] info  Pointer to the field information.
+ *
+ * @return Filter function or NULL if field is not filtered
+ */
+static field_filter_fn_t field_filter(const syslog_field_info_t *info)
+{
+	unsigned int flags = config.filter.flags;
+
+	switch(info->id)
+	{
+		case SYSLOG_FIELD_ID_TIMESTAMP:
+			if (flags & (SYSLOG_FILTER_SINCE | SYSLOG_FILTER_UNTIL))
+				return filter_time;
+
+			break;
+
+		case SYSLOG_FIELD_ID_FACILITY:
+			if (flags & SYSLOG_FILTER_FACILITY)
+				return filter_facility;
+
+			break;
+
+		case SYSLOG_FIELD_ID_PRIORITY:
+			if (flags & SYSLOG_FILTER_MIN_PRIORITY)
+				return filter_priority;
+
+			break;
+
+		case SYSLOG_FIELD_ID_TAG:
+			if (flags & SYSLOG_FILTER_TAG)
+				return filter_tag;
 
-		field->flags |= SYSLOG_FIELD_FLAG_MEM_ALLOCATED;
+			break;
+
+		default:
+			break;
 	}
 
-	return 0;
+	return NULL;
 }
 
 /* ----------------------------------------------------------------------- */
@@ -284,6 +541,8 @@ int syslog_entry_init(
 	assert(entry);
 	assert(entry_spec);
 
+	pthread_once(&syslog_names_once, syslog_names_init);
+
 	memset(entry, 0, sizeof(syslog_entry_t));
 
 	for( ; *p; p++)
@@ -324,7 +583,7 @@ int syslog_entry_init(
 			goto get_next_ch;
 		}
 
-		for (i = 0; i < ARRAY_SIZE(syslog_field_info); i++)
+		for (i = 0; ch && (i < ARRAY_SIZE(syslog_field_info)); i++)
 		{
 			if (ch == syslog_field_info[i].spec)
 			{
@@ -370,6 +629,26 @@ int syslog_entry_init(
 		field->next             = NULL;
 		field->parse_start_char = parse_start_char;
 		field->parse_stop_char  = 0;
+		field->time_parser      = NULL;
+		field->code             = -1;
+		field->filter           = field_filter(field_info);
+
+		if (field_info->type == SYSLOG_FIELD_TYPE_TIME)
+		{
+			field->time_parser = malloc(sizeof(syslog_time_parser_t));
+			if (!field->time_parser)
+			{
+				free(field);
+				return -ENOMEM;
+			}
+
+			syslog_time_parser_init(field->time_parser,
+				config.ts_parse_spec);
+
+			/* Parser does not set the daylight saving time flag */
+			memset(&field->value.time.timestamp, 0, sizeof(struct tm));
+			field->value.time.timestamp.tm_isdst = -1;
+		}
 
 		entry->fields_num++;
 
@@ -391,8 +670,55 @@ int syslog_entry_init(
 		parse_start_char = 0;
 	}
 
-	return 0;
+	return entry_compile(entry);
+}
+
+int syslog_entry_init_fields(
+	syslog_entry_t *entry,
+	const syslog_field_id_t *ids,
+	unsigned int ids_n
+)
+{
+	syslog_field_t **next;
+	unsigned int i, j;
+
+	assert(entry);
+	assert(ids || !ids_n);
 
+	pthread_once(&syslog_names_once, syslog_names_init);
+
+	memset(entry, 0, sizeof(syslog_entry_t));
+	next = &entry->fields;
+
+	for (i = 0; i < ids_n; i++)
+	{
+		syslog_field_t *field;
+
+		for (j = 0; j < ARRAY_SIZE(syslog_field_info); j++)
+		{
+			if (syslog_field_info[j].id == ids[i])
+				break;
+		}
+
+		if (j == ARRAY_SIZE(syslog_field_info))
+			return -EINVAL;
+
+		field = calloc(1, sizeof(syslog_field_t));
+		if (!field)
+			return -ENOMEM;
+
+		field->info = &syslog_field_info[j];
+		field->code = -1;
+
+		entry->fields_mask |= (1 << ids[i]);
+		entry->fields_num++;
+		entry->fields_output_num++;
+
+		*next = field;
+		next = &field->next;
+	}
+
+	return 0;
 }
 
 void syslog_entry_destroy(syslog_entry_t *entry)
@@ -403,12 +729,12 @@ void syslog_entry_destroy(syslog_entry_t *entry)
 	{
 		syslog_field_t *field_next = field->next;
 
-		if (field->flags & SYSLOG_FIELD_FLAG_MEM_ALLOCATED)
-			free(field->value.string);
-
+		free(field->time_parser);
 		free(field);
 		field = field_next;
 	}
+
+	free(entry->ops);
 }
 
 /* ----------------------------------------------------------------------- */
@@ -437,6 +763,7 @@ static char *strskipspaces(const char *p)
  * (@ref syslog_field_t::syslog_field_value_union.time).
  *
  * @param[in,out] data  Pointer to the buffer with syslog file data.
+ * @param[in]     end   Pointer to the end of the syslog line data.
  * @param[in,out] field Pointer to the syslog entry field data structure.
  *
  * @return 0 on success
@@ -444,18 +771,19 @@ static char *strskipspaces(const char *p)
  */
 static int parse_timestamp(
 	char **data,
+	char *end,
 	syslog_field_t *field
 )
 {
-	*data = strptime(
-		*data, config.ts_parse_spec,
+	*data = syslog_time_parse(
+		field->time_parser, *data,
 		&field->value.time.timestamp
 	);
 
 	if (*data)
 	{
-		field->value.time.unixtime =
-			timelocal(&field->value.time.timestamp);
+		field->value.time.unixtime = syslog_time_local(
+			field->time_parser, &field->value.time.timestamp);
 	}
 
 	return *data ? 0 : -EILSEQ;
@@ -468,195 +796,441 @@ static int parse_timestamp(
  * (@ref syslog_field_t::syslog_field_value_union.string).
  *
  * @param[in,out] data  Pointer to the buffer with syslog file data.
+ * @param[in]     end   Pointer to the end of the syslog line data.
  * @param[in,out] field Pointer to the syslog entry field data structure.
+ * @param[in]     stop  Stop character (0 if string lasts till the end
+ *                      of line).
+ * @param[in]     skip  Skip spaces before searching for the stop
+ *                      character.
  *
  * @return 0 on success
  * @return <0 on error
  */
-static int parse_string(
+static inline int parse_string(
 	char **data,
-	syslog_field_t *field
+	char *end,
+	syslog_field_t *field,
+	char stop,
+	int skip
 )
 {
 	char *p = *data;
 
-	if (field->flags & SYSLOG_FIELD_FLAG_NOTRIM)
+	if (stop)
 	{
 		/*
 		 * If we do not remove spaces from the data, then we must find
 		 * the first non-space character in order to correctly find
 		 * stop character, that can be space space character.
 		 */
-		p = strskipspaces(p);
-	}
+		if (skip)
+			p = strskipspaces(p);
 
-	p = strchr(p, field->parse_stop_char);
-	if (!p)
-		return -EILSEQ;
+		p = memchr(p, stop, end - p);
+		if (!p)
+			return -EILSEQ;
+	}
+	else
+	{
+		/* No stop character, string lasts till the end of line */
+		p = end;
+	}
 
 	*p = '\0';
 
 	field->value.string = *data;
-	*data = p + 1;
+	*data = (p < end) ? p + 1 : end;
 
-	if ((p = strpbrk(field->value.string, "\r\n")) != NULL)
+	if ((p = memchr(field->value.string, '\r', p - field->value.string)))
 		*p = '\0';
 
 	return 0;
 }
 
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @name Entry parsing operation codes
+ * @{
+ */
+
+/** @brief Skip data up to and including the character */
+#define PARSE_OP_SEEK         1
+
+/** @brief Skip spaces */
+#define PARSE_OP_TRIM         2
+
+/** @brief Parse timestamp */
+#define PARSE_OP_TIME         3
+
+/** @brief Take string up to the stop character or till the end of line */
+#define PARSE_OP_TAKE         4
+
+/** @brief Skip spaces and take string up to the stop character */
+#define PARSE_OP_TAKE_NOTRIM  5
+
+/** @brief Convert taken string to signed integer */
+#define PARSE_OP_INT          6
+
+/** @brief Convert taken string to unsigned integer */
+#define PARSE_OP_UINT         7
+
+/** @brief Call field value modifier */
+#define PARSE_OP_MODIFY       8
+
+/** @brief Call field value validator */
+#define PARSE_OP_VALIDATE     9
+
+/** @brief Call field value validator to set field code only */
+#define PARSE_OP_RESOLVE      10
+
 /**
- * Integer parsing
+ * @brief Flag of the last operation of the filtered field
  *
- * Parsed integer will be stored into @p field->value.integer
- * (@ref syslog_field_t::syslog_field_value_union.integer).
+ * Field filter is called after the operation.
+ */
+#define PARSE_OP_FILTER       0x80
+
+/** @} */
+
+/**
+ * Report field parsing error
  *
- * @param[in,out] data  Pointer to the buffer with syslog file data.
- * @param[in,out] field Pointer to the syslog entry field data structure.
+ * @param[in] line_n Input line number.
+ * @param[in] op     Pointer to the failed operation.
+ * @param[in] ret    Error code.
  *
- * @return 0 on success
- * @return <0 on error
+ * @return @p ret
  */
-static int parse_integer(
-	char **data,
-	syslog_field_t *field
+static int parse_error(
+	unsigned int line_n,
+	const syslog_parse_op_t *op,
+	int ret
 )
 {
-	int ret = parse_string(data, field);
+	const char *msg;
+
+	switch(op->code & ~PARSE_OP_FILTER)
+	{
+		case PARSE_OP_SEEK:
+			/* Can't find start char */
+			return ret;
+
+		case PARSE_OP_MODIFY:
+			msg = "line %u: Modifier failed for field '%s' (%d)\n";
+			break;
+
+		case PARSE_OP_VALIDATE:
+			msg = "line %u: Readed invalid value for field '%s' (%d)\n";
+			break;
 
-	if (!ret)
-		field->value.integer = strtol(field->value.string, NULL, 0);
+		default:
+			msg = "line %u: Failed to parse '%s' field (%d)\n";
+			break;
+	}
 
+	fprintf(stderr, msg, line_n, op->field->info->param_name, ret);
 	return ret;
 }
 
 /**
- * Unsigned integer parsing
+ * Execute single entry parsing operation
  *
- * Parsed unsigned integer will be stored into @p field->value.uinteger
- * (@ref syslog_field_t::syslog_field_value_union.uinteger).
- *
- * @param[in,out] data  Pointer to the buffer with syslog file data.
- * @param[in,out] field Pointer to the syslog entry field data structure.
+ * @param[in]     op    Pointer to the operation.
+ * @param[in,out] data  Pointer to the current position in the line.
+ * @param[in]     end   Pointer to the end of the line.
  *
  * @return 0 on success
  * @return <0 on error
  */
-static int parse_uinteger(
+static inline int parse_op_exec(
+	const syslog_parse_op_t *op,
 	char **data,
-	syslog_field_t *field
+	char *end
 )
 {
-	int ret = parse_string(data, field);
+	syslog_field_t *field = op->field;
 
-	if (!ret)
-		field->value.uinteger = strtoul(field->value.string, NULL, 0);
+	switch(op->code & ~PARSE_OP_FILTER)
+	{
+		case PARSE_OP_SEEK:
+			*data = memchr(*data, op->ch, end - *data);
+			if (!*data)
+				return -EILSEQ;
 
-	return ret;
+			++(*data);
+			return 0;
+
+		case PARSE_OP_TRIM:
+			*data = strskipspaces(*data);
+			return 0;
+
+		case PARSE_OP_TIME:
+			return parse_timestamp(data, end, field);
+
+		case PARSE_OP_TAKE:
+			return parse_string(data, end, field, op->ch, 0);
+
+		case PARSE_OP_TAKE_NOTRIM:
+			return parse_string(data, end, field, op->ch, 1);
+
+		case PARSE_OP_INT:
+			field->value.integer = strtol(field->value.string, NULL, 0);
+			return 0;
+
+		case PARSE_OP_UINT:
+			field->value.uinteger = strtoul(field->value.string, NULL, 0);
+			return 0;
+
+		case PARSE_OP_MODIFY:
+			return field->info->modifier(field);
+
+		case PARSE_OP_VALIDATE:
+			return field->info->validator(field);
+
+		case PARSE_OP_RESOLVE:
+			field->info->validator(field);
+			return 0;
+	}
+
+	return -EINVAL;
 }
 
 /**
- * Syslog entry field parsing function
+ * Generic entry parser executing compiled operations
  *
- * @param[in]     line_n  Input line number (used only for output
- *                        in error messages).
- * @param[in,out] data    Pointer to the buffer with syslog file data.
- * @param[in,out] field   Pointer to the syslog entry field data structure.
+ * @param[in,out] entry   Pointer to the entry data structure.
+ * @param[in]     line_n  Input line number.
+ * @param[in,out] data    Pointer to the line data.
+ * @param[in]     end     Pointer to the end of the line.
  *
  * @return 0 on success
  * @return <0 on error
  */
-static int syslog_entry_field_parse(
+static int entry_parse_generic(
+	const syslog_entry_t *entry,
 	unsigned int line_n,
-	char **data,
-	syslog_field_t *field
+	char *data,
+	char *end
 )
 {
-	int ret;
+	const syslog_parse_op_t *op = entry->ops;
+	const syslog_parse_op_t *ops_end = entry->ops + entry->ops_num;
 
-	if (field->flags & SYSLOG_FIELD_FLAG_MEM_ALLOCATED)
+	for (; op < ops_end; op++)
 	{
-		free(field->value.string);
-		field->flags &= (~SYSLOG_FIELD_FLAG_MEM_ALLOCATED);
+		int ret = parse_op_exec(op, &data, end);
+		if (ret)
+			return parse_error(line_n, op, ret);
+
+		if ((op->code & PARSE_OP_FILTER) && op->field->filter(op->field))
+			return SYSLOG_ENTRY_FILTERED;
 	}
 
-	if (field->parse_start_char)
-	{
-		*data = strchr(*data, field->parse_start_char);
-		if (!*data)
-		{
-			/* Can't find start char */
-			return -EILSEQ;
-		}
+	return 0;
+}
 
-		++(*data);
-	}
+/**
+ * Operations of the default entry format specification
+ * ("%T %F.%P %G: %_M")
+ */
+static const syslog_parse_op_t entry_default_ops[] =
+{
+	{ .code = PARSE_OP_TRIM                 }, /* %T */
+	{ .code = PARSE_OP_TIME                 },
+	{ .code = PARSE_OP_TRIM                 }, /* %F */
+	{ .code = PARSE_OP_TAKE,     .ch = '.'  },
+	{ .code = PARSE_OP_VALIDATE             },
+	{ .code = PARSE_OP_TRIM                 }, /* %P */
+	{ .code = PARSE_OP_TAKE,     .ch = ' '  },
+	{ .code = PARSE_OP_MODIFY               },
+	{ .code = PARSE_OP_VALIDATE             },
+	{ .code = PARSE_OP_TRIM                 }, /* %G */
+	{ .code = PARSE_OP_TAKE,     .ch = ':'  },
+	{ .code = PARSE_OP_SEEK,     .ch = ' '  }, /* %_M */
+	{ .code = PARSE_OP_TAKE,     .ch = 0    },
+};
 
-	if (!(field->flags & SYSLOG_FIELD_FLAG_NOTRIM))
-		*data = strskipspaces(*data);
+/**
+ * Specialized entry parser for the default entry format specification
+ *
+ * Works exactly as entry_parse_generic() for the operations
+ * listed in the @ref entry_default_ops array.
+ *
+ * @param[in,out] entry   Pointer to the entry data structure.
+ * @param[in]     line_n  Input line number.
+ * @param[in,out] data    Pointer to the line data.
+ * @param[in]     end     Pointer to the end of the line.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int entry_parse_default(
+	const syslog_entry_t *entry,
+	unsigned int line_n,
+	char *data,
+	char *end
+)
+{
+	const syslog_parse_op_t *op = entry->ops;
+	int ret;
 
-	switch(field->info->type)
-	{
-		case SYSLOG_FIELD_TYPE_TIME:
-			ret = parse_timestamp(data, field);
-			break;
+	/* %T */
+	data = strskipspaces(data);
 
-		case SYSLOG_FIELD_TYPE_STRING:
-			ret = parse_string(data, field);
-			break;
+	if ((ret = parse_timestamp(&data, end, op[1].field)))
+		return parse_error(line_n, &op[1], ret);
 
-		case SYSLOG_FIELD_TYPE_INTEGER:
-			ret = parse_integer(data, field);
-			break;
+	if (op[1].field->filter && op[1].field->filter(op[1].field))
+		return SYSLOG_ENTRY_FILTERED;
 
-		case SYSLOG_FIELD_TYPE_UINTEGER:
-			ret = parse_uinteger(data, field);
-			break;
+	/* %F */
+	data = strskipspaces(data);
 
-		default:
-			ret = -EINVAL;
-			break;
-	}
+	if ((ret = parse_string(&data, end, op[3].field, '.', 0)))
+		return parse_error(line_n, &op[3], ret);
 
-	if (ret)
-	{
-		fprintf(stderr,
-			"line %u: Failed to parse '%s' field (%d)\n",
-			line_n, field->info->param_name, ret
-		);
+	if ((ret = op[4].field->info->validator(op[4].field)))
+		return parse_error(line_n, &op[4], ret);
 
-		return ret;
-	}
+	if (op[4].field->filter && op[4].field->filter(op[4].field))
+		return SYSLOG_ENTRY_FILTERED;
+
+	/* %P */
+	data = strskipspaces(data);
 
-	/* Modify parsed value if needed */
-	if (field->info->modifier)
+	if ((ret = parse_string(&data, end, op[6].field, ' ', 0)))
+		return parse_error(line_n, &op[6], ret);
+
+	if ((ret = op[7].field->info->modifier(op[7].field)))
+		return parse_error(line_n, &op[7], ret);
+
+	if ((ret = op[8].field->info->validator(op[8].field)))
+		return parse_error(line_n, &op[8], ret);
+
+	if (op[8].field->filter && op[8].field->filter(op[8].field))
+		return SYSLOG_ENTRY_FILTERED;
+
+	/* %G */
+	data = strskipspaces(data);
+
+	if ((ret = parse_string(&data, end, op[10].field, ':', 0)))
+		return parse_error(line_n, &op[10], ret);
+
+	if (op[10].field->filter && op[10].field->filter(op[10].field))
+		return SYSLOG_ENTRY_FILTERED;
+
+	/* %_M */
+	data = memchr(data, ' ', end - data);
+	if (!data)
+		return -EILSEQ;
+
+	data++;
+	return parse_string(&data, end, op[12].field, 0, 0);
+}
+
+/**
+ * Add operation to the compiled entry parser
+ *
+ * @param[in,out] entry  Pointer to the entry data structure.
+ * @param[in]     code   Operation code.
+ * @param[in]     ch     Operation character argument.
+ * @param[in]     field  Pointer to the field.
+ */
+static void entry_compile_op(
+	syslog_entry_t *entry,
+	unsigned char code,
+	char ch,
+	syslog_field_t *field
+)
+{
+	syslog_parse_op_t *op = &entry->ops[entry->ops_num++];
+
+	op->code  = code;
+	op->ch    = ch;
+	op->field = field;
+}
+
+/**
+ * Compile entry fields list into the flat array of parsing operations
+ *
+ * @param[in,out] entry  Pointer to the entry data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int entry_compile(syslog_entry_t *entry)
+{
+	syslog_field_t *field;
+	unsigned int i;
+
+	/* At most 5 operations per field */
+	entry->ops = malloc(
+		(entry->fields_num * 5 + 1) * sizeof(syslog_parse_op_t));
+	if (!entry->ops)
+		return -ENOMEM;
+
+	entry->ops_num = 0;
+
+	for (field = entry->fields; field; field = field->next)
 	{
-		ret = field->info->modifier(field);
-		if (ret)
+		const syslog_field_info_t *info = field->info;
+		int notrim = !!(field->flags & SYSLOG_FIELD_FLAG_NOTRIM);
+
+		if (field->parse_start_char)
 		{
-			fprintf(stderr,
-				"line %u: Modifier failed for field '%s' (%d)\n",
-				line_n, field->info->param_name, ret
-			);
+			entry_compile_op(entry, PARSE_OP_SEEK,
+				field->parse_start_char, field);
+		}
 
-			return ret;
+		if (!notrim)
+			entry_compile_op(entry, PARSE_OP_TRIM, 0, field);
+
+		if (info->type == SYSLOG_FIELD_TYPE_TIME)
+			entry_compile_op(entry, PARSE_OP_TIME, 0, field);
+		else
+		{
+			entry_compile_op(entry,
+				(notrim && field->parse_stop_char) ?
+					PARSE_OP_TAKE_NOTRIM : PARSE_OP_TAKE,
+				field->parse_stop_char, field);
+
+			if (info->type == SYSLOG_FIELD_TYPE_INTEGER)
+				entry_compile_op(entry, PARSE_OP_INT, 0, field);
+			else if (info->type == SYSLOG_FIELD_TYPE_UINTEGER)
+				entry_compile_op(entry, PARSE_OP_UINT, 0, field);
 		}
+
+		if (info->modifier)
+			entry_compile_op(entry, PARSE_OP_MODIFY, 0, field);
+
+		if (info->validator)
+		{
+			entry_compile_op(entry,
+				(field->flags & SYSLOG_FIELD_FLAG_NOVALIDATION) ?
+					PARSE_OP_RESOLVE : PARSE_OP_VALIDATE,
+				0, field);
+		}
+
+		if (field->filter)
+			entry->ops[entry->ops_num - 1].code |= PARSE_OP_FILTER;
 	}
 
-	/* Validate parsed value */
-	if (!(field->flags & SYSLOG_FIELD_FLAG_NOVALIDATION) &&
-	    field->info->validator)
+	/* Select specialized parser if available */
+	entry->parse_fn = entry_parse_generic;
+
+	if (entry->ops_num == ARRAY_SIZE(entry_default_ops))
 	{
-		ret = field->info->validator(field);
-		if (ret)
+		for (i = 0; i < entry->ops_num; i++)
 		{
-			fprintf(stderr,
-				"line %u: Readed invalid value for field '%s' (%d)\n",
-				line_n, field->info->param_name, ret
-			);
-
-			return ret;
+			if (((entry->ops[i].code & ~PARSE_OP_FILTER) !=
+			      entry_default_ops[i].code) ||
+			    (entry->ops[i].ch   != entry_default_ops[i].ch))
+				break;
 		}
+
+		if (i == entry->ops_num)
+			entry->parse_fn = entry_parse_default;
 	}
 
 	return 0;
@@ -667,43 +1241,279 @@ static int syslog_entry_field_parse(
 int syslog_entry_parse(
 	syslog_entry_t *entry,
 	unsigned int line_n,
-	char *line
+	char *line,
+	size_t len
 )
 {
-	syslog_field_t *field;
+	assert(entry);
+	assert(line);
+
+	return entry->parse_fn(entry, line_n, line, line + len);
+}
+
+int syslog_entry_parse_time(
+	syslog_entry_t *entry,
+	char *line,
+	size_t len,
+	time_t *time
+)
+{
+	const syslog_parse_op_t *op = entry->ops;
+	const syslog_parse_op_t *ops_end = entry->ops + entry->ops_num;
 	char *data = line;
+	char *end = line + len;
 
 	assert(entry);
 	assert(line);
 
-	for (field = entry->fields; field; field = field->next)
+	for (; op < ops_end; op++)
 	{
-		int ret = syslog_entry_field_parse(line_n, &data, field);
-		if (ret)
-			return ret;
+		if (parse_op_exec(op, &data, end))
+			return -EILSEQ;
+
+		if (((op->code & ~PARSE_OP_FILTER) == PARSE_OP_TIME) &&
+		    (op->field->info->id == SYSLOG_FIELD_ID_TIMESTAMP))
+		{
+			*time = (time_t)op->field->value.time.unixtime;
+			return 0;
+		}
 	}
 
-	return 0;
+	return -ENOENT;
 }
 
 /* ----------------------------------------------------------------------- */
 
+void syslog_entry_save(
+	syslog_entry_t *entry,
+	syslog_field_state_t *state
+)
+{
+	syslog_field_t *field;
+
+	for (field = entry->fields; field; field = field->next, state++)
+	{
+		state->value = field->value;
+		state->flags = field->flags;
+		state->code  = field->code;
+	}
+}
+
+void syslog_entry_restore(
+	syslog_entry_t *entry,
+	const syslog_field_state_t *state
+)
+{
+	syslog_field_t *field;
+
+	for (field = entry->fields; field; field = field->next, state++)
+	{
+		field->value = state->value;
+		field->flags = state->flags;
+		field->code  = state->code;
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Check whether timestamp output specification allows
+ * incremental update of the seconds
+ *
+ * Seconds may be represented only by %S and %T conversions
+ * without flags and modifiers.
+ *
+ * @param[in] spec Timestamp output format specification.
+ *
+ * @return Number of seconds fields in the formatted timestamp
+ * @return <0 if incremental update is not possible
+ */
+static int time_fmt_sec_fields(const char *spec)
+{
+	int n = 0;
+
+	for (; *spec; spec++)
+	{
+		if (*spec != '%')
+			continue;
+
+		spec++;
+
+		if ((*spec == 'S') || (*spec == 'T'))
+			n++;
+		else if (*spec == '%')
+			continue;
+		else if (!isalpha(*spec) || strchr("EOcrsX", *spec))
+			return -1;
+	}
+
+	return (n <= SYSLOG_TIME_FMT_MAX_SEC_FIELDS) ? n : -1;
+}
+
+/**
+ * Compare all date/time structure fields except seconds
+ *
+ * @param[in] a Pointer to the first date/time structure.
+ * @param[in] b Pointer to the second date/time structure.
+ *
+ * @return Non-zero value if structures differ only in seconds
+ */
+static int time_fmt_same_minute(const struct tm *a, const struct tm *b)
+{
+	return (a->tm_min    == b->tm_min)    &&
+	       (a->tm_hour   == b->tm_hour)   &&
+	       (a->tm_mday   == b->tm_mday)   &&
+	       (a->tm_mon    == b->tm_mon)    &&
+	       (a->tm_year   == b->tm_year)   &&
+	       (a->tm_wday   == b->tm_wday)   &&
+	       (a->tm_yday   == b->tm_yday)   &&
+	       (a->tm_isdst  == b->tm_isdst)  &&
+	       (a->tm_gmtoff == b->tm_gmtoff) &&
+	       (a->tm_zone   == b->tm_zone);
+}
+
+/**
+ * Format timestamp with strftime() and find positions
+ * of the seconds digits in the formatted string
+ *
+ * @param[in,out] cache Pointer to the cache data structure.
+ * @param[in]     tm    Pointer to the date/time structure.
+ */
+static void time_fmt_fill(syslog_time_fmt_cache_t *cache, const struct tm *tm)
+{
+	struct tm probe_tm = *tm;
+	char probe[sizeof(cache->buffer)];
+	size_t len;
+	size_t i;
+	int n = 0;
+
+	cache->tm = *tm;
+	cache->sec_fields_n = -1;
+
+	len = strftime(cache->buffer, sizeof(cache->buffer),
+		cache->spec, tm);
+
+	/* Result of the strftime() is unspecified, do not cache it */
+	cache->valid = !!len;
+
+	if (!cache->valid || (cache->spec_sec_fields <= 0) ||
+	    (tm->tm_sec < 0) || (tm->tm_sec > 60))
+		return;
+
+	/* Format with other seconds, so both seconds digits are changed */
+	probe_tm.tm_sec = ((tm->tm_sec / 10 + 1) % 6) * 10 +
+		(tm->tm_sec + 1) % 10;
+
+	if (strftime(probe, sizeof(probe), cache->spec, &probe_tm) != len)
+		return;
+
+	for (i = 0; i < len; i++)
+	{
+		if (probe[i] == cache->buffer[i])
+			continue;
+
+		if ((n == cache->spec_sec_fields) || (i + 1 == len) ||
+		    (probe[i + 1] == cache->buffer[i + 1]))
+			return;
+
+		cache->sec_fields[n++] = i++;
+	}
+
+	if (n == cache->spec_sec_fields)
+		cache->sec_fields_n = n;
+}
+
 char *syslog_field_time_fmt(const syslog_field_t *field)
 {
-	static char buffer[128];
+	static __thread syslog_time_fmt_cache_t cache;
+
+	const struct tm *tm = &field->value.time.timestamp;
+	time_t unixtime = field->value.time.unixtime;
 
-	if (config.ts_output_spec && config.ts_output_spec[0])
+	if (cache.spec != config.ts_output_spec)
 	{
-		strftime(buffer, sizeof(buffer), config.ts_output_spec,
-			&field->value.time.timestamp);
+		cache.spec  = config.ts_output_spec;
+		cache.valid = 0;
+
+		if (cache.spec && cache.spec[0])
+			cache.spec_sec_fields = time_fmt_sec_fields(cache.spec);
+	}
+
+	if (cache.spec && cache.spec[0])
+	{
+		if (cache.valid && time_fmt_same_minute(&cache.tm, tm))
+		{
+			if (cache.tm.tm_sec == tm->tm_sec)
+				return cache.buffer;
+
+			if ((cache.sec_fields_n > 0) &&
+			    (tm->tm_sec >= 0) && (tm->tm_sec <= 60))
+			{
+				int i;
+
+				for (i = 0; i < cache.sec_fields_n; i++)
+				{
+					cache.buffer[cache.sec_fields[i]]     = '0' + tm->tm_sec / 10;
+					cache.buffer[cache.sec_fields[i] + 1] = '0' + tm->tm_sec % 10;
+				}
+
+				cache.tm.tm_sec = tm->tm_sec;
+				return cache.buffer;
+			}
+		}
+
+		time_fmt_fill(&cache, tm);
+
+		if (!cache.valid)
+			cache.buffer[0] = 0;
 	}
 	else
 	{
-		snprintf(buffer, sizeof(buffer), "%lu",
-			field->value.time.unixtime);
+		if (cache.valid && (cache.unixtime == unixtime))
+			return cache.buffer;
+
+		if (cache.valid && (unixtime >= 0) && (cache.unixtime >= 0) &&
+		    (unixtime / 10 == cache.unixtime / 10))
+		{
+			/* Only the last digit is changed */
+			cache.buffer[cache.len - 1] = '0' + unixtime % 10;
+		}
+		else
+		{
+			cache.len = snprintf(cache.buffer, sizeof(cache.buffer),
+				"%lu", unixtime);
+		}
+
+		cache.unixtime = unixtime;
+		cache.valid    = 1;
 	}
 
-	return buffer;
+	return cache.buffer;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_facility_code(const char *name)
+{
+	const CODE *c;
+
+	pthread_once(&syslog_names_once, syslog_names_init);
+
+	c = syslog_names_find(&syslog_facility_names, name);
+	return c ? LOG_FAC(c->c_val) : -EINVAL;
+}
+
+int syslog_priority_code(const char *name)
+{
+	const CODE *c;
+
+	pthread_once(&syslog_names_once, syslog_names_init);
+
+	if (strisnumber(name))
+		return (int)strtoul(name, NULL, 0);
+
+	c = syslog_names_find(&syslog_priority_names, name);
+	return c ? c->c_val : -EINVAL;
 }
 
 /* ----------------------------------------------------------------------- */
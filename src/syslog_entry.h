@@ -17,6 +17,8 @@
 #ifndef __SYSLOG_ENTRY_H__
 #define __SYSLOG_ENTRY_H__
 
+#include <syslog_time.h>
+
 struct syslog_entry;
 struct syslog_field;
 
@@ -36,13 +38,67 @@ struct syslog_field;
 /** @brief Skip validation */
 #define SYSLOG_FIELD_FLAG_NOVALIDATION (1 << 2)
 
-/** @brief Memory allocated for data flag */
-#define SYSLOG_FIELD_FLAG_MEM_ALLOCATED (1 << 3)
+/** @} */
+
+/**
+ * @name Syslog entry filter flags
+ * @{
+ */
+
+/** @brief Keep entries with priority not lower than the specified */
+#define SYSLOG_FILTER_MIN_PRIORITY  (1 << 0)
+
+/** @brief Keep entries with one of the specified facilities */
+#define SYSLOG_FILTER_FACILITY  (1 << 1)
+
+/** @brief Keep entries with the specified tag */
+#define SYSLOG_FILTER_TAG  (1 << 2)
+
+/** @brief Keep entries with timestamp not before the specified time */
+#define SYSLOG_FILTER_SINCE  (1 << 3)
+
+/** @brief Keep entries with timestamp before the specified time */
+#define SYSLOG_FILTER_UNTIL  (1 << 4)
 
 /** @} */
 
+/**
+ * @brief syslog_entry_parse() result for the entry that does not
+ *        pass the filter
+ */
+#define SYSLOG_ENTRY_FILTERED  1
+
 /* ----------------------------------------------------------------------- */
 
+/**
+ * @brief Syslog entry filter
+ *
+ * Filters are evaluated during parsing as soon as the field they are
+ * applied to is parsed, so the rest of the filtered out line is
+ * not parsed at all.
+ */
+typedef struct syslog_filter
+{
+	/** Enabled filters (SYSLOG_FILTER_xxx flags) */
+	unsigned int flags;
+
+	/** Minimum priority (maximum LOG_PRI() priority number) */
+	int min_priority;
+
+	/** Mask of the allowed LOG_FAC() facility numbers */
+	unsigned long facilities;
+
+	/** Tag (process name, "[pid]" suffix of the entry tag is ignored) */
+	const char *tag;
+
+	/** Start time (inclusive) */
+	time_t since;
+
+	/** End time (exclusive) */
+	time_t until;
+
+} syslog_filter_t;
+
 /**
  * @brief Syslog entry field types.
  */
@@ -68,6 +124,14 @@ typedef enum
 	SYSLOG_FIELD_ID_PRIORITY,   /**< Priority */
 	SYSLOG_FIELD_ID_TAG,        /**< Tag */
 	SYSLOG_FIELD_ID_MESSAGE,    /**< Message */
+	SYSLOG_FIELD_ID_COUNT,      /**< Number of entries (generated entries only) */
+	SYSLOG_FIELD_ID_KEY,        /**< Summarized field name (generated entries only) */
+	SYSLOG_FIELD_ID_DISTINCT,   /**< Number of distinct values (generated entries only) */
+	SYSLOG_FIELD_ID_VALUE,      /**< Summarized field value (generated entries only) */
+	SYSLOG_FIELD_ID_ERROR,      /**< Maximum count error (generated entries only) */
+	SYSLOG_FIELD_ID_TEMPLATE,   /**< Message template (generated entries only) */
+	SYSLOG_FIELD_ID_FIRST,      /**< First occurrence time (generated entries only) */
+	SYSLOG_FIELD_ID_LAST,       /**< Last occurrence time (generated entries only) */
 
 } syslog_field_id_t;
 
@@ -89,9 +153,11 @@ typedef struct syslog_field_info
 	 * is a pointer to the syslog entry field data structure.
 	 *
 	 * Function must return 0 if field data is valid,
-	 * and < 0 otherwise.
+	 * and < 0 otherwise. Function sets @ref syslog_field_t::code
+	 * (validation result is ignored if validation is disabled
+	 * for the field, but the code is still used).
 	 */
-	int (*validator)(const struct syslog_field *field);
+	int (*validator)(struct syslog_field *field);
 
 	/**
 	 * @brief Modifier function pointer
@@ -145,17 +211,71 @@ typedef struct syslog_field
 
 	} value;
 
+	/**
+	 * Integer code of the value for enumerated fields
+	 * (LOG_FAC() facility or LOG_PRI() priority number),
+	 * -1 if the value is unknown
+	 */
+	int code;
+
 	/** Parsing start character */
 	char parse_start_char;
 
 	/** Parsing stop character */
 	char parse_stop_char;
 
+	/** Timestamp parser (#SYSLOG_FIELD_TYPE_TIME fields only) */
+	syslog_time_parser_t *time_parser;
+
+	/**
+	 * Filter function (NULL if field is not filtered). Function
+	 * returns non-zero if the parsed entry must be skipped.
+	 */
+	int (*filter)(const struct syslog_field *field);
+
 	/** Next field pointer */
 	struct syslog_field *next;
 
 } syslog_field_t;
 
+/**
+ * @brief Saved syslog field state
+ *
+ * Used to keep parsed field values of the entry for deferred output
+ * (see syslog_entry_save() and syslog_entry_restore()).
+ */
+typedef struct syslog_field_state
+{
+	/** Field value */
+	union syslog_field_value_union value;
+
+	/** Field flags */
+	unsigned int flags;
+
+	/** Field code */
+	int code;
+
+} syslog_field_state_t;
+
+/**
+ * @brief Compiled entry parsing operation
+ *
+ * Entry format specification is compiled by syslog_entry_init() into
+ * the flat array of operations executed for each parsed line.
+ */
+typedef struct syslog_parse_op
+{
+	/** Operation code */
+	unsigned char code;
+
+	/** Start or stop character */
+	char ch;
+
+	/** Field the operation is applied to */
+	syslog_field_t *field;
+
+} syslog_parse_op_t;
+
 /**
  * @brief Syslog entry data structure
  */
@@ -167,6 +287,17 @@ typedef struct syslog_entry
 	unsigned int fields_output_num; /**< Number of fields for output */
 	syslog_field_t *fields;         /**< Fields list */
 
+	syslog_parse_op_t *ops;         /**< Compiled parsing operations */
+	unsigned int ops_num;           /**< Number of parsing operations */
+
+	/** Line parsing function for the compiled operations */
+	int (*parse_fn)(
+		const struct syslog_entry *entry,
+		unsigned int line_n,
+		char *data,
+		char *end
+	);
+
 } syslog_entry_t;
 
 /* ----------------------------------------------------------------------- */
@@ -186,6 +317,26 @@ int syslog_entry_init(
 	const char *entry_spec
 );
 
+/**
+ * Initialize entry data structure with the specified fields
+ *
+ * Entry is used for output of the generated entries (e.g. aggregation
+ * results), so it can not be used for parsing. Field values must be set
+ * by the caller.
+ *
+ * @param[out] entry      Pointer to the entry data structure.
+ * @param[in]  ids        Array of the field identifiers in the output order.
+ * @param[in]  ids_n      Number of the field identifiers.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_entry_init_fields(
+	syslog_entry_t *entry,
+	const syslog_field_id_t *ids,
+	unsigned int ids_n
+);
+
 /**
  * Free resources allocated for syslog entry data structure.
  *
@@ -199,17 +350,74 @@ void syslog_entry_destroy(syslog_entry_t *entry);
  * @param[in,out] entry   Pointer to the entry data structure.
  * @param[in]     line_n  Input line number (used only for output
  *                        in error messages).
- * @param[in,out] line    Pointer to the NULL-terminated syslog
- *                        file message. Source buffer data will be
- *                        modified by function.
+ * @param[in,out] line    Pointer to the syslog file message. Source
+ *                        buffer data will be modified by function.
+ *                        Message must be NULL-terminated at @p len.
+ * @param[in]     len     Message length (without terminator). All
+ *                        scans performed by the parser are bounded
+ *                        by this length.
  *
  * @return 0 on success
+ * @return #SYSLOG_ENTRY_FILTERED if entry does not pass the filter
+ *         (see @ref config_t::filter)
  * @return <0 on error
  */
 int syslog_entry_parse(
 	syslog_entry_t *entry,
 	unsigned int line_n,
-	char *line
+	char *line,
+	size_t len
+);
+
+/**
+ * Parse only the timestamp of the syslog entry line
+ *
+ * Only the fields preceding the timestamp field and the timestamp
+ * field itself are parsed. Filters are not applied and parsing
+ * errors are not reported.
+ *
+ * @param[in,out] entry  Pointer to the entry data structure.
+ * @param[in,out] line   Pointer to the syslog file message (modified
+ *                       by function, NULL-terminated at @p len).
+ * @param[in]     len    Message length (without terminator).
+ * @param[out]    time   Parsed timestamp.
+ *
+ * @return 0 on success
+ * @return <0 on error or if entry has no timestamp field
+ */
+int syslog_entry_parse_time(
+	syslog_entry_t *entry,
+	char *line,
+	size_t len,
+	time_t *time
+);
+
+/**
+ * Save parsed values of all entry fields
+ *
+ * Saved string values point into the parsed line data, so the
+ * line data must be kept until the state is restored.
+ *
+ * @param[in,out] entry  Pointer to the entry data structure.
+ * @param[out]    state  Pointer to the array of the field states
+ *                       with at least @ref syslog_entry_t::fields_num
+ *                       items.
+ */
+void syslog_entry_save(
+	syslog_entry_t *entry,
+	syslog_field_state_t *state
+);
+
+/**
+ * Restore values of all entry fields previously saved
+ * by syslog_entry_save()
+ *
+ * @param[in,out] entry  Pointer to the entry data structure.
+ * @param[in]     state  Pointer to the array of the saved field states.
+ */
+void syslog_entry_restore(
+	syslog_entry_t *entry,
+	const syslog_field_state_t *state
 );
 
 /**
@@ -232,8 +440,74 @@ static inline int syslog_entry_has_field(
 	return !!(entry->fields_mask & (1 << field_id));
 }
 
+/**
+ * Find the first field of the entry with a specified identifier
+ *
+ * @param[in] entry     Pointer to the entry data structure.
+ * @param[in] field_id  Field identifier to find.
+ *
+ * @return Pointer to the field data structure
+ * @return NULL if field is not present
+ */
+static inline syslog_field_t *syslog_entry_field(
+	const syslog_entry_t *entry,
+	const syslog_field_id_t field_id
+)
+{
+	syslog_field_t *field;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->info->id == field_id)
+			return field;
+	}
+
+	return NULL;
+}
+
 /* ----------------------------------------------------------------------- */
 
+/** @brief Maximum number of seconds fields updated in the cached timestamp */
+#define SYSLOG_TIME_FMT_MAX_SEC_FIELDS  4
+
+/**
+ * @brief Formatted timestamp cache
+ *
+ * Consecutive entries usually have the same timestamp or timestamps
+ * that differ in seconds only, so the previously formatted string is
+ * reused or only its seconds digits are updated.
+ */
+typedef struct syslog_time_fmt_cache
+{
+	/** Output format specification the cache is filled for */
+	const char *spec;
+
+	/** Number of seconds fields in the @ref spec (<0 if unknown) */
+	int spec_sec_fields;
+
+	/** Cache contains formatted timestamp */
+	int valid;
+
+	/** Cached Unix timestamp (Unix timestamp output) */
+	time_t unixtime;
+
+	/** Cached date/time (formatted output) */
+	struct tm tm;
+
+	/** Length of the formatted Unix timestamp */
+	size_t len;
+
+	/** Number of the seconds fields positions (<0 if not known) */
+	int sec_fields_n;
+
+	/** Positions of the seconds fields in the formatted timestamp */
+	size_t sec_fields[SYSLOG_TIME_FMT_MAX_SEC_FIELDS];
+
+	/** Formatted timestamp */
+	char buffer[128];
+
+} syslog_time_fmt_cache_t;
+
 /**
  * Format field's timestamp value into buffer.
  *
@@ -241,24 +515,44 @@ static inline int syslog_entry_has_field(
  * specificator in @ref config_t::ts_output_spec of the global
  * configuiration @ref config.
  *
+ * Formatted timestamp is cached per thread (see
+ * @ref syslog_time_fmt_cache_t).
+ *
  * @attention
- *   ATTENTION: This function uses single static buffer for work.
+ *   ATTENTION: This function uses single static per-thread cache
+ *   buffer for work.
  *
  * @attention
  *   DO NOT CALL this function repeatedly until you are convinced
  *   that the results of the previous call are no longer needed
  *   and are not used anywhere.
  *
- * @attention
- *   DO NOT USE this function more than in one single thread.
- *   This function is NOT threadsafe.
- *
  * @param[in] field Pointer to the field data structure.
  *
  * @return Pointer to the formatted string with timestamp.
  */
 char *syslog_field_time_fmt(const syslog_field_t *field);
 
+/**
+ * Get facility number by the facility name
+ *
+ * @param[in] name Facility name.
+ *
+ * @return LOG_FAC() facility number
+ * @return <0 if facility name is unknown
+ */
+int syslog_facility_code(const char *name);
+
+/**
+ * Get priority number by the priority name
+ *
+ * @param[in] name Priority name or number.
+ *
+ * @return LOG_PRI() priority number
+ * @return <0 if priority name is unknown
+ */
+int syslog_priority_code(const char *name);
+
 /* ----------------------------------------------------------------------- */
 
 #endif /* __SYSLOG_ENTRY_H__ */
@@ -17,11 +17,87 @@
 #ifndef __SYSLOG_FC_H__
 #define __SYSLOG_FC_H__
 
-/** @brief Maximum syslog entry line size */
-#define SYSLOG_MAX_BUFFER_SIZE  16384
+/** @brief Block size for streamed syslog input reading */
+#define SYSLOG_INPUT_BLOCK_SIZE  (1024 * 1024)
 
-/** @brief Initial buffer size for syslog file reading */
-#define SYSLOG_BUFFER_SIZE  256
+/** @brief Input chunk size for multi-threaded conversion */
+#define SYSLOG_INPUT_CHUNK_SIZE  (4 * 1024 * 1024)
+
+/** @brief Maximum number of the mapped inputs guarded from SIGBUS
+ *         (other inputs are read as streams) */
+#define SYSLOG_INPUT_MAPS_MAX  1024
+
+/** @brief Maximum syslog entry line size, longer lines are truncated */
+#define SYSLOG_MAX_LINE_SIZE  (SYSLOG_INPUT_BLOCK_SIZE - 1)
+
+/** @brief Decompressed input data buffer size */
+#define SYSLOG_DECOMPRESS_BUFFER_SIZE  (1024 * 1024)
+
+/** @brief Number of decompressed input data buffers in the ring */
+#define SYSLOG_DECOMPRESS_BUFFERS  4
+
+/** @brief Maximum number of lines parsed ahead for each merged input */
+#define SYSLOG_MERGE_BATCH_LINES  512
+
+/** @brief Line data buffer size of the merged streamed input batch */
+#define SYSLOG_MERGE_BATCH_SIZE  (64 * 1024)
+
+/** @brief Followed file check interval (ms) if inotify is not available */
+#define SYSLOG_FOLLOW_POLL_INTERVAL  1000
+
+/** @brief Arena block size of the interned strings */
+#define SYSLOG_INTERN_BLOCK_SIZE  (64 * 1024)
+
+/** @brief Maximum number of the aggregation groups */
+#define SYSLOG_STATS_MAX_GROUPS  (1024 * 1024)
+
+/** @brief Maximum memory size of the interned aggregation key values */
+#define SYSLOG_STATS_MAX_KEYS_SIZE  (64 * 1024 * 1024)
+
+/** @brief Number of the HyperLogLog register index bits (2^N registers) */
+#define SYSLOG_HLL_PRECISION  14
+
+/** @brief Count-Min sketch width (power of 2) */
+#define SYSLOG_CMS_WIDTH  8192
+
+/** @brief Count-Min sketch depth */
+#define SYSLOG_CMS_DEPTH  4
+
+/** @brief Number of the Space-Saving top values counters */
+#define SYSLOG_TOPK_CAPACITY  1024
+
+/** @brief Maximum size of the top value (including NULL-terminator) */
+#define SYSLOG_TOPK_VALUE_SIZE  128
+
+/** @brief Default number of the output top values */
+#define SYSLOG_TOP_DEFAULT_N  10
+
+/** @brief Depth of the message templates parse tree (>= 3) */
+#define SYSLOG_TEMPLATES_DEPTH  4
+
+/** @brief Minimum similarity of the message to its template (percents) */
+#define SYSLOG_TEMPLATES_SIMILARITY  40
+
+/** @brief Maximum number of the children of the templates parse tree node */
+#define SYSLOG_TEMPLATES_MAX_CHILDREN  100
+
+/** @brief Maximum number of the message tokens, the rest is the last token */
+#define SYSLOG_TEMPLATES_MAX_TOKENS  128
+
+/** @brief Maximum number of the message templates */
+#define SYSLOG_TEMPLATES_MAX  (64 * 1024)
+
+/** @brief Maximum memory size of the interned message template tokens */
+#define SYSLOG_TEMPLATES_MAX_TOKENS_SIZE  (16 * 1024 * 1024)
+
+/** @brief Maximum number of the deduplicated entries waiting for output */
+#define SYSLOG_DEDUP_MAX_PENDING  4096
+
+/** @brief Output buffer size */
+#define SYSLOG_OUTPUT_BUFFER_SIZE  (256 * 1024)
+
+/** @brief Maximum number of conversion threads */
+#define SYSLOG_MAX_THREADS  256
 
 /** @brief Helper macro for array size calculation */
 #define ARRAY_SIZE(a)  (sizeof(a) / sizeof(a[0]))
@@ -34,11 +110,33 @@
 #include <assert.h>
 
 #include <syslog_entry.h>
+#include <syslog_output.h>
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * @name Output format flags
+ * @{
+ */
+
+/**
+ * @brief Entries must be output in the input order into the
+ *        single output (entry callback is never called concurrently)
+ */
+#define OUTPUT_FMT_FLAG_SEQUENTIAL  (1 << 0)
+
+/** @brief Output can not be continued by the incremental conversion */
+#define OUTPUT_FMT_FLAG_NOAPPEND  (1 << 1)
+
+/** @} */
+
 /**
  * @brief Output format data structure
+ *
+ * All callback functions write output into the buffered output
+ * writer passed as the first argument. Entry output callback may be
+ * called concurrently from several threads with different outputs
+ * and entries (unless #OUTPUT_FMT_FLAG_SEQUENTIAL flag is set).
  */
 typedef struct
 {
@@ -48,14 +146,30 @@ typedef struct
 	/** Description */
 	char *description;
 
+	/** Flags (OUTPUT_FMT_FLAG_xxx) */
+	unsigned int flags;
+
+	/**
+	 * Output preparation callback function (called once for the
+	 * entry specification before any output, optional)
+	 */
+	void (*fn_output_init)(const syslog_entry_t *);
+
 	/** Output start callback function */
-	void (*fn_output_start)(const syslog_entry_t *);
+	void (*fn_output_start)(syslog_output_t *, const syslog_entry_t *);
 
 	/** Output entry data callback function */
-	void (*fn_output_entry)(const syslog_entry_t *);
+	void (*fn_output_entry)(syslog_output_t *, const syslog_entry_t *);
 
 	/** Output end callback function */
-	void (*fn_output_end)(const syslog_entry_t *);
+	void (*fn_output_end)(syslog_output_t *, const syslog_entry_t *);
+
+	/**
+	 * Worker output merge callback function (optional). Called by the
+	 * main thread of the multi-threaded conversion for the worker
+	 * output of each converted chunk in the input order
+	 */
+	void (*fn_output_merge)(syslog_output_t *, syslog_output_t *);
 
 } output_fmt_t;
 
@@ -69,8 +183,39 @@ typedef struct config
 	/** Read data from stdin */
 	int is_stdin;
 
-	/** Input file name */
-	const char *input_filename;
+	/** Input file names */
+	char *const *input_filenames;
+
+	/** Number of input files */
+	unsigned int inputs_n;
+
+	/** Merge entries of all input files ordered by timestamp */
+	int merge;
+
+	/** Follow the growing input file */
+	int follow;
+
+	/** Incremental conversion state file name */
+	const char *state_filename;
+
+	/** Aggregation specification (NULL if entries are not aggregated) */
+	const char *stats_spec;
+
+	/** Top values specification (NULL if top values are not output) */
+	const char *top_spec;
+
+	/** Output message templates instead of the entries */
+	int templates;
+
+	/** Add message template field to the output entries */
+	int template_column;
+
+	/** Collapse repeated entries */
+	int dedup;
+
+	/** Time window of the collapsed repeated entries (NULL if
+	 *  only consecutive entries are collapsed) */
+	const char *dedup_window;
 
 	/** Syslog entry format */
 	const char *entry_spec;
@@ -93,6 +238,18 @@ typedef struct config
 	/** Enable or disable HTML classes for each cell */
 	int html_cell_classes;
 
+	/** Number of conversion threads */
+	unsigned int threads;
+
+	/** Entry filter */
+	syslog_filter_t filter;
+
+	/** Use and build sidecar time index of the input file */
+	int index;
+
+	/** Binary search time range in the regular input files */
+	int seek;
+
 } config_t;
 
 /**
@@ -0,0 +1,345 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Growing input file following source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <libgen.h> /* dirname() */
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+
+#include <syslog_fc.h>
+#include <syslog_follow.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Watched followed file events */
+#define FOLLOW_FILE_EVENTS \
+	(IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/** @brief Watched followed file directory events */
+#define FOLLOW_DIR_EVENTS \
+	(IN_CREATE | IN_MOVED_TO)
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Start watching the followed file
+ *
+ * @param[in,out] follow Pointer to the follow data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int follow_watch_file(syslog_follow_t *follow)
+{
+	if (follow->inotify_fd < 0)
+		return 0;
+
+	if (follow->file_wd >= 0)
+		inotify_rm_watch(follow->inotify_fd, follow->file_wd);
+
+	follow->file_wd = inotify_add_watch(follow->inotify_fd,
+		follow->filename, FOLLOW_FILE_EVENTS);
+
+	if (follow->file_wd < 0)
+	{
+		int ret = -errno;
+
+		fprintf(stderr,
+			"Failed to watch file '%s' (%d)\n",
+			follow->filename, ret);
+
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Block termination signals and start receiving them
+ * by the signal file descriptor
+ *
+ * @param[in,out] follow Pointer to the follow data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int follow_signals(syslog_follow_t *follow)
+{
+	sigset_t mask;
+	int ret;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+
+	if (sigprocmask(SIG_BLOCK, &mask, &follow->sigmask))
+		return -errno;
+
+	follow->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (follow->signal_fd < 0)
+	{
+		ret = -errno;
+		sigprocmask(SIG_SETMASK, &follow->sigmask, NULL);
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Open the new file, that has replaced the followed file
+ *
+ * @param[in,out] follow Pointer to the follow data structure.
+ * @param[in,out] input  Pointer to the followed input.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int follow_reopen(
+	syslog_follow_t *follow,
+	syslog_input_t *input
+)
+{
+	int ret;
+
+	follow->replaced = 0;
+
+	syslog_input_close(input);
+
+	if (syslog_input_open(input, follow->filename))
+	{
+		fprintf(stderr, "Could not open file '%s'\n", follow->filename);
+		return -ENODEV;
+	}
+
+	ret = syslog_input_follow(input);
+	if (ret)
+	{
+		fprintf(stderr,
+			"Follow mode requires regular uncompressed file (%d)\n", ret);
+
+		return ret;
+	}
+
+	fprintf(stderr,
+		"File '%s' has been replaced, following the new file\n",
+		follow->filename);
+
+	return follow_watch_file(follow);
+}
+
+/**
+ * Check whether the followed file has been truncated or replaced
+ *
+ * @param[in,out] follow Pointer to the follow data structure.
+ * @param[in,out] input  Pointer to the followed input.
+ *
+ * @return 1 if file has been truncated or replaced
+ * @return 0 if file has not been changed
+ * @return <0 on error
+ */
+static int follow_check(
+	syslog_follow_t *follow,
+	syslog_input_t *input
+)
+{
+	struct stat st;
+	struct stat path_st;
+	int ret;
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	if (st.st_size < syslog_input_tell(input))
+	{
+		fprintf(stderr,
+			"File '%s' has been truncated, reading from the beginning\n",
+			follow->filename);
+
+		ret = syslog_input_rewind(input);
+		return ret ? ret : 1;
+	}
+
+	/* File is kept while the new file has not been created */
+	if (stat(follow->filename, &path_st) ||
+	    ((path_st.st_ino == st.st_ino) && (path_st.st_dev == st.st_dev)))
+		return 0;
+
+	ret = syslog_input_follow_end(input);
+	if (ret)
+		return ret;
+
+	follow->replaced = 1;
+	return 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_follow_init(
+	syslog_follow_t *follow,
+	const char *filename
+)
+{
+	char *dir;
+	int ret;
+
+	assert(follow);
+	assert(filename);
+
+	memset(follow, 0, sizeof(syslog_follow_t));
+
+	follow->filename  = filename;
+	follow->file_wd   = -1;
+	follow->dir_wd    = -1;
+	follow->signal_fd = -1;
+
+	follow->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (follow->inotify_fd < 0)
+	{
+		fprintf(stderr,
+			"inotify is not available (%d), file is checked "
+			"every %d ms\n", -errno, SYSLOG_FOLLOW_POLL_INTERVAL);
+
+		return 0;
+	}
+
+	ret = follow_watch_file(follow);
+	if (ret)
+	{
+		syslog_follow_free(follow);
+		return ret;
+	}
+
+	/* dirname() may modify its argument */
+	dir = strdup(filename);
+	if (!dir)
+	{
+		syslog_follow_free(follow);
+		return -ENOMEM;
+	}
+
+	follow->dir_wd = inotify_add_watch(follow->inotify_fd,
+		dirname(dir), FOLLOW_DIR_EVENTS);
+
+	free(dir);
+
+	if (follow->dir_wd < 0)
+	{
+		ret = -errno;
+
+		fprintf(stderr,
+			"Failed to watch directory of file '%s' (%d)\n",
+			filename, ret);
+
+		syslog_follow_free(follow);
+		return ret;
+	}
+
+	return 0;
+}
+
+int syslog_follow_wait(
+	syslog_follow_t *follow,
+	syslog_input_t *input
+)
+{
+	char events[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+
+	struct signalfd_siginfo siginfo;
+	struct pollfd fds[2];
+	int ret;
+
+	assert(follow);
+	assert(input);
+
+	/* Rest of the replaced file has been read */
+	if (follow->replaced)
+	{
+		ret = follow_reopen(follow, input);
+		return ret ? ret : 1;
+	}
+
+	if (follow->signal_fd < 0)
+	{
+		ret = follow_signals(follow);
+		if (ret)
+		{
+			fprintf(stderr, "Failed to set up signal handling (%d)\n", ret);
+			return ret;
+		}
+	}
+
+	while (1)
+	{
+		ret = follow_check(follow, input);
+		if (ret)
+			return ret;
+
+		/* Negative file descriptors are ignored by poll() */
+		fds[0].fd     = follow->signal_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd     = follow->inotify_fd;
+		fds[1].events = POLLIN;
+
+		ret = poll(fds, ARRAY_SIZE(fds), (follow->inotify_fd < 0)
+			? SYSLOG_FOLLOW_POLL_INTERVAL : -1);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -errno;
+		}
+
+		if (fds[0].revents)
+		{
+			/* Signal must not stay pending after the mask is restored */
+			ret = read(follow->signal_fd, &siginfo, sizeof(siginfo));
+			return 0;
+		}
+
+		/* Events are not inspected, any event triggers the check */
+		if (fds[1].revents)
+		{
+			while (read(follow->inotify_fd, events, sizeof(events)) > 0)
+				;
+		}
+
+		return 1;
+	}
+}
+
+void syslog_follow_free(syslog_follow_t *follow)
+{
+	if (follow->inotify_fd >= 0)
+		close(follow->inotify_fd);
+
+	if (follow->signal_fd >= 0)
+	{
+		close(follow->signal_fd);
+		sigprocmask(SIG_SETMASK, &follow->sigmask, NULL);
+	}
+
+	memset(follow, 0, sizeof(syslog_follow_t));
+	follow->inotify_fd = -1;
+	follow->signal_fd  = -1;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,108 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Growing input file following header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_FOLLOW_H__
+#define __SYSLOG_FOLLOW_H__
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <syslog_input.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Followed file data structure
+ *
+ * File is watched by inotify for the appended data. The directory
+ * of the file is watched for the new file with the same name, so
+ * the rotated file is replaced by the new one. If inotify is not
+ * available, file is checked every #SYSLOG_FOLLOW_POLL_INTERVAL
+ * milliseconds.
+ */
+typedef struct syslog_follow
+{
+	/** Followed file name */
+	const char *filename;
+
+	/** Inotify file descriptor (<0 if inotify is not available) */
+	int inotify_fd;
+
+	/** Followed file watch descriptor */
+	int file_wd;
+
+	/** Followed file directory watch descriptor */
+	int dir_wd;
+
+	/** Termination signals file descriptor (<0 if not created yet) */
+	int signal_fd;
+
+	/** Signal mask before the termination signals have been blocked */
+	sigset_t sigmask;
+
+	/** Followed file has been replaced, rest of it is being read */
+	int replaced;
+
+} syslog_follow_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Start following of the input file
+ *
+ * Input must be switched into the follow mode by syslog_input_follow().
+ *
+ * @param[out] follow   Pointer to the follow data structure.
+ * @param[in]  filename Input file name.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_follow_init(
+	syslog_follow_t *follow,
+	const char *filename
+);
+
+/**
+ * Wait for the new input data
+ *
+ * Function blocks without CPU usage until data is appended to the
+ * file, the file is truncated or replaced, or SIGINT or SIGTERM signal
+ * is received. Truncated file is read from the beginning. Rest of the
+ * replaced file is read before the new file is opened.
+ *
+ * @param[in,out] follow Pointer to the follow data structure.
+ * @param[in,out] input  Pointer to the followed input.
+ *
+ * @return 1 if new data may be available in the input
+ * @return 0 if following is stopped by signal
+ * @return <0 on error
+ */
+int syslog_follow_wait(
+	syslog_follow_t *follow,
+	syslog_input_t *input
+);
+
+/**
+ * Stop following and free all allocated resources
+ *
+ * @param[in] follow Pointer to the follow data structure.
+ */
+void syslog_follow_free(syslog_follow_t *follow);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_FOLLOW_H__ */
@@ -0,0 +1,583 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Sidecar time index source
+ *
+ * Index file consists of the header (@ref index_header_t) followed
+ * by the array of items (@ref syslog_index_item_t). Index file is
+ * in the native byte order and is not portable between platforms,
+ * index with unexpected header is considered stale.
+ *
+ * Index is valid while the input file has the same size and
+ * modification time and the same last indexed bytes. If input file
+ * has only grown, the index is updated by indexing the new lines.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <syslog_fc.h>
+#include <syslog_index.h>
+#include <syslog_seek.h>
+
+/** @brief Index file magic */
+#define INDEX_MAGIC  "SFCIDX1\n"
+
+/** @brief Index file format version */
+#define INDEX_VERSION  1
+
+/** @brief Number of the last indexed input bytes to check */
+#define INDEX_TAIL_SIZE  4096
+
+/**
+ * @brief Index file header
+ */
+typedef struct index_header
+{
+	char magic[8];       /**< #INDEX_MAGIC */
+	uint32_t version;    /**< #INDEX_VERSION */
+	uint32_t bucket;     /**< #SYSLOG_INDEX_BUCKET */
+	uint32_t ordered;    /**< @ref syslog_index_t::ordered */
+	uint32_t reserved;   /**< Reserved (zero) */
+	uint64_t size;       /**< @ref syslog_index_t::size */
+	int64_t mtime;       /**< @ref syslog_index_t::mtime */
+	uint64_t tail_hash;  /**< @ref syslog_index_t::tail_hash */
+	uint64_t lines_n;    /**< @ref syslog_index_t::lines_n */
+	int64_t min_time;    /**< @ref syslog_index_t::min_time */
+	int64_t max_time;    /**< @ref syslog_index_t::max_time */
+	uint64_t items_n;    /**< Number of items */
+} index_header_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Calculate hash of the last input bytes (FNV-1a)
+ *
+ * @param[in] data  Input data.
+ * @param[in] size  Input data size.
+ *
+ * @return Hash value
+ */
+static uint64_t index_tail_hash(const char *data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i = (size > INDEX_TAIL_SIZE) ? size - INDEX_TAIL_SIZE : 0;
+
+	for (; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * Make index file name for the input file name
+ *
+ * @param[in] filename  Input file name.
+ *
+ * @return Allocated index file name (must be freed by caller)
+ * @return NULL on error
+ */
+static char *index_filename(const char *filename)
+{
+	char *name = malloc(strlen(filename) + sizeof(SYSLOG_INDEX_SUFFIX));
+
+	if (name)
+	{
+		strcpy(name, filename);
+		strcat(name, SYSLOG_INDEX_SUFFIX);
+	}
+
+	return name;
+}
+
+/**
+ * Identify the input the index is built for
+ *
+ * Input identity must be taken before the conversion, because parser
+ * modifies the line data of the private mapping.
+ *
+ * @param[in,out] index  Pointer to the index data structure.
+ * @param[in]     input  Pointer to the input data structure.
+ * @param[in]     st     Input file status.
+ */
+static void index_identify(
+	syslog_index_t *index,
+	const syslog_input_t *input,
+	const struct stat *st
+)
+{
+	index->size      = input->map_size;
+	index->mtime     = st->st_mtime;
+	index->tail_hash = index_tail_hash(input->map, input->map_size);
+}
+
+/**
+ * Append item to the index
+ *
+ * @param[in,out] index  Pointer to the index data structure.
+ * @param[in]     item   Pointer to the item.
+ */
+static void index_push(
+	syslog_index_t *index,
+	const syslog_index_item_t *item
+)
+{
+	if (index->items_n == index->items_max)
+	{
+		size_t items_max = index->items_max ? index->items_max * 2 : 256;
+		syslog_index_item_t *items = realloc(index->items,
+			items_max * sizeof(syslog_index_item_t));
+
+		if (!items)
+		{
+			index->error = -ENOMEM;
+			return;
+		}
+
+		index->items = items;
+		index->items_max = items_max;
+	}
+
+	index->items[index->items_n++] = *item;
+}
+
+/**
+ * Index new lines of the memory-mapped input
+ *
+ * @param[in,out] index   Pointer to the index data structure.
+ * @param[in]     input   Pointer to the input data structure.
+ * @param[in,out] entry   Pointer to the entry data structure.
+ * @param[in]     offset  Offset of the first new line.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int index_scan(
+	syslog_index_t *index,
+	const syslog_input_t *input,
+	syslog_entry_t *entry,
+	size_t offset
+)
+{
+	const char *map = input->map;
+	size_t end = input->map_size;
+	uint64_t line_n = index->lines_n;
+	char *line = malloc(SYSLOG_MAX_LINE_SIZE + 1);
+
+	if (!line)
+		return -ENOMEM;
+
+	while (offset < end)
+	{
+		const char *eol = memchr(map + offset, '\n', end - offset);
+		size_t next = eol ? (size_t)(eol - map) + 1 : end;
+		size_t len = (eol ? (size_t)(eol - map) : end) - offset;
+		time_t time;
+
+		if (len > SYSLOG_MAX_LINE_SIZE)
+			len = SYSLOG_MAX_LINE_SIZE;
+
+		/* Parser modifies the line data, the mapping must be kept intact */
+		memcpy(line, map + offset, len);
+		line[len] = '\0';
+
+		line_n++;
+
+		if (!syslog_entry_parse_time(entry, line, len, &time))
+			syslog_index_add(index, offset, line_n, time);
+
+		offset = next;
+	}
+
+	free(line);
+
+	index->lines_n = line_n;
+	return index->error;
+}
+
+/**
+ * Find the first index item with bucket start time not before
+ * the specified time
+ *
+ * @param[in] index  Pointer to the index data structure.
+ * @param[in] time   Time.
+ *
+ * @return Pointer to the found item
+ * @return NULL if there is no such item
+ */
+static const syslog_index_item_t *index_find(
+	const syslog_index_t *index,
+	int64_t time
+)
+{
+	size_t lo = 0;
+	size_t hi = index->items_n;
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (index->items[mid].time < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo < index->items_n) ? &index->items[lo] : NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void syslog_index_init(syslog_index_t *index)
+{
+	assert(index);
+
+	memset(index, 0, sizeof(syslog_index_t));
+
+	index->ordered  = 1;
+	index->min_time = INT64_MAX;
+	index->max_time = INT64_MIN;
+}
+
+void syslog_index_free(syslog_index_t *index)
+{
+	assert(index);
+
+	free(index->items);
+	syslog_index_init(index);
+}
+
+void syslog_index_add(
+	syslog_index_t *index,
+	uint64_t offset,
+	uint64_t line_n,
+	time_t time
+)
+{
+	syslog_index_item_t item;
+
+	/* Round down to the bucket start (time may be negative) */
+	item.time   = (int64_t)time - (((int64_t)time % SYSLOG_INDEX_BUCKET) +
+		SYSLOG_INDEX_BUCKET) % SYSLOG_INDEX_BUCKET;
+	item.offset = offset;
+	item.line_n = line_n;
+
+	if ((index->max_time != INT64_MIN) &&
+	    (time < index->max_time - SYSLOG_SEEK_TOLERANCE))
+		index->ordered = 0;
+
+	if (!index->items_n || (item.time > index->items[index->items_n - 1].time))
+		index_push(index, &item);
+
+	if (time < index->min_time)
+		index->min_time = time;
+
+	if (time > index->max_time)
+		index->max_time = time;
+}
+
+void syslog_index_append(
+	syslog_index_t *index,
+	const syslog_index_t *part
+)
+{
+	size_t i;
+
+	assert(index);
+	assert(part);
+
+	if (part->error)
+		index->error = part->error;
+
+	if (!part->items_n)
+		return;
+
+	if (!part->ordered ||
+	    ((index->max_time != INT64_MIN) &&
+	     (part->min_time < index->max_time - SYSLOG_SEEK_TOLERANCE)))
+		index->ordered = 0;
+
+	for (i = 0; i < part->items_n; i++)
+	{
+		if (!index->items_n ||
+		    (part->items[i].time > index->items[index->items_n - 1].time))
+			index_push(index, &part->items[i]);
+	}
+
+	if (part->min_time < index->min_time)
+		index->min_time = part->min_time;
+
+	if (part->max_time > index->max_time)
+		index->max_time = part->max_time;
+}
+
+int syslog_index_load(
+	syslog_index_t *index,
+	const char *filename,
+	syslog_input_t *input,
+	syslog_entry_t *entry
+)
+{
+	index_header_t hdr;
+	struct stat st;
+	char *name;
+	FILE *f;
+	size_t i;
+	int ret;
+
+	assert(index);
+	assert(filename);
+	assert(input);
+	assert(entry);
+
+	syslog_index_init(index);
+
+	if (!input->map)
+		return 0;
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	name = index_filename(filename);
+	if (!name)
+		return -ENOMEM;
+
+	f = fopen(name, "rb");
+	free(name);
+
+	if (!f)
+	{
+		index_identify(index, input, &st);
+		return 0;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, f) != 1) ||
+	    memcmp(hdr.magic, INDEX_MAGIC, sizeof(hdr.magic)) ||
+	    (hdr.version != INDEX_VERSION) ||
+	    (hdr.bucket != SYSLOG_INDEX_BUCKET) ||
+	    !hdr.size || (hdr.size > (uint64_t)st.st_size) ||
+	    (hdr.tail_hash != index_tail_hash(input->map, hdr.size)) ||
+	    (hdr.items_n > hdr.size))
+		goto stale;
+
+	if (hdr.size == (uint64_t)st.st_size)
+	{
+		/* Same size, but the file may be rewritten */
+		if (hdr.mtime != (int64_t)st.st_mtime)
+			goto stale;
+	}
+	else if (input->map[hdr.size - 1] != '\n')
+	{
+		/* Last indexed line was not complete */
+		goto stale;
+	}
+
+	index->items = malloc((hdr.items_n ? hdr.items_n : 1) *
+		sizeof(syslog_index_item_t));
+
+	if (!index->items)
+	{
+		fclose(f);
+		return -ENOMEM;
+	}
+
+	index->items_max = hdr.items_n;
+
+	if (fread(index->items, sizeof(syslog_index_item_t),
+		hdr.items_n, f) != hdr.items_n)
+		goto stale;
+
+	for (i = 0; i < hdr.items_n; i++)
+	{
+		if ((index->items[i].offset >= hdr.size) ||
+		    (i && (index->items[i].offset <= index->items[i - 1].offset)))
+			goto stale;
+	}
+
+	fclose(f);
+
+	index->items_n   = hdr.items_n;
+	index->size      = hdr.size;
+	index->mtime     = hdr.mtime;
+	index->tail_hash = hdr.tail_hash;
+	index->lines_n   = hdr.lines_n;
+	index->min_time  = hdr.min_time;
+	index->max_time  = hdr.max_time;
+	index->ordered   = hdr.ordered;
+
+	if (index->size < (uint64_t)st.st_size)
+	{
+		/* Input has grown, index new lines */
+		ret = index_scan(index, input, entry, index->size);
+		if (!ret)
+		{
+			index_identify(index, input, &st);
+			ret = syslog_index_save(index, filename, input);
+		}
+
+		if (ret)
+		{
+			syslog_index_free(index);
+			return ret;
+		}
+	}
+
+	return 1;
+
+stale:
+	fclose(f);
+	syslog_index_free(index);
+	index_identify(index, input, &st);
+	return 0;
+}
+
+int syslog_index_save(
+	syslog_index_t *index,
+	const char *filename,
+	const syslog_input_t *input
+)
+{
+	index_header_t hdr;
+	char *name;
+	char *tmp_name;
+	FILE *f;
+	int ret = 0;
+
+	assert(index);
+	assert(filename);
+	assert(input);
+
+	if (!input->map)
+		return -EINVAL;
+
+	if (index->error)
+		return index->error;
+
+	if (index->size != input->map_size)
+		return -EINVAL;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, INDEX_MAGIC, sizeof(hdr.magic));
+
+	hdr.version   = INDEX_VERSION;
+	hdr.bucket    = SYSLOG_INDEX_BUCKET;
+	hdr.ordered   = index->ordered;
+	hdr.size      = index->size;
+	hdr.mtime     = index->mtime;
+	hdr.tail_hash = index->tail_hash;
+	hdr.lines_n   = index->lines_n;
+	hdr.min_time  = index->min_time;
+	hdr.max_time  = index->max_time;
+	hdr.items_n   = index->items_n;
+
+	name = index_filename(filename);
+	tmp_name = name ? malloc(strlen(name) + sizeof(".tmp")) : NULL;
+
+	if (!tmp_name)
+	{
+		free(name);
+		return -ENOMEM;
+	}
+
+	strcpy(tmp_name, name);
+	strcat(tmp_name, ".tmp");
+
+	/* Index is replaced atomically */
+	f = fopen(tmp_name, "wb");
+	if (!f)
+		ret = -errno;
+	else
+	{
+		if ((fwrite(&hdr, sizeof(hdr), 1, f) != 1) ||
+		    (fwrite(index->items, sizeof(syslog_index_item_t),
+		     index->items_n, f) != index->items_n))
+			ret = -EIO;
+
+		if (fclose(f) && !ret)
+			ret = -errno;
+
+		if (!ret && rename(tmp_name, name))
+			ret = -errno;
+
+		if (ret)
+			unlink(tmp_name);
+	}
+
+	free(tmp_name);
+	free(name);
+	return ret;
+}
+
+int syslog_index_seek(
+	const syslog_index_t *index,
+	syslog_input_t *input
+)
+{
+	const syslog_index_item_t *item;
+	size_t start = 0;
+	size_t end = index->size;
+	uint64_t line_n = 0;
+	int ret;
+
+	assert(index);
+	assert(input);
+
+	if (!input->map || (index->size != input->map_size))
+		return -EINVAL;
+
+	if (config.filter.flags & SYSLOG_FILTER_SINCE)
+	{
+		/* All lines before the item are before its bucket start */
+		item = index_find(index, (int64_t)config.filter.since -
+			SYSLOG_INDEX_BUCKET + 1);
+
+		if (item)
+		{
+			start  = item->offset;
+			line_n = item->line_n - 1;
+		}
+		else
+		{
+			start  = end;
+			line_n = index->lines_n;
+		}
+	}
+
+	if ((config.filter.flags & SYSLOG_FILTER_UNTIL) && index->ordered)
+	{
+		/*
+		 * Lines after the item may go back from its bucket
+		 * start by the tolerance only
+		 */
+		item = index_find(index, (int64_t)config.filter.until +
+			SYSLOG_SEEK_TOLERANCE);
+
+		if (item)
+			end = item->offset;
+	}
+
+	if (start > end)
+		start = end;
+
+	ret = syslog_input_set_range(input, start, end);
+	if (!ret)
+		input->line_n = line_n;
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,199 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Sidecar time index header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_INDEX_H__
+#define __SYSLOG_INDEX_H__
+
+#include <stdint.h>
+
+#include <syslog_input.h>
+#include <syslog_entry.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Index file name suffix */
+#define SYSLOG_INDEX_SUFFIX  ".sfcidx"
+
+/** @brief Index time bucket size in seconds */
+#define SYSLOG_INDEX_BUCKET  60
+
+/**
+ * @brief Index item
+ *
+ * Item points to the first line of the time bucket.
+ */
+typedef struct syslog_index_item
+{
+	int64_t time;     /**< Bucket start time */
+	uint64_t offset;  /**< Line offset */
+	uint64_t line_n;  /**< Line number */
+} syslog_index_item_t;
+
+/**
+ * @brief Sidecar time index
+ *
+ * Index maps time buckets of #SYSLOG_INDEX_BUCKET seconds to the
+ * offsets and numbers of their first lines. An item is added for
+ * each line with the timestamp in the bucket after the last indexed
+ * bucket, so all lines before an item have timestamps before
+ * the item bucket start time.
+ */
+typedef struct syslog_index
+{
+	/** Indexed input size */
+	uint64_t size;
+
+	/** Input modification time */
+	int64_t mtime;
+
+	/** Hash of the last indexed input bytes */
+	uint64_t tail_hash;
+
+	/** Number of indexed lines */
+	uint64_t lines_n;
+
+	/** Minimum timestamp */
+	int64_t min_time;
+
+	/** Maximum timestamp */
+	int64_t max_time;
+
+	/**
+	 * Timestamps are ordered (never go back by more than
+	 * #SYSLOG_SEEK_TOLERANCE seconds)
+	 */
+	int ordered;
+
+	/** Index items */
+	syslog_index_item_t *items;
+
+	/** Number of index items */
+	size_t items_n;
+
+	/** Number of items that fit into @ref items array */
+	size_t items_max;
+
+	/** Memory allocation failed */
+	int error;
+
+} syslog_index_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize empty index
+ *
+ * @param[out] index  Pointer to the index data structure.
+ */
+void syslog_index_init(syslog_index_t *index);
+
+/**
+ * Free resources allocated for the index
+ *
+ * @param[in] index  Pointer to the index data structure.
+ */
+void syslog_index_free(syslog_index_t *index);
+
+/**
+ * Add line to the index
+ *
+ * Lines must be added in the input order.
+ *
+ * @param[in,out] index   Pointer to the index data structure.
+ * @param[in]     offset  Line offset.
+ * @param[in]     line_n  Line number.
+ * @param[in]     time    Line timestamp.
+ */
+void syslog_index_add(
+	syslog_index_t *index,
+	uint64_t offset,
+	uint64_t line_n,
+	time_t time
+);
+
+/**
+ * Append index built for the following part of the input
+ *
+ * @param[in,out] index  Pointer to the index data structure.
+ * @param[in]     part   Pointer to the index of the input part.
+ */
+void syslog_index_append(
+	syslog_index_t *index,
+	const syslog_index_t *part
+);
+
+/**
+ * Load index of the memory-mapped input
+ *
+ * If input has only grown since the index has been built, new lines
+ * are indexed and the updated index is saved. If index does not exist
+ * or is stale, empty index identifying the current input is returned
+ * to be built during the conversion.
+ *
+ * @param[out]    index     Pointer to the index data structure.
+ * @param[in]     filename  Input file name.
+ * @param[in]     input     Pointer to the input data structure.
+ * @param[in,out] entry     Pointer to the entry data structure (used
+ *                          for parsing timestamps only).
+ *
+ * @return 1 if index is loaded and up to date
+ * @return 0 if index does not exist or is stale
+ * @return <0 on error
+ */
+int syslog_index_load(
+	syslog_index_t *index,
+	const char *filename,
+	syslog_input_t *input,
+	syslog_entry_t *entry
+);
+
+/**
+ * Save index of the whole memory-mapped input
+ *
+ * Index must be loaded by syslog_index_load() before the conversion,
+ * which identifies the input.
+ *
+ * @param[in,out] index     Pointer to the index data structure.
+ * @param[in]     filename  Input file name.
+ * @param[in]     input     Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_index_save(
+	syslog_index_t *index,
+	const char *filename,
+	const syslog_input_t *input
+);
+
+/**
+ * Restrict memory-mapped input to the lines that may match the time
+ * range filter (see @ref config_t::filter) using the index
+ *
+ * @param[in]     index  Pointer to the loaded index data structure.
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error (index can't be used)
+ */
+int syslog_index_seek(
+	const syslog_index_t *index,
+	syslog_input_t *input
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_INDEX_H__ */
@@ -0,0 +1,1190 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Syslog input reader source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <syslog_fc.h>
+#include <syslog_input.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Table of the mapped inputs, which are guarded from SIGBUS
+ *
+ * Table is read by the SIGBUS handler in any thread, so its slots are
+ * set and cleared by the atomic operations only and it is never resized.
+ */
+static syslog_input_t *input_maps[SYSLOG_INPUT_MAPS_MAX];
+
+/** @brief System page size (0 if SIGBUS handler is not installed yet) */
+static uintptr_t input_page_size = 0;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Ensure that the line buffer can hold at least @p size bytes
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ * @param[in]     size  Required buffer size.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_buffer_reserve(
+	syslog_input_t *input,
+	size_t size
+)
+{
+	char *new_buffer;
+
+	if (size <= input->buffer_size)
+		return 0;
+
+	new_buffer = realloc(input->buffer, size);
+	if (!new_buffer)
+	{
+		fprintf(stderr,
+			"line %u: Failed to reallocate memory for line buffer "
+			"(%zu -> %zu)\n",
+			input->line_n, input->buffer_size, size);
+
+		return -ENOMEM;
+	}
+
+	input->buffer = new_buffer;
+	input->buffer_size = size;
+	return 0;
+}
+
+/**
+ * SIGBUS signal handler
+ *
+ * Access to the pages of the mapping past the end of the truncated file
+ * raises SIGBUS. The pages are replaced by zero pages and the input is
+ * marked as truncated, so the faulting access is restarted and the
+ * readers discard the copied data. Other faults terminate the program.
+ *
+ * Handler must be async-signal-safe and may interrupt the main thread
+ * while it opens or closes inputs, so it only reads the table of the
+ * guarded inputs and sets the truncation flag by the atomic operations,
+ * and calls mmap() and signal(). mmap() is not listed as async-signal-safe
+ * by POSIX, but it is a plain system call on Linux, which does not touch
+ * any user-space state. Input is removed from the table before it is
+ * unmapped and its mapping fields are not changed while it is in the table.
+ *
+ * @param[in] sig      Signal number.
+ * @param[in] info     Signal information.
+ * @param[in] context  Signal context (unused).
+ */
+static void input_sigbus(int sig, siginfo_t *info, void *context)
+{
+	uintptr_t addr = (uintptr_t)info->si_addr;
+	syslog_input_t *input;
+	int saved_errno = errno;
+	int expected = 0;
+	unsigned int i;
+
+	(void)context;
+
+	for (i = 0; i < SYSLOG_INPUT_MAPS_MAX; i++)
+	{
+		uintptr_t start;
+		uintptr_t end;
+		uintptr_t page;
+
+		input = __atomic_load_n(&input_maps[i], __ATOMIC_ACQUIRE);
+		if (!input)
+			continue;
+
+		start = (uintptr_t)input->map;
+		end = start + input->map_size;
+
+		if ((addr < start) || (addr >= end))
+			continue;
+
+		page = addr & ~(input_page_size - 1);
+		end = (end + input_page_size - 1) & ~(input_page_size - 1);
+
+		if (mmap((void *)page, end - page, PROT_READ,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+			break;
+
+		__atomic_compare_exchange_n(&input->map_truncated, &expected, 1,
+			0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+		errno = saved_errno;
+		return;
+	}
+
+	/* Fault is not caused by the input truncation */
+	signal(sig, SIG_DFL);
+	errno = saved_errno;
+}
+
+/**
+ * Add mapped input to the table of the inputs guarded from SIGBUS
+ *
+ * SIGBUS handler is installed on the first call.
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_map_guard(syslog_input_t *input)
+{
+	struct sigaction sa;
+	unsigned int i;
+
+	if (!input_page_size)
+	{
+		input_page_size = sysconf(_SC_PAGESIZE);
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_sigaction = input_sigbus;
+		sa.sa_flags = SA_SIGINFO;
+		sigemptyset(&sa.sa_mask);
+
+		if (sigaction(SIGBUS, &sa, NULL))
+		{
+			input_page_size = 0;
+			return -errno;
+		}
+	}
+
+	__atomic_store_n(&input->map_truncated, 0, __ATOMIC_RELAXED);
+
+	for (i = 0; i < SYSLOG_INPUT_MAPS_MAX; i++)
+	{
+		syslog_input_t *expected = NULL;
+
+		/* Input fields are published to the handler with the slot */
+		if (__atomic_compare_exchange_n(&input_maps[i], &expected, input,
+			0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return 0;
+	}
+
+	return -ENOSPC;
+}
+
+/**
+ * Unmap input file and remove it from the table of the guarded inputs
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ */
+static void input_unmap(syslog_input_t *input)
+{
+	unsigned int i;
+
+	for (i = 0; i < SYSLOG_INPUT_MAPS_MAX; i++)
+	{
+		if (__atomic_load_n(&input_maps[i], __ATOMIC_RELAXED) == input)
+		{
+			__atomic_store_n(&input_maps[i], NULL, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+
+	munmap(input->map, input->map_size);
+
+	input->map        = NULL;
+	input->map_size   = 0;
+	input->map_offset = 0;
+	input->map_end    = 0;
+}
+
+/**
+ * Try to map input file into memory
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 if input can't be mapped
+ */
+static int input_map(syslog_input_t *input)
+{
+	struct stat st;
+	void *map;
+	int ret;
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	/* Empty files can't be mapped, they are read as streams */
+	if (!S_ISREG(st.st_mode) || (st.st_size <= 0))
+		return -ENOTSUP;
+
+	/*
+	 * Mapping is read-only, lines are copied into the private buffers
+	 * before the parser terminates fields in place. Writing into the
+	 * private mapping would make a private copy of every page, so the
+	 * anonymous memory would grow up to the input size.
+	 */
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+
+	if (map == MAP_FAILED)
+		return -errno;
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	input->map        = map;
+	input->map_size   = st.st_size;
+	input->map_offset = 0;
+	input->map_end    = st.st_size;
+
+	ret = input_map_guard(input);
+	if (ret)
+		input_unmap(input);
+
+	return ret;
+}
+
+/**
+ * Read next block of data from the input stream into the block buffer
+ *
+ * Unread data is moved to the beginning of the buffer before reading.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_stream_fill(syslog_input_t *input)
+{
+	ssize_t n;
+
+	if (input->data_start)
+	{
+		memmove(input->buffer, input->buffer + input->data_start,
+			input->data_end - input->data_start);
+
+		input->stream_offset += input->data_start;
+		input->data_end -= input->data_start;
+		input->data_start = 0;
+	}
+
+	if (input->decompress)
+	{
+		n = syslog_decompress_read(input->decompress,
+			input->buffer + input->data_end,
+			SYSLOG_INPUT_BLOCK_SIZE - input->data_end);
+	}
+	else
+	{
+		do
+			n = read(input->fd, input->buffer + input->data_end,
+				SYSLOG_INPUT_BLOCK_SIZE - input->data_end);
+		while ((n < 0) && (errno == EINTR));
+
+		if (n < 0)
+			n = -errno;
+	}
+
+	if (n < 0)
+	{
+		fprintf(stderr,
+			"line %u: Failed to read input data (%d)\n",
+			input->line_n, (int)n);
+
+		return n;
+	}
+
+	if (!n)
+		input->eof = 1;
+
+	input->data_end += n;
+	return 0;
+}
+
+/**
+ * Start decompression of the compressed input
+ *
+ * @param[in,out] input        Pointer to the input data structure.
+ * @param[in]     type         Compression format.
+ * @param[in]     prefix       Compressed data already read from the input
+ *                             (or NULL).
+ * @param[in]     prefix_size  Size of the @p prefix data.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_decompress(
+	syslog_input_t *input,
+	syslog_compression_t type,
+	const void *prefix,
+	size_t prefix_size
+)
+{
+	int ret = syslog_decompress_open(&input->decompress,
+		input->fd, type, prefix, prefix_size);
+
+	if (ret == -ENOTSUP)
+	{
+		fprintf(stderr,
+			"Input data is %s compressed, but %s support "
+			"is not built in\n",
+			syslog_compression_name(type),
+			syslog_compression_name(type));
+	}
+	else if (ret)
+	{
+		fprintf(stderr,
+			"Failed to start %s decompression (%d)\n",
+			syslog_compression_name(type), ret);
+	}
+
+	return ret;
+}
+
+/**
+ * Detect compression of the input stream
+ *
+ * Magic bytes are read into the block buffer. If input is compressed,
+ * they are handed over to the decompressor.
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_stream_detect(syslog_input_t *input)
+{
+	syslog_compression_t type;
+	int ret;
+
+	while (!input->eof &&
+	       (input->data_end < SYSLOG_COMPRESSION_MAGIC_SIZE))
+	{
+		ret = input_stream_fill(input);
+		if (ret)
+			return ret;
+	}
+
+	type = syslog_compression_detect(input->buffer, input->data_end);
+	if (type == SYSLOG_COMPRESSION_NONE)
+		return 0;
+
+	ret = input_decompress(input, type, input->buffer, input->data_end);
+
+	input->data_end = 0;
+	input->eof = 0;
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_input_open(
+	syslog_input_t *input,
+	const char *filename
+)
+{
+	syslog_compression_t type = SYSLOG_COMPRESSION_NONE;
+	char magic[SYSLOG_COMPRESSION_MAGIC_SIZE];
+	ssize_t magic_size = -1;
+	int ret;
+
+	assert(input);
+
+	memset(input, 0, sizeof(syslog_input_t));
+
+	if (filename)
+	{
+		input->fd = open(filename, O_RDONLY);
+		if (input->fd < 0)
+			return -ENODEV;
+
+		magic_size = pread(input->fd, magic, sizeof(magic), 0);
+		if (magic_size > 0)
+			type = syslog_compression_detect(magic, magic_size);
+
+		if ((type == SYSLOG_COMPRESSION_NONE) && !input_map(input))
+			return 0;
+	}
+	else
+		input->fd = STDIN_FILENO;
+
+	/* Extra byte is reserved for the line terminator */
+	input->buffer_size = SYSLOG_INPUT_BLOCK_SIZE + 1;
+	input->buffer = malloc(input->buffer_size);
+	if (!input->buffer)
+	{
+		fprintf(stderr,
+			"Failed to allocate memory for input buffer\n");
+
+		syslog_input_close(input);
+		return -ENOMEM;
+	}
+
+	if (type != SYSLOG_COMPRESSION_NONE)
+		ret = input_decompress(input, type, NULL, 0);
+	else if (magic_size < 0)
+	{
+		/* Input can't be probed without reading (pipe or terminal) */
+		ret = input_stream_detect(input);
+	}
+	else
+		ret = 0;
+
+	if (ret)
+	{
+		syslog_input_close(input);
+		return ret;
+	}
+
+	return 0;
+}
+
+void syslog_input_close(syslog_input_t *input)
+{
+	if (input->map)
+		input_unmap(input);
+
+	syslog_decompress_close(input->decompress);
+
+	if (input->fd > STDIN_FILENO)
+		close(input->fd);
+
+	free(input->buffer);
+	memset(input, 0, sizeof(syslog_input_t));
+}
+
+int syslog_input_set_range(
+	syslog_input_t *input,
+	size_t start,
+	size_t end
+)
+{
+	assert(input);
+
+	if (!input->map || (start > end) || (end > input->map_size))
+		return -EINVAL;
+
+	input->map_offset = start;
+	input->map_end    = end;
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Continue reading of the mapped input as the stream
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in]     offset Input offset to read the stream from.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_map_stream(syslog_input_t *input, size_t offset)
+{
+	int ret;
+
+	if (lseek(input->fd, offset, SEEK_SET) < 0)
+		return -errno;
+
+	/* Extra byte is reserved for the line terminator */
+	ret = input_buffer_reserve(input, SYSLOG_INPUT_BLOCK_SIZE + 1);
+	if (ret)
+		return ret;
+
+	input->stream_offset = offset;
+	input->data_start    = 0;
+	input->data_end      = 0;
+
+	input_unmap(input);
+	return 0;
+}
+
+/**
+ * Continue reading of the truncated mapped input as the stream
+ *
+ * Stream is read from the offset of the next unread line, so the data
+ * read from the mapping after the truncation is discarded.
+ *
+ * @param[in,out] input Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_map_truncated(syslog_input_t *input)
+{
+	fprintf(stderr,
+		"line %u: Input file has been truncated while reading, "
+		"continuing as stream\n", input->line_n);
+
+	return input_map_stream(input, input->map_offset);
+}
+
+int syslog_input_follow(syslog_input_t *input)
+{
+	struct stat st;
+	char *eol;
+
+	assert(input);
+
+	if (input->decompress)
+		return -ENOTSUP;
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	if (!S_ISREG(st.st_mode))
+		return -ENOTSUP;
+
+	/* Leave unterminated last line for the stream reading */
+	if (input->map && (input->map_end == input->map_size))
+	{
+		eol = memrchr(input->map + input->map_offset, '\n',
+			input->map_end - input->map_offset);
+
+		if (eol)
+			input->map_end = eol - input->map + 1;
+		else
+			input->map_end = input->map_offset;
+	}
+
+	input->follow = 1;
+	return 0;
+}
+
+int syslog_input_follow_end(syslog_input_t *input)
+{
+	int ret;
+
+	assert(input);
+
+	if (input->map)
+	{
+		ret = input_map_stream(input, input->map_end);
+		if (ret)
+			return ret;
+	}
+
+	input->follow = 0;
+	return 0;
+}
+
+int syslog_input_rewind(syslog_input_t *input)
+{
+	int ret;
+
+	assert(input);
+
+	if (input->map)
+	{
+		ret = input_map_stream(input, input->map_end);
+		if (ret)
+			return ret;
+	}
+
+	if (lseek(input->fd, 0, SEEK_SET) < 0)
+		return -errno;
+
+	input->stream_offset = 0;
+	input->data_start    = 0;
+	input->data_end      = 0;
+	input->eof           = 0;
+	input->skip_line     = 0;
+	input->line_n        = 0;
+
+	return 0;
+}
+
+off_t syslog_input_tell(const syslog_input_t *input)
+{
+	assert(input);
+
+	if (input->map)
+		return input->map_offset;
+	else
+		return input->stream_offset + input->data_start;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Truncate line if it exceeds #SYSLOG_MAX_LINE_SIZE
+ *
+ * @param[in]     line_n Line number (used only for output
+ *                       in error messages).
+ * @param[in,out] line   Pointer to the line data.
+ * @param[in,out] len    Line length (without terminator).
+ *
+ * @return 1 if line has been truncated, 0 otherwise
+ */
+static int input_truncate_line(
+	unsigned int line_n,
+	char *line,
+	size_t *len
+)
+{
+	if (*len <= SYSLOG_MAX_LINE_SIZE)
+		return 0;
+
+	fprintf(stderr,
+		"line %u: Line size limit (%zu) reached, line truncated\n",
+		line_n, (size_t)SYSLOG_MAX_LINE_SIZE);
+
+	*len = SYSLOG_MAX_LINE_SIZE;
+	line[*len] = '\0';
+	return 1;
+}
+
+/**
+ * Read next line from the mapped input data
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[out]    line   Pointer to the line data.
+ * @param[out]    len    Line length (without terminator).
+ *
+ * @return 1 if line has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+static int input_map_read_line(
+	syslog_input_t *input,
+	char **line,
+	size_t *len
+)
+{
+	const char *p = input->map + input->map_offset;
+	size_t avail = input->map_end - input->map_offset;
+	const char *eol;
+	size_t size;
+	int ret;
+
+	if (!avail)
+		return 0;
+
+	eol = memchr(p, '\n', avail);
+	*len = eol ? (size_t)(eol - p) : avail;
+
+	/* Line is copied into the line buffer, as the mapping is read-only
+	 * and the parser terminates field values in place */
+	size = (*len > SYSLOG_MAX_LINE_SIZE) ? SYSLOG_MAX_LINE_SIZE : *len;
+
+	ret = input_buffer_reserve(input, size + 1);
+	if (ret)
+		return ret;
+
+	memcpy(input->buffer, p, size);
+	input->buffer[size] = '\0';
+
+	/* Copied data is not valid if file has been truncated */
+	if (__atomic_load_n(&input->map_truncated, __ATOMIC_ACQUIRE))
+		return 0;
+
+	*line = input->buffer;
+
+	input->line_n++;
+	input->map_offset += eol ? *len + 1 : *len;
+	input_truncate_line(input->line_n, *line, len);
+	return 1;
+}
+
+/**
+ * Discard the rest of the previously truncated line
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_stream_skip_line(syslog_input_t *input)
+{
+	int ret;
+	char *p;
+	char *eol;
+
+	while (input->skip_line)
+	{
+		p = input->buffer + input->data_start;
+		eol = memchr(p, '\n', input->data_end - input->data_start);
+
+		if (eol)
+		{
+			input->data_start += eol - p + 1;
+			input->skip_line = 0;
+			break;
+		}
+
+		input->data_start = input->data_end;
+
+		if (input->eof)
+			break;
+
+		ret = input_stream_fill(input);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Read next line from the input stream
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[out]    line   Pointer to the line data.
+ * @param[out]    len    Line length (without terminator).
+ *
+ * @return 1 if line has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+static int input_stream_read_line(
+	syslog_input_t *input,
+	char **line,
+	size_t *len
+)
+{
+	int ret;
+	char *p;
+	char *eol;
+	size_t avail;
+
+	ret = input_stream_skip_line(input);
+	if (ret)
+		return ret;
+
+	while (1)
+	{
+		p = input->buffer + input->data_start;
+		avail = input->data_end - input->data_start;
+
+		eol = memchr(p, '\n', avail);
+		if (eol)
+		{
+			*eol = '\0';
+			*line = p;
+			*len = eol - p;
+
+			input->data_start += *len + 1;
+			input->line_n++;
+			return 1;
+		}
+
+		if (input->eof)
+		{
+			if (input->follow)
+			{
+				/* Wait for the rest of the line to be appended */
+				input->eof = 0;
+				return 0;
+			}
+
+			if (!avail)
+				return 0;
+
+			/* Last line without terminator */
+			p[avail] = '\0';
+			*line = p;
+			*len = avail;
+
+			input->data_start = input->data_end;
+			input->line_n++;
+			return 1;
+		}
+
+		if ((input->data_start == 0) &&
+		    (input->data_end == SYSLOG_INPUT_BLOCK_SIZE))
+		{
+			/* Whole block contains single unterminated line */
+			input->line_n++;
+
+			*line = input->buffer;
+			*len = SYSLOG_MAX_LINE_SIZE + 1;
+			input_truncate_line(input->line_n, *line, len);
+
+			input->data_start = input->data_end;
+			input->skip_line = 1;
+			return 1;
+		}
+
+		ret = input_stream_fill(input);
+		if (ret)
+			return ret;
+	}
+}
+
+int syslog_input_read_line(
+	syslog_input_t *input,
+	char **line,
+	size_t *len
+)
+{
+	int ret;
+
+	assert(input);
+	assert(line);
+	assert(len);
+
+	if (input->map)
+	{
+		ret = input_map_read_line(input, line, len);
+
+		if (__atomic_load_n(&input->map_truncated, __ATOMIC_ACQUIRE))
+			ret = input_map_truncated(input);
+		else if (ret || !input->follow)
+			return ret;
+		else
+		{
+			/* Initial part of the followed input has been read */
+			ret = input_map_stream(input, input->map_end);
+		}
+
+		if (ret)
+			return ret;
+	}
+
+	return input_stream_read_line(input, line, len);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Read next chunk from the mapped input data
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ *
+ * @return 1 if chunk has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+static int input_map_read_chunk(
+	syslog_input_t *input,
+	syslog_input_chunk_t *chunk
+)
+{
+	char *p = input->map + input->map_offset;
+	size_t avail = input->map_end - input->map_offset;
+	size_t size = avail;
+	char *eol;
+
+	if (!avail)
+		return 0;
+
+	/* Extend chunk till the end of the line at the chunk boundary */
+	if (size > SYSLOG_INPUT_CHUNK_SIZE)
+	{
+		eol = memchr(p + SYSLOG_INPUT_CHUNK_SIZE - 1, '\n',
+			avail - SYSLOG_INPUT_CHUNK_SIZE + 1);
+
+		if (eol)
+			size = eol - p + 1;
+	}
+
+	/* Data is copied by the first syslog_input_chunk_read_line() call */
+	chunk->data   = p;
+	chunk->size   = size;
+	chunk->offset = 0;
+
+	chunk->map_input = input;
+
+	input->map_offset += size;
+	return 1;
+}
+
+/**
+ * Read next chunk from the input stream
+ *
+ * The chunk takes the input block buffer, and the input
+ * continues with the previous chunk buffer.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ *
+ * @return 1 if chunk has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+static int input_stream_read_chunk(
+	syslog_input_t *input,
+	syslog_input_chunk_t *chunk
+)
+{
+	int ret;
+	char *p;
+	char *eol;
+	char *buffer;
+	size_t avail;
+	size_t size;
+
+	ret = input_stream_skip_line(input);
+	if (ret)
+		return ret;
+
+	/* Fill the whole block */
+	while (!input->eof &&
+	       (input->data_end - input->data_start < SYSLOG_INPUT_BLOCK_SIZE))
+	{
+		ret = input_stream_fill(input);
+		if (ret)
+			return ret;
+	}
+
+	p = input->buffer + input->data_start;
+	avail = input->data_end - input->data_start;
+	size = avail;
+
+	if (!avail)
+		return 0;
+
+	if (!input->eof)
+	{
+		eol = memrchr(p, '\n', avail);
+		if (eol)
+			size = eol - p + 1;
+		else
+		{
+			/* Whole block contains single unterminated line */
+			input->skip_line = 1;
+		}
+	}
+
+	buffer = chunk->buffer;
+	if (!buffer || (chunk->buffer_size < input->buffer_size))
+	{
+		free(buffer);
+
+		buffer = malloc(input->buffer_size);
+		if (!buffer)
+			return -ENOMEM;
+	}
+
+	/* Carry over the incomplete line into the new block buffer */
+	memcpy(buffer, p + size, avail - size);
+
+	chunk->buffer      = input->buffer;
+	chunk->buffer_size = input->buffer_size;
+	chunk->data        = p;
+	chunk->size        = size;
+	chunk->offset      = 0;
+	chunk->map_input   = NULL;
+
+	input->stream_offset += input->data_start + size;
+
+	input->buffer     = buffer;
+	input->data_start = 0;
+	input->data_end   = avail - size;
+
+	return 1;
+}
+
+int syslog_input_read_chunk(
+	syslog_input_t *input,
+	syslog_input_chunk_t *chunk
+)
+{
+	struct stat st;
+
+	assert(input);
+	assert(chunk);
+
+	if (!input->map)
+		return input_stream_read_chunk(input, chunk);
+
+	/*
+	 * Chunks handed out before may still point into the mapping, so
+	 * the input is not switched to the stream. Rest of the input is
+	 * limited to the file size and chunks are read from the file.
+	 */
+	if (__atomic_load_n(&input->map_truncated, __ATOMIC_ACQUIRE) == 1)
+	{
+		fprintf(stderr,
+			"Input file has been truncated while reading\n");
+
+		if (fstat(input->fd, &st))
+			return -errno;
+
+		if ((size_t)st.st_size < input->map_end)
+		{
+			input->map_end = ((size_t)st.st_size > input->map_offset)
+				? (size_t)st.st_size : input->map_offset;
+		}
+
+		__atomic_store_n(&input->map_truncated, 2, __ATOMIC_RELAXED);
+	}
+
+	return input_map_read_chunk(input, chunk);
+}
+
+/**
+ * Read chunk data of the truncated mapped input from the file
+ *
+ * Data copied from the mapping may contain zero pages, so the chunk
+ * is read again from the file. Chunk is shortened if the file ends
+ * before the chunk end.
+ *
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_chunk_pread(syslog_input_chunk_t *chunk)
+{
+	const syslog_input_t *input = chunk->map_input;
+	off_t offset = chunk->data - input->map;
+	size_t size = 0;
+	ssize_t n;
+
+	while (size < chunk->size)
+	{
+		n = pread(input->fd, chunk->buffer + size,
+			chunk->size - size, offset + size);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -errno;
+		}
+
+		if (!n)
+			break;
+
+		size += n;
+	}
+
+	chunk->size = size;
+	return 0;
+}
+
+/**
+ * Copy mapped chunk data into the chunk own buffer
+ *
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int input_chunk_copy(syslog_input_chunk_t *chunk)
+{
+	int ret;
+
+	/* Extra byte is reserved for the terminator of the last line */
+	if (chunk->buffer_size < chunk->size + 1)
+	{
+		char *new_buffer = realloc(chunk->buffer, chunk->size + 1);
+		if (!new_buffer)
+			return -ENOMEM;
+
+		chunk->buffer = new_buffer;
+		chunk->buffer_size = chunk->size + 1;
+	}
+
+	memcpy(chunk->buffer, chunk->data, chunk->size);
+
+	if (__atomic_load_n(&chunk->map_input->map_truncated, __ATOMIC_ACQUIRE))
+	{
+		ret = input_chunk_pread(chunk);
+		if (ret)
+			return ret;
+	}
+
+	chunk->data      = chunk->buffer;
+	chunk->map_input = NULL;
+	return 0;
+}
+
+unsigned int syslog_input_chunk_count_lines(
+	syslog_input_chunk_t *chunk
+)
+{
+	unsigned int lines_n = 0;
+	const char *p;
+	const char *end;
+
+	/* Copy error is returned by syslog_input_chunk_read_line() */
+	if (chunk->map_input && input_chunk_copy(chunk))
+		return 0;
+
+	p = chunk->data;
+	end = chunk->data + chunk->size;
+
+	while ((p < end) && (p = memchr(p, '\n', end - p)))
+	{
+		lines_n++;
+		p++;
+	}
+
+	/* Unterminated last line */
+	if (chunk->size && (chunk->data[chunk->size - 1] != '\n'))
+		lines_n++;
+
+	return lines_n;
+}
+
+int syslog_input_chunk_read_line(
+	syslog_input_chunk_t *chunk,
+	char **line,
+	size_t *len
+)
+{
+	char *p;
+	size_t avail;
+	char *eol;
+	int ret;
+
+	assert(chunk);
+	assert(line);
+	assert(len);
+
+	if (chunk->map_input)
+	{
+		ret = input_chunk_copy(chunk);
+		if (ret)
+			return ret;
+	}
+
+	p = chunk->data + chunk->offset;
+	avail = chunk->size - chunk->offset;
+
+	if (!avail)
+		return 0;
+
+	chunk->line_n++;
+
+	eol = memchr(p, '\n', avail);
+	if (eol)
+		*len = eol - p;
+	else
+		*len = avail;
+
+	/* There is always room for the terminator in the chunk */
+	p[*len] = '\0';
+	*line = p;
+
+	chunk->offset += eol ? *len + 1 : *len;
+	input_truncate_line(chunk->line_n, *line, len);
+	return 1;
+}
+
+void syslog_input_chunk_free(syslog_input_chunk_t *chunk)
+{
+	free(chunk->buffer);
+	memset(chunk, 0, sizeof(syslog_input_chunk_t));
+}
+
+/* ----------------------------------------------------------------------- */
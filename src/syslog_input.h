@@ -0,0 +1,337 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Syslog input reader header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_INPUT_H__
+#define __SYSLOG_INPUT_H__
+
+#include <signal.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <syslog_decompress.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Syslog input reader data structure
+ *
+ * Regular files are memory-mapped (read-only) and lines are copied from
+ * the mapping into the line buffer or into the chunk buffers, because
+ * field values are NUL-terminated in place by the parser. The copy is
+ * done right after the line end is found, while the line is in cache,
+ * and the mapping saves the read() calls and the block buffer moves of
+ * the streamed inputs.
+ *
+ * Standard input and other non-mappable inputs are read by large blocks
+ * of #SYSLOG_INPUT_BLOCK_SIZE bytes. Lines longer than
+ * #SYSLOG_MAX_LINE_SIZE are truncated in both modes.
+ *
+ * Compressed inputs (see @ref syslog_compression_t) are detected by the
+ * magic bytes and read as streams of the decompressed data.
+ *
+ * Followed inputs (see syslog_input_follow()) are read from the mapping
+ * till the last complete line and then continue as streams.
+ *
+ * If the mapped file is truncated while it is read, SIGBUS is caught and
+ * the pages past the end of the file are replaced by zero pages. Line
+ * read from the mapping after the truncation is discarded and the input
+ * continues as the stream from the same line, chunks are read again
+ * from the file by pread().
+ */
+typedef struct syslog_input
+{
+	/** Input file descriptor */
+	int fd;
+
+	/** Mapped file data (mmap mode only) */
+	char *map;
+
+	/** Mapped file data size */
+	size_t map_size;
+
+	/** Current read offset in the mapped data */
+	size_t map_offset;
+
+	/** End of the data to read in the mapped data */
+	size_t map_end;
+
+	/**
+	 * Mapped file has been truncated while reading (0 - no, 1 - set by
+	 * the SIGBUS handler, 2 - handled by the chunk reader). Accessed
+	 * by the atomic operations only, as it is set by the signal handler
+	 * in any thread and read by the workers
+	 */
+	int map_truncated;
+
+	/** Decompressor (compressed input only) */
+	syslog_decompress_t *decompress;
+
+	/** Block buffer (or line buffer in mmap mode) */
+	char *buffer;
+
+	/** Buffer size */
+	size_t buffer_size;
+
+	/** Offset of the unread data in the block buffer */
+	size_t data_start;
+
+	/** Offset of the end of data in the block buffer */
+	size_t data_end;
+
+	/** Input offset of the block buffer start */
+	off_t stream_offset;
+
+	/** End of input reached */
+	int eof;
+
+	/** Discard data till the end of the truncated line */
+	int skip_line;
+
+	/** Input is followed, unterminated last line is not read */
+	int follow;
+
+	/** Number of the last read line */
+	unsigned int line_n;
+
+} syslog_input_t;
+
+/**
+ * @brief Syslog input chunk data structure
+ *
+ * Chunk is a block of complete input lines, that can be
+ * processed independently from the other chunks.
+ */
+typedef struct syslog_input_chunk
+{
+	/** Chunk data */
+	char *data;
+
+	/** Chunk data size */
+	size_t size;
+
+	/** Current read offset in the chunk data */
+	size_t offset;
+
+	/** Chunk own buffer (streaming mode or unterminated last line) */
+	char *buffer;
+
+	/** Chunk own buffer size */
+	size_t buffer_size;
+
+	/** Input, which read-only mapping the chunk data points into
+	 *  (NULL if chunk data is in the chunk own buffer). Mapped data
+	 *  is copied into the chunk own buffer before reading the lines */
+	const struct syslog_input *map_input;
+
+	/** Number of the last read line */
+	unsigned int line_n;
+
+} syslog_input_chunk_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Open syslog input
+ *
+ * @param[out] input    Pointer to the input data structure.
+ * @param[in]  filename Input file name or NULL for the standard input.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_input_open(
+	syslog_input_t *input,
+	const char *filename
+);
+
+/**
+ * Close syslog input and free all allocated resources
+ *
+ * @param[in] input  Pointer to the input data structure.
+ */
+void syslog_input_close(syslog_input_t *input);
+
+/**
+ * Restrict memory-mapped input to the range of lines
+ *
+ * Must be called before reading any data from the input. Line
+ * numbers are counted from the start of the range.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in]     start  Offset of the first line in the range.
+ * @param[in]     end    Offset of the end of the range (offset
+ *                       of the line following the last line
+ *                       in the range or the input size).
+ *
+ * @return 0 on success
+ * @return <0 on error (input is not memory-mapped or invalid range)
+ */
+int syslog_input_set_range(
+	syslog_input_t *input,
+	size_t start,
+	size_t end
+);
+
+/**
+ * Start following of the growing input
+ *
+ * Unterminated last line of the followed input is not read until its
+ * terminator is appended. When end of the input is reached, reading
+ * functions return 0, but reading can be continued after more data
+ * has been appended to the input. Memory-mapped input is read till the
+ * last complete line (or till the end of the range) and then continues
+ * as the stream, so syslog_input_read_chunk() is only usable for the
+ * initial part of the input.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return -ENOTSUP if input is not a regular uncompressed file
+ * @return <0 on other errors
+ */
+int syslog_input_follow(syslog_input_t *input);
+
+/**
+ * Stop following of the input
+ *
+ * Rest of the input is read up to the current end of the input,
+ * including unterminated last line.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_input_follow_end(syslog_input_t *input);
+
+/**
+ * Restart reading of the followed input from the beginning
+ *
+ * Used when followed file has been truncated. All unread data is
+ * discarded and line numbers are counted from the start.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_input_rewind(syslog_input_t *input);
+
+/**
+ * Get input offset of the next unread line
+ *
+ * For compressed input offset is counted in the decompressed data.
+ *
+ * @param[in] input  Pointer to the input data structure.
+ *
+ * @return Input offset
+ */
+off_t syslog_input_tell(const syslog_input_t *input);
+
+/**
+ * Read next line from the syslog input
+ *
+ * Line terminator character is replaced with NULL character, so the
+ * returned line is always NULL-terminated at @p len. Returned line
+ * data is writable and stays valid until the next call of this
+ * function or until the input is closed.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[out]    line   Pointer to the line data.
+ * @param[out]    len    Line length (without terminator).
+ *
+ * @return 1 if line has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+int syslog_input_read_line(
+	syslog_input_t *input,
+	char **line,
+	size_t *len
+);
+
+/**
+ * Read next chunk of lines from the syslog input
+ *
+ * In mmap mode chunk is about #SYSLOG_INPUT_CHUNK_SIZE bytes and points
+ * into the mapping. Chunk data is copied into the chunk own buffer by the
+ * first syslog_input_chunk_read_line() call, so the copying is done by
+ * the thread reading the chunk lines. In streaming mode chunk takes the
+ * whole block buffer of the input. Chunk data stays valid until the next
+ * call of this function for the same chunk or until the input is closed.
+ *
+ * Function must not be mixed with syslog_input_read_line()
+ * for the same input.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in,out] chunk  Pointer to the chunk data structure. Structure
+ *                       must be zero-initialized before first use.
+ *
+ * @return 1 if chunk has been read
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+int syslog_input_read_chunk(
+	syslog_input_t *input,
+	syslog_input_chunk_t *chunk
+);
+
+/**
+ * Count lines in the chunk
+ *
+ * Mapped chunk data is copied into the chunk own buffer first, so lines
+ * are counted in the same data, that is read by the following
+ * syslog_input_chunk_read_line() calls.
+ *
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ *
+ * @return Number of lines in the chunk
+ */
+unsigned int syslog_input_chunk_count_lines(
+	syslog_input_chunk_t *chunk
+);
+
+/**
+ * Read next line from the chunk
+ *
+ * Works the same way as syslog_input_read_line(). Line numbers are
+ * counted from the @ref syslog_input_chunk_t::line_n value, which can
+ * be set by caller before reading the first line.
+ *
+ * @param[in,out] chunk  Pointer to the chunk data structure.
+ * @param[out]    line   Pointer to the line data.
+ * @param[out]    len    Line length (without terminator).
+ *
+ * @return 1 if line has been read
+ * @return 0 on end of chunk
+ * @return <0 on error
+ */
+int syslog_input_chunk_read_line(
+	syslog_input_chunk_t *chunk,
+	char **line,
+	size_t *len
+);
+
+/**
+ * Free resources allocated for the chunk
+ *
+ * @param[in] chunk  Pointer to the chunk data structure.
+ */
+void syslog_input_chunk_free(syslog_input_chunk_t *chunk);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_INPUT_H__ */
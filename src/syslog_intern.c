@@ -0,0 +1,232 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief String interning source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <syslog_fc.h>
+#include <syslog_intern.h>
+
+/** @brief Initial size of the hash table (power of 2) */
+#define SYSLOG_INTERN_HASH_SIZE  256
+
+/**
+ * @brief Arena block
+ */
+typedef struct syslog_intern_block
+{
+	/** Next block */
+	struct syslog_intern_block *next;
+
+	/** Block data */
+	char data[];
+
+} syslog_intern_block_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Compute FNV-1a hash of the string
+ */
+static uint32_t intern_hash(const char *string, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)string;
+	uint32_t hash = 2166136261u;
+
+	while (len--)
+		hash = (hash ^ *p++) * 16777619u;
+
+	return hash;
+}
+
+/**
+ * Resize hash table
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int intern_rehash(syslog_intern_t *intern, uint32_t hash_size)
+{
+	uint32_t *hash = calloc(hash_size, sizeof(uint32_t));
+	uint32_t id;
+	uint32_t i;
+
+	if (!hash)
+		return -ENOMEM;
+
+	for (id = 0; id < intern->strings_n; id++)
+	{
+		i = intern->strings[id].hash & (hash_size - 1);
+		while (hash[i])
+			i = (i + 1) & (hash_size - 1);
+
+		hash[i] = id + 1;
+	}
+
+	intern->size += (size_t)(hash_size - intern->hash_size) * sizeof(uint32_t);
+
+	free(intern->hash);
+	intern->hash = hash;
+	intern->hash_size = hash_size;
+	return 0;
+}
+
+/**
+ * Copy string into the arena
+ *
+ * @return Pointer to the copy or NULL on error
+ */
+static char *intern_copy(syslog_intern_t *intern, const char *string, size_t len)
+{
+	syslog_intern_block_t *block;
+	size_t block_size;
+	char *copy;
+
+	if (len + 1 > intern->block_free)
+	{
+		/* Long strings are stored in the blocks of their own */
+		block_size = (len + 1 > SYSLOG_INTERN_BLOCK_SIZE / 4) ?
+			len + 1 : SYSLOG_INTERN_BLOCK_SIZE;
+
+		block = malloc(sizeof(syslog_intern_block_t) + block_size);
+		if (!block)
+			return NULL;
+
+		block->next = intern->blocks;
+		intern->blocks = block;
+		intern->size += sizeof(syslog_intern_block_t) + block_size;
+
+		if (block_size != len + 1)
+		{
+			intern->block_ptr = block->data;
+			intern->block_free = block_size;
+		}
+		else
+		{
+			memcpy(block->data, string, len);
+			block->data[len] = 0;
+			return block->data;
+		}
+	}
+
+	copy = intern->block_ptr;
+	memcpy(copy, string, len);
+	copy[len] = 0;
+
+	intern->block_ptr += len + 1;
+	intern->block_free -= len + 1;
+	return copy;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void syslog_intern_init(syslog_intern_t *intern, size_t max_size)
+{
+	assert(intern);
+
+	memset(intern, 0, sizeof(syslog_intern_t));
+	intern->max_size = max_size;
+}
+
+void syslog_intern_free(syslog_intern_t *intern)
+{
+	syslog_intern_block_t *block = intern->blocks;
+
+	while (block)
+	{
+		syslog_intern_block_t *next = block->next;
+
+		free(block);
+		block = next;
+	}
+
+	free(intern->strings);
+	free(intern->hash);
+
+	syslog_intern_init(intern, intern->max_size);
+}
+
+int syslog_intern_add(syslog_intern_t *intern, const char *string, size_t len)
+{
+	uint32_t hash = intern_hash(string, len);
+	syslog_intern_string_t *s;
+	uint32_t i;
+	int ret;
+
+	if (intern->hash_size)
+	{
+		for (i = hash & (intern->hash_size - 1); intern->hash[i];
+		     i = (i + 1) & (intern->hash_size - 1))
+		{
+			s = &intern->strings[intern->hash[i] - 1];
+
+			if ((s->hash == hash) && (s->len == len) &&
+			    !memcmp(s->string, string, len))
+				return intern->hash[i] - 1;
+		}
+	}
+
+	/* New string */
+	if (intern->max_size &&
+	    (intern->size + len + 1 + sizeof(syslog_intern_string_t) +
+	     2 * sizeof(uint32_t) > intern->max_size))
+		return -ENOSPC;
+
+	if (intern->strings_n == INT32_MAX)
+		return -ENOSPC;
+
+	if ((intern->strings_n + 1) * 2 > intern->hash_size)
+	{
+		ret = intern_rehash(intern, intern->hash_size ?
+			intern->hash_size * 2 : SYSLOG_INTERN_HASH_SIZE);
+
+		if (ret)
+			return ret;
+	}
+
+	if (intern->strings_n == intern->strings_max)
+	{
+		uint32_t strings_max = intern->strings_max ?
+			intern->strings_max * 2 : SYSLOG_INTERN_HASH_SIZE / 2;
+
+		s = realloc(intern->strings,
+			strings_max * sizeof(syslog_intern_string_t));
+
+		if (!s)
+			return -ENOMEM;
+
+		intern->size += (strings_max - intern->strings_max) *
+			sizeof(syslog_intern_string_t);
+
+		intern->strings = s;
+		intern->strings_max = strings_max;
+	}
+
+	s = &intern->strings[intern->strings_n];
+
+	s->string = intern_copy(intern, string, len);
+	if (!s->string)
+		return -ENOMEM;
+
+	s->len = len;
+	s->hash = hash;
+
+	for (i = hash & (intern->hash_size - 1); intern->hash[i];
+	     i = (i + 1) & (intern->hash_size - 1))
+		;
+
+	intern->hash[i] = ++intern->strings_n;
+	return intern->strings_n - 1;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,128 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief String interning header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_INTERN_H__
+#define __SYSLOG_INTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Interned string
+ */
+typedef struct syslog_intern_string
+{
+	const char *string; /**< NULL-terminated string */
+	size_t len;         /**< String length */
+	uint32_t hash;      /**< String hash */
+
+} syslog_intern_string_t;
+
+struct syslog_intern_block;
+
+/**
+ * @brief String intern table
+ *
+ * Each distinct string is stored once and gets the stable identifier,
+ * identifiers are assigned sequentially from 0. Strings are copied into
+ * the arena blocks of #SYSLOG_INTERN_BLOCK_SIZE bytes, so the pointers
+ * to the interned strings stay valid until the table is freed.
+ */
+typedef struct syslog_intern
+{
+	/** Interned strings by identifiers */
+	syslog_intern_string_t *strings;
+
+	/** Number of interned strings */
+	uint32_t strings_n;
+
+	/** Number of strings that fit into @ref strings array */
+	uint32_t strings_max;
+
+	/** Hash table of the identifiers (identifier + 1, 0 if slot is empty) */
+	uint32_t *hash;
+
+	/** Hash table size (power of 2) */
+	uint32_t hash_size;
+
+	/** Arena blocks list */
+	struct syslog_intern_block *blocks;
+
+	/** Free space of the current arena block */
+	char *block_ptr;
+
+	/** Free space size of the current arena block */
+	size_t block_free;
+
+	/** Memory used by the table */
+	size_t size;
+
+	/** Memory limit (0 if memory is not limited) */
+	size_t max_size;
+
+} syslog_intern_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize string intern table
+ *
+ * @param[out] intern    Pointer to the intern table.
+ * @param[in]  max_size  Memory limit in bytes (0 if memory is not limited).
+ */
+void syslog_intern_init(syslog_intern_t *intern, size_t max_size);
+
+/**
+ * Free all resources allocated for the intern table
+ *
+ * @param[in,out] intern  Pointer to the intern table.
+ */
+void syslog_intern_free(syslog_intern_t *intern);
+
+/**
+ * Get identifier of the string (string is interned if it is new)
+ *
+ * @param[in,out] intern  Pointer to the intern table.
+ * @param[in]     string  String.
+ * @param[in]     len     String length.
+ *
+ * @return String identifier (>= 0)
+ * @return -ENOSPC if string is new and memory limit is reached
+ * @return <0 on other errors
+ */
+int syslog_intern_add(syslog_intern_t *intern, const char *string, size_t len);
+
+/**
+ * Get interned string by identifier
+ *
+ * @param[in] intern  Pointer to the intern table.
+ * @param[in] id      String identifier.
+ *
+ * @return Pointer to the interned string
+ */
+static inline const syslog_intern_string_t *syslog_intern_get(
+	const syslog_intern_t *intern,
+	int id
+)
+{
+	return &intern->strings[id];
+}
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_INTERN_H__ */
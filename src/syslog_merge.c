@@ -0,0 +1,748 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Timestamp ordered merge of multiple inputs source
+ *
+ * Each input has two batches of parsed entries. While entries of one
+ * batch are merged, the other batch is filled with the following entries
+ * of the input (by a worker thread, if there are any). Inputs are kept
+ * in the binary heap ordered by the timestamp of their next entry, and
+ * the main thread outputs the entry from the top of the heap.
+ *
+ * Parsed entries are saved by syslog_entry_save() and reference the line
+ * data. Read lines are valid only till the next read, so they are copied
+ * into the batch line buffer.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <pthread.h>
+
+#include <syslog_fc.h>
+#include <syslog_merge.h>
+
+struct merge_source;
+struct syslog_merge;
+
+/**
+ * @brief Batch of the parsed entries
+ */
+typedef struct merge_batch
+{
+	/** Input of the batch */
+	struct merge_source *source;
+
+	/** Saved states of the parsed entries */
+	syslog_field_state_t *states;
+
+	/** Timestamps of the parsed entries */
+	time_t *times;
+
+	/** Number of the parsed entries */
+	unsigned int entries_n;
+
+	/** Number of the merged entries */
+	unsigned int pos;
+
+	/** Line data buffer */
+	char *data;
+
+	/** Size of the line data in the buffer */
+	size_t data_size;
+
+	/** Line data buffer size */
+	size_t data_max;
+
+	/** Batch is filled */
+	int ready;
+
+	/** Input has ended in this batch */
+	int eof;
+
+	/** Batch fill status */
+	int ret;
+
+} merge_batch_t;
+
+/**
+ * @brief Merged input
+ */
+typedef struct merge_source
+{
+	/** Input data structure */
+	syslog_input_t *input;
+
+	/** Input index */
+	unsigned int index;
+
+	/** Batches of the parsed entries */
+	merge_batch_t batches[2];
+
+	/** Index of the merged batch */
+	unsigned int cur;
+
+	/** Timestamp of the next merged entry */
+	time_t time;
+
+	/** Line read, but not fitted into the previous batch */
+	char *pending;
+
+	/** Length of the @ref pending line */
+	size_t pending_len;
+
+	/** Number of the @ref pending line */
+	unsigned int pending_line_n;
+
+} merge_source_t;
+
+/**
+ * @brief Worker thread data structure
+ */
+typedef struct merge_worker
+{
+	/** Thread */
+	pthread_t thread;
+
+	/** Merge data structure */
+	struct syslog_merge *merge;
+
+	/** Worker own entry structure */
+	syslog_entry_t entry;
+
+} merge_worker_t;
+
+/**
+ * @brief Merge data structure
+ */
+typedef struct syslog_merge
+{
+	/** Inputs */
+	merge_source_t *sources;
+
+	/** Number of the inputs */
+	unsigned int sources_n;
+
+	/** Heap of the inputs with entries to merge */
+	merge_source_t **heap;
+
+	/** Number of the inputs in the heap */
+	unsigned int heap_n;
+
+	/** Output entry (also used for parsing without worker threads) */
+	syslog_entry_t entry;
+
+	/** Worker threads */
+	merge_worker_t *workers;
+
+	/** Number of the worker threads */
+	unsigned int workers_n;
+
+	/** Number of the allocated worker data structures */
+	unsigned int workers_max;
+
+	/** Queue of the batches to fill */
+	merge_batch_t **queue;
+
+	/** Index of the first batch in the queue */
+	unsigned int queue_head;
+
+	/** Number of the batches in the queue */
+	unsigned int queue_n;
+
+	/** Worker threads must exit */
+	int stop;
+
+	/** Queue and batches state mutex */
+	pthread_mutex_t mutex;
+
+	/** Queue and batches state change condition */
+	pthread_cond_t cond;
+
+} syslog_merge_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Copy streamed input line into the batch line buffer
+ *
+ * @param[in,out] batch  Pointer to the batch.
+ * @param[in,out] line   Pointer to the line data.
+ * @param[in]     len    Line length (without terminator).
+ *
+ * @return 0 on success
+ * @return 1 if line does not fit into the batch
+ * @return <0 on error
+ */
+static int merge_copy_line(
+	merge_batch_t *batch,
+	char **line,
+	size_t len
+)
+{
+	if (batch->data_size + len + 1 > batch->data_max)
+	{
+		char *data;
+
+		/* Parsed entries reference the buffer */
+		if (batch->entries_n)
+			return 1;
+
+		batch->data_size = 0;
+
+		if (len + 1 > batch->data_max)
+		{
+			data = realloc(batch->data, len + 1);
+			if (!data)
+				return -ENOMEM;
+
+			batch->data = data;
+			batch->data_max = len + 1;
+		}
+	}
+
+	memcpy(batch->data + batch->data_size, *line, len + 1);
+
+	*line = batch->data + batch->data_size;
+	batch->data_size += len + 1;
+	return 0;
+}
+
+/**
+ * Fill the batch with the following entries of the input
+ *
+ * @param[in,out] batch  Pointer to the batch.
+ * @param[in,out] entry  Pointer to the entry data structure for parsing.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int merge_fill(
+	merge_batch_t *batch,
+	syslog_entry_t *entry
+)
+{
+	merge_source_t *src = batch->source;
+	unsigned int fields_num = entry->fields_num;
+	const syslog_field_t *time_field =
+		syslog_entry_field(entry, SYSLOG_FIELD_ID_TIMESTAMP);
+
+	unsigned int lines_n;
+	unsigned int line_n;
+	size_t len;
+	char *line;
+	int ret;
+
+	batch->entries_n = 0;
+	batch->pos = 0;
+	batch->data_size = 0;
+
+	for (lines_n = 0; lines_n < SYSLOG_MERGE_BATCH_LINES; lines_n++)
+	{
+		if (src->pending)
+		{
+			line   = src->pending;
+			len    = src->pending_len;
+			line_n = src->pending_line_n;
+
+			src->pending = NULL;
+		}
+		else
+		{
+			ret = syslog_input_read_line(src->input, &line, &len);
+			if (ret < 0)
+				return ret;
+
+			if (!ret)
+			{
+				batch->eof = 1;
+				break;
+			}
+
+			line_n = src->input->line_n;
+		}
+
+		/* Line data is valid only till the next read */
+		ret = merge_copy_line(batch, &line, len);
+		if (ret < 0)
+			return ret;
+
+		if (ret)
+		{
+			src->pending        = line;
+			src->pending_len    = len;
+			src->pending_line_n = line_n;
+			break;
+		}
+
+		if (syslog_entry_parse(entry, line_n, line, len))
+			continue;
+
+		syslog_entry_save(entry,
+			batch->states + (size_t)batch->entries_n * fields_num);
+
+		batch->times[batch->entries_n++] = time_field->value.time.unixtime;
+	}
+
+	return 0;
+}
+
+/**
+ * Worker thread function
+ *
+ * @param[in] arg  Pointer to the worker data structure.
+ *
+ * @return NULL
+ */
+static void *merge_worker_thread(void *arg)
+{
+	merge_worker_t *worker = arg;
+	syslog_merge_t *m = worker->merge;
+	merge_batch_t *batch;
+	int ret;
+
+	while (1)
+	{
+		pthread_mutex_lock(&m->mutex);
+
+		while (!m->queue_n && !m->stop)
+			pthread_cond_wait(&m->cond, &m->mutex);
+
+		if (m->stop)
+		{
+			pthread_mutex_unlock(&m->mutex);
+			break;
+		}
+
+		batch = m->queue[m->queue_head];
+		m->queue_head = (m->queue_head + 1) % m->sources_n;
+		m->queue_n--;
+
+		pthread_mutex_unlock(&m->mutex);
+
+		ret = merge_fill(batch, &worker->entry);
+
+		pthread_mutex_lock(&m->mutex);
+
+		batch->ret = ret;
+		batch->ready = 1;
+
+		pthread_cond_broadcast(&m->cond);
+		pthread_mutex_unlock(&m->mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * Request batch filling
+ *
+ * Without worker threads batch is filled when it is needed.
+ *
+ * @param[in,out] m      Pointer to the merge data structure.
+ * @param[in,out] batch  Pointer to the batch.
+ */
+static void merge_request(
+	syslog_merge_t *m,
+	merge_batch_t *batch
+)
+{
+	if (!m->workers_n)
+	{
+		batch->ready = 0;
+		return;
+	}
+
+	pthread_mutex_lock(&m->mutex);
+
+	batch->ready = 0;
+	m->queue[(m->queue_head + m->queue_n) % m->sources_n] = batch;
+	m->queue_n++;
+
+	pthread_cond_broadcast(&m->cond);
+	pthread_mutex_unlock(&m->mutex);
+}
+
+/**
+ * Wait for the requested batch to be filled
+ *
+ * @param[in,out] m      Pointer to the merge data structure.
+ * @param[in,out] batch  Pointer to the batch.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int merge_wait(
+	syslog_merge_t *m,
+	merge_batch_t *batch
+)
+{
+	if (!m->workers_n)
+	{
+		batch->ready = 1;
+		return merge_fill(batch, &m->entry);
+	}
+
+	pthread_mutex_lock(&m->mutex);
+
+	while (!batch->ready)
+		pthread_cond_wait(&m->cond, &m->mutex);
+
+	pthread_mutex_unlock(&m->mutex);
+	return batch->ret;
+}
+
+/**
+ * Advance input to the next entry to merge
+ *
+ * @param[in,out] m    Pointer to the merge data structure.
+ * @param[in,out] src  Pointer to the input.
+ *
+ * @return 1 if input has entry to merge
+ * @return 0 if all entries of the input are merged
+ * @return <0 on error
+ */
+static int merge_next(
+	syslog_merge_t *m,
+	merge_source_t *src
+)
+{
+	merge_batch_t *batch = &src->batches[src->cur];
+	int ret;
+
+	while (batch->pos == batch->entries_n)
+	{
+		if (batch->eof)
+			return 0;
+
+		/* Switch to the batch filled ahead */
+		src->cur ^= 1;
+		batch = &src->batches[src->cur];
+
+		ret = merge_wait(m, batch);
+		if (ret)
+			return ret;
+
+		/* Fill the merged batch ahead */
+		if (!batch->eof)
+			merge_request(m, &src->batches[src->cur ^ 1]);
+	}
+
+	src->time = batch->times[batch->pos];
+	return 1;
+}
+
+/**
+ * Compare inputs by the timestamps of their next entries
+ *
+ * @param[in] a  Pointer to the first input.
+ * @param[in] b  Pointer to the second input.
+ *
+ * @return 1 if entry of the first input must be merged first, 0 otherwise
+ */
+static inline int merge_before(
+	const merge_source_t *a,
+	const merge_source_t *b
+)
+{
+	return (a->time < b->time) ||
+		((a->time == b->time) && (a->index < b->index));
+}
+
+/**
+ * Restore heap order moving the input down from the position
+ *
+ * @param[in,out] m  Pointer to the merge data structure.
+ * @param[in]     i  Input position in the heap.
+ */
+static void merge_heap_down(
+	syslog_merge_t *m,
+	unsigned int i
+)
+{
+	merge_source_t *src = m->heap[i];
+
+	while (1)
+	{
+		unsigned int child = i * 2 + 1;
+
+		if (child >= m->heap_n)
+			break;
+
+		if ((child + 1 < m->heap_n) &&
+		    merge_before(m->heap[child + 1], m->heap[child]))
+			child++;
+
+		if (!merge_before(m->heap[child], src))
+			break;
+
+		m->heap[i] = m->heap[child];
+		i = child;
+	}
+
+	m->heap[i] = src;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Free resources allocated for the merge
+ *
+ * @param[in,out] m  Pointer to the merge data structure.
+ */
+static void merge_free(syslog_merge_t *m)
+{
+	unsigned int i, j;
+
+	pthread_mutex_lock(&m->mutex);
+	m->stop = 1;
+	pthread_cond_broadcast(&m->cond);
+	pthread_mutex_unlock(&m->mutex);
+
+	for (i = 0; i < m->workers_n; i++)
+		pthread_join(m->workers[i].thread, NULL);
+
+	pthread_cond_destroy(&m->cond);
+	pthread_mutex_destroy(&m->mutex);
+
+	for (i = 0; i < m->workers_max; i++)
+		syslog_entry_destroy(&m->workers[i].entry);
+
+	if (m->sources)
+	{
+		for (i = 0; i < m->sources_n; i++)
+		{
+			for (j = 0; j < 2; j++)
+			{
+				free(m->sources[i].batches[j].states);
+				free(m->sources[i].batches[j].times);
+				free(m->sources[i].batches[j].data);
+			}
+		}
+	}
+
+	syslog_entry_destroy(&m->entry);
+
+	free(m->workers);
+	free(m->queue);
+	free(m->heap);
+	free(m->sources);
+}
+
+/**
+ * Allocate resources for the merge
+ *
+ * @param[out] m          Pointer to the merge data structure.
+ * @param[in]  inputs     Array of the inputs.
+ * @param[in]  inputs_n   Number of the inputs.
+ * @param[in]  threads_n  Number of threads.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int merge_init(
+	syslog_merge_t *m,
+	syslog_input_t *inputs,
+	unsigned int inputs_n,
+	unsigned int threads_n
+)
+{
+	unsigned int i, j;
+	unsigned int workers_n = (threads_n > 1) ? threads_n - 1 : 0;
+	int ret;
+
+	memset(m, 0, sizeof(syslog_merge_t));
+
+	pthread_mutex_init(&m->mutex, NULL);
+	pthread_cond_init(&m->cond, NULL);
+
+	ret = syslog_entry_init(&m->entry, config.entry_spec);
+	if (ret)
+	{
+		fprintf(stderr,
+			"Syslog entry initialization failed (%d)\n", ret);
+
+		return ret;
+	}
+
+	m->sources_n = inputs_n;
+	m->sources   = calloc(inputs_n, sizeof(merge_source_t));
+	m->heap      = calloc(inputs_n, sizeof(merge_source_t *));
+	m->queue     = calloc(inputs_n, sizeof(merge_batch_t *));
+	m->workers   = calloc(workers_n ? workers_n : 1, sizeof(merge_worker_t));
+
+	if (!m->sources || !m->heap || !m->queue || !m->workers)
+		return -ENOMEM;
+
+	m->workers_max = workers_n;
+
+	for (i = 0; i < inputs_n; i++)
+	{
+		merge_source_t *src = &m->sources[i];
+
+		src->input = &inputs[i];
+		src->index = i;
+
+		for (j = 0; j < 2; j++)
+		{
+			merge_batch_t *batch = &src->batches[j];
+
+			batch->source = src;
+			batch->states = malloc((size_t)SYSLOG_MERGE_BATCH_LINES *
+				m->entry.fields_num * sizeof(syslog_field_state_t));
+
+			batch->times = malloc(
+				SYSLOG_MERGE_BATCH_LINES * sizeof(time_t));
+
+			if (!batch->states || !batch->times)
+				return -ENOMEM;
+
+			batch->data = malloc(SYSLOG_MERGE_BATCH_SIZE);
+			if (!batch->data)
+				return -ENOMEM;
+
+			batch->data_max = SYSLOG_MERGE_BATCH_SIZE;
+		}
+	}
+
+	for (i = 0; i < workers_n; i++)
+	{
+		m->workers[i].merge = m;
+
+		ret = syslog_entry_init(&m->workers[i].entry, config.entry_spec);
+		if (ret)
+		{
+			fprintf(stderr,
+				"Syslog entry initialization failed (%d)\n", ret);
+
+			return ret;
+		}
+	}
+
+	for (i = 0; i < workers_n; i++)
+	{
+		ret = -pthread_create(&m->workers[i].thread, NULL,
+			merge_worker_thread, &m->workers[i]);
+
+		if (ret)
+		{
+			fprintf(stderr, "Failed to create thread (%d)\n", ret);
+			return ret;
+		}
+
+		/* Created threads must be joined */
+		m->workers_n++;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_merge_convert(
+	syslog_input_t *inputs,
+	unsigned int inputs_n,
+	syslog_output_t *out,
+	unsigned int threads_n,
+	unsigned int *entries_n
+)
+{
+	syslog_merge_t m;
+	unsigned int fields_num;
+	unsigned int i;
+	int ret;
+
+	assert(inputs);
+	assert(out);
+	assert(entries_n);
+
+	ret = merge_init(&m, inputs, inputs_n, threads_n);
+	if (ret)
+	{
+		merge_free(&m);
+		return ret;
+	}
+
+	if (!syslog_entry_field(&m.entry, SYSLOG_FIELD_ID_TIMESTAMP))
+	{
+		merge_free(&m);
+		return -EINVAL;
+	}
+
+	fields_num = m.entry.fields_num;
+
+	/* Fill the first batches of all inputs */
+	for (i = 0; i < inputs_n; i++)
+		merge_request(&m, &m.sources[i].batches[1]);
+
+	for (i = 0; i < inputs_n; i++)
+	{
+		ret = merge_next(&m, &m.sources[i]);
+		if (ret < 0)
+			goto out;
+
+		if (ret)
+		{
+			unsigned int j = m.heap_n++;
+
+			/* Move the input up to its heap position */
+			while (j && merge_before(&m.sources[i], m.heap[(j - 1) / 2]))
+			{
+				m.heap[j] = m.heap[(j - 1) / 2];
+				j = (j - 1) / 2;
+			}
+
+			m.heap[j] = &m.sources[i];
+		}
+	}
+
+	ret = 0;
+
+	while (m.heap_n)
+	{
+		merge_source_t *src = m.heap[0];
+		merge_batch_t *batch = &src->batches[src->cur];
+
+		syslog_entry_restore(&m.entry,
+			batch->states + (size_t)batch->pos * fields_num);
+
+		batch->pos++;
+
+		m.entry.num = ++(*entries_n);
+
+		if (config.output_fmt->fn_output_entry)
+			config.output_fmt->fn_output_entry(out, &m.entry);
+
+		if (out->error)
+		{
+			ret = out->error;
+			break;
+		}
+
+		ret = merge_next(&m, src);
+		if (ret < 0)
+			break;
+
+		/* Input without entries is replaced by the last heap input */
+		if (!ret)
+			m.heap[0] = m.heap[--m.heap_n];
+
+		if (m.heap_n)
+			merge_heap_down(&m, 0);
+
+		ret = 0;
+	}
+
+out:
+	merge_free(&m);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,58 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Timestamp ordered merge of multiple inputs header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_MERGE_H__
+#define __SYSLOG_MERGE_H__
+
+#include <syslog_input.h>
+#include <syslog_output.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Convert entries of multiple inputs merged by the timestamp
+ *
+ * Each input is expected to be time-ordered. Entries of all inputs are
+ * output in the timestamp order (entries with equal timestamps are
+ * output in the inputs order). Inputs are parsed ahead by batches of
+ * up to #SYSLOG_MERGE_BATCH_LINES lines, so memory usage does not
+ * depend on the input sizes. If @p threads_n is greater than 1, batches
+ * are parsed by the worker threads while the previous batches are merged.
+ *
+ * Entry format specification must contain timestamp field. Output start
+ * and end callbacks are not called by this function.
+ *
+ * @param[in,out] inputs     Array of the inputs.
+ * @param[in]     inputs_n   Number of the inputs.
+ * @param[in,out] out        Pointer to the output structure.
+ * @param[in]     threads_n  Number of threads.
+ * @param[in,out] entries_n  Number of the previously converted entries
+ *                           (updated by the function).
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_merge_convert(
+	syslog_input_t *inputs,
+	unsigned int inputs_n,
+	syslog_output_t *out,
+	unsigned int threads_n,
+	unsigned int *entries_n
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_MERGE_H__ */
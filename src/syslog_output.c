@@ -0,0 +1,300 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Buffered output writer source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <syslog_fc.h>
+#include <syslog_output.h>
+
+const char syslog_output_escape_stop[] = "";
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Write data vector into the output file descriptor
+ *
+ * Partial writes and interrupted calls are retried.
+ *
+ * @param[in,out] out     Pointer to the output data structure.
+ * @param[in,out] iov     Data vector (modified).
+ * @param[in]     iov_n   Number of items in the data vector.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int output_writev(syslog_output_t *out, struct iovec *iov, int iov_n)
+{
+	while (iov_n)
+	{
+		ssize_t written = writev(out->fd, iov, iov_n);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			out->error = -errno;
+			return out->error;
+		}
+
+		while (iov_n && ((size_t)written >= iov->iov_len))
+		{
+			written -= iov->iov_len;
+			iov++;
+			iov_n--;
+		}
+
+		if (iov_n)
+		{
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_output_open(syslog_output_t *out, int fd)
+{
+	assert(out);
+
+	out->fd       = fd;
+	out->size     = 0;
+	out->error    = 0;
+	out->fmt_data = NULL;
+	out->capacity = SYSLOG_OUTPUT_BUFFER_SIZE;
+	out->buffer   = malloc(out->capacity);
+
+	if (!out->buffer)
+	{
+		out->capacity = 0;
+		out->error = -ENOMEM;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+int syslog_output_flush(syslog_output_t *out)
+{
+	struct iovec iov;
+
+	assert(out);
+
+	if (out->error || (out->fd < 0) || !out->size)
+		return out->error;
+
+	iov.iov_base = out->buffer;
+	iov.iov_len  = out->size;
+
+	out->size = 0;
+	return output_writev(out, &iov, 1);
+}
+
+int syslog_output_close(syslog_output_t *out)
+{
+	int ret;
+
+	assert(out);
+
+	ret = syslog_output_flush(out);
+
+	free(out->buffer);
+	out->buffer   = NULL;
+	out->size     = 0;
+	out->capacity = 0;
+
+	return ret;
+}
+
+int syslog_output_reserve(syslog_output_t *out, size_t len)
+{
+	assert(out);
+
+	if (out->error)
+		return out->error;
+
+	if (out->capacity - out->size >= len)
+		return 0;
+
+	if (out->fd >= 0)
+	{
+		if (syslog_output_flush(out))
+			return out->error;
+
+		if (out->capacity >= len)
+			return 0;
+	}
+
+	/* Grow buffer */
+	{
+		size_t capacity = out->capacity ? out->capacity : 1;
+		char *buffer;
+
+		while (capacity - out->size < len)
+			capacity *= 2;
+
+		buffer = realloc(out->buffer, capacity);
+		if (!buffer)
+		{
+			out->error = -ENOMEM;
+			return out->error;
+		}
+
+		out->buffer   = buffer;
+		out->capacity = capacity;
+	}
+
+	return 0;
+}
+
+void syslog_output_write(syslog_output_t *out, const void *data, size_t len)
+{
+	if (len > out->capacity - out->size)
+	{
+		if (out->error)
+			return;
+
+		if ((out->fd >= 0) && (len >= out->capacity / 2))
+		{
+			/* Write buffered and new data without copying */
+			struct iovec iov[2];
+
+			iov[0].iov_base = out->buffer;
+			iov[0].iov_len  = out->size;
+			iov[1].iov_base = (void *)data;
+			iov[1].iov_len  = len;
+
+			out->size = 0;
+			output_writev(out, iov, 2);
+			return;
+		}
+
+		if (syslog_output_reserve(out, len))
+			return;
+	}
+
+	memcpy(out->buffer + out->size, data, len);
+	out->size += len;
+}
+
+void syslog_output_uint(syslog_output_t *out, unsigned long value)
+{
+	char buffer[24];
+	char *p = buffer + sizeof(buffer);
+
+	do
+	{
+		*(--p) = '0' + value % 10;
+		value /= 10;
+	}
+	while (value);
+
+	syslog_output_write(out, p, buffer + sizeof(buffer) - p);
+}
+
+void syslog_output_int(syslog_output_t *out, long value)
+{
+	if (value < 0)
+	{
+		syslog_output_putc(out, '-');
+		syslog_output_uint(out, -(unsigned long)value);
+	}
+	else
+		syslog_output_uint(out, value);
+}
+
+const char *syslog_output_escaped(
+	syslog_output_t *out,
+	const char *string,
+	const syslog_output_escapes_t escapes
+)
+{
+	const char *p = string;
+	const char *span = string;
+
+	while (*(p = syslog_scan_escape(p)))
+	{
+		const char *escape = escapes[(unsigned char)*p];
+
+		if (!escape)
+		{
+			p++;
+			continue;
+		}
+
+		syslog_output_write(out, span, p - span);
+
+		if (escape == SYSLOG_OUTPUT_ESCAPE_STOP)
+			return p;
+
+		syslog_output_puts(out, escape);
+		span = ++p;
+	}
+
+	syslog_output_write(out, span, p - span);
+	return p;
+}
+
+size_t syslog_output_utf8_valid(const char *string, size_t len)
+{
+	const unsigned char *s = (const unsigned char *)string;
+	const unsigned char *end = s + len;
+	size_t n;
+
+	while (s < end)
+	{
+		/* ASCII characters */
+		if (*s < 0x80)
+		{
+			s++;
+			continue;
+		}
+
+		if ((s[0] >= 0xc2) && (s[0] <= 0xdf))
+			n = 2;
+		else if ((s[0] & 0xf0) == 0xe0)
+			n = 3;
+		else if ((s[0] >= 0xf0) && (s[0] <= 0xf4))
+			n = 4;
+		else
+			break;
+
+		if ((size_t)(end - s) < n)
+			break;
+
+		if (((s[1] & 0xc0) != 0x80) ||
+		    ((n > 2) && ((s[2] & 0xc0) != 0x80)) ||
+		    ((n > 3) && ((s[3] & 0xc0) != 0x80)))
+			break;
+
+		/* Overlong sequences, surrogates and code points above U+10FFFF */
+		if (((s[0] == 0xe0) && (s[1] < 0xa0)) ||
+		    ((s[0] == 0xed) && (s[1] > 0x9f)) ||
+		    ((s[0] == 0xf0) && (s[1] < 0x90)) ||
+		    ((s[0] == 0xf4) && (s[1] > 0x8f)))
+			break;
+
+		s += n;
+	}
+
+	return s - (const unsigned char *)string;
+}
+
+/* ----------------------------------------------------------------------- */
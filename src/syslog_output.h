@@ -0,0 +1,207 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Buffered output writer header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_OUTPUT_H__
+#define __SYSLOG_OUTPUT_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <syslog_scan.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Buffered output writer data structure
+ *
+ * Output data is collected into the large contiguous buffer. File
+ * descriptor outputs flush the buffer with write()/writev() when it
+ * is full. Memory outputs (file descriptor < 0) grow the buffer
+ * instead, so the caller can take the collected data.
+ *
+ * Once an error has occurred, all subsequent output is discarded
+ * and the error is reported by syslog_output_flush() and
+ * syslog_output_close().
+ */
+typedef struct syslog_output
+{
+	/** Output file descriptor (<0 for memory output) */
+	int fd;
+
+	/** Output buffer */
+	char *buffer;
+
+	/** Number of bytes in the output buffer */
+	size_t size;
+
+	/** Output buffer capacity */
+	size_t capacity;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+	/** Output format data of the worker output (NULL if not used) */
+	void *fmt_data;
+
+} syslog_output_t;
+
+/**
+ * @brief Character escapes table
+ *
+ * Table is indexed by the unsigned character value. NULL entry means
+ * that character is output as is, other entries are the replacement
+ * strings. Special entry #SYSLOG_OUTPUT_ESCAPE_STOP stops the
+ * escaped output at the character.
+ *
+ * Only control characters and #SYSLOG_SCAN_ESCAPE_CHARS characters
+ * can be escaped, other entries are ignored.
+ */
+typedef const char *syslog_output_escapes_t[256];
+
+/** @brief Escapes table entry stopping the escaped output */
+#define SYSLOG_OUTPUT_ESCAPE_STOP  (syslog_output_escape_stop)
+
+extern const char syslog_output_escape_stop[];
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Open buffered output
+ *
+ * @param[out] out Pointer to the output data structure.
+ * @param[in]  fd  Output file descriptor or -1 for memory output.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_output_open(syslog_output_t *out, int fd);
+
+/**
+ * Flush buffered output data into the file descriptor
+ *
+ * Does nothing for memory output.
+ *
+ * @param[in,out] out Pointer to the output data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_output_flush(syslog_output_t *out);
+
+/**
+ * Flush and close buffered output
+ *
+ * Output buffer is freed. The file descriptor is not closed.
+ *
+ * @param[in,out] out Pointer to the output data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_output_close(syslog_output_t *out);
+
+/**
+ * Make room for the data in the output buffer
+ *
+ * @param[in,out] out Pointer to the output data structure.
+ * @param[in]     len Required number of free bytes.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_output_reserve(syslog_output_t *out, size_t len);
+
+/**
+ * Append bytes to the output
+ *
+ * Large blocks are written directly together with the buffered data
+ * by a single writev() call.
+ *
+ * @param[in,out] out  Pointer to the output data structure.
+ * @param[in]     data Pointer to the data.
+ * @param[in]     len  Data length in bytes.
+ */
+void syslog_output_write(syslog_output_t *out, const void *data, size_t len);
+
+/**
+ * Append signed integer in decimal notation to the output
+ *
+ * @param[in,out] out   Pointer to the output data structure.
+ * @param[in]     value Value.
+ */
+void syslog_output_int(syslog_output_t *out, long value);
+
+/**
+ * Append unsigned integer in decimal notation to the output
+ *
+ * @param[in,out] out   Pointer to the output data structure.
+ * @param[in]     value Value.
+ */
+void syslog_output_uint(syslog_output_t *out, unsigned long value);
+
+/**
+ * Append escaped string to the output
+ *
+ * @param[in,out] out     Pointer to the output data structure.
+ * @param[in]     string  NULL-terminated string.
+ * @param[in]     escapes Character escapes table.
+ *
+ * @return Pointer to the terminating NULL character or to the character
+ *         with #SYSLOG_OUTPUT_ESCAPE_STOP entry in the @p escapes table
+ */
+const char *syslog_output_escaped(
+	syslog_output_t *out,
+	const char *string,
+	const syslog_output_escapes_t escapes
+);
+
+/**
+ * Get length of the valid UTF-8 prefix of the string
+ *
+ * @param[in] string Pointer to the string.
+ * @param[in] len    String length in bytes.
+ *
+ * @return Length of the longest prefix of the string, which is a valid
+ *         UTF-8 sequence (@p len if the whole string is valid)
+ */
+size_t syslog_output_utf8_valid(const char *string, size_t len);
+
+/**
+ * Append character to the output
+ *
+ * @param[in,out] out Pointer to the output data structure.
+ * @param[in]     c   Character.
+ */
+static inline void syslog_output_putc(syslog_output_t *out, char c)
+{
+	if ((out->size < out->capacity) || !syslog_output_reserve(out, 1))
+		out->buffer[out->size++] = c;
+}
+
+/**
+ * Append NULL-terminated string to the output
+ *
+ * @param[in,out] out    Pointer to the output data structure.
+ * @param[in]     string NULL-terminated string.
+ */
+static inline void syslog_output_puts(syslog_output_t *out, const char *string)
+{
+	syslog_output_write(out, string, strlen(string));
+}
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_OUTPUT_H__ */
@@ -0,0 +1,180 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Vectorized string scanners source
+ *
+ * Vectorized scanners load aligned blocks only. Aligned block
+ * never crosses the page boundary, so reading the block that contains
+ * terminating NULL character is safe even if the block extends
+ * past the end of the string.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <syslog_scan.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SYSLOG_SCAN_X86
+#include <immintrin.h>
+#endif
+
+/** @brief Do not instrument function memory accesses by sanitizers */
+#if defined(__SANITIZE_ADDRESS__)
+#define SCAN_NO_SANITIZE  __attribute__((no_sanitize_address))
+#else
+#define SCAN_NO_SANITIZE
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Scalar escape scanner
+ *
+ * @param[in] string NULL-terminated string.
+ *
+ * @return Pointer to the first character that may need escaping
+ */
+static const char *scan_escape_scalar(const char *string)
+{
+	const unsigned char *p = (const unsigned char *)string;
+
+	while ((*p >= 0x20) && !strchr(SYSLOG_SCAN_ESCAPE_CHARS, *p))
+		p++;
+
+	return (const char *)p;
+}
+
+#ifdef SYSLOG_SCAN_X86
+
+/**
+ * SSE2 escape scanner
+ *
+ * @param[in] string NULL-terminated string.
+ *
+ * @return Pointer to the first character that may need escaping
+ */
+__attribute__((target("sse2"))) SCAN_NO_SANITIZE
+static const char *scan_escape_sse2(const char *string)
+{
+	const char *p = (const char *)((uintptr_t)string & ~(uintptr_t)15);
+	unsigned int skip = string - p;
+
+	/* Signed comparison of (c ^ 0x80) is unsigned comparison of c */
+	const __m128i sign   = _mm_set1_epi8((char)0x80);
+	const __m128i ctrl   = _mm_set1_epi8((char)(0x20 ^ 0x80));
+	const __m128i quot   = _mm_set1_epi8('"');
+	const __m128i bslash = _mm_set1_epi8('\\');
+	const __m128i amp    = _mm_set1_epi8('&');
+	const __m128i lt     = _mm_set1_epi8('<');
+	const __m128i gt     = _mm_set1_epi8('>');
+
+	while (1)
+	{
+		__m128i v = _mm_load_si128((const __m128i *)p);
+		__m128i m;
+		unsigned int mask;
+
+		m = _mm_cmplt_epi8(_mm_xor_si128(v, sign), ctrl);
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, quot));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, bslash));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, amp));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, lt));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, gt));
+
+		mask = (unsigned int)_mm_movemask_epi8(m) >> skip << skip;
+		if (mask)
+			return p + __builtin_ctz(mask);
+
+		skip = 0;
+		p += 16;
+	}
+}
+
+/**
+ * AVX2 escape scanner
+ *
+ * @param[in] string NULL-terminated string.
+ *
+ * @return Pointer to the first character that may need escaping
+ */
+__attribute__((target("avx2"))) SCAN_NO_SANITIZE
+static const char *scan_escape_avx2(const char *string)
+{
+	const char *p = (const char *)((uintptr_t)string & ~(uintptr_t)31);
+	unsigned int skip = string - p;
+
+	/* Signed comparison of (c ^ 0x80) is unsigned comparison of c */
+	const __m256i sign   = _mm256_set1_epi8((char)0x80);
+	const __m256i ctrl   = _mm256_set1_epi8((char)(0x20 ^ 0x80));
+	const __m256i quot   = _mm256_set1_epi8('"');
+	const __m256i bslash = _mm256_set1_epi8('\\');
+	const __m256i amp    = _mm256_set1_epi8('&');
+	const __m256i lt     = _mm256_set1_epi8('<');
+	const __m256i gt     = _mm256_set1_epi8('>');
+
+	while (1)
+	{
+		__m256i v = _mm256_load_si256((const __m256i *)p);
+		__m256i m;
+		uint64_t mask;
+
+		m = _mm256_cmpgt_epi8(ctrl, _mm256_xor_si256(v, sign));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, quot));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, bslash));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, amp));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, lt));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, gt));
+
+		mask = (uint64_t)(uint32_t)_mm256_movemask_epi8(m) >> skip << skip;
+		if (mask)
+			return p + __builtin_ctzll(mask);
+
+		skip = 0;
+		p += 32;
+	}
+}
+
+#endif /* SYSLOG_SCAN_X86 */
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Select escape scanner implementation and scan the string
+ *
+ * @param[in] string NULL-terminated string.
+ *
+ * @return Pointer to the first character that may need escaping
+ */
+static const char *scan_escape_select(const char *string)
+{
+	syslog_scan_fn_t fn = scan_escape_scalar;
+
+#ifdef SYSLOG_SCAN_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		fn = scan_escape_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		fn = scan_escape_sse2;
+#endif
+
+	/* All threads select the same implementation */
+	__atomic_store_n(&syslog_scan_escape, fn, __ATOMIC_RELAXED);
+
+	return fn(string);
+}
+
+syslog_scan_fn_t syslog_scan_escape = scan_escape_select;
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,50 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Vectorized string scanners header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_SCAN_H__
+#define __SYSLOG_SCAN_H__
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Characters (besides control characters) that may need escaping
+ *
+ * Control characters (0x00-0x1f) always stop the escape scanner.
+ */
+#define SYSLOG_SCAN_ESCAPE_CHARS  "\"\\&<>"
+
+/**
+ * @brief Escape scanner function type
+ *
+ * @param[in] string NULL-terminated string.
+ *
+ * @return Pointer to the first control character (including
+ *         terminating NULL character) or one of the
+ *         #SYSLOG_SCAN_ESCAPE_CHARS characters in the @p string
+ */
+typedef const char *(*syslog_scan_fn_t)(const char *string);
+
+/**
+ * @brief Escape scanner
+ *
+ * Implementation (AVX2, SSE2 or scalar) is selected at the first call
+ * according to the CPU features.
+ */
+extern syslog_scan_fn_t syslog_scan_escape;
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_SCAN_H__ */
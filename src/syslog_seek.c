@@ -0,0 +1,440 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Timestamp seek source
+ *
+ * Syslog files are mostly time-ordered, so the lines of the requested
+ * time range are found by the binary search over the byte offsets.
+ * Each probe resyncs to the start of the next line and parses only
+ * the timestamp of the first parsable line. Timestamps of all probed
+ * lines are kept to check the order of the input afterwards. The end of
+ * the range is found by the scan of the lines from the found start,
+ * which also checks that their timestamps are ordered, and the lines
+ * around the range bounds are checked to be out of the range.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <syslog_fc.h>
+#include <syslog_seek.h>
+
+/** @brief Maximum number of the kept probes */
+#define SEEK_SAMPLES_MAX  256
+
+/** @brief Number of the evenly spaced probes to check the order */
+#define SEEK_ORDER_PROBES  32
+
+/**
+ * @brief Probed line
+ */
+typedef struct seek_sample
+{
+	size_t offset;  /**< Line offset */
+	time_t time;    /**< Line timestamp */
+} seek_sample_t;
+
+/**
+ * @brief Seek state
+ */
+typedef struct seek_state
+{
+	/** Input data structure */
+	syslog_input_t *input;
+
+	/** Entry data structure */
+	syslog_entry_t *entry;
+
+	/** Line copy buffer (parser modifies the line data) */
+	char *line;
+
+	/** Probed lines */
+	seek_sample_t samples[SEEK_SAMPLES_MAX];
+
+	/** Number of the probed lines */
+	unsigned int samples_n;
+
+} seek_state_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Resync offset to the start of the next line (if offset points into
+ * the middle of the line)
+ *
+ * @param[in] seek    Pointer to the seek state.
+ * @param[in] offset  Offset.
+ *
+ * @return Offset of the line start
+ */
+static size_t seek_line_start(const seek_state_t *seek, size_t offset)
+{
+	const char *map = seek->input->map;
+	size_t end = seek->input->map_end;
+	const char *eol;
+
+	if (offset && (map[offset - 1] != '\n'))
+	{
+		eol = memchr(map + offset, '\n', end - offset);
+		offset = eol ? (size_t)(eol - map) + 1 : end;
+	}
+
+	return offset;
+}
+
+/**
+ * Parse timestamp of the line
+ *
+ * @param[in,out] seek    Pointer to the seek state.
+ * @param[in]     offset  Line offset.
+ * @param[out]    next    Offset of the next line.
+ * @param[out]    time    Line timestamp.
+ *
+ * @return 1 if timestamp has been parsed, 0 otherwise
+ */
+static int seek_line_time(
+	seek_state_t *seek,
+	size_t offset,
+	size_t *next,
+	time_t *time
+)
+{
+	const char *map = seek->input->map;
+	size_t end = seek->input->map_end;
+	const char *eol;
+	size_t len;
+
+	eol = memchr(map + offset, '\n', end - offset);
+	*next = eol ? (size_t)(eol - map) + 1 : end;
+	len = (eol ? (size_t)(eol - map) : end) - offset;
+
+	if (len > SYSLOG_MAX_LINE_SIZE)
+		len = SYSLOG_MAX_LINE_SIZE;
+
+	memcpy(seek->line, map + offset, len);
+	seek->line[len] = '\0';
+
+	return !syslog_entry_parse_time(seek->entry, seek->line, len, time);
+}
+
+/**
+ * Find the first line with parsable timestamp starting at or after
+ * the offset
+ *
+ * @param[in,out] seek        Pointer to the seek state.
+ * @param[in]     offset      Offset to start from (may point into
+ *                            the middle of the line).
+ * @param[in]     limit       Offset to stop at (lines starting at or
+ *                            after the offset are not probed).
+ * @param[out]    line_start  Offset of the found line. If line is not
+ *                            found, offset of the first line starting
+ *                            at or after the @p offset (or @p limit).
+ * @param[out]    line_next   Offset of the line following the found line.
+ * @param[out]    time        Timestamp of the found line.
+ *
+ * @return 1 if line has been found, 0 otherwise
+ */
+static int seek_probe(
+	seek_state_t *seek,
+	size_t offset,
+	size_t limit,
+	size_t *line_start,
+	size_t *line_next,
+	time_t *time
+)
+{
+	size_t next;
+
+	offset = seek_line_start(seek, offset);
+	*line_start = (offset < limit) ? offset : limit;
+
+	while (offset < limit)
+	{
+		if (seek_line_time(seek, offset, &next, time))
+		{
+			if (seek->samples_n < SEEK_SAMPLES_MAX)
+			{
+				seek->samples[seek->samples_n].offset = offset;
+				seek->samples[seek->samples_n].time   = *time;
+				seek->samples_n++;
+			}
+
+			*line_start = offset;
+			*line_next  = next;
+			return 1;
+		}
+
+		offset = next;
+	}
+
+	return 0;
+}
+
+/**
+ * Binary search input for the bound of the lines with timestamp
+ * before the target time
+ *
+ * Assuming the input is time-ordered, all lines before the @p lo
+ * offset have timestamps before the @p target, and all lines
+ * at and after the @p hi offset have timestamps not before
+ * the @p target (or have no parsable timestamp).
+ *
+ * @param[in,out] seek    Pointer to the seek state.
+ * @param[in]     target  Target time.
+ * @param[out]    lo      Lower bound line offset.
+ * @param[out]    hi      Upper bound line offset.
+ */
+static void seek_bound(
+	seek_state_t *seek,
+	time_t target,
+	size_t *lo,
+	size_t *hi
+)
+{
+	*lo = seek->input->map_offset;
+	*hi = seek->input->map_end;
+
+	while (*hi - *lo > SYSLOG_SEEK_LINEAR_SIZE)
+	{
+		size_t mid = *lo + (*hi - *lo) / 2;
+		size_t start;
+		size_t next;
+		time_t time;
+
+		if (!seek_probe(seek, mid, *hi, &start, &next, &time))
+		{
+			/* No parsable lines in the upper half */
+			if (start >= *hi)
+				break;
+
+			*hi = start;
+		}
+		else if (time < target)
+			*lo = next;
+		else
+			*hi = start;
+	}
+}
+
+/**
+ * Compare probed lines by the offset (qsort() callback)
+ */
+static int seek_sample_cmp(const void *a, const void *b)
+{
+	const seek_sample_t *sa = a;
+	const seek_sample_t *sb = b;
+
+	return (sa->offset > sb->offset) - (sa->offset < sb->offset);
+}
+
+/**
+ * Check that probed lines are time-ordered
+ *
+ * @param[in,out] seek  Pointer to the seek state.
+ *
+ * @return 1 if lines are ordered, 0 otherwise
+ */
+static int seek_check_order(seek_state_t *seek)
+{
+	unsigned int i;
+
+	qsort(seek->samples, seek->samples_n,
+		sizeof(seek_sample_t), seek_sample_cmp);
+
+	for (i = 1; i < seek->samples_n; i++)
+	{
+		if (seek->samples[i].time <
+		    seek->samples[i - 1].time - SYSLOG_SEEK_TOLERANCE)
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Check that lines of the input part skipped by the seek do not match
+ * the time range filter
+ *
+ * @param[in,out] seek   Pointer to the seek state.
+ * @param[in]     start  Start offset of the checked lines (may point
+ *                       into the middle of the line).
+ * @param[in]     end    End offset of the checked lines.
+ *
+ * @return 1 if lines do not match the time range, 0 otherwise
+ */
+static int seek_check_skipped(
+	seek_state_t *seek,
+	size_t start,
+	size_t end
+)
+{
+	size_t offset = seek_line_start(seek, start);
+	size_t next;
+	time_t time;
+
+	for (; offset < end; offset = next)
+	{
+		if (!seek_line_time(seek, offset, &next, &time))
+			continue;
+
+		if ((config.filter.flags & SYSLOG_FILTER_SINCE) &&
+		    (time < config.filter.since))
+			continue;
+
+		if ((config.filter.flags & SYSLOG_FILTER_UNTIL) &&
+		    (time >= config.filter.until))
+			continue;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Find the end of the range by the scan of the lines from the range
+ * start and check that their timestamps are ordered
+ *
+ * Range ends at the first line with timestamp at or after the --until
+ * time (extended by #SYSLOG_SEEK_TOLERANCE seconds). Lines within
+ * #SYSLOG_SEEK_CHECK_SIZE bytes after the range end are checked too.
+ *
+ * @param[in,out] seek   Pointer to the seek state.
+ * @param[in]     start  Range start offset.
+ * @param[in]     limit  Input end offset.
+ * @param[out]    end    Range end offset.
+ *
+ * @return 1 if timestamps are ordered, 0 otherwise
+ */
+static int seek_scan_range(
+	seek_state_t *seek,
+	size_t start,
+	size_t limit,
+	size_t *end
+)
+{
+	size_t check_end = limit;
+	size_t offset = start;
+	time_t last = 0;
+	int last_set = 0;
+	size_t next;
+	time_t time;
+
+	*end = limit;
+
+	for (; (offset < limit) && (offset < check_end); offset = next)
+	{
+		if (!seek_line_time(seek, offset, &next, &time))
+			continue;
+
+		if (last_set && (time < last - SYSLOG_SEEK_TOLERANCE))
+			return 0;
+
+		if (!last_set || (time > last))
+			last = time;
+
+		last_set = 1;
+
+		if ((config.filter.flags & SYSLOG_FILTER_UNTIL) &&
+		    (*end == limit) &&
+		    (time >= config.filter.until + SYSLOG_SEEK_TOLERANCE))
+		{
+			*end = offset;
+
+			if (limit - offset > SYSLOG_SEEK_CHECK_SIZE)
+				check_end = offset + SYSLOG_SEEK_CHECK_SIZE;
+		}
+	}
+
+	return 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_seek_time_range(
+	syslog_input_t *input,
+	syslog_entry_t *entry
+)
+{
+	seek_state_t *seek;
+	size_t input_start = input->map_offset;
+	size_t input_end = input->map_end;
+	size_t start = input_start;
+	size_t end = input_end;
+	size_t check_start;
+	size_t lo, hi, next;
+	time_t time;
+	int ret = 0;
+	int i;
+
+	assert(input);
+	assert(entry);
+
+	if (!input->map ||
+	    !(config.filter.flags & (SYSLOG_FILTER_SINCE | SYSLOG_FILTER_UNTIL)))
+		return 0;
+
+	seek = malloc(sizeof(seek_state_t));
+	if (!seek)
+		return -ENOMEM;
+
+	seek->input     = input;
+	seek->entry     = entry;
+	seek->samples_n = 0;
+	seek->line      = malloc(SYSLOG_MAX_LINE_SIZE + 1);
+
+	if (!seek->line)
+	{
+		free(seek);
+		return -ENOMEM;
+	}
+
+	/* Probe evenly spaced lines and the last line to check the order */
+	for (i = 0; i < SEEK_ORDER_PROBES; i++)
+	{
+		size_t step = (end - start) / SEEK_ORDER_PROBES;
+
+		seek_probe(seek, start + step * i,
+			(i + 1 < SEEK_ORDER_PROBES) ? start + step * (i + 1) : end,
+			&lo, &next, &time);
+	}
+
+	if (end - start > SYSLOG_MAX_LINE_SIZE)
+		seek_probe(seek, end - SYSLOG_MAX_LINE_SIZE, end, &lo, &next, &time);
+
+	if (config.filter.flags & SYSLOG_FILTER_SINCE)
+	{
+		seek_bound(seek, config.filter.since - SYSLOG_SEEK_TOLERANCE,
+			&lo, &hi);
+
+		start = lo;
+	}
+
+	/* Lines just before the found range must not match */
+	check_start = (start - input_start > SYSLOG_SEEK_CHECK_SIZE)
+		? start - SYSLOG_SEEK_CHECK_SIZE : input_start;
+
+	if (!seek_check_order(seek) ||
+	    !seek_check_skipped(seek, check_start, start) ||
+	    !seek_scan_range(seek, start, input_end, &end))
+	{
+		fprintf(stderr,
+			"Input timestamps are not ordered, "
+			"reading the whole input\n");
+	}
+	else
+		ret = syslog_input_set_range(input, start, end);
+
+	free(seek->line);
+	free(seek);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
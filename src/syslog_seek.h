@@ -0,0 +1,67 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Timestamp seek header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_SEEK_H__
+#define __SYSLOG_SEEK_H__
+
+#include <syslog_input.h>
+#include <syslog_entry.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Allowed backward timestamp step (in seconds) between
+ *        the lines of the time-ordered input
+ */
+#define SYSLOG_SEEK_TOLERANCE  60
+
+/** @brief Input range size to stop the binary search at */
+#define SYSLOG_SEEK_LINEAR_SIZE  (64 * 1024)
+
+/** @brief Size of the input parts before and after the found range,
+ *         which are checked to have no lines in the time range */
+#define SYSLOG_SEEK_CHECK_SIZE  (1024 * 1024)
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Restrict memory-mapped input to the lines that may match the time
+ * range filter (see @ref config_t::filter)
+ *
+ * Input is binary searched by the byte offset for the range start, the
+ * range end is found by the scan of the lines from the range start.
+ * Range is extended by #SYSLOG_SEEK_TOLERANCE seconds on both sides,
+ * the time range filter is still applied to the lines in the range.
+ * If probed or scanned timestamps are not ordered or if there are lines
+ * in the time range within #SYSLOG_SEEK_CHECK_SIZE bytes before the
+ * found range, input is left unrestricted and the warning is printed.
+ * Nothing is done for the streamed inputs.
+ *
+ * @param[in,out] input  Pointer to the input data structure.
+ * @param[in,out] entry  Pointer to the entry data structure (used
+ *                       for parsing timestamps only).
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_seek_time_range(
+	syslog_input_t *input,
+	syslog_entry_t *entry
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_SEEK_H__ */
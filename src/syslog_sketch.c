@@ -0,0 +1,424 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Streaming summaries (sketches) source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <math.h>
+
+#include <syslog_fc.h>
+#include <syslog_sketch.h>
+
+/** @brief Space-Saving hash table size mask */
+#define SYSLOG_TOPK_TABLE_MASK  (SYSLOG_TOPK_CAPACITY * 2 - 1)
+
+/* ----------------------------------------------------------------------- */
+
+uint64_t syslog_sketch_hash(const char *string, size_t len)
+{
+	const unsigned char *p = (const unsigned char *)string;
+	uint64_t hash = 14695981039346656037ull;
+
+	/* FNV-1a with the MurmurHash3 finalizer for the better
+	 * distribution of the high bits used by HyperLogLog */
+	while (len--)
+		hash = (hash ^ *p++) * 1099511628211ull;
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void syslog_hll_add(syslog_hll_t *hll, uint64_t hash)
+{
+	uint32_t index = hash >> (64 - SYSLOG_HLL_PRECISION);
+	uint8_t rank;
+
+	/* Rank is the position of the first 1 bit after the index bits,
+	 * guard bit limits it when all remaining bits are zero */
+	hash = (hash << SYSLOG_HLL_PRECISION) |
+		(1ull << (SYSLOG_HLL_PRECISION - 1));
+
+	rank = __builtin_clzll(hash) + 1;
+
+	if (hll->registers[index] < rank)
+		hll->registers[index] = rank;
+}
+
+void syslog_hll_merge(syslog_hll_t *hll, const syslog_hll_t *from)
+{
+	unsigned int i;
+
+	for (i = 0; i < SYSLOG_HLL_REGISTERS; i++)
+	{
+		if (hll->registers[i] < from->registers[i])
+			hll->registers[i] = from->registers[i];
+	}
+}
+
+uint64_t syslog_hll_count(const syslog_hll_t *hll)
+{
+	const double m = SYSLOG_HLL_REGISTERS;
+	unsigned int zeros = 0;
+	double sum = 0.0;
+	double estimate;
+	unsigned int i;
+
+	for (i = 0; i < SYSLOG_HLL_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -hll->registers[i]);
+
+		if (!hll->registers[i])
+			zeros++;
+	}
+
+	estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+
+	/* Linear counting is more accurate for the small cardinalities */
+	if ((estimate <= 2.5 * m) && zeros)
+		estimate = m * log(m / zeros);
+
+	return (uint64_t)(estimate + 0.5);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get Count-Min sketch column of the value hash in the row
+ */
+static inline uint32_t cms_column(uint64_t hash, unsigned int row)
+{
+	/* Double hashing by the low and high halves of the hash */
+	uint32_t h1 = (uint32_t)hash;
+	uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+
+	return (h1 + row * h2) & (SYSLOG_CMS_WIDTH - 1);
+}
+
+void syslog_cms_add(syslog_cms_t *cms, uint64_t hash, uint64_t count)
+{
+	unsigned int row;
+
+	for (row = 0; row < SYSLOG_CMS_DEPTH; row++)
+		cms->counters[row][cms_column(hash, row)] += count;
+}
+
+void syslog_cms_merge(syslog_cms_t *cms, const syslog_cms_t *from)
+{
+	unsigned int row;
+	unsigned int i;
+
+	for (row = 0; row < SYSLOG_CMS_DEPTH; row++)
+	{
+		for (i = 0; i < SYSLOG_CMS_WIDTH; i++)
+			cms->counters[row][i] += from->counters[row][i];
+	}
+}
+
+uint64_t syslog_cms_estimate(const syslog_cms_t *cms, uint64_t hash)
+{
+	uint64_t estimate = UINT64_MAX;
+	unsigned int row;
+
+	for (row = 0; row < SYSLOG_CMS_DEPTH; row++)
+	{
+		uint64_t count = cms->counters[row][cms_column(hash, row)];
+
+		if (estimate > count)
+			estimate = count;
+	}
+
+	return estimate;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Swap Space-Saving heap elements
+ */
+static inline void topk_heap_swap(syslog_topk_t *topk, uint32_t a, uint32_t b)
+{
+	uint32_t tmp = topk->heap[a];
+
+	topk->heap[a] = topk->heap[b];
+	topk->heap[b] = tmp;
+
+	topk->items[topk->heap[a]].heap_pos = a;
+	topk->items[topk->heap[b]].heap_pos = b;
+}
+
+/**
+ * Move Space-Saving heap element up to its place
+ */
+static void topk_heap_up(syslog_topk_t *topk, uint32_t pos)
+{
+	while (pos)
+	{
+		uint32_t parent = (pos - 1) / 2;
+
+		if (topk->items[topk->heap[parent]].count <=
+		    topk->items[topk->heap[pos]].count)
+			break;
+
+		topk_heap_swap(topk, pos, parent);
+		pos = parent;
+	}
+}
+
+/**
+ * Move Space-Saving heap element down to its place
+ */
+static void topk_heap_down(syslog_topk_t *topk, uint32_t pos)
+{
+	for (;;)
+	{
+		uint32_t min = pos;
+		uint32_t child = pos * 2 + 1;
+
+		if ((child < topk->items_n) &&
+		    (topk->items[topk->heap[child]].count <
+		     topk->items[topk->heap[min]].count))
+			min = child;
+
+		child++;
+
+		if ((child < topk->items_n) &&
+		    (topk->items[topk->heap[child]].count <
+		     topk->items[topk->heap[min]].count))
+			min = child;
+
+		if (min == pos)
+			break;
+
+		topk_heap_swap(topk, pos, min);
+		pos = min;
+	}
+}
+
+/**
+ * Find Space-Saving counter of the value hash
+ *
+ * @return Counter index or -1 if value is not monitored
+ */
+static int topk_find(const syslog_topk_t *topk, uint64_t hash)
+{
+	uint32_t i;
+
+	for (i = hash & SYSLOG_TOPK_TABLE_MASK; topk->table[i];
+	     i = (i + 1) & SYSLOG_TOPK_TABLE_MASK)
+	{
+		if (topk->items[topk->table[i] - 1].hash == hash)
+			return topk->table[i] - 1;
+	}
+
+	return -1;
+}
+
+/**
+ * Add Space-Saving counter into the hash table
+ */
+static void topk_table_insert(syslog_topk_t *topk, uint32_t index)
+{
+	uint32_t i;
+
+	for (i = topk->items[index].hash & SYSLOG_TOPK_TABLE_MASK; topk->table[i];
+	     i = (i + 1) & SYSLOG_TOPK_TABLE_MASK)
+		;
+
+	topk->table[i] = index + 1;
+}
+
+/**
+ * Remove Space-Saving counter from the hash table
+ */
+static void topk_table_remove(syslog_topk_t *topk, uint32_t index)
+{
+	uint32_t i = topk->items[index].hash & SYSLOG_TOPK_TABLE_MASK;
+	uint32_t j;
+
+	while (topk->table[i] != index + 1)
+		i = (i + 1) & SYSLOG_TOPK_TABLE_MASK;
+
+	/* Following entries of the probe sequence are moved back
+	 * into the free slot, so no deletion markers are required */
+	for (j = (i + 1) & SYSLOG_TOPK_TABLE_MASK; topk->table[j];
+	     j = (j + 1) & SYSLOG_TOPK_TABLE_MASK)
+	{
+		uint32_t home = topk->items[topk->table[j] - 1].hash &
+			SYSLOG_TOPK_TABLE_MASK;
+
+		if (((j - home) & SYSLOG_TOPK_TABLE_MASK) >=
+		    ((j - i) & SYSLOG_TOPK_TABLE_MASK))
+		{
+			topk->table[i] = topk->table[j];
+			i = j;
+		}
+	}
+
+	topk->table[i] = 0;
+}
+
+/**
+ * Set value of the Space-Saving counter
+ */
+static void topk_set_value(
+	syslog_topk_item_t *item,
+	const char *string,
+	size_t len
+)
+{
+	if (len > SYSLOG_TOPK_VALUE_SIZE - 1)
+	{
+		/* Truncate to the UTF-8 character boundary */
+		len = SYSLOG_TOPK_VALUE_SIZE - 1;
+		while (len && ((string[len] & 0xc0) == 0x80))
+			len--;
+	}
+
+	memcpy(item->value, string, len);
+	item->value[len] = 0;
+}
+
+/**
+ * Monitor new value by the Space-Saving summary
+ *
+ * If all counters are used, the counter with the minimum count
+ * is taken over by the value if its count is less than @p count.
+ */
+static void topk_insert(
+	syslog_topk_t *topk,
+	uint64_t hash,
+	const char *string,
+	size_t len,
+	uint64_t count,
+	uint64_t error
+)
+{
+	syslog_topk_item_t *item;
+	uint32_t index;
+
+	if (topk->items_n < SYSLOG_TOPK_CAPACITY)
+	{
+		index = topk->items_n++;
+		item = &topk->items[index];
+
+		item->hash = hash;
+		item->count = count;
+		item->error = error;
+		item->heap_pos = index;
+		topk_set_value(item, string, len);
+
+		topk->heap[index] = index;
+		topk_table_insert(topk, index);
+		topk_heap_up(topk, index);
+		return;
+	}
+
+	index = topk->heap[0];
+	item = &topk->items[index];
+
+	if (item->count >= count)
+		return;
+
+	topk_table_remove(topk, index);
+
+	item->hash = hash;
+	item->count = count;
+	item->error = error;
+	topk_set_value(item, string, len);
+
+	topk_table_insert(topk, index);
+	topk_heap_down(topk, 0);
+}
+
+void syslog_topk_add(
+	syslog_topk_t *topk,
+	uint64_t hash,
+	const char *string,
+	size_t len
+)
+{
+	int index = topk_find(topk, hash);
+	uint64_t min;
+
+	if (index >= 0)
+	{
+		topk->items[index].count++;
+		topk_heap_down(topk, topk->items[index].heap_pos);
+		return;
+	}
+
+	/* New value takes over the minimum counter, the previous
+	 * count of which is the maximum error of the new count */
+	min = (topk->items_n < SYSLOG_TOPK_CAPACITY) ?
+		0 : topk->items[topk->heap[0]].count;
+
+	topk_insert(topk, hash, string, len, min + 1, min);
+}
+
+void syslog_topk_merge(syslog_topk_t *topk, const syslog_topk_t *from)
+{
+	uint64_t merged[(SYSLOG_TOPK_CAPACITY + 63) / 64] = { 0 };
+	uint64_t min, from_min;
+	uint32_t i;
+	int j;
+
+	/* Values, which are not monitored by the full summary,
+	 * could occur up to its minimum count times */
+	min = (topk->items_n < SYSLOG_TOPK_CAPACITY) ?
+		0 : topk->items[topk->heap[0]].count;
+
+	from_min = (from->items_n < SYSLOG_TOPK_CAPACITY) ?
+		0 : from->items[from->heap[0]].count;
+
+	for (i = 0; i < topk->items_n; i++)
+	{
+		syslog_topk_item_t *item = &topk->items[i];
+
+		j = topk_find(from, item->hash);
+		if (j >= 0)
+		{
+			item->count += from->items[j].count;
+			item->error += from->items[j].error;
+			merged[j / 64] |= 1ull << (j % 64);
+		}
+		else
+		{
+			item->count += from_min;
+			item->error += from_min;
+		}
+	}
+
+	/* Rebuild heap, as all counts are changed */
+	for (i = topk->items_n / 2; i-- > 0; )
+		topk_heap_down(topk, i);
+
+	for (i = 0; i < from->items_n; i++)
+	{
+		const syslog_topk_item_t *item = &from->items[i];
+
+		if (merged[i / 64] & (1ull << (i % 64)))
+			continue;
+
+		topk_insert(topk, item->hash, item->value, strlen(item->value),
+			item->count + min, item->error + min);
+	}
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,199 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Streaming summaries (sketches) header
+ *
+ * All sketches have the fixed size, are updated by the 64-bit hashes of
+ * the values (see syslog_sketch_hash()) and are mergeable: sketch merged
+ * from the sketches of the parts of the stream is the same (or, for the
+ * top values, has the same error guarantees) as the sketch of the whole
+ * stream.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_SKETCH_H__
+#define __SYSLOG_SKETCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <syslog_fc.h>
+
+/** @brief Number of the HyperLogLog registers */
+#define SYSLOG_HLL_REGISTERS  (1 << SYSLOG_HLL_PRECISION)
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief HyperLogLog distinct values counter
+ *
+ * Standard error of the count is 1.04 / sqrt(#SYSLOG_HLL_REGISTERS).
+ */
+typedef struct syslog_hll
+{
+	/** Registers (maximum rank of the hashes by the register index) */
+	uint8_t registers[SYSLOG_HLL_REGISTERS];
+
+} syslog_hll_t;
+
+/**
+ * @brief Count-Min sketch
+ *
+ * Estimated count of the value is never less than the real one.
+ */
+typedef struct syslog_cms
+{
+	/** Counters */
+	uint64_t counters[SYSLOG_CMS_DEPTH][SYSLOG_CMS_WIDTH];
+
+} syslog_cms_t;
+
+/**
+ * @brief Space-Saving top values counter
+ */
+typedef struct syslog_topk_item
+{
+	/** Value hash */
+	uint64_t hash;
+
+	/** Estimated number of occurrences (never less than the real one) */
+	uint64_t count;
+
+	/** Maximum overestimation of @ref count */
+	uint64_t error;
+
+	/** Counter index in the heap */
+	uint32_t heap_pos;
+
+	/** NULL-terminated value (truncated to #SYSLOG_TOPK_VALUE_SIZE) */
+	char value[SYSLOG_TOPK_VALUE_SIZE];
+
+} syslog_topk_item_t;
+
+/**
+ * @brief Space-Saving top values summary
+ *
+ * Summary monitors at most #SYSLOG_TOPK_CAPACITY values. When a new value
+ * occurs and all counters are used, the counter with the minimum count is
+ * taken over by the new value. Every value with the number of occurrences
+ * more than 1 / #SYSLOG_TOPK_CAPACITY of the stream is monitored, and
+ * counts are exact while the number of distinct values does not exceed
+ * #SYSLOG_TOPK_CAPACITY.
+ */
+typedef struct syslog_topk
+{
+	/** Counters */
+	syslog_topk_item_t items[SYSLOG_TOPK_CAPACITY];
+
+	/** Number of used counters */
+	uint32_t items_n;
+
+	/** Min-heap of the counter indices by the count */
+	uint32_t heap[SYSLOG_TOPK_CAPACITY];
+
+	/** Hash table of the counter indices (index + 1, 0 if slot is empty) */
+	uint32_t table[SYSLOG_TOPK_CAPACITY * 2];
+
+} syslog_topk_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Compute 64-bit hash of the value
+ *
+ * @param[in] string  Value.
+ * @param[in] len     Value length.
+ *
+ * @return Hash
+ */
+uint64_t syslog_sketch_hash(const char *string, size_t len);
+
+/**
+ * Add value to the HyperLogLog counter
+ *
+ * @param[in,out] hll   Pointer to the counter.
+ * @param[in]     hash  Value hash.
+ */
+void syslog_hll_add(syslog_hll_t *hll, uint64_t hash);
+
+/**
+ * Merge HyperLogLog counters
+ *
+ * @param[in,out] hll   Pointer to the counter.
+ * @param[in]     from  Pointer to the counter merged into @p hll.
+ */
+void syslog_hll_merge(syslog_hll_t *hll, const syslog_hll_t *from);
+
+/**
+ * Get estimated number of the distinct values
+ *
+ * @param[in] hll  Pointer to the counter.
+ *
+ * @return Number of the distinct values
+ */
+uint64_t syslog_hll_count(const syslog_hll_t *hll);
+
+/**
+ * Add value occurrences to the Count-Min sketch
+ *
+ * @param[in,out] cms    Pointer to the sketch.
+ * @param[in]     hash   Value hash.
+ * @param[in]     count  Number of occurrences.
+ */
+void syslog_cms_add(syslog_cms_t *cms, uint64_t hash, uint64_t count);
+
+/**
+ * Merge Count-Min sketches
+ *
+ * @param[in,out] cms   Pointer to the sketch.
+ * @param[in]     from  Pointer to the sketch merged into @p cms.
+ */
+void syslog_cms_merge(syslog_cms_t *cms, const syslog_cms_t *from);
+
+/**
+ * Get estimated number of the value occurrences
+ *
+ * @param[in] cms   Pointer to the sketch.
+ * @param[in] hash  Value hash.
+ *
+ * @return Number of occurrences (never less than the real one)
+ */
+uint64_t syslog_cms_estimate(const syslog_cms_t *cms, uint64_t hash);
+
+/**
+ * Add value occurrence to the Space-Saving summary
+ *
+ * Summary must be zero-initialized before the first use.
+ *
+ * @param[in,out] topk    Pointer to the summary.
+ * @param[in]     hash    Value hash.
+ * @param[in]     string  Value (stored only if value is not monitored).
+ * @param[in]     len     Value length.
+ */
+void syslog_topk_add(
+	syslog_topk_t *topk,
+	uint64_t hash,
+	const char *string,
+	size_t len
+);
+
+/**
+ * Merge Space-Saving summaries
+ *
+ * @param[in,out] topk  Pointer to the summary.
+ * @param[in]     from  Pointer to the summary merged into @p topk.
+ */
+void syslog_topk_merge(syslog_topk_t *topk, const syslog_topk_t *from);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_SKETCH_H__ */
@@ -0,0 +1,259 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Incremental conversion state source
+ *
+ * Input file is identified by the device, inode and the hash of the
+ * last converted bytes, so a rotated, truncated or rewritten file is
+ * converted from the beginning.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <syslog_fc.h>
+#include <syslog_state.h>
+
+/** @brief State file magic */
+#define STATE_MAGIC  "SFCSTA1\n"
+
+/** @brief State file format version */
+#define STATE_VERSION  1
+
+/** @brief Number of the last converted input bytes to check */
+#define STATE_TAIL_SIZE  4096
+
+/**
+ * @brief State file header
+ */
+typedef struct state_header
+{
+	char magic[8];       /**< #STATE_MAGIC */
+	uint32_t version;    /**< #STATE_VERSION */
+	uint32_t reserved;   /**< Reserved (zero) */
+} state_header_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Calculate hash of the input bytes before the offset (FNV-1a)
+ *
+ * Bytes are read from the file, as the mapped data may be
+ * already modified by parsing.
+ *
+ * @param[in]  input   Pointer to the input data structure.
+ * @param[in]  offset  Input offset.
+ * @param[out] hash    Hash value.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int state_tail_hash(
+	const syslog_input_t *input,
+	uint64_t offset,
+	uint64_t *hash
+)
+{
+	unsigned char data[STATE_TAIL_SIZE];
+	size_t size = (offset > STATE_TAIL_SIZE) ? STATE_TAIL_SIZE : offset;
+	ssize_t n;
+	size_t i;
+
+	do
+		n = pread(input->fd, data, size, offset - size);
+	while ((n < 0) && (errno == EINTR));
+
+	if (n < 0)
+		return -errno;
+
+	if ((size_t)n != size)
+		return -EIO;
+
+	*hash = 0xcbf29ce484222325ULL;
+
+	for (i = 0; i < size; i++)
+	{
+		*hash ^= data[i];
+		*hash *= 0x100000001b3ULL;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_state_load(
+	syslog_state_t *state,
+	const char *filename
+)
+{
+	state_header_t hdr;
+	FILE *f;
+	int ret = 1;
+
+	assert(state);
+	assert(filename);
+
+	memset(state, 0, sizeof(syslog_state_t));
+
+	f = fopen(filename, "rb");
+	if (!f)
+		return (errno == ENOENT) ? 0 : -errno;
+
+	if ((fread(&hdr, sizeof(hdr), 1, f) != 1) ||
+	    memcmp(hdr.magic, STATE_MAGIC, sizeof(hdr.magic)) ||
+	    (hdr.version != STATE_VERSION) ||
+	    (fread(state, sizeof(syslog_state_t), 1, f) != 1) ||
+	    (state->trailer_size > state->output_size))
+	{
+		memset(state, 0, sizeof(syslog_state_t));
+		ret = -EINVAL;
+	}
+
+	fclose(f);
+	return ret;
+}
+
+int syslog_state_save(
+	const syslog_state_t *state,
+	const char *filename
+)
+{
+	state_header_t hdr;
+	char *tmp_name;
+	FILE *f;
+	int ret = 0;
+
+	assert(state);
+	assert(filename);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, STATE_MAGIC, sizeof(hdr.magic));
+	hdr.version = STATE_VERSION;
+
+	tmp_name = malloc(strlen(filename) + sizeof(".tmp"));
+	if (!tmp_name)
+		return -ENOMEM;
+
+	strcpy(tmp_name, filename);
+	strcat(tmp_name, ".tmp");
+
+	f = fopen(tmp_name, "wb");
+	if (!f)
+		ret = -errno;
+	else
+	{
+		if ((fwrite(&hdr, sizeof(hdr), 1, f) != 1) ||
+		    (fwrite(state, sizeof(syslog_state_t), 1, f) != 1))
+			ret = -EIO;
+
+		if (fclose(f) && !ret)
+			ret = -errno;
+
+		if (!ret && rename(tmp_name, filename))
+			ret = -errno;
+
+		if (ret)
+			unlink(tmp_name);
+	}
+
+	free(tmp_name);
+	return ret;
+}
+
+int syslog_state_resume(
+	syslog_state_t *state,
+	syslog_input_t *input
+)
+{
+	struct stat st;
+	uint64_t hash;
+	size_t start;
+	int ret;
+
+	assert(state);
+	assert(input);
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	if ((state->dev != (uint64_t)st.st_dev) ||
+	    (state->inode != (uint64_t)st.st_ino) ||
+	    (state->offset > (uint64_t)st.st_size) ||
+	    (!input->map && state->offset))
+		goto reset;
+
+	ret = state_tail_hash(input, state->offset, &hash);
+	if (ret)
+		return ret;
+
+	if (hash != state->tail_hash)
+		goto reset;
+
+	if (!input->map)
+		return 1;
+
+	/* Input may be already restricted by the time range seek */
+	start = input->map_offset;
+
+	if (state->offset > start)
+	{
+		start = (state->offset < input->map_end)
+			? state->offset : input->map_end;
+
+		input->line_n = state->line_n;
+	}
+
+	ret = syslog_input_set_range(input, start, input->map_end);
+	return ret ? ret : 1;
+
+reset:
+	state->dev       = st.st_dev;
+	state->inode     = st.st_ino;
+	state->offset    = 0;
+	state->tail_hash = 0;
+	state->line_n    = 0;
+	return 0;
+}
+
+int syslog_state_checkpoint(
+	syslog_state_t *state,
+	const syslog_input_t *input
+)
+{
+	struct stat st;
+	uint64_t offset;
+	int ret;
+
+	assert(state);
+	assert(input);
+
+	if (fstat(input->fd, &st))
+		return -errno;
+
+	offset = syslog_input_tell(input);
+
+	ret = state_tail_hash(input, offset, &state->tail_hash);
+	if (ret)
+		return ret;
+
+	state->dev    = st.st_dev;
+	state->inode  = st.st_ino;
+	state->offset = offset;
+	state->line_n = input->line_n;
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
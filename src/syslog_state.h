@@ -0,0 +1,131 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Incremental conversion state header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_STATE_H__
+#define __SYSLOG_STATE_H__
+
+#include <stdint.h>
+
+#include <syslog_input.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Incremental conversion state
+ *
+ * State identifies the converted input file and the position of the
+ * first unconverted line in it, so the next conversion converts only
+ * the lines appended since. It also describes the output file, so the
+ * output can be continued.
+ */
+typedef struct syslog_state
+{
+	/** Input file device */
+	uint64_t dev;
+
+	/** Input file inode */
+	uint64_t inode;
+
+	/** Offset of the first unconverted line */
+	uint64_t offset;
+
+	/** Hash of the input bytes before the @ref offset */
+	uint64_t tail_hash;
+
+	/** Number of the converted lines */
+	uint64_t line_n;
+
+	/** Number of the entries in the output */
+	uint64_t parsed_n;
+
+	/** Output file size (0 if output is not a regular file) */
+	uint64_t output_size;
+
+	/** Size of the output format trailer at the end of the output */
+	uint64_t trailer_size;
+
+} syslog_state_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Load incremental conversion state
+ *
+ * @param[out] state     Pointer to the state data structure.
+ * @param[in]  filename  State file name.
+ *
+ * @return 1 if state is loaded
+ * @return 0 if state file does not exist (state is zeroed)
+ * @return <0 on error
+ */
+int syslog_state_load(
+	syslog_state_t *state,
+	const char *filename
+);
+
+/**
+ * Save incremental conversion state
+ *
+ * State file is replaced atomically.
+ *
+ * @param[in] state     Pointer to the state data structure.
+ * @param[in] filename  State file name.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_state_save(
+	const syslog_state_t *state,
+	const char *filename
+);
+
+/**
+ * Restrict memory-mapped input to the lines following the state position
+ *
+ * Must be called before the input data is modified by parsing. If the
+ * input is not the file the state has been saved for (file has been
+ * rotated, truncated or rewritten), input is read from the beginning
+ * and the input position of the state is reset.
+ *
+ * @param[in,out] state  Pointer to the state data structure.
+ * @param[in,out] input  Pointer to the input data structure.
+ *
+ * @return 1 if conversion is resumed from the state position
+ * @return 0 if input is converted from the beginning
+ * @return <0 on error
+ */
+int syslog_state_resume(
+	syslog_state_t *state,
+	syslog_input_t *input
+);
+
+/**
+ * Save the input position of the first unread line into the state
+ *
+ * @param[in,out] state  Pointer to the state data structure.
+ * @param[in]     input  Pointer to the input data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_state_checkpoint(
+	syslog_state_t *state,
+	const syslog_input_t *input
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_STATE_H__ */
@@ -0,0 +1,698 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Entries aggregation (group-by statistics) source
+ *
+ * Group key values are interned, so each group is the time bucket, the
+ * array of the interned string identifiers and the counter, which are
+ * kept in the open addressing hash table. Memory usage is bounded:
+ * at most #SYSLOG_STATS_MAX_GROUPS groups are created, and key values
+ * are interned up to #SYSLOG_STATS_MAX_KEYS_SIZE bytes. Entries, which
+ * do not fit, are counted in the "(other)" group of their time bucket.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <syslog_intern.h>
+#include <syslog_stats.h>
+
+/** @brief Maximum number of the group key fields */
+#define SYSLOG_STATS_MAX_KEYS  4
+
+/** @brief Initial size of the groups hash table (power of 2) */
+#define SYSLOG_STATS_HASH_SIZE  1024
+
+/** @brief Key value of the groups over the limits */
+#define SYSLOG_STATS_OTHER  "(other)"
+
+/**
+ * @brief Group data structure
+ */
+typedef struct syslog_stats_group
+{
+	/** Time bucket start (0 if entries are not grouped by time) */
+	time_t bucket;
+
+	/** Number of entries */
+	uint64_t count;
+
+	/** Group hash */
+	uint32_t hash;
+
+	/** Group creation order */
+	uint32_t order;
+
+	/** Interned key values in the specification order */
+	int keys[SYSLOG_STATS_MAX_KEYS];
+
+} syslog_stats_group_t;
+
+/**
+ * @brief Aggregation data structure
+ */
+typedef struct syslog_stats
+{
+	/** Output format of the results */
+	const output_fmt_t *output_fmt;
+
+	/** Group key fields in the specification order */
+	syslog_field_id_t keys[SYSLOG_STATS_MAX_KEYS];
+
+	/** Number of the group key fields */
+	unsigned int keys_n;
+
+	/** Key index of the fields by the field identifiers (-1 if not a key) */
+	int key_slots[SYSLOG_FIELD_ID_COUNT + 1];
+
+	/** Time bucket size in seconds (0 if entries are not grouped by time) */
+	time_t bucket_size;
+
+	/** Start of the last used time bucket */
+	time_t bucket_start;
+
+	/** End of the last used time bucket */
+	time_t bucket_end;
+
+	/** Interned key values */
+	syslog_intern_t intern;
+
+	/** Identifier of the "(other)" key value */
+	int other;
+
+	/** Groups */
+	syslog_stats_group_t *groups;
+
+	/** Number of groups */
+	uint32_t groups_n;
+
+	/** Number of groups that fit into @ref groups array */
+	uint32_t groups_max;
+
+	/** Hash table of the group indices (index + 1, 0 if slot is empty) */
+	uint32_t *hash;
+
+	/** Hash table size (power of 2) */
+	uint32_t hash_size;
+
+	/** Number of entries counted in the "(other)" groups over the limits */
+	uint64_t other_n;
+
+	/** Result entry */
+	syslog_entry_t result;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+} syslog_stats_t;
+
+/** @brief Aggregation data */
+static syslog_stats_t stats;
+
+/**
+ * @brief Group key fields
+ */
+static const struct
+{
+	const char *name;       /**< Name in the specification */
+	syslog_field_id_t id;   /**< Field identifier */
+	const char *spec;       /**< Entry specificator */
+
+} stats_keys[] =
+{
+	{ "facility", SYSLOG_FIELD_ID_FACILITY, "%F" },
+	{ "priority", SYSLOG_FIELD_ID_PRIORITY, "%P" },
+	{ "tag",      SYSLOG_FIELD_ID_TAG,      "%G" },
+	{ "hostname", SYSLOG_FIELD_ID_HOSTNAME, "%H" },
+};
+
+/**
+ * @brief Named time buckets
+ */
+static const struct
+{
+	const char *name; /**< Name in the specification */
+	time_t size;      /**< Bucket size in seconds */
+
+} stats_buckets[] =
+{
+	{ "minute", 60 },
+	{ "hour",   60 * 60 },
+	{ "day",    24 * 60 * 60 },
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Parse time bucket size
+ *
+ * @param[in]  arg   Bucket name or "<N>[s|m|h|d]" string.
+ * @param[out] size  Bucket size in seconds.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int stats_parse_bucket(const char *arg, time_t *size)
+{
+	unsigned long value;
+	char *end;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stats_buckets); i++)
+	{
+		if (!strcmp(arg, stats_buckets[i].name))
+		{
+			*size = stats_buckets[i].size;
+			return 0;
+		}
+	}
+
+	if (!isdigit((unsigned char)*arg))
+		return -EINVAL;
+
+	value = strtoul(arg, &end, 10);
+	if (!value || (end[0] && end[1]))
+		return -EINVAL;
+
+	switch(*end)
+	{
+		case '\0':
+		case 's': *size = value; break;
+		case 'm': *size = value * 60; break;
+		case 'h': *size = value * 60 * 60; break;
+		case 'd': *size = value * 24 * 60 * 60; break;
+		default:
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse aggregation specification
+ *
+ * @param[in] spec  Aggregation specification.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int stats_parse_spec(const char *spec)
+{
+	char *copy = strdup(spec);
+	char *saveptr = NULL;
+	char *token;
+	int ret = 0;
+	int i;
+
+	if (!copy)
+		return -ENOMEM;
+
+	for (token = strtok_r(copy, ",", &saveptr); token;
+	     token = strtok_r(NULL, ",", &saveptr))
+	{
+		for (i = 0; i < ARRAY_SIZE(stats_keys); i++)
+		{
+			if (!strcmp(token, stats_keys[i].name))
+				break;
+		}
+
+		if (i < ARRAY_SIZE(stats_keys))
+		{
+			if (stats.key_slots[stats_keys[i].id] >= 0)
+			{
+				fprintf(stderr, "Duplicate aggregation key '%s'\n", token);
+				ret = -EINVAL;
+				break;
+			}
+
+			stats.key_slots[stats_keys[i].id] = stats.keys_n;
+			stats.keys[stats.keys_n++] = stats_keys[i].id;
+			continue;
+		}
+
+		if (stats.bucket_size || stats_parse_bucket(token, &stats.bucket_size))
+		{
+			fprintf(stderr, "Invalid aggregation key '%s'\n", token);
+			ret = -EINVAL;
+			break;
+		}
+	}
+
+	if (!ret && !stats.keys_n && !stats.bucket_size)
+	{
+		fprintf(stderr, "Aggregation keys are not specified\n");
+		ret = -EINVAL;
+	}
+
+	free(copy);
+	return ret;
+}
+
+/**
+ * Get time bucket of the timestamp
+ *
+ * Buckets are aligned to the local time, so e.g. day buckets
+ * start at the local midnight.
+ *
+ * @param[in] time  Timestamp.
+ *
+ * @return Time bucket start
+ */
+static time_t stats_bucket(time_t time)
+{
+	struct tm tm;
+	time_t offset;
+
+	if ((time >= stats.bucket_start) && (time < stats.bucket_end))
+		return stats.bucket_start;
+
+	localtime_r(&time, &tm);
+
+	offset = (time + tm.tm_gmtoff) % stats.bucket_size;
+	if (offset < 0)
+		offset += stats.bucket_size;
+
+	stats.bucket_start = time - offset;
+	stats.bucket_end = stats.bucket_start + stats.bucket_size;
+	return stats.bucket_start;
+}
+
+/**
+ * Compute group hash
+ */
+static uint32_t stats_hash(time_t bucket, const int *keys)
+{
+	uint64_t hash = (uint64_t)bucket * 0x9e3779b97f4a7c15ull;
+	unsigned int i;
+
+	for (i = 0; i < stats.keys_n; i++)
+		hash = (hash ^ (uint32_t)keys[i]) * 0x100000001b3ull;
+
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * Resize groups hash table
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int stats_rehash(uint32_t hash_size)
+{
+	uint32_t *hash = calloc(hash_size, sizeof(uint32_t));
+	uint32_t n;
+	uint32_t i;
+
+	if (!hash)
+		return -ENOMEM;
+
+	for (n = 0; n < stats.groups_n; n++)
+	{
+		i = stats.groups[n].hash & (hash_size - 1);
+		while (hash[i])
+			i = (i + 1) & (hash_size - 1);
+
+		hash[i] = n + 1;
+	}
+
+	free(stats.hash);
+	stats.hash = hash;
+	stats.hash_size = hash_size;
+	return 0;
+}
+
+/**
+ * Count entry in the group
+ *
+ * @param[in]     bucket  Time bucket.
+ * @param[in,out] keys    Interned key values (replaced by the "(other)"
+ *                        values if group is new and groups limit
+ *                        is reached).
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int stats_count(time_t bucket, int *keys)
+{
+	size_t keys_size = stats.keys_n * sizeof(int);
+	syslog_stats_group_t *group;
+	uint32_t hash;
+	uint32_t i;
+	int ret;
+
+	hash = stats_hash(bucket, keys);
+
+	if (stats.hash_size)
+	{
+		for (i = hash & (stats.hash_size - 1); stats.hash[i];
+		     i = (i + 1) & (stats.hash_size - 1))
+		{
+			group = &stats.groups[stats.hash[i] - 1];
+
+			if ((group->hash == hash) && (group->bucket == bucket) &&
+			    !memcmp(group->keys, keys, keys_size))
+			{
+				group->count++;
+				return 0;
+			}
+		}
+	}
+
+	/* Groups over the limit are counted in the "(other)"
+	 * group, one such group is created for each time bucket */
+	if (stats.groups_n >= SYSLOG_STATS_MAX_GROUPS)
+	{
+		for (i = 0; i < stats.keys_n; i++)
+		{
+			if (keys[i] != stats.other)
+				break;
+		}
+
+		if (i < stats.keys_n)
+		{
+			for (i = 0; i < stats.keys_n; i++)
+				keys[i] = stats.other;
+
+			stats.other_n++;
+			return stats_count(bucket, keys);
+		}
+	}
+
+	if ((stats.groups_n + 1) * 2 > stats.hash_size)
+	{
+		ret = stats_rehash(stats.hash_size ?
+			stats.hash_size * 2 : SYSLOG_STATS_HASH_SIZE);
+
+		if (ret)
+			return ret;
+	}
+
+	if (stats.groups_n == stats.groups_max)
+	{
+		uint32_t groups_max = stats.groups_max ?
+			stats.groups_max * 2 : SYSLOG_STATS_HASH_SIZE / 2;
+
+		group = realloc(stats.groups,
+			groups_max * sizeof(syslog_stats_group_t));
+
+		if (!group)
+			return -ENOMEM;
+
+		stats.groups = group;
+		stats.groups_max = groups_max;
+	}
+
+	group = &stats.groups[stats.groups_n];
+	group->bucket = bucket;
+	group->count  = 1;
+	group->hash   = hash;
+	group->order  = stats.groups_n;
+	memcpy(group->keys, keys, keys_size);
+
+	for (i = hash & (stats.hash_size - 1); stats.hash[i];
+	     i = (i + 1) & (stats.hash_size - 1))
+		;
+
+	stats.hash[i] = ++stats.groups_n;
+	return 0;
+}
+
+/**
+ * Compare groups in the output order (time bucket,
+ * number of entries descending, creation order)
+ */
+static int stats_group_cmp(const void *a, const void *b)
+{
+	const syslog_stats_group_t *ga = a;
+	const syslog_stats_group_t *gb = b;
+
+	if (ga->bucket != gb->bucket)
+		return (ga->bucket < gb->bucket) ? -1 : 1;
+
+	if (ga->count != gb->count)
+		return (ga->count > gb->count) ? -1 : 1;
+
+	return (ga->order < gb->order) ? -1 : 1;
+}
+
+/**
+ * Free all allocated resources
+ */
+static void stats_free(void)
+{
+	syslog_intern_free(&stats.intern);
+	syslog_entry_destroy(&stats.result);
+	free(stats.groups);
+	free(stats.hash);
+
+	memset(&stats, 0, sizeof(stats));
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_stats_init(
+	const char *spec,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+)
+{
+	syslog_field_id_t ids[SYSLOG_STATS_MAX_KEYS + 2];
+	unsigned int ids_n = 0;
+	unsigned int i, j;
+	int ret;
+
+	assert(spec);
+	assert(entry);
+	assert(output_fmt);
+
+	memset(&stats, 0, sizeof(stats));
+	stats.output_fmt = output_fmt;
+
+	for (i = 0; i < ARRAY_SIZE(stats.key_slots); i++)
+		stats.key_slots[i] = -1;
+
+	ret = stats_parse_spec(spec);
+	if (ret)
+		return ret;
+
+	if (stats.bucket_size)
+	{
+		if (!syslog_entry_has_field(entry, SYSLOG_FIELD_ID_TIMESTAMP))
+		{
+			fprintf(stderr, "Aggregation by time requires field %%T "
+				"in the entry specification\n");
+
+			return -EINVAL;
+		}
+
+		ids[ids_n++] = SYSLOG_FIELD_ID_TIMESTAMP;
+	}
+
+	for (i = 0; i < stats.keys_n; i++)
+	{
+		for (j = 0; stats_keys[j].id != stats.keys[i]; j++)
+			;
+
+		if (!syslog_entry_has_field(entry, stats.keys[i]))
+		{
+			fprintf(stderr, "Aggregation by %s requires field %s "
+				"in the entry specification\n",
+				stats_keys[j].name, stats_keys[j].spec);
+
+			return -EINVAL;
+		}
+
+		ids[ids_n++] = stats.keys[i];
+	}
+
+	ids[ids_n++] = SYSLOG_FIELD_ID_COUNT;
+
+	ret = syslog_entry_init_fields(&stats.result, ids, ids_n);
+	if (ret)
+	{
+		stats_free();
+		return ret;
+	}
+
+	syslog_intern_init(&stats.intern, SYSLOG_STATS_MAX_KEYS_SIZE);
+
+	stats.other = syslog_intern_add(&stats.intern,
+		SYSLOG_STATS_OTHER, strlen(SYSLOG_STATS_OTHER));
+
+	if (stats.other < 0)
+	{
+		ret = stats.other;
+		stats_free();
+		return ret;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_stats_output_init(const syslog_entry_t *entry)
+{
+	(void)entry;
+
+	if (stats.output_fmt->fn_output_init)
+		stats.output_fmt->fn_output_init(&stats.result);
+}
+
+static void syslog_stats_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	int keys[SYSLOG_STATS_MAX_KEYS] = { 0 };
+	time_t bucket = 0;
+	syslog_field_t *field;
+	const char *string;
+	size_t len;
+	int over = 0;
+	int slot;
+	int id;
+
+	if (stats.error)
+		return;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->info->id == SYSLOG_FIELD_ID_TIMESTAMP)
+		{
+			if (stats.bucket_size)
+				bucket = stats_bucket((time_t)field->value.time.unixtime);
+
+			continue;
+		}
+
+		slot = stats.key_slots[field->info->id];
+		if (slot < 0)
+			continue;
+
+		string = field->value.string ? field->value.string : "";
+
+		/* Tags are grouped without "[pid]" suffix */
+		if (field->info->id == SYSLOG_FIELD_ID_TAG)
+			len = strcspn(string, "[");
+		else
+			len = strlen(string);
+
+		id = syslog_intern_add(&stats.intern, string, len);
+		if (id == -ENOSPC)
+		{
+			id = stats.other;
+			over = 1;
+		}
+
+		if (id < 0)
+		{
+			stats.error = id;
+			out->error = id;
+			return;
+		}
+
+		keys[slot] = id;
+	}
+
+	if (over)
+		stats.other_n++;
+
+	stats.error = stats_count(bucket, keys);
+	if (stats.error)
+		out->error = stats.error;
+}
+
+static void syslog_stats_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	const output_fmt_t *fmt = stats.output_fmt;
+	syslog_entry_t *result = &stats.result;
+	syslog_field_t *field;
+	uint32_t n;
+
+	(void)entry;
+
+	if (stats.error)
+	{
+		if (!out->error)
+			out->error = stats.error;
+
+		stats_free();
+		return;
+	}
+
+	qsort(stats.groups, stats.groups_n, sizeof(syslog_stats_group_t),
+		stats_group_cmp);
+
+	result->num = 0;
+
+	if (fmt->fn_output_start)
+		fmt->fn_output_start(out, result);
+
+	for (n = 0; n < stats.groups_n; n++)
+	{
+		const syslog_stats_group_t *group = &stats.groups[n];
+		unsigned int key = 0;
+
+		for (field = result->fields; field; field = field->next)
+		{
+			switch(field->info->id)
+			{
+				case SYSLOG_FIELD_ID_TIMESTAMP:
+					field->value.time.unixtime = group->bucket;
+					localtime_r(&group->bucket, &field->value.time.timestamp);
+					break;
+
+				case SYSLOG_FIELD_ID_COUNT:
+					field->value.uinteger = group->count;
+					break;
+
+				default:
+					field->value.string = (char *)syslog_intern_get(
+						&stats.intern, group->keys[key++])->string;
+					break;
+			}
+		}
+
+		result->num = n + 1;
+
+		if (fmt->fn_output_entry)
+			fmt->fn_output_entry(out, result);
+	}
+
+	if (fmt->fn_output_end)
+		fmt->fn_output_end(out, result);
+
+	if (stats.other_n)
+	{
+		fprintf(stderr, "Aggregation limits are reached, %llu entries "
+			"are counted in the \"" SYSLOG_STATS_OTHER "\" groups\n",
+			(unsigned long long)stats.other_n);
+	}
+
+	stats_free();
+}
+
+output_fmt_t syslog_stats_fmt =
+{
+	.name              = "stats",
+	.description       = "Aggregation of the entries by groups",
+	.flags             = OUTPUT_FMT_FLAG_SEQUENTIAL | OUTPUT_FMT_FLAG_NOAPPEND,
+	.fn_output_init    = syslog_stats_output_init,
+	.fn_output_entry   = syslog_stats_output_entry,
+	.fn_output_end     = syslog_stats_output_end
+};
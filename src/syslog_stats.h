@@ -0,0 +1,60 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Entries aggregation (group-by statistics) header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_STATS_H__
+#define __SYSLOG_STATS_H__
+
+#include <syslog_fc.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Aggregation output format
+ *
+ * Entries passed to the entry output callback are counted by groups
+ * instead of output. Groups are output at the end of the conversion
+ * as entries of the output format passed to syslog_stats_init().
+ */
+extern output_fmt_t syslog_stats_fmt;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize entries aggregation
+ *
+ * Aggregation specification is the comma-separated list of the group
+ * key fields ("facility", "priority", "tag" and "hostname") and of the
+ * optional time bucket ("minute", "hour", "day" or "<N>[s|m|h|d]").
+ * Group keys are output in the specified order after the time bucket
+ * start timestamp and before the number of entries in the group.
+ *
+ * @param[in] spec        Aggregation specification.
+ * @param[in] entry       Pointer to the entry data structure used for
+ *                        parsing (must have all group key fields).
+ * @param[in] output_fmt  Output format of the aggregation results.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_stats_init(
+	const char *spec,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_STATS_H__ */
@@ -0,0 +1,1252 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Message templates mining source
+ *
+ * Messages are grouped by templates with the Drain algorithm. Message is
+ * split into tokens by whitespace, and numbers, hexadecimal values, IP
+ * addresses and paths in the tokens are masked. Tokens are interned, so
+ * the message is the array of the token identifiers. Fixed-depth parse
+ * tree selects the leaf node by the number of tokens and by the first
+ * tokens of the message (tokens with digits are replaced by the wildcard
+ * "<*>"), and the message is compared with the templates of the leaf.
+ * If the most similar template has at least #SYSLOG_TEMPLATES_SIMILARITY
+ * percents of the same tokens, the message is counted in it and the
+ * different template tokens are replaced by the wildcard, otherwise the
+ * new template is created.
+ *
+ * Tree nodes, edges, templates and template tokens are stored in the
+ * arrays (pools) and are referenced by indices, so nothing is allocated
+ * for each message.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+
+#include <syslog_fc.h>
+#include <syslog_intern.h>
+#include <syslog_templates.h>
+
+/** @brief Wildcard token */
+#define SYSLOG_TEMPLATES_WILDCARD  "<*>"
+
+/** @brief Template of the messages over the limits */
+#define SYSLOG_TEMPLATES_OTHER  "(other)"
+
+/** @brief Initial size of the parse tree edges hash table (power of 2) */
+#define SYSLOG_TEMPLATES_HASH_SIZE  1024
+
+/** @brief Check if character is a word character */
+#define TEMPLATES_IS_WORD(c)  (isalnum((unsigned char)(c)) || ((c) == '_'))
+
+/**
+ * @brief Parse tree node
+ */
+typedef struct syslog_templates_node
+{
+	/** Number of children */
+	uint32_t children_n;
+
+	/** First template of the leaf node (-1 if node has no templates) */
+	int32_t templates;
+
+} syslog_templates_node_t;
+
+/**
+ * @brief Parse tree edge
+ */
+typedef struct syslog_templates_edge
+{
+	/** Parent node */
+	uint32_t parent;
+
+	/** Token identifier (number of tokens for the root node children) */
+	int32_t key;
+
+	/** Child node */
+	uint32_t child;
+
+	/** Edge hash */
+	uint32_t hash;
+
+} syslog_templates_edge_t;
+
+/**
+ * @brief Message template
+ */
+typedef struct syslog_template
+{
+	/** Offset of the template tokens in the tokens pool */
+	uint32_t tokens;
+
+	/** Number of the template tokens */
+	uint32_t tokens_n;
+
+	/** Next template of the leaf node (-1 if template is the last) */
+	int32_t next;
+
+	/** Number of messages */
+	uint64_t count;
+
+	/** First message time */
+	time_t first;
+
+	/** Last message time */
+	time_t last;
+
+	/** Template string (NULL if it is not built yet) */
+	char *string;
+
+} syslog_template_t;
+
+/**
+ * @brief Message templates mining data structure
+ */
+typedef struct syslog_templates
+{
+	/** Output format of the results */
+	const output_fmt_t *output_fmt;
+
+	/** Interned tokens */
+	syslog_intern_t intern;
+
+	/** Identifier of the wildcard token */
+	int32_t wildcard;
+
+	/** Parse tree nodes pool (node 0 is the root) */
+	syslog_templates_node_t *nodes;
+
+	/** Number of nodes */
+	uint32_t nodes_n;
+
+	/** Number of nodes that fit into @ref nodes array */
+	uint32_t nodes_max;
+
+	/** Parse tree edges pool */
+	syslog_templates_edge_t *edges;
+
+	/** Number of edges */
+	uint32_t edges_n;
+
+	/** Number of edges that fit into @ref edges array */
+	uint32_t edges_max;
+
+	/** Hash table of the edge indices (index + 1, 0 if slot is empty) */
+	uint32_t *hash;
+
+	/** Hash table size (power of 2) */
+	uint32_t hash_size;
+
+	/** Templates pool */
+	syslog_template_t *templates;
+
+	/** Number of templates */
+	uint32_t templates_n;
+
+	/** Number of templates that fit into @ref templates array */
+	uint32_t templates_max;
+
+	/** Template tokens pool */
+	int32_t *tokens;
+
+	/** Number of template tokens */
+	uint32_t tokens_n;
+
+	/** Number of template tokens that fit into @ref tokens array */
+	uint32_t tokens_max;
+
+	/** Template of the messages over the limits (-1 if not created) */
+	int32_t other;
+
+	/** Number of messages counted in the "(other)" template */
+	uint64_t other_n;
+
+	/** Masked token buffer */
+	char *buffer;
+
+	/** Masked token buffer size */
+	size_t buffer_size;
+
+	/** Tokens of the current message */
+	int32_t message[SYSLOG_TEMPLATES_MAX_TOKENS];
+
+	/** Tokens of the current message with digits or masked values */
+	uint8_t variable[SYSLOG_TEMPLATES_MAX_TOKENS];
+
+	/** Result entry */
+	syslog_entry_t result;
+
+	/** First occurred error (negative errno value) */
+	int error;
+
+} syslog_templates_t;
+
+/** @brief Message templates mining data */
+static syslog_templates_t tpl;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Grow pool array to fit at least @p n + 1 items
+ *
+ * @param[in,out] array      Pointer to the array pointer.
+ * @param[in,out] max        Pointer to the number of items that fit
+ *                           into the array.
+ * @param[in]     n          Number of used items.
+ * @param[in]     item_size  Item size.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int templates_grow(
+	void **array,
+	uint32_t *max,
+	uint32_t n,
+	size_t item_size
+)
+{
+	uint32_t new_max = *max;
+	void *new_array;
+
+	if (n < *max)
+		return 0;
+
+	while (new_max <= n)
+		new_max = new_max ? new_max * 2 : 256;
+
+	new_array = realloc(*array, (size_t)new_max * item_size);
+	if (!new_array)
+		return -ENOMEM;
+
+	*array = new_array;
+	*max = new_max;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get length of the IPv4 address at the start of the string
+ *
+ * @return IPv4 address length or 0 if string does not start with it
+ */
+static size_t templates_match_ipv4(const char *s, size_t len)
+{
+	size_t i = 0;
+	size_t start;
+	int part;
+
+	for (part = 0; part < 4; part++)
+	{
+		if (part)
+		{
+			if ((i >= len) || (s[i] != '.'))
+				return 0;
+
+			i++;
+		}
+
+		for (start = i; (i < len) && isdigit((unsigned char)s[i]) &&
+		     (i - start < 3); i++)
+			;
+
+		if (i == start)
+			return 0;
+	}
+
+	if ((i < len) && (TEMPLATES_IS_WORD(s[i]) ||
+	    ((s[i] == '.') && (i + 1 < len) && isdigit((unsigned char)s[i + 1]))))
+		return 0;
+
+	return i;
+}
+
+/**
+ * Get length of the hexadecimal value at the start of the string
+ *
+ * Hexadecimal values are "0x" prefixed values, values of 8 or more
+ * hexadecimal digits with at least one decimal digit and one letter,
+ * and colon separated groups (MAC and IPv6 addresses).
+ *
+ * @param[in]  s     String.
+ * @param[in]  len   String length.
+ * @param[out] mask  Mask of the value.
+ *
+ * @return Value length or 0 if string does not start with it
+ */
+static size_t templates_match_hex(const char *s, size_t len, const char **mask)
+{
+	unsigned int digits = 0;
+	unsigned int letters = 0;
+	unsigned int colons = 0;
+	size_t group = 0;
+	size_t group_max = 0;
+	size_t i;
+
+	*mask = "<HEX>";
+
+	if ((len > 2) && (s[0] == '0') && ((s[1] | 0x20) == 'x') &&
+	    isxdigit((unsigned char)s[2]))
+	{
+		for (i = 2; (i < len) && isxdigit((unsigned char)s[i]); i++)
+			;
+
+		return ((i < len) && TEMPLATES_IS_WORD(s[i])) ? 0 : i;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		if (isdigit((unsigned char)s[i]))
+			digits++;
+		else if (isxdigit((unsigned char)s[i]))
+			letters++;
+		else if ((s[i] == ':') && (i + 1 < len) &&
+		         (isxdigit((unsigned char)s[i + 1]) || (s[i + 1] == ':')))
+		{
+			colons++;
+			group = 0;
+			continue;
+		}
+		else
+			break;
+
+		if (++group > group_max)
+			group_max = group;
+	}
+
+	if ((i < len) && TEMPLATES_IS_WORD(s[i]))
+		return 0;
+
+	/* MAC addresses have 2-digit groups, IPv6 addresses do not */
+	if ((colons >= 2) && (letters || ((colons == 5) && (i == 17))))
+	{
+		if ((group_max > 2) || memmem(s, i, "::", 2))
+			*mask = "<IP>";
+
+		return i;
+	}
+
+	if (!colons && (i >= 8) && digits && letters)
+		return i;
+
+	return 0;
+}
+
+/**
+ * Get length of the decimal number at the start of the string
+ *
+ * @return Number length or 0 if string does not start with it
+ */
+static size_t templates_match_number(const char *s, size_t len)
+{
+	size_t i;
+
+	for (i = 0; (i < len) && isdigit((unsigned char)s[i]); i++)
+		;
+
+	if (!i)
+		return 0;
+
+	if ((i + 1 < len) && (s[i] == '.') && isdigit((unsigned char)s[i + 1]))
+	{
+		for (i++; (i < len) && isdigit((unsigned char)s[i]); i++)
+			;
+	}
+
+	return ((i < len) && TEMPLATES_IS_WORD(s[i])) ? 0 : i;
+}
+
+/**
+ * Get length of the absolute path at the start of the string
+ *
+ * @return Path length or 0 if string does not start with it
+ */
+static size_t templates_match_path(const char *s, size_t len)
+{
+	size_t i;
+
+	if (s[0] != '/')
+		return 0;
+
+	for (i = 1; (i < len) && (TEMPLATES_IS_WORD(s[i]) ||
+	     strchr("./-~+@%=", s[i])); i++)
+		;
+
+	return (i > 1) ? i : 0;
+}
+
+/**
+ * Mask variable values in the token
+ *
+ * @param[in]  s         Token.
+ * @param[in]  len       Token length.
+ * @param[out] masked    Buffer for the masked token (at least
+ *                       5 * @p len bytes).
+ * @param[out] variable  Set to non-zero if token has digits
+ *                       or masked values.
+ *
+ * @return Masked token length
+ */
+static size_t templates_mask(
+	const char *s,
+	size_t len,
+	char *masked,
+	int *variable
+)
+{
+	size_t masked_len = 0;
+	size_t i = 0;
+
+	*variable = 0;
+
+	while (i < len)
+	{
+		const char *mask = NULL;
+		size_t n = 0;
+
+		/* Values are masked only at the word start */
+		if (!i || !TEMPLATES_IS_WORD(s[i - 1]))
+		{
+			if (s[i] == '/')
+			{
+				n = templates_match_path(s + i, len - i);
+				mask = "<PATH>";
+			}
+			else if (isxdigit((unsigned char)s[i]))
+			{
+				n = templates_match_ipv4(s + i, len - i);
+				mask = "<IP>";
+
+				if (!n)
+					n = templates_match_hex(s + i, len - i, &mask);
+
+				if (!n)
+				{
+					n = templates_match_number(s + i, len - i);
+					mask = "<NUM>";
+				}
+			}
+		}
+
+		if (n)
+		{
+			size_t mask_len = strlen(mask);
+
+			memcpy(masked + masked_len, mask, mask_len);
+			masked_len += mask_len;
+			i += n;
+
+			*variable = 1;
+			continue;
+		}
+
+		if (isdigit((unsigned char)s[i]))
+			*variable = 1;
+
+		masked[masked_len++] = s[i++];
+	}
+
+	return masked_len;
+}
+
+/**
+ * Split message into the interned masked tokens (@ref tpl.message)
+ *
+ * @param[in] message  Message.
+ *
+ * @return Number of tokens
+ * @return <0 on error
+ */
+static int templates_tokenize(const char *message)
+{
+	size_t len = strlen(message);
+	const char *end = message + len;
+	const char *p = message;
+	unsigned int n = 0;
+
+	if (len * 5 + 1 > tpl.buffer_size)
+	{
+		char *buffer = realloc(tpl.buffer, len * 5 + 1);
+		if (!buffer)
+			return -ENOMEM;
+
+		tpl.buffer = buffer;
+		tpl.buffer_size = len * 5 + 1;
+	}
+
+	for (;;)
+	{
+		const char *token;
+		size_t masked_len;
+		int variable;
+		int id;
+
+		while ((p < end) && ((*p == ' ') || (*p == '\t')))
+			p++;
+
+		if (p == end)
+			break;
+
+		token = p;
+
+		/* Rest of the long message is the last token */
+		if (n == SYSLOG_TEMPLATES_MAX_TOKENS - 1)
+			p = end;
+		else
+		{
+			while ((p < end) && (*p != ' ') && (*p != '\t'))
+				p++;
+		}
+
+		masked_len = templates_mask(token, p - token, tpl.buffer, &variable);
+
+		/* New tokens over the limit are the wildcards */
+		id = syslog_intern_add(&tpl.intern, tpl.buffer, masked_len);
+		if (id == -ENOSPC)
+		{
+			id = tpl.wildcard;
+			variable = 1;
+		}
+		else if (id < 0)
+			return id;
+
+		tpl.message[n] = id;
+		tpl.variable[n] = variable;
+		n++;
+	}
+
+	return n;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Compute parse tree edge hash
+ */
+static uint32_t templates_edge_hash(uint32_t parent, int32_t key)
+{
+	uint64_t hash = (((uint64_t)parent << 32) | (uint32_t)key) *
+		0x9e3779b97f4a7c15ull;
+
+	return (uint32_t)(hash >> 32);
+}
+
+/**
+ * Resize parse tree edges hash table
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int templates_rehash(uint32_t hash_size)
+{
+	uint32_t *hash = calloc(hash_size, sizeof(uint32_t));
+	uint32_t n;
+	uint32_t i;
+
+	if (!hash)
+		return -ENOMEM;
+
+	for (n = 0; n < tpl.edges_n; n++)
+	{
+		i = tpl.edges[n].hash & (hash_size - 1);
+		while (hash[i])
+			i = (i + 1) & (hash_size - 1);
+
+		hash[i] = n + 1;
+	}
+
+	free(tpl.hash);
+	tpl.hash = hash;
+	tpl.hash_size = hash_size;
+	return 0;
+}
+
+/**
+ * Get child node of the parse tree node
+ *
+ * @param[in] parent  Parent node.
+ * @param[in] key     Token identifier (number of tokens for the root).
+ * @param[in] create  Create child node if it does not exist.
+ *
+ * @return Child node
+ * @return -ENOENT if child node does not exist and is not created
+ * @return <0 on other errors
+ */
+static int templates_child(uint32_t parent, int32_t key, int create)
+{
+	uint32_t hash = templates_edge_hash(parent, key);
+	syslog_templates_edge_t *edge;
+	uint32_t i;
+	int ret;
+
+	if (tpl.hash_size)
+	{
+		for (i = hash & (tpl.hash_size - 1); tpl.hash[i];
+		     i = (i + 1) & (tpl.hash_size - 1))
+		{
+			edge = &tpl.edges[tpl.hash[i] - 1];
+
+			if ((edge->parent == parent) && (edge->key == key))
+				return edge->child;
+		}
+	}
+
+	if (!create)
+		return -ENOENT;
+
+	if ((tpl.edges_n + 1) * 2 > tpl.hash_size)
+	{
+		ret = templates_rehash(tpl.hash_size ?
+			tpl.hash_size * 2 : SYSLOG_TEMPLATES_HASH_SIZE);
+
+		if (ret)
+			return ret;
+	}
+
+	ret = templates_grow((void **)&tpl.edges, &tpl.edges_max,
+		tpl.edges_n, sizeof(syslog_templates_edge_t));
+
+	if (!ret)
+	{
+		ret = templates_grow((void **)&tpl.nodes, &tpl.nodes_max,
+			tpl.nodes_n, sizeof(syslog_templates_node_t));
+	}
+
+	if (ret)
+		return ret;
+
+	tpl.nodes[tpl.nodes_n].children_n = 0;
+	tpl.nodes[tpl.nodes_n].templates = -1;
+	tpl.nodes[parent].children_n++;
+
+	edge = &tpl.edges[tpl.edges_n];
+	edge->parent = parent;
+	edge->key = key;
+	edge->child = tpl.nodes_n++;
+	edge->hash = hash;
+
+	for (i = hash & (tpl.hash_size - 1); tpl.hash[i];
+	     i = (i + 1) & (tpl.hash_size - 1))
+		;
+
+	tpl.hash[i] = ++tpl.edges_n;
+	return edge->child;
+}
+
+/**
+ * Get leaf node of the current message
+ *
+ * @param[in] tokens_n  Number of the message tokens.
+ * @param[in] create    Create missing nodes.
+ *
+ * @return Leaf node
+ * @return -ENOENT if leaf node does not exist and is not created
+ * @return <0 on other errors
+ */
+static int templates_leaf(unsigned int tokens_n, int create)
+{
+	unsigned int i;
+	int node;
+
+	node = templates_child(0, tokens_n, create);
+
+	for (i = 0; (node >= 0) && (i < tokens_n) &&
+	     (i < SYSLOG_TEMPLATES_DEPTH - 2); i++)
+	{
+		int32_t key = tpl.variable[i] ? tpl.wildcard : tpl.message[i];
+		int child = templates_child(node, key, 0);
+
+		/* Tokens, which do not fit into the full node,
+		 * are the wildcards */
+		if (child == -ENOENT)
+		{
+			if (!create || (tpl.nodes[node].children_n >=
+			    SYSLOG_TEMPLATES_MAX_CHILDREN - 1))
+				key = tpl.wildcard;
+
+			child = templates_child(node, key, create);
+		}
+
+		node = child;
+	}
+
+	return node;
+}
+
+/**
+ * Add message template
+ *
+ * @param[in] leaf      Leaf node or -1 for the "(other)" template.
+ * @param[in] tokens_n  Number of the message tokens.
+ *
+ * @return Template index
+ * @return <0 on error
+ */
+static int templates_new(int leaf, unsigned int tokens_n)
+{
+	syslog_template_t *template;
+	int32_t *next;
+	int ret;
+
+	ret = templates_grow((void **)&tpl.templates, &tpl.templates_max,
+		tpl.templates_n, sizeof(syslog_template_t));
+
+	if (ret)
+		return ret;
+
+	while (tpl.tokens_n + tokens_n > tpl.tokens_max)
+	{
+		ret = templates_grow((void **)&tpl.tokens, &tpl.tokens_max,
+			tpl.tokens_max, sizeof(int32_t));
+
+		if (ret)
+			return ret;
+	}
+
+	template = &tpl.templates[tpl.templates_n];
+	template->tokens   = tpl.tokens_n;
+	template->tokens_n = tokens_n;
+	template->next     = -1;
+	template->count    = 0;
+	template->string   = NULL;
+
+	memcpy(tpl.tokens + tpl.tokens_n, tpl.message, tokens_n * sizeof(int32_t));
+	tpl.tokens_n += tokens_n;
+
+	if (leaf < 0)
+	{
+		template->string = strdup(SYSLOG_TEMPLATES_OTHER);
+		if (!template->string)
+			return -ENOMEM;
+	}
+	else
+	{
+		/* Templates of the leaf are kept in the creation order */
+		for (next = &tpl.nodes[leaf].templates; *next >= 0;
+		     next = &tpl.templates[*next].next)
+			;
+
+		*next = tpl.templates_n;
+	}
+
+	return tpl.templates_n++;
+}
+
+/**
+ * Find the most similar template of the current message in the leaf node
+ *
+ * @param[in] leaf      Leaf node.
+ * @param[in] tokens_n  Number of the message tokens.
+ *
+ * @return Template index or -1 if there is no similar template
+ */
+static int templates_match(int leaf, unsigned int tokens_n)
+{
+	unsigned int best_same = 0;
+	unsigned int best_wildcards = 0;
+	int best = -1;
+	int32_t index;
+
+	for (index = tpl.nodes[leaf].templates; index >= 0;
+	     index = tpl.templates[index].next)
+	{
+		const int32_t *tokens = tpl.tokens + tpl.templates[index].tokens;
+		unsigned int wildcards = 0;
+		unsigned int same = 0;
+		unsigned int i;
+
+		for (i = 0; i < tokens_n; i++)
+		{
+			if (tokens[i] == tpl.wildcard)
+				wildcards++;
+			else if (tokens[i] == tpl.message[i])
+				same++;
+		}
+
+		if ((best < 0) || (same > best_same) ||
+		    ((same == best_same) && (wildcards > best_wildcards)))
+		{
+			best = index;
+			best_same = same;
+			best_wildcards = wildcards;
+		}
+	}
+
+	if ((best >= 0) &&
+	    (best_same * 100 < tokens_n * SYSLOG_TEMPLATES_SIMILARITY))
+		return -1;
+
+	return best;
+}
+
+/**
+ * Compare templates in the output order (number of
+ * messages descending, creation order)
+ */
+static int templates_cmp(const void *a, const void *b)
+{
+	const syslog_template_t *ta = &tpl.templates[*(const uint32_t *)a];
+	const syslog_template_t *tb = &tpl.templates[*(const uint32_t *)b];
+
+	if (ta->count != tb->count)
+		return (ta->count > tb->count) ? -1 : 1;
+
+	return (*(const uint32_t *)a < *(const uint32_t *)b) ? -1 : 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_templates_add(const syslog_entry_t *entry)
+{
+	const char *message = "";
+	syslog_template_t *template;
+	syslog_field_t *field;
+	time_t time = 0;
+	int has_time = 0;
+	int create;
+	int index;
+	int leaf;
+	int n;
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->info->id == SYSLOG_FIELD_ID_MESSAGE)
+		{
+			if (field->value.string)
+				message = field->value.string;
+		}
+		else if (field->info->id == SYSLOG_FIELD_ID_TIMESTAMP)
+		{
+			time = (time_t)field->value.time.unixtime;
+			has_time = 1;
+		}
+	}
+
+	n = templates_tokenize(message);
+	if (n < 0)
+		return n;
+
+	/* Tree is not grown when templates limit is reached */
+	create = (tpl.templates_n < SYSLOG_TEMPLATES_MAX);
+
+	leaf = templates_leaf(n, create);
+	if ((leaf < 0) && (leaf != -ENOENT))
+		return leaf;
+
+	index = (leaf >= 0) ? templates_match(leaf, n) : -1;
+	if (index >= 0)
+	{
+		int32_t *tokens = tpl.tokens + tpl.templates[index].tokens;
+		int i;
+
+		for (i = 0; i < n; i++)
+		{
+			if ((tokens[i] != tpl.message[i]) &&
+			    (tokens[i] != tpl.wildcard))
+			{
+				tokens[i] = tpl.wildcard;
+
+				free(tpl.templates[index].string);
+				tpl.templates[index].string = NULL;
+			}
+		}
+	}
+	else if (create)
+	{
+		index = templates_new(leaf, n);
+		if (index < 0)
+			return index;
+	}
+	else
+	{
+		if (tpl.other < 0)
+		{
+			tpl.other = templates_new(-1, 0);
+			if (tpl.other < 0)
+				return tpl.other;
+		}
+
+		index = tpl.other;
+		tpl.other_n++;
+	}
+
+	template = &tpl.templates[index];
+
+	if (has_time)
+	{
+		if (!template->count || (time < template->first))
+			template->first = time;
+
+		if (!template->count || (time > template->last))
+			template->last = time;
+	}
+
+	template->count++;
+	return index;
+}
+
+const char *syslog_templates_string(int index)
+{
+	syslog_template_t *template = &tpl.templates[index];
+	const int32_t *tokens = tpl.tokens + template->tokens;
+	size_t len = 0;
+	unsigned int i;
+	char *p;
+
+	if (template->string)
+		return template->string;
+
+	for (i = 0; i < template->tokens_n; i++)
+		len += syslog_intern_get(&tpl.intern, tokens[i])->len + 1;
+
+	template->string = p = malloc(len + 1);
+	if (!p)
+		return NULL;
+
+	for (i = 0; i < template->tokens_n; i++)
+	{
+		const syslog_intern_string_t *token =
+			syslog_intern_get(&tpl.intern, tokens[i]);
+
+		if (i)
+			*p++ = ' ';
+
+		memcpy(p, token->string, token->len);
+		p += token->len;
+	}
+
+	*p = 0;
+	return template->string;
+}
+
+void syslog_templates_free(void)
+{
+	uint32_t i;
+
+	if (tpl.other_n)
+	{
+		fprintf(stderr, "Templates limit is reached, %llu entries "
+			"are counted in the \"" SYSLOG_TEMPLATES_OTHER "\" template\n",
+			(unsigned long long)tpl.other_n);
+	}
+
+	for (i = 0; i < tpl.templates_n; i++)
+		free(tpl.templates[i].string);
+
+	syslog_intern_free(&tpl.intern);
+	syslog_entry_destroy(&tpl.result);
+
+	free(tpl.nodes);
+	free(tpl.edges);
+	free(tpl.hash);
+	free(tpl.templates);
+	free(tpl.tokens);
+	free(tpl.buffer);
+
+	memset(&tpl, 0, sizeof(tpl));
+}
+
+int syslog_templates_init(
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt,
+	int column
+)
+{
+	syslog_field_id_t ids[SYSLOG_FIELD_ID_LAST + 1];
+	unsigned int ids_n = 0;
+	syslog_field_t *field;
+	int ret;
+
+	assert(entry);
+
+	if (!syslog_entry_has_field(entry, SYSLOG_FIELD_ID_MESSAGE))
+	{
+		fprintf(stderr, "Message templates require field %%M "
+			"in the entry specification\n");
+
+		return -EINVAL;
+	}
+
+	memset(&tpl, 0, sizeof(tpl));
+	tpl.output_fmt = output_fmt;
+	tpl.other = -1;
+
+	if (!output_fmt)
+	{
+		/* Templates are only mined */
+	}
+	else if (column)
+	{
+		/* Output fields of the entry and the template field */
+		for (field = entry->fields; field; field = field->next)
+		{
+			if (!(field->flags & SYSLOG_FIELD_FLAG_DROP))
+				ids[ids_n++] = field->info->id;
+		}
+	}
+	else if (syslog_entry_has_field(entry, SYSLOG_FIELD_ID_TIMESTAMP))
+	{
+		ids[ids_n++] = SYSLOG_FIELD_ID_FIRST;
+		ids[ids_n++] = SYSLOG_FIELD_ID_LAST;
+	}
+
+	if (output_fmt)
+	{
+		if (!column)
+			ids[ids_n++] = SYSLOG_FIELD_ID_COUNT;
+
+		ids[ids_n++] = SYSLOG_FIELD_ID_TEMPLATE;
+
+		ret = syslog_entry_init_fields(&tpl.result, ids, ids_n);
+		if (ret)
+		{
+			syslog_templates_free();
+			return ret;
+		}
+	}
+
+	syslog_intern_init(&tpl.intern, SYSLOG_TEMPLATES_MAX_TOKENS_SIZE);
+
+	tpl.wildcard = syslog_intern_add(&tpl.intern,
+		SYSLOG_TEMPLATES_WILDCARD, strlen(SYSLOG_TEMPLATES_WILDCARD));
+
+	ret = (tpl.wildcard < 0) ? tpl.wildcard :
+		templates_grow((void **)&tpl.nodes, &tpl.nodes_max,
+			0, sizeof(syslog_templates_node_t));
+
+	if (ret)
+	{
+		syslog_templates_free();
+		return ret;
+	}
+
+	/* Root node */
+	tpl.nodes[0].children_n = 0;
+	tpl.nodes[0].templates = -1;
+	tpl.nodes_n = 1;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_templates_output_init(const syslog_entry_t *entry)
+{
+	(void)entry;
+
+	if (tpl.output_fmt->fn_output_init)
+		tpl.output_fmt->fn_output_init(&tpl.result);
+}
+
+static void syslog_templates_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	int ret;
+
+	if (tpl.error)
+		return;
+
+	ret = syslog_templates_add(entry);
+	if (ret < 0)
+	{
+		tpl.error = ret;
+		out->error = ret;
+	}
+}
+
+static void syslog_templates_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	const output_fmt_t *fmt = tpl.output_fmt;
+	syslog_entry_t *result = &tpl.result;
+	syslog_field_t *field;
+	uint32_t *order;
+	uint32_t n;
+
+	(void)entry;
+
+	order = malloc((tpl.templates_n + 1) * sizeof(uint32_t));
+	if (!order && !tpl.error)
+		tpl.error = -ENOMEM;
+
+	if (tpl.error)
+	{
+		if (!out->error)
+			out->error = tpl.error;
+
+		free(order);
+		syslog_templates_free();
+		return;
+	}
+
+	for (n = 0; n < tpl.templates_n; n++)
+		order[n] = n;
+
+	qsort(order, tpl.templates_n, sizeof(uint32_t), templates_cmp);
+
+	result->num = 0;
+
+	if (fmt->fn_output_start)
+		fmt->fn_output_start(out, result);
+
+	for (n = 0; n < tpl.templates_n; n++)
+	{
+		syslog_template_t *template = &tpl.templates[order[n]];
+		const char *string = syslog_templates_string(order[n]);
+
+		if (!string)
+		{
+			out->error = -ENOMEM;
+			break;
+		}
+
+		for (field = result->fields; field; field = field->next)
+		{
+			switch(field->info->id)
+			{
+				case SYSLOG_FIELD_ID_FIRST:
+					field->value.time.unixtime = template->first;
+					localtime_r(&template->first, &field->value.time.timestamp);
+					break;
+
+				case SYSLOG_FIELD_ID_LAST:
+					field->value.time.unixtime = template->last;
+					localtime_r(&template->last, &field->value.time.timestamp);
+					break;
+
+				case SYSLOG_FIELD_ID_COUNT:
+					field->value.uinteger = template->count;
+					break;
+
+				case SYSLOG_FIELD_ID_TEMPLATE:
+					field->value.string = (char *)string;
+					break;
+
+				default:
+					break;
+			}
+		}
+
+		result->num = n + 1;
+
+		if (fmt->fn_output_entry)
+			fmt->fn_output_entry(out, result);
+	}
+
+	if (fmt->fn_output_end)
+		fmt->fn_output_end(out, result);
+
+	free(order);
+	syslog_templates_free();
+}
+
+output_fmt_t syslog_templates_fmt =
+{
+	.name              = "templates",
+	.description       = "Message templates",
+	.flags             = OUTPUT_FMT_FLAG_SEQUENTIAL | OUTPUT_FMT_FLAG_NOAPPEND,
+	.fn_output_init    = syslog_templates_output_init,
+	.fn_output_entry   = syslog_templates_output_entry,
+	.fn_output_end     = syslog_templates_output_end
+};
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_templates_column_output_start(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	tpl.result.num = entry->num;
+
+	if (tpl.output_fmt->fn_output_start)
+		tpl.output_fmt->fn_output_start(out, &tpl.result);
+}
+
+static void syslog_templates_column_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	syslog_field_t *field;
+	syslog_field_t *dst = tpl.result.fields;
+	const char *string;
+	int ret;
+
+	if (tpl.error)
+		return;
+
+	ret = syslog_templates_add(entry);
+	if (ret >= 0)
+	{
+		string = syslog_templates_string(ret);
+		if (!string)
+			ret = -ENOMEM;
+	}
+
+	if (ret < 0)
+	{
+		tpl.error = ret;
+		out->error = ret;
+		return;
+	}
+
+	/* Result entry has the same output fields followed by the template.
+	 * Template is output as it is now, later entries of its group may
+	 * replace more of its tokens by the wildcard */
+	for (field = entry->fields; field; field = field->next)
+	{
+		if (field->flags & SYSLOG_FIELD_FLAG_DROP)
+			continue;
+
+		dst->value = field->value;
+		dst->code  = field->code;
+		dst = dst->next;
+	}
+
+	dst->value.string = (char *)string;
+	tpl.result.num = entry->num;
+
+	if (tpl.output_fmt->fn_output_entry)
+		tpl.output_fmt->fn_output_entry(out, &tpl.result);
+}
+
+static void syslog_templates_column_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	if (tpl.error && !out->error)
+		out->error = tpl.error;
+
+	tpl.result.num = entry->num;
+
+	if (tpl.output_fmt->fn_output_end)
+		tpl.output_fmt->fn_output_end(out, &tpl.result);
+
+	syslog_templates_free();
+}
+
+output_fmt_t syslog_templates_column_fmt =
+{
+	.name              = "template-column",
+	.description       = "Entries with the message templates",
+	.flags             = OUTPUT_FMT_FLAG_SEQUENTIAL,
+	.fn_output_init    = syslog_templates_output_init,
+	.fn_output_start   = syslog_templates_column_output_start,
+	.fn_output_entry   = syslog_templates_column_output_entry,
+	.fn_output_end     = syslog_templates_column_output_end
+};
@@ -0,0 +1,101 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Message templates mining header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_TEMPLATES_H__
+#define __SYSLOG_TEMPLATES_H__
+
+#include <syslog_fc.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Message templates output format
+ *
+ * Entry messages passed to the entry output callback are grouped by
+ * templates instead of output. Templates are output at the end of the
+ * conversion as entries of the output format passed to
+ * syslog_templates_init().
+ */
+extern output_fmt_t syslog_templates_fmt;
+
+/**
+ * @brief Message template field output format
+ *
+ * Entries passed to the entry output callback are output in the output
+ * format passed to syslog_templates_init() with the message template
+ * field added after all fields. Entries are output as they are mined,
+ * so the template field is the template of the entry group at the
+ * moment the entry is output. Earlier entries of the group may have
+ * fewer wildcards than later ones, so the field depends on the input
+ * order.
+ */
+extern output_fmt_t syslog_templates_column_fmt;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize message templates mining
+ *
+ * @param[in] entry       Pointer to the entry data structure used for
+ *                        parsing (must have message field).
+ * @param[in] output_fmt  Output format of the templates or entries, or
+ *                        NULL if templates are only mined by the
+ *                        syslog_templates_add() calls (e.g. for the
+ *                        top values).
+ * @param[in] column      Output entries with the template field
+ *                        (#syslog_templates_column_fmt) instead of the
+ *                        templates (#syslog_templates_fmt).
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_templates_init(
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt,
+	int column
+);
+
+/**
+ * Count entry message in its template
+ *
+ * Templates are never removed, so the template index identifies the
+ * template till the end of mining, although the template string may
+ * get more wildcards.
+ *
+ * @param[in] entry  Pointer to the entry data structure.
+ *
+ * @return Template index
+ * @return <0 on error
+ */
+int syslog_templates_add(const syslog_entry_t *entry);
+
+/**
+ * Get template string
+ *
+ * @param[in] index  Template index.
+ *
+ * @return Template string or NULL on error
+ */
+const char *syslog_templates_string(int index);
+
+/**
+ * Free all resources of the message templates mining
+ */
+void syslog_templates_free(void);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_TEMPLATES_H__ */
@@ -0,0 +1,546 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Multi-threaded syslog conversion source
+ *
+ * Conversion is pipelined through the ordered queue of chunk slots. The
+ * main thread reads input chunks into the free slots, and the persistent
+ * worker threads take queued slots in the input order. For each slot
+ * the worker:
+ *
+ *   1. Counts lines in the chunk and waits until line numbers of the
+ *      preceding chunks are known to get the number of its first line.
+ *   2. Parses the chunk and saves parsed field values of all entries,
+ *      then waits until entry numbers of the preceding chunks are known
+ *      to get the number of its first entry.
+ *   3. Formats saved entries into the private output buffer of the slot
+ *      with correct entry numbers.
+ *
+ * Meanwhile the main thread writes output buffers of the converted slots
+ * in the input order and merges data collected by the workers (if output
+ * format has the merge callback) in the same order, so the results do
+ * not depend on the thread scheduling. Written slots are reused for the
+ * next chunks, so chunk N is written while chunks N+1 and later are
+ * converted.
+ * Entries of the sequential output formats (#OUTPUT_FMT_FLAG_SEQUENTIAL)
+ * are formatted by the main thread directly into the output instead.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <pthread.h>
+
+#include <syslog_fc.h>
+#include <syslog_threads.h>
+
+/** Number of queue slots per worker thread */
+#define SYSLOG_THREADS_SLOTS_PER_WORKER 2
+
+struct syslog_queue;
+
+/**
+ * @brief Chunk queue slot data structure
+ */
+typedef struct syslog_slot
+{
+	/** Sequence number of the chunk in the input */
+	unsigned int seq;
+
+	/** Slot is converted by the worker */
+	int done;
+
+	/** Input chunk */
+	syslog_input_chunk_t chunk;
+
+	/** Input offset of the chunk data (mmap mode only) */
+	size_t chunk_offset;
+
+	/** Time index of the chunk (if index is built) */
+	syslog_index_t time_index;
+
+	/** Number of lines in the chunk */
+	unsigned int lines_n;
+
+	/** Number of parsed entries in the chunk */
+	unsigned int parsed_n;
+
+	/** Number of the entries preceding the chunk */
+	unsigned int entry_num;
+
+	/** Saved states of the parsed entries */
+	syslog_field_state_t *states;
+
+	/** Number of entries that fit into @ref states array */
+	unsigned int states_max;
+
+	/** Output buffer */
+	syslog_output_t output;
+
+	/** Conversion status */
+	int ret;
+
+} syslog_slot_t;
+
+/**
+ * @brief Worker thread data structure
+ */
+typedef struct syslog_worker
+{
+	/** Thread */
+	pthread_t thread;
+
+	/** Chunk queue */
+	struct syslog_queue *queue;
+
+	/** Worker own entry structure */
+	syslog_entry_t entry;
+
+} syslog_worker_t;
+
+/**
+ * @brief Ordered chunk queue data structure
+ *
+ * Slot of the chunk with sequence number N is
+ * @ref slots[N % @ref slots_n]. All counters are protected
+ * by the @ref mutex, state changes are signalled by the @ref cond.
+ */
+typedef struct syslog_queue
+{
+	/** Queue mutex */
+	pthread_mutex_t mutex;
+
+	/** Queue state change condition */
+	pthread_cond_t cond;
+
+	/** Slots array */
+	syslog_slot_t *slots;
+
+	/** Number of slots */
+	unsigned int slots_n;
+
+	/** Number of chunks read by the main thread */
+	unsigned int read_n;
+
+	/** Number of chunks taken by the workers */
+	unsigned int taken_n;
+
+	/** Number of chunks with known first line numbers */
+	unsigned int counted_n;
+
+	/** Number of chunks with known first entry numbers */
+	unsigned int numbered_n;
+
+	/** Number of lines in the counted chunks */
+	unsigned int line_n;
+
+	/** Number of entries in the numbered chunks */
+	unsigned int entry_num;
+
+	/** No more chunks will be queued */
+	int stop;
+
+	/** Index to build or NULL */
+	syslog_index_t *index;
+
+} syslog_queue_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Save parsed entry into the slot
+ *
+ * @param[in,out] slot   Pointer to the slot data structure.
+ * @param[in]     entry  Pointer to the parsed entry.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int slot_save_entry(syslog_slot_t *slot, syslog_entry_t *entry)
+{
+	unsigned int fields_num = entry->fields_num;
+
+	if (slot->parsed_n == slot->states_max)
+	{
+		unsigned int states_max = slot->states_max ?
+			slot->states_max * 2 : 1024;
+
+		syslog_field_state_t *states = realloc(slot->states,
+			(size_t)states_max * fields_num * sizeof(syslog_field_state_t));
+
+		if (!states)
+			return -ENOMEM;
+
+		slot->states = states;
+		slot->states_max = states_max;
+	}
+
+	syslog_entry_save(entry,
+		slot->states + (size_t)slot->parsed_n * fields_num);
+
+	slot->parsed_n++;
+	return 0;
+}
+
+/**
+ * Output saved entries of the slot
+ *
+ * @param[in]     slot   Pointer to the slot data structure.
+ * @param[in,out] entry  Pointer to the entry to restore saved states into.
+ * @param[in,out] out    Pointer to the output structure.
+ */
+static void slot_output(
+	const syslog_slot_t *slot,
+	syslog_entry_t *entry,
+	syslog_output_t *out
+)
+{
+	unsigned int fields_num = entry->fields_num;
+	unsigned int i;
+
+	if (slot->ret)
+		return;
+
+	entry->num = slot->entry_num;
+
+	for (i = 0; i < slot->parsed_n; i++)
+	{
+		syslog_entry_restore(entry, slot->states + (size_t)i * fields_num);
+
+		entry->num++;
+
+		if (config.output_fmt->fn_output_entry)
+			config.output_fmt->fn_output_entry(out, entry);
+	}
+}
+
+/**
+ * Convert the chunk of the slot taken from the queue
+ *
+ * @param[in,out] worker  Pointer to the worker data structure.
+ * @param[in,out] slot    Pointer to the slot data structure.
+ */
+static void worker_convert(syslog_worker_t *worker, syslog_slot_t *slot)
+{
+	syslog_queue_t *queue = worker->queue;
+	char *line;
+	size_t line_len;
+	int ret;
+	const syslog_field_t *time_field =
+		syslog_entry_field(&worker->entry, SYSLOG_FIELD_ID_TIMESTAMP);
+
+	slot->parsed_n = 0;
+	slot->ret = 0;
+
+	/* Stage 1: count lines */
+	slot->lines_n = syslog_input_chunk_count_lines(&slot->chunk);
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while (queue->counted_n != slot->seq)
+		pthread_cond_wait(&queue->cond, &queue->mutex);
+
+	slot->chunk.line_n = queue->line_n;
+	queue->line_n += slot->lines_n;
+	queue->counted_n++;
+
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	/* Stage 2: parse entries */
+	while ((ret = syslog_input_chunk_read_line(&slot->chunk,
+		&line, &line_len)) > 0)
+	{
+		if (syslog_entry_parse(&worker->entry,
+			slot->chunk.line_n, line, line_len))
+			continue;
+
+		slot->ret = slot_save_entry(slot, &worker->entry);
+		if (slot->ret)
+			break;
+
+		if (queue->index)
+		{
+			syslog_index_add(&slot->time_index,
+				slot->chunk_offset + (line - slot->chunk.data),
+				slot->chunk.line_n, time_field->value.time.unixtime);
+		}
+	}
+
+	if (ret < 0)
+		slot->ret = ret;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while (queue->numbered_n != slot->seq)
+		pthread_cond_wait(&queue->cond, &queue->mutex);
+
+	slot->entry_num = queue->entry_num;
+	queue->entry_num += slot->parsed_n;
+	queue->numbered_n++;
+
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	/* Stage 3: output entries (sequential formats are output
+	 * by the main thread) */
+	if (!(config.output_fmt->flags & OUTPUT_FMT_FLAG_SEQUENTIAL))
+		slot_output(slot, &worker->entry, &slot->output);
+
+	if (!slot->ret)
+		slot->ret = slot->output.error;
+}
+
+/**
+ * Worker thread function
+ *
+ * Converts queued slots till the queue is stopped.
+ *
+ * @param[in] arg  Pointer to the worker data structure.
+ *
+ * @return NULL
+ */
+static void *worker_thread(void *arg)
+{
+	syslog_worker_t *worker = arg;
+	syslog_queue_t *queue = worker->queue;
+	syslog_slot_t *slot;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	for (;;)
+	{
+		while ((queue->taken_n == queue->read_n) && !queue->stop)
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+
+		if (queue->taken_n == queue->read_n)
+			break;
+
+		slot = &queue->slots[queue->taken_n % queue->slots_n];
+		queue->taken_n++;
+
+		pthread_mutex_unlock(&queue->mutex);
+
+		worker_convert(worker, slot);
+
+		pthread_mutex_lock(&queue->mutex);
+
+		slot->done = 1;
+		pthread_cond_broadcast(&queue->cond);
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_threads_convert(
+	syslog_input_t *input,
+	syslog_output_t *out,
+	unsigned int threads_n,
+	syslog_index_t *index,
+	unsigned int *entries_n
+)
+{
+	int ret = 0;
+	int eof = 0;
+	unsigned int i;
+	unsigned int threads_started = 0;
+	unsigned int written_n = 0;
+	unsigned int line_n;
+	syslog_queue_t queue = { 0 };
+	syslog_worker_t *workers = NULL;
+	syslog_entry_t entry;
+
+	assert(input);
+	assert(out);
+	assert(threads_n);
+	assert(entries_n);
+
+	ret = syslog_entry_init(&entry, config.entry_spec);
+	if (ret)
+	{
+		fprintf(stderr, "Syslog entry initialization failed (%d)\n", ret);
+		goto out_free;
+	}
+
+	queue.slots_n = threads_n * SYSLOG_THREADS_SLOTS_PER_WORKER;
+	queue.slots = calloc(queue.slots_n, sizeof(syslog_slot_t));
+	workers = calloc(threads_n, sizeof(syslog_worker_t));
+
+	if (!queue.slots || !workers)
+	{
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	/* Input may be restricted to the range of lines */
+	line_n = input->line_n;
+	queue.line_n = input->line_n;
+	queue.entry_num = *entries_n;
+	queue.index = index;
+
+	pthread_mutex_init(&queue.mutex, NULL);
+	pthread_cond_init(&queue.cond, NULL);
+
+	for (i = 0; i < queue.slots_n; i++)
+	{
+		syslog_index_init(&queue.slots[i].time_index);
+
+		ret = syslog_output_open(&queue.slots[i].output, -1);
+		if (ret)
+			goto out;
+	}
+
+	for (i = 0; i < threads_n; i++)
+	{
+		workers[i].queue = &queue;
+
+		ret = syslog_entry_init(&workers[i].entry, config.entry_spec);
+		if (ret)
+		{
+			fprintf(stderr,
+				"Syslog entry initialization failed (%d)\n", ret);
+
+			goto out;
+		}
+	}
+
+	for (threads_started = 0; threads_started < threads_n; threads_started++)
+	{
+		ret = -pthread_create(&workers[threads_started].thread, NULL,
+			worker_thread, &workers[threads_started]);
+
+		if (ret)
+		{
+			fprintf(stderr, "Failed to create thread (%d)\n", ret);
+			goto out;
+		}
+	}
+
+	while (!eof || (written_n != queue.read_n))
+	{
+		syslog_slot_t *slot;
+
+		/* Read ahead chunks into the free slots */
+		if (!eof && (queue.read_n - written_n < queue.slots_n))
+		{
+			int read_ret;
+
+			slot = &queue.slots[queue.read_n % queue.slots_n];
+			slot->chunk_offset = input->map_offset;
+
+			read_ret = syslog_input_read_chunk(input, &slot->chunk);
+			if (read_ret <= 0)
+			{
+				/* Queued chunks are drained, but not written */
+				if (read_ret < 0)
+					ret = read_ret;
+
+				eof = 1;
+				continue;
+			}
+
+			pthread_mutex_lock(&queue.mutex);
+
+			slot->seq = queue.read_n;
+			slot->done = 0;
+			queue.read_n++;
+
+			pthread_cond_broadcast(&queue.cond);
+			pthread_mutex_unlock(&queue.mutex);
+			continue;
+		}
+
+		/* Write the oldest slot in the input order */
+		slot = &queue.slots[written_n % queue.slots_n];
+
+		pthread_mutex_lock(&queue.mutex);
+
+		while (!slot->done)
+			pthread_cond_wait(&queue.cond, &queue.mutex);
+
+		pthread_mutex_unlock(&queue.mutex);
+
+		if (!ret && slot->ret)
+		{
+			fprintf(stderr,
+				"Failed to convert input chunk (%d)\n", slot->ret);
+
+			ret = slot->ret;
+		}
+
+		if (!ret)
+		{
+			if (config.output_fmt->flags & OUTPUT_FMT_FLAG_SEQUENTIAL)
+				slot_output(slot, &entry, out);
+			else
+				syslog_output_write(out,
+					slot->output.buffer, slot->output.size);
+
+			ret = out->error;
+		}
+
+		/* Data collected by the worker is released on error too */
+		if (config.output_fmt->fn_output_merge)
+			config.output_fmt->fn_output_merge(out, &slot->output);
+
+		slot->output.size = 0;
+
+		if (index)
+		{
+			syslog_index_append(index, &slot->time_index);
+			syslog_index_free(&slot->time_index);
+		}
+
+		line_n += slot->lines_n;
+		*entries_n += slot->parsed_n;
+		written_n++;
+
+		/* Stop reading on error, but convert already queued chunks */
+		if (ret)
+			eof = 1;
+	}
+
+	if (!ret)
+		input->line_n = line_n;
+
+out:
+	pthread_mutex_lock(&queue.mutex);
+	queue.stop = 1;
+	pthread_cond_broadcast(&queue.cond);
+	pthread_mutex_unlock(&queue.mutex);
+
+	for (i = 0; i < threads_started; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	pthread_cond_destroy(&queue.cond);
+	pthread_mutex_destroy(&queue.mutex);
+
+	for (i = 0; i < threads_n; i++)
+		syslog_entry_destroy(&workers[i].entry);
+
+	for (i = 0; i < queue.slots_n; i++)
+	{
+		syslog_index_free(&queue.slots[i].time_index);
+		syslog_input_chunk_free(&queue.slots[i].chunk);
+		free(queue.slots[i].states);
+		syslog_output_close(&queue.slots[i].output);
+	}
+
+out_free:
+	free(workers);
+	free(queue.slots);
+	syslog_entry_destroy(&entry);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,57 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Multi-threaded syslog conversion header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_THREADS_H__
+#define __SYSLOG_THREADS_H__
+
+#include <syslog_index.h>
+#include <syslog_input.h>
+#include <syslog_output.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Convert all entries of the syslog input using multiple threads
+ *
+ * Input is split into chunks at line boundaries. Chunks are parsed and
+ * formatted by @p threads_n persistent worker threads into private memory
+ * outputs, and outputs are written into @p out in the input order while
+ * the workers convert the following chunks, so the output is the same as
+ * for the single-threaded conversion.
+ *
+ * Output start and end callbacks are not called by this function.
+ *
+ * @param[in,out] input      Pointer to the syslog input structure.
+ * @param[in,out] out        Pointer to the output structure.
+ * @param[in]     threads_n  Number of threads.
+ * @param[in,out] index      Pointer to the index to build or NULL.
+ * @param[in,out] entries_n  Number of the previously converted entries
+ *                           (updated by the function).
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_threads_convert(
+	syslog_input_t *input,
+	syslog_output_t *out,
+	unsigned int threads_n,
+	syslog_index_t *index,
+	unsigned int *entries_n
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_THREADS_H__ */
@@ -0,0 +1,542 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Syslog timestamp parser source
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <ctype.h>
+
+#include <syslog_fc.h>
+#include <syslog_time.h>
+
+/**
+ * @name Timestamp parser operation types
+ * @{
+ */
+
+/** @brief Match single character */
+#define TIME_OP_CHAR   0
+
+/** @brief Skip any number of white-space characters */
+#define TIME_OP_SPACE  1
+
+/** @brief Match day of the week name */
+#define TIME_OP_WDAY   2
+
+/** @brief Match month name */
+#define TIME_OP_MONTH  3
+
+/** @brief Parse number */
+#define TIME_OP_NUMBER 4
+
+/** @} */
+
+/**
+ * @name Parsed number targets
+ * @{
+ */
+
+#define TIME_TARGET_MDAY  0 /**< Day of the month */
+#define TIME_TARGET_MON   1 /**< Month (1-12) */
+#define TIME_TARGET_HOUR  2 /**< Hours */
+#define TIME_TARGET_MIN   3 /**< Minutes */
+#define TIME_TARGET_SEC   4 /**< Seconds */
+#define TIME_TARGET_YEAR  5 /**< Year with century */
+
+/** @} */
+
+/** @brief Full names of the days of the week (C locale) */
+static const char *time_wday_names[] =
+{
+	"Sunday", "Monday", "Tuesday", "Wednesday",
+	"Thursday", "Friday", "Saturday"
+};
+
+/** @brief Full names of the months (C locale) */
+static const char *time_month_names[] =
+{
+	"January", "February", "March", "April", "May", "June", "July",
+	"August", "September", "October", "November", "December"
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Add operation to the compiled timestamp parser
+ *
+ * @param[in,out] parser Pointer to the parser data structure.
+ * @param[in]     type   Operation type.
+ * @param[in]     arg    Operation argument.
+ * @param[in]     target Target field of the parsed number.
+ * @param[in]     min    Minimum value of the parsed number.
+ * @param[in]     max    Maximum value of the parsed number.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int time_parser_add(
+	syslog_time_parser_t *parser,
+	unsigned char type,
+	unsigned char arg,
+	unsigned char target,
+	short min,
+	short max
+)
+{
+	syslog_time_op_t *op;
+
+	if (parser->ops_n == SYSLOG_TIME_MAX_OPS)
+		return -ENOSPC;
+
+	op = &parser->ops[parser->ops_n++];
+
+	op->type   = type;
+	op->arg    = arg;
+	op->target = target;
+	op->min    = min;
+	op->max    = max;
+
+	return 0;
+}
+
+/**
+ * Compile timestamp parsing format specification
+ *
+ * @param[in,out] parser Pointer to the parser data structure.
+ * @param[in]     spec   Timestamp parsing format specification.
+ *
+ * @return 0 on success
+ * @return <0 if specification can't be compiled
+ */
+static int time_parser_compile(
+	syslog_time_parser_t *parser,
+	const char *spec
+)
+{
+	int ret = 0;
+	const char *p;
+
+	for (p = spec; *p && !ret; p++)
+	{
+		if (isspace(*p))
+		{
+			/* Sequence of spaces matches any number of spaces */
+			if (!parser->ops_n ||
+			    (parser->ops[parser->ops_n - 1].type != TIME_OP_SPACE))
+				ret = time_parser_add(parser, TIME_OP_SPACE, 0, 0, 0, 0);
+
+			continue;
+		}
+
+		if (*p != '%')
+		{
+			ret = time_parser_add(parser, TIME_OP_CHAR, *p, 0, 0, 0);
+			continue;
+		}
+
+		switch(*(++p))
+		{
+			case 'a':
+			case 'A':
+				ret = time_parser_add(parser, TIME_OP_WDAY, 0, 0, 0, 0);
+				break;
+
+			case 'b':
+			case 'B':
+			case 'h':
+				ret = time_parser_add(parser, TIME_OP_MONTH, 0, 0, 0, 0);
+				break;
+
+			case 'd':
+			case 'e':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 2,
+					TIME_TARGET_MDAY, 1, 31);
+				break;
+
+			case 'm':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 2,
+					TIME_TARGET_MON, 1, 12);
+				break;
+
+			case 'H':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 2,
+					TIME_TARGET_HOUR, 0, 23);
+				break;
+
+			case 'M':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 2,
+					TIME_TARGET_MIN, 0, 59);
+				break;
+
+			case 'S':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 2,
+					TIME_TARGET_SEC, 0, 61);
+				break;
+
+			case 'Y':
+				ret = time_parser_add(parser, TIME_OP_NUMBER, 4,
+					TIME_TARGET_YEAR, 0, 9999);
+				break;
+
+			case 'T':
+				ret = time_parser_compile(parser, "%H:%M:%S");
+				break;
+
+			case 'R':
+				ret = time_parser_compile(parser, "%H:%M");
+				break;
+
+			case 'F':
+				ret = time_parser_compile(parser, "%Y-%m-%d");
+				break;
+
+			case 'n':
+			case 't':
+				ret = time_parser_add(parser, TIME_OP_SPACE, 0, 0, 0, 0);
+				break;
+
+			case '%':
+				ret = time_parser_add(parser, TIME_OP_CHAR, '%', 0, 0, 0);
+				break;
+
+			default:
+				/* Unsupported conversion specification */
+				return -ENOTSUP;
+		}
+	}
+
+	return ret;
+}
+
+void syslog_time_parser_init(
+	syslog_time_parser_t *parser,
+	const char *spec
+)
+{
+	unsigned int i;
+
+	assert(parser);
+	assert(spec);
+
+	memset(parser, 0, sizeof(syslog_time_parser_t));
+
+	parser->spec = spec;
+
+	if (time_parser_compile(parser, spec))
+		parser->fallback = 1;
+
+	for (i = 0; i < SYSLOG_TIME_CACHE_SIZE; i++)
+		parser->days[i].key = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Match day of the week name case-insensitively
+ *
+ * Longest matched full or abbreviated name wins. The glibc strptime()
+ * advances its input pointer after each matched abbreviated name and
+ * continues matching the following names from there (so "MonSaturday"
+ * is matched as a whole). This behaviour is reproduced here to keep
+ * results the same.
+ *
+ * @param[in,out] data  Pointer to the data to parse.
+ *
+ * @return Day of the week
+ * @return <0 if no name is matched
+ */
+static int time_match_wday(const char **data)
+{
+	int i;
+	int wday = -1;
+	const char *p = *data;
+	const char *longest = *data;
+
+	for (i = 0; i < ARRAY_SIZE(time_wday_names); i++)
+	{
+		size_t len = strlen(time_wday_names[i]);
+
+		if (tolower(*p) != tolower(time_wday_names[i][0]))
+			continue;
+
+		if (!strncasecmp(p, time_wday_names[i], len) && (p + len > longest))
+		{
+			longest = p + len;
+			wday = i;
+		}
+
+		if (!strncasecmp(p, time_wday_names[i], 3))
+		{
+			if (p + 3 > longest)
+			{
+				longest = p + 3;
+				wday = i;
+			}
+
+			p += 3;
+		}
+	}
+
+	*data = longest;
+	return wday;
+}
+
+/**
+ * Match month name case-insensitively
+ *
+ * Full names are matched first, then abbreviated (first three
+ * characters) names are matched.
+ *
+ * @param[in,out] data  Pointer to the data to parse.
+ *
+ * @return Month (0-11)
+ * @return <0 if no name is matched
+ */
+static int time_match_month(const char **data)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(time_month_names); i++)
+	{
+		size_t len = strlen(time_month_names[i]);
+
+		if (!strncasecmp(*data, time_month_names[i], len))
+		{
+			*data += len;
+			return i;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(time_month_names); i++)
+	{
+		if (!strncasecmp(*data, time_month_names[i], 3))
+		{
+			*data += 3;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+char *syslog_time_parse(
+	const syslog_time_parser_t *parser,
+	const char *data,
+	struct tm *tm
+)
+{
+	unsigned int i;
+	const char *p = data;
+
+	assert(parser);
+	assert(data);
+	assert(tm);
+
+	if (parser->fallback)
+		return strptime(data, parser->spec, tm);
+
+	for (i = 0; i < parser->ops_n; i++)
+	{
+		const syslog_time_op_t *op = &parser->ops[i];
+
+		switch(op->type)
+		{
+			case TIME_OP_CHAR:
+				if (*p++ != (char)op->arg)
+					return NULL;
+
+				break;
+
+			case TIME_OP_SPACE:
+				while (isspace(*p))
+					p++;
+
+				break;
+
+			case TIME_OP_WDAY:
+			{
+				int wday = time_match_wday(&p);
+
+				if (wday < 0)
+					return NULL;
+
+				tm->tm_wday = wday;
+				break;
+			}
+
+			case TIME_OP_MONTH:
+			{
+				int mon = time_match_month(&p);
+
+				if (mon < 0)
+					return NULL;
+
+				tm->tm_mon = mon;
+				break;
+			}
+
+			case TIME_OP_NUMBER:
+			{
+				int val = 0;
+				int n = op->arg;
+
+				while (isspace(*p))
+					p++;
+
+				if ((*p < '0') || (*p > '9'))
+					return NULL;
+
+				do
+					val = val * 10 + (*p++ - '0');
+				while ((--n > 0) && (val * 10 <= op->max) &&
+				       (*p >= '0') && (*p <= '9'));
+
+				if ((val < op->min) || (val > op->max))
+					return NULL;
+
+				switch(op->target)
+				{
+					case TIME_TARGET_MDAY: tm->tm_mday = val;        break;
+					case TIME_TARGET_MON:  tm->tm_mon  = val - 1;    break;
+					case TIME_TARGET_HOUR: tm->tm_hour = val;        break;
+					case TIME_TARGET_MIN:  tm->tm_min  = val;        break;
+					case TIME_TARGET_SEC:  tm->tm_sec  = val;        break;
+					case TIME_TARGET_YEAR: tm->tm_year = val - 1900; break;
+				}
+
+				break;
+			}
+		}
+	}
+
+	return (char *)p;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get number of days in month
+ *
+ * @param[in] year  Year (since 1900).
+ * @param[in] mon   Month (0-11).
+ *
+ * @return Number of days in month
+ */
+static int time_month_days(int year, int mon)
+{
+	static const int days[] =
+		{ 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	year += 1900;
+
+	if ((mon == 1) &&
+	    (((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0)))
+		return 29;
+
+	return days[mon];
+}
+
+/**
+ * Fill local time conversion cache item for the day
+ *
+ * Day can be cached only if there are no daylight saving
+ * time transitions during the day.
+ *
+ * @param[out] day  Pointer to the cache item.
+ * @param[in]  tm   Pointer to the date/time structure.
+ * @param[in]  key  Day key.
+ */
+static void time_day_init(
+	syslog_time_day_t *day,
+	const struct tm *tm,
+	long key
+)
+{
+	struct tm day_start = { 0 };
+	struct tm day_end;
+	time_t end;
+
+	day_start.tm_year  = tm->tm_year;
+	day_start.tm_mon   = tm->tm_mon;
+	day_start.tm_mday  = tm->tm_mday;
+	day_start.tm_isdst = -1;
+
+	day_end = day_start;
+	day_end.tm_hour = 23;
+	day_end.tm_min  = 59;
+	day_end.tm_sec  = 59;
+
+	day->key   = key;
+	day->start = mktime(&day_start);
+	end        = mktime(&day_end);
+
+	day->valid =
+		(day->start != (time_t)-1) &&
+		(end - day->start == 86399) &&
+		(day_start.tm_isdst == day_end.tm_isdst) &&
+		(day_start.tm_gmtoff == day_end.tm_gmtoff) &&
+		(day_start.tm_mday == tm->tm_mday) &&
+		(day_start.tm_hour == 0);
+
+	day->wday   = day_start.tm_wday;
+	day->yday   = day_start.tm_yday;
+	day->isdst  = day_start.tm_isdst;
+	day->gmtoff = day_start.tm_gmtoff;
+	day->zone   = day_start.tm_zone;
+}
+
+time_t syslog_time_local(
+	syslog_time_parser_t *parser,
+	struct tm *tm
+)
+{
+	syslog_time_day_t *day;
+	long key;
+
+	assert(parser);
+	assert(tm);
+
+	/* Only normalized date/time values can be cached */
+	if ((tm->tm_sec  < 0) || (tm->tm_sec  > 59) ||
+	    (tm->tm_min  < 0) || (tm->tm_min  > 59) ||
+	    (tm->tm_hour < 0) || (tm->tm_hour > 23) ||
+	    (tm->tm_mon  < 0) || (tm->tm_mon  > 11) ||
+	    (tm->tm_year < 0) || (tm->tm_year > 8099) ||
+	    (tm->tm_mday < 1) ||
+	    (tm->tm_mday > time_month_days(tm->tm_year, tm->tm_mon)))
+		return timelocal(tm);
+
+	key = ((long)tm->tm_year * 12 + tm->tm_mon) * 31 + tm->tm_mday - 1;
+	day = &parser->days[key % SYSLOG_TIME_CACHE_SIZE];
+
+	if (day->key != key)
+		time_day_init(day, tm, key);
+
+	/*
+	 * Daylight saving time flag passed to mktime() affects
+	 * the result if it differs from the actual one
+	 */
+	if (!day->valid ||
+	    ((tm->tm_isdst >= 0) && (!tm->tm_isdst != !day->isdst)))
+		return timelocal(tm);
+
+	tm->tm_wday   = day->wday;
+	tm->tm_yday   = day->yday;
+	tm->tm_isdst  = day->isdst;
+	tm->tm_gmtoff = day->gmtoff;
+	tm->tm_zone   = day->zone;
+
+	return day->start + tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec;
+}
+
+/* ----------------------------------------------------------------------- */
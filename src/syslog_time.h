@@ -0,0 +1,165 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Syslog timestamp parser header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_TIME_H__
+#define __SYSLOG_TIME_H__
+
+#include <time.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Maximum number of operations in compiled timestamp parser */
+#define SYSLOG_TIME_MAX_OPS  32
+
+/** @brief Number of days in the local time conversion cache */
+#define SYSLOG_TIME_CACHE_SIZE  16
+
+/**
+ * @brief Timestamp parser operation
+ */
+typedef struct syslog_time_op
+{
+	/** Operation type */
+	unsigned char type;
+
+	/** Character to match or number of digits */
+	unsigned char arg;
+
+	/** Target field of the parsed number */
+	unsigned char target;
+
+	/** Minimum value of the parsed number */
+	short min;
+
+	/** Maximum value of the parsed number */
+	short max;
+
+} syslog_time_op_t;
+
+/**
+ * @brief Local time conversion cache item for single calendar day
+ */
+typedef struct syslog_time_day
+{
+	/** Day key (year, month and day of month) */
+	long key;
+
+	/** Conversion results for this day can be cached */
+	int valid;
+
+	/** Unix timestamp of the day start */
+	time_t start;
+
+	/** Day of the week */
+	int wday;
+
+	/** Day of the year */
+	int yday;
+
+	/** Daylight saving time flag */
+	int isdst;
+
+	/** Offset from UTC in seconds */
+	long gmtoff;
+
+	/** Timezone abbreviation */
+	const char *zone;
+
+} syslog_time_day_t;
+
+/**
+ * @brief Timestamp parser data structure
+ *
+ * Timestamp parsing format specification is compiled into the
+ * array of simple operations for the commonly used conversion
+ * specifications (%a, %A, %b, %B, %h, %d, %e, %m, %H, %M, %S, %Y,
+ * %T, %R, %F, %n, %t and %%). Any other specification is parsed
+ * by the strptime() function.
+ *
+ * Local time conversion is memoized per calendar day.
+ */
+typedef struct syslog_time_parser
+{
+	/** Timestamp parsing format specification */
+	const char *spec;
+
+	/** Specification is not compiled, strptime() is used */
+	int fallback;
+
+	/** Compiled operations */
+	syslog_time_op_t ops[SYSLOG_TIME_MAX_OPS];
+
+	/** Number of compiled operations */
+	unsigned int ops_n;
+
+	/** Local time conversion cache */
+	syslog_time_day_t days[SYSLOG_TIME_CACHE_SIZE];
+
+} syslog_time_parser_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize timestamp parser
+ *
+ * @param[out] parser Pointer to the parser data structure.
+ * @param[in]  spec   Timestamp parsing format specification
+ *                    (strptime() format).
+ */
+void syslog_time_parser_init(
+	syslog_time_parser_t *parser,
+	const char *spec
+);
+
+/**
+ * Parse timestamp
+ *
+ * Works exactly as the strptime() function with the format
+ * specification given to syslog_time_parser_init(). Fields of
+ * @p tm that are not specified by format are not modified.
+ *
+ * @param[in]     parser Pointer to the parser data structure.
+ * @param[in]     data   Pointer to the NULL-terminated string to parse.
+ * @param[in,out] tm     Pointer to the date/time structure.
+ *
+ * @return Pointer to the first character not processed
+ * @return NULL on error
+ */
+char *syslog_time_parse(
+	const syslog_time_parser_t *parser,
+	const char *data,
+	struct tm *tm
+);
+
+/**
+ * Convert local date/time into Unix timestamp
+ *
+ * Works exactly as the timelocal() function, but uses the
+ * per day cache of conversion results.
+ *
+ * @param[in,out] parser Pointer to the parser data structure.
+ * @param[in,out] tm     Pointer to the date/time structure.
+ *
+ * @return Unix timestamp
+ */
+time_t syslog_time_local(
+	syslog_time_parser_t *parser,
+	struct tm *tm
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_TIME_H__ */
@@ -0,0 +1,586 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Approximate top values and distinct counts source
+ *
+ * Values of each specified field are added to the fixed-size sketches:
+ * Space-Saving summary of the top values, Count-Min sketch, which bounds
+ * the overestimated Space-Saving counts, and HyperLogLog distinct values
+ * counter. So memory usage does not depend on the input size.
+ *
+ * Messages are also summarized by their templates (see
+ * syslog_templates_add()). Template indices are counted and replaced by
+ * the template strings on output. Templates are mined in the input order,
+ * so the entries are counted by the main thread in this case.
+ *
+ * Worker threads of the multi-threaded conversion add entries to the
+ * sketches of their chunk outputs, which are merged into the main
+ * thread sketches by the main thread in the input order, so the results
+ * are the same for each run.
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+
+#include <syslog_fc.h>
+#include <syslog_sketch.h>
+#include <syslog_templates.h>
+#include <syslog_top.h>
+
+/** @brief Maximum number of the fields */
+#define SYSLOG_TOP_MAX_KEYS  6
+
+/**
+ * @brief Sketches of the field values
+ */
+typedef struct syslog_top_sketch
+{
+	/** Distinct values counter */
+	syslog_hll_t hll;
+
+	/** Values occurrences counters */
+	syslog_cms_t cms;
+
+	/** Top values */
+	syslog_topk_t topk;
+
+} syslog_top_sketch_t;
+
+/**
+ * @brief Top values data structure
+ */
+typedef struct syslog_top
+{
+	/** Output format of the results */
+	const output_fmt_t *output_fmt;
+
+	/** Fields in the specification order */
+	syslog_field_id_t keys[SYSLOG_TOP_MAX_KEYS];
+
+	/** Number of the output top values of the fields */
+	unsigned int top_n[SYSLOG_TOP_MAX_KEYS];
+
+	/** Number of the fields */
+	unsigned int keys_n;
+
+	/** Key index of the fields by the field identifiers (-1 if not a key) */
+	int key_slots[SYSLOG_FIELD_ID_LAST + 1];
+
+	/** Message templates are mined */
+	int templates;
+
+	/** Sketches of the main thread (one per field) */
+	syslog_top_sketch_t *sketches;
+
+	/** Main thread */
+	pthread_t main_thread;
+
+	/** Result entry */
+	syslog_entry_t result;
+
+} syslog_top_t;
+
+/** @brief Top values data */
+static syslog_top_t top;
+
+/**
+ * @brief Fields
+ */
+static const struct
+{
+	const char *name;       /**< Name in the specification */
+	syslog_field_id_t id;   /**< Field identifier */
+	const char *spec;       /**< Entry specificator */
+
+} top_keys[] =
+{
+	{ "facility", SYSLOG_FIELD_ID_FACILITY, "%F" },
+	{ "priority", SYSLOG_FIELD_ID_PRIORITY, "%P" },
+	{ "tag",      SYSLOG_FIELD_ID_TAG,      "%G" },
+	{ "hostname", SYSLOG_FIELD_ID_HOSTNAME, "%H" },
+	{ "message",  SYSLOG_FIELD_ID_MESSAGE,  "%M" },
+	{ "template", SYSLOG_FIELD_ID_TEMPLATE, "%M" },
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Parse top values specification
+ *
+ * @param[in] spec  Top values specification.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int top_parse_spec(const char *spec)
+{
+	char *copy = strdup(spec);
+	char *saveptr = NULL;
+	char *token;
+	char *arg;
+	int ret = 0;
+	int i;
+
+	if (!copy)
+		return -ENOMEM;
+
+	for (token = strtok_r(copy, ",", &saveptr); token;
+	     token = strtok_r(NULL, ",", &saveptr))
+	{
+		unsigned long n = SYSLOG_TOP_DEFAULT_N;
+
+		arg = strchr(token, ':');
+		if (arg)
+		{
+			char *end;
+
+			*arg++ = 0;
+			n = strtoul(arg, &end, 10);
+
+			if (!isdigit((unsigned char)*arg) || *end ||
+			    !n || (n > SYSLOG_TOPK_CAPACITY))
+			{
+				fprintf(stderr, "Invalid number of top values '%s' "
+					"(1-%d)\n", arg, SYSLOG_TOPK_CAPACITY);
+
+				ret = -EINVAL;
+				break;
+			}
+		}
+
+		for (i = 0; i < ARRAY_SIZE(top_keys); i++)
+		{
+			if (!strcmp(token, top_keys[i].name))
+				break;
+		}
+
+		if (i == ARRAY_SIZE(top_keys))
+		{
+			fprintf(stderr, "Invalid top values field '%s'\n", token);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (top.key_slots[top_keys[i].id] >= 0)
+		{
+			fprintf(stderr, "Duplicate top values field '%s'\n", token);
+			ret = -EINVAL;
+			break;
+		}
+
+		top.key_slots[top_keys[i].id] = top.keys_n;
+		top.top_n[top.keys_n] = n;
+		top.keys[top.keys_n++] = top_keys[i].id;
+	}
+
+	if (!ret && !top.keys_n)
+	{
+		fprintf(stderr, "Top values fields are not specified\n");
+		ret = -EINVAL;
+	}
+
+	free(copy);
+	return ret;
+}
+
+/**
+ * Get sketches of the output
+ *
+ * Worker outputs of the multi-threaded conversion get the sketches
+ * of their own (see syslog_top_output_merge()).
+ *
+ * @param[in,out] out  Pointer to the output structure.
+ *
+ * @return Pointer to the sketches or NULL on error
+ */
+static syslog_top_sketch_t *top_output_sketches(syslog_output_t *out)
+{
+	if (out->fmt_data)
+		return out->fmt_data;
+
+	if (pthread_equal(pthread_self(), top.main_thread))
+		return top.sketches;
+
+	out->fmt_data = calloc(top.keys_n, sizeof(syslog_top_sketch_t));
+	return out->fmt_data;
+}
+
+/**
+ * Add value to the sketches
+ *
+ * @param[in,out] sketch  Pointer to the sketches of the field.
+ * @param[in]     hash    Value hash.
+ * @param[in]     string  Value.
+ * @param[in]     len     Value length.
+ */
+static void top_add(
+	syslog_top_sketch_t *sketch,
+	uint64_t hash,
+	const char *string,
+	size_t len
+)
+{
+	syslog_hll_add(&sketch->hll, hash);
+	syslog_cms_add(&sketch->cms, hash, 1);
+	syslog_topk_add(&sketch->topk, hash, string, len);
+}
+
+/**
+ * Add message template of the entry to the sketches
+ *
+ * Template is counted by its index, as the template string may change.
+ *
+ * @param[in,out] sketch  Pointer to the sketches of the templates.
+ * @param[in]     entry   Pointer to the entry data structure.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+static int top_add_template(
+	syslog_top_sketch_t *sketch,
+	const syslog_entry_t *entry
+)
+{
+	char value[16];
+	int index;
+	int len;
+
+	index = syslog_templates_add(entry);
+	if (index < 0)
+		return index;
+
+	len = snprintf(value, sizeof(value), "%d", index);
+	top_add(sketch, syslog_sketch_hash(value, len), value, len);
+	return 0;
+}
+
+/**
+ * Compare top values in the output order (number of occurrences
+ * descending, value)
+ */
+static int top_item_cmp(const void *a, const void *b)
+{
+	const syslog_topk_item_t *ia = a;
+	const syslog_topk_item_t *ib = b;
+
+	if (ia->count != ib->count)
+		return (ia->count > ib->count) ? -1 : 1;
+
+	return strcmp(ia->value, ib->value);
+}
+
+/**
+ * Free all allocated resources
+ */
+static void top_free(void)
+{
+	syslog_entry_destroy(&top.result);
+	free(top.sketches);
+
+	if (top.templates)
+		syslog_templates_free();
+
+	memset(&top, 0, sizeof(top));
+}
+
+/* ----------------------------------------------------------------------- */
+
+int syslog_top_init(
+	const char *spec,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+)
+{
+	static const syslog_field_id_t ids[] =
+	{
+		SYSLOG_FIELD_ID_KEY,
+		SYSLOG_FIELD_ID_DISTINCT,
+		SYSLOG_FIELD_ID_VALUE,
+		SYSLOG_FIELD_ID_COUNT,
+		SYSLOG_FIELD_ID_ERROR,
+	};
+
+	unsigned int i, j;
+	int ret;
+
+	assert(spec);
+	assert(entry);
+	assert(output_fmt);
+
+	memset(&top, 0, sizeof(top));
+	top.output_fmt = output_fmt;
+
+	for (i = 0; i < ARRAY_SIZE(top.key_slots); i++)
+		top.key_slots[i] = -1;
+
+	ret = top_parse_spec(spec);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < top.keys_n; i++)
+	{
+		syslog_field_id_t id = (top.keys[i] == SYSLOG_FIELD_ID_TEMPLATE)
+			? SYSLOG_FIELD_ID_MESSAGE : top.keys[i];
+
+		for (j = 0; top_keys[j].id != top.keys[i]; j++)
+			;
+
+		if (!syslog_entry_has_field(entry, id))
+		{
+			fprintf(stderr, "Top values of %s require field %s "
+				"in the entry specification\n",
+				top_keys[j].name, top_keys[j].spec);
+
+			return -EINVAL;
+		}
+	}
+
+	ret = syslog_entry_init_fields(&top.result, ids, ARRAY_SIZE(ids));
+	if (ret)
+	{
+		syslog_entry_destroy(&top.result);
+		return ret;
+	}
+
+	top.sketches = calloc(top.keys_n, sizeof(syslog_top_sketch_t));
+	if (!top.sketches)
+	{
+		syslog_entry_destroy(&top.result);
+		return -ENOMEM;
+	}
+
+	/* Templates are mined by the main thread in the input order */
+	if (top.key_slots[SYSLOG_FIELD_ID_TEMPLATE] >= 0)
+	{
+		ret = syslog_templates_init(entry, NULL, 0);
+		if (ret)
+		{
+			top_free();
+			return ret;
+		}
+
+		top.templates = 1;
+		syslog_top_fmt.flags |= OUTPUT_FMT_FLAG_SEQUENTIAL;
+	}
+	else
+		syslog_top_fmt.flags &= ~OUTPUT_FMT_FLAG_SEQUENTIAL;
+
+	top.main_thread = pthread_self();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_top_output_init(const syslog_entry_t *entry)
+{
+	(void)entry;
+
+	if (top.output_fmt->fn_output_init)
+		top.output_fmt->fn_output_init(&top.result);
+}
+
+static void syslog_top_output_entry(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	syslog_top_sketch_t *sketches = top_output_sketches(out);
+	syslog_field_t *field;
+	const char *string;
+	uint64_t hash;
+	size_t len;
+	int slot;
+
+	if (!sketches)
+	{
+		if (!out->error)
+			out->error = -ENOMEM;
+
+		return;
+	}
+
+	for (field = entry->fields; field; field = field->next)
+	{
+		slot = top.key_slots[field->info->id];
+		if (slot < 0)
+			continue;
+
+		string = field->value.string ? field->value.string : "";
+
+		/* Tags are counted without "[pid]" suffix */
+		if (field->info->id == SYSLOG_FIELD_ID_TAG)
+			len = strcspn(string, "[");
+		else
+			len = strlen(string);
+
+		hash = syslog_sketch_hash(string, len);
+
+		top_add(&sketches[slot], hash, string, len);
+	}
+
+	slot = top.key_slots[SYSLOG_FIELD_ID_TEMPLATE];
+	if (slot >= 0)
+	{
+		int ret = top_add_template(&sketches[slot], entry);
+		if (ret && !out->error)
+			out->error = ret;
+	}
+}
+
+static void syslog_top_output_merge(
+	syslog_output_t *out,
+	syslog_output_t *worker_out
+)
+{
+	syslog_top_sketch_t *sketches = worker_out->fmt_data;
+	unsigned int i;
+
+	(void)out;
+
+	if (!sketches)
+		return;
+
+	for (i = 0; i < top.keys_n; i++)
+	{
+		syslog_hll_merge(&top.sketches[i].hll, &sketches[i].hll);
+		syslog_cms_merge(&top.sketches[i].cms, &sketches[i].cms);
+		syslog_topk_merge(&top.sketches[i].topk, &sketches[i].topk);
+	}
+
+	free(sketches);
+	worker_out->fmt_data = NULL;
+}
+
+static void syslog_top_output_end(
+	syslog_output_t *out,
+	const syslog_entry_t *entry
+)
+{
+	const output_fmt_t *fmt = top.output_fmt;
+	syslog_entry_t *result = &top.result;
+	syslog_field_t *field;
+	unsigned int i, j, k;
+
+	(void)entry;
+
+	result->num = 0;
+
+	if (fmt->fn_output_start)
+		fmt->fn_output_start(out, result);
+
+	for (i = 0; i < top.keys_n; i++)
+	{
+		syslog_top_sketch_t *sketch = &top.sketches[i];
+		syslog_topk_t *topk = &sketch->topk;
+		uint64_t distinct;
+
+		/* Summary, which is not full, monitors all values */
+		if (topk->items_n < SYSLOG_TOPK_CAPACITY)
+			distinct = topk->items_n;
+		else
+		{
+			distinct = syslog_hll_count(&sketch->hll);
+			if (distinct < topk->items_n)
+				distinct = topk->items_n;
+		}
+
+		/* Both Space-Saving and Count-Min counts are never less
+		 * than the real ones, so the least of them is used */
+		for (j = 0; j < topk->items_n; j++)
+		{
+			syslog_topk_item_t *item = &topk->items[j];
+			uint64_t lower = item->count - item->error;
+			uint64_t count = syslog_cms_estimate(&sketch->cms, item->hash);
+
+			if (item->count > count)
+				item->count = count;
+
+			item->error = item->count - lower;
+		}
+
+		qsort(topk->items, topk->items_n, sizeof(syslog_topk_item_t),
+			top_item_cmp);
+
+		for (k = 0; k < ARRAY_SIZE(top_keys); k++)
+		{
+			if (top_keys[k].id == top.keys[i])
+				break;
+		}
+
+		for (j = 0; (j < topk->items_n) && (j < top.top_n[i]); j++)
+		{
+			const syslog_topk_item_t *item = &topk->items[j];
+			const char *value = item->value;
+
+			if (top.keys[i] == SYSLOG_FIELD_ID_TEMPLATE)
+			{
+				value = syslog_templates_string(atoi(item->value));
+				if (!value)
+				{
+					out->error = -ENOMEM;
+					break;
+				}
+			}
+
+			for (field = result->fields; field; field = field->next)
+			{
+				switch(field->info->id)
+				{
+					case SYSLOG_FIELD_ID_KEY:
+						field->value.string = (char *)top_keys[k].name;
+						break;
+
+					case SYSLOG_FIELD_ID_DISTINCT:
+						field->value.uinteger = distinct;
+						break;
+
+					case SYSLOG_FIELD_ID_VALUE:
+						field->value.string = (char *)value;
+						break;
+
+					case SYSLOG_FIELD_ID_COUNT:
+						field->value.uinteger = item->count;
+						break;
+
+					case SYSLOG_FIELD_ID_ERROR:
+						field->value.uinteger = item->error;
+						break;
+
+					default:
+						break;
+				}
+			}
+
+			result->num++;
+
+			if (fmt->fn_output_entry)
+				fmt->fn_output_entry(out, result);
+		}
+	}
+
+	if (fmt->fn_output_end)
+		fmt->fn_output_end(out, result);
+
+	top_free();
+}
+
+output_fmt_t syslog_top_fmt =
+{
+	.name              = "top",
+	.description       = "Approximate top values and distinct counts",
+	.flags             = OUTPUT_FMT_FLAG_NOAPPEND,
+	.fn_output_init    = syslog_top_output_init,
+	.fn_output_entry   = syslog_top_output_entry,
+	.fn_output_end     = syslog_top_output_end,
+	.fn_output_merge   = syslog_top_output_merge
+};
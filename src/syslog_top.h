@@ -0,0 +1,63 @@
+/*
+ * Syslog File Converter
+ * Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Approximate top values and distinct counts header
+ *
+ * @author Anton Kikin <a.kikin@tano-systems.com>
+ */
+
+#ifndef __SYSLOG_TOP_H__
+#define __SYSLOG_TOP_H__
+
+#include <syslog_fc.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Top values output format
+ *
+ * Entries passed to the entry output callback are added to the sketches
+ * instead of output. Top values are output at the end of the conversion
+ * as entries of the output format passed to syslog_top_init().
+ */
+extern output_fmt_t syslog_top_fmt;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Initialize top values summary
+ *
+ * Top values specification is the comma-separated list of the fields
+ * ("facility", "priority", "tag", "hostname", "message" and "template"),
+ * each optionally followed by ":<N>" with the number of the output top
+ * values. Messages are summarized by the message templates for the
+ * "template" field.
+ * For each field the number of distinct values and the top values with
+ * the estimated number of occurrences are output.
+ *
+ * @param[in] spec        Top values specification.
+ * @param[in] entry       Pointer to the entry data structure used for
+ *                        parsing (must have all specified fields, message
+ *                        field for the "template" field).
+ * @param[in] output_fmt  Output format of the top values.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int syslog_top_init(
+	const char *spec,
+	const syslog_entry_t *entry,
+	const output_fmt_t *output_fmt
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* __SYSLOG_TOP_H__ */
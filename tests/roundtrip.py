@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+#
+# Syslog File Converter
+# Copyright © 2019-2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Round-trip test of the MessagePack and CBOR output formats
+#
+# Entries decoded by the reference decoders (python msgpack and cbor2
+# modules) must be equal to the entries of the ndjson output. Test is
+# skipped (exit code 77) if the decoders are not installed.
+#
+# Usage: roundtrip.py <syslog_fc binary>
+#
+
+import io
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+try:
+	import cbor2
+	import msgpack
+except ImportError as e:
+	print("SKIP: %s" % e)
+	sys.exit(77)
+
+MESSAGES = [
+	b"short message",
+	b"utf-8 \xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 \xe2\x82\xac",
+	b"invalid utf-8 \xff\xfe\xc3",
+	b"control \x01\x1f bytes and \"quotes\" \\ and \ttab",
+	b"str8 " + b"x" * 200,
+	b"str16 " + b"y" * 1000,
+	b"str32 " + b"z" * 70000,
+	b"",
+]
+
+TAGS = [b"kernel", b"sshd[1234]", b"cron[1]", b"\xd1\x82\xd1\x8d\xd0\xb3"]
+LEVELS = [b"kern.notice", b"daemon.err", b"auth.info", b"user.debug"]
+
+# Numeric identifier of the entry is prepended to the lines with %I
+RUNS = [
+	[],
+	["-t", "2"],
+	["--stats", "facility,priority"],
+	["--top", "tag"],
+	["--dedup"],
+	["-e", "%I %T %F.%P %G: %_M"],
+]
+
+
+def generate(path, with_id):
+	with open(path, "wb") as f:
+		for i in range(3000):
+			message = MESSAGES[i % len(MESSAGES)]
+
+			if with_id:
+				f.write(b"%d " % (i * 1000003))
+
+			f.write(b"Fri Jun 28 %02d:%02d:%02d 2019 %s %s: %s\n" % (
+				i // 3600 % 24, i // 60 % 60, i % 60,
+				LEVELS[i % len(LEVELS)], TAGS[i % len(TAGS)], message))
+
+
+def convert(binary, fmt, args, path):
+	return subprocess.run([binary, "-f", fmt, "-o", ""] + args + [path],
+		stdout=subprocess.PIPE, check=True).stdout
+
+
+def normalize(value):
+	# Invalid UTF-8 strings are output as binary values and as raw bytes
+	# in the ndjson output
+	if isinstance(value, bytes):
+		return value.decode("utf-8", "surrogateescape")
+
+	# Timestamps are integers, ndjson outputs them as strings
+	if isinstance(value, int):
+		return str(value)
+
+	return value
+
+
+def decode_ndjson(data):
+	entries = []
+
+	for line in data.split(b"\n"):
+		if not line:
+			continue
+
+		# Control characters must be escaped in ndjson lines
+		entry = json.loads(line.decode("utf-8", "surrogateescape"))
+
+		entries.append({k: normalize(v) for k, v in entry.items()})
+
+	return entries
+
+
+def decode_msgpack(data):
+	unpacker = msgpack.Unpacker(io.BytesIO(data), raw=False,
+		max_buffer_size=len(data) + 1)
+
+	return [{k: normalize(v) for k, v in entry.items()} for entry in unpacker]
+
+
+def decode_cbor(data):
+	stream = io.BytesIO(data)
+	entries = []
+
+	while stream.tell() < len(data):
+		entry = cbor2.load(stream)
+		entries.append({k: normalize(v) for k, v in entry.items()})
+
+	return entries
+
+
+def main():
+	binary = sys.argv[1]
+	failed = 0
+
+	with tempfile.TemporaryDirectory() as tmp:
+		for args in RUNS:
+			path = os.path.join(tmp, "input.log")
+			generate(path, "%I" in " ".join(args))
+
+			expected = decode_ndjson(convert(binary, "ndjson", args, path))
+
+			for fmt, decode in (("msgpack", decode_msgpack),
+			                    ("cbor", decode_cbor)):
+				entries = decode(convert(binary, fmt, args, path))
+
+				if entries != expected:
+					failed += 1
+					print("FAIL: %s %s" % (fmt, " ".join(args)))
+				else:
+					print("OK: %s %s (%d entries)" % (
+						fmt, " ".join(args), len(entries)))
+
+	return 1 if failed else 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())